@@ -3,6 +3,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "bet.h"
+#include "bettingdb.h"
+#include "checkqueue.h"
+#include "crypto/common.h"
+#include "limitedmap.h"
 #include <boost/filesystem.hpp>
 
 #include "wallet/wallet.h"
@@ -22,38 +26,113 @@
 #define PTE_OP_STRLEN 34
 
 
+// Oracle status of previously looked up prevouts, evicted oldest first.
+static limitedmap<COutPoint, std::pair<uint64_t, bool> > mapOracleTxCache(MAX_ORACLE_TX_CACHE_SIZE);
+static uint64_t nOracleTxCacheSequence = 0;
+static uint64_t nOracleTxCacheHits = 0;
+static uint64_t nOracleTxCacheMisses = 0;
+static CCriticalSection cs_oracleTxCache;
+
+/**
+ * Get the destinations of the oracle wallet addresses of the current network, decoded once.
+ * Requires cs_oracleTxCache.
+ *
+ * @return The oracle wallet destinations.
+ */
+static const std::set<CTxDestination>& GetOracleDestinations()
+{
+    static std::set<CTxDestination> setOracleDestinations;
+    static CBaseChainParams::Network oracleNetwork = CBaseChainParams::MAX_NETWORK_TYPES;
+
+    if (oracleNetwork != Params().NetworkID()) {
+        setOracleDestinations.clear();
+        for (const std::string& oracleAddr : Params().OracleWalletAddrs()) {
+            CBitcoinAddress address(oracleAddr);
+            if (address.IsValid())
+                setOracleDestinations.insert(address.Get());
+        }
+        oracleNetwork = Params().NetworkID();
+    }
+
+    return setOracleDestinations;
+}
+
 /**
  * Validate the transaction to ensure it has been posted by an oracle node.
  *
+ * The result is cached per prevout. Only prevouts whose transaction was found are cached, and a
+ * transaction id commits to the output script, so a cached result stays right across reorgs.
+ *
  * @param txin  TX vin input hash.
  * @return      Bool
  */
 bool IsValidOracleTx(const CTxIn &txin)
 {
     COutPoint prevout = txin.prevout;
-    std::vector<std::string> oracleAddrs = Params().OracleWalletAddrs();
+
+    {
+        LOCK(cs_oracleTxCache);
+        limitedmap<COutPoint, std::pair<uint64_t, bool> >::const_iterator it = mapOracleTxCache.find(prevout);
+        if (it != mapOracleTxCache.end()) {
+            nOracleTxCacheHits++;
+            return it->second.second;
+        }
+        nOracleTxCacheMisses++;
+    }
 
     uint256 hashBlock;
     CTransaction txPrev;
-    if (GetTransaction(prevout.hash, txPrev, hashBlock, true)) {
-
-        const CTxOut &prevTxOut = txPrev.vout[prevout.n];
-        std::string scriptPubKey = prevTxOut.scriptPubKey.ToString();
-
-        txnouttype type;
-        std::vector<CTxDestination> prevAddrs;
-        int nRequired;
+    if (!GetTransaction(prevout.hash, txPrev, hashBlock, true))
+        return false;
 
-        if (ExtractDestinations(prevTxOut.scriptPubKey, type, prevAddrs, nRequired)) {
-            for (const CTxDestination &prevAddr : prevAddrs) {
-                if (std::find(oracleAddrs.begin(), oracleAddrs.end(), CBitcoinAddress(prevAddr).ToString()) != oracleAddrs.end()) {
-                    return true;
-                }
+    txnouttype type;
+    std::vector<CTxDestination> prevAddrs;
+    int nRequired;
+    bool fExtracted = prevout.n < txPrev.vout.size() &&
+            ExtractDestinations(txPrev.vout[prevout.n].scriptPubKey, type, prevAddrs, nRequired);
+
+    LOCK(cs_oracleTxCache);
+    bool fOracle = false;
+    if (fExtracted) {
+        const std::set<CTxDestination>& setOracleDestinations = GetOracleDestinations();
+        for (const CTxDestination &prevAddr : prevAddrs) {
+            if (setOracleDestinations.count(prevAddr)) {
+                fOracle = true;
+                break;
             }
         }
     }
+    mapOracleTxCache.insert(std::make_pair(prevout, std::make_pair(nOracleTxCacheSequence++, fOracle)));
 
-    return false;
+    return fOracle;
+}
+
+/**
+ * Drop the cached oracle status of the outputs of a transaction, as when its block is disconnected.
+ *
+ * @param tx The transaction.
+ */
+void UncacheOracleTx(const CTransaction& tx)
+{
+    LOCK(cs_oracleTxCache);
+    uint256 hash = tx.GetHash();
+    for (unsigned int i = 0; i < tx.vout.size(); i++)
+        mapOracleTxCache.erase(COutPoint(hash, i));
+}
+
+/**
+ * Get the size and the hit and miss counts of the IsValidOracleTx() cache.
+ *
+ * @param nSize   The number of cached prevouts.
+ * @param nHits   The number of lookups answered by the cache.
+ * @param nMisses The number of lookups that had to read the previous transaction.
+ */
+void GetOracleTxCacheStats(size_t& nSize, uint64_t& nHits, uint64_t& nMisses)
+{
+    LOCK(cs_oracleTxCache);
+    nSize = mapOracleTxCache.size();
+    nHits = nOracleTxCacheHits;
+    nMisses = nOracleTxCacheMisses;
 }
 
 /**
@@ -125,14 +204,14 @@ int64_t GetCGBlockPayouts(std::vector<CBetOut>& vexpectedCGPayouts, CAmount& nMN
  * @param nHeight - The current chain height.
  * @return
  */
-bool IsBlockPayoutsValid(std::vector<CBetOut> vExpectedPayouts, CBlock block)
+bool IsBlockPayoutsValid(const std::vector<CBetOut>& vExpectedPayouts, const CBlock& block)
 {
     unsigned long size = vExpectedPayouts.size();
 
     // If we have payouts to validate.
     if (size > 0) {
 
-        CTransaction &tx = block.vtx[1];
+        const CTransaction &tx = block.vtx[1];
 
         // Get the vin staking value so we can use it to find out how many staking TX in the vouts.
         const CTxIn &txin         = tx.vin[0];
@@ -593,24 +672,12 @@ bool CPeerlessUpdateOdds::ToOpCode(CPeerlessUpdateOdds puo, std::string &opCode)
  * Updates a peerless event object with new money line odds.
  */
 void SetEventMLOdds (CPeerlessUpdateOdds puo) {
-    CEventDB edb;
-    eventIndex_t eventIndex;
-    edb.GetEvents(eventIndex);
-
-    // First check a peerless event exists in the event index.
-    if (eventIndex.count(puo.nEventId) > 0) {
-
-        // Get the event object from the index and update the money line odds values.
-        CPeerlessEvent plEvent = eventIndex.find(puo.nEventId)->second;
-
+    // Update the money line odds values of the event, if it exists in the event index.
+    CEventDB::UpdateEvent(puo.nEventId, [&puo](CPeerlessEvent &plEvent) {
         plEvent.nHomeOdds = puo.nHomeOdds;
         plEvent.nAwayOdds = puo.nAwayOdds;
         plEvent.nDrawOdds = puo.nDrawOdds;
-
-        // Update the event in the event index.
-        eventIndex[puo.nEventId] = plEvent;
-        CEventDB::SetEvents(eventIndex);
-    }
+    });
 }
 
 /**
@@ -847,24 +914,12 @@ bool CPeerlessSpreadsEvent::ToOpCode(CPeerlessSpreadsEvent pse, std::string &opC
  * Updates a peerless event object with spread odds for the given event ID.
  */
 void SetEventSpreadOdds (CPeerlessSpreadsEvent spreadEvent) {
-    CEventDB edb;
-    eventIndex_t eventIndex;
-    edb.GetEvents(eventIndex);
-
-    // First check a peerless event exists in the event index.
-    if (eventIndex.count(spreadEvent.nEventId) > 0) {
-
-        // Get the event object from the index and update the spread odds values.
-        CPeerlessEvent plEvent = eventIndex.find(spreadEvent.nEventId)->second;
-
+    // Update the spread odds values of the event, if it exists in the event index.
+    CEventDB::UpdateEvent(spreadEvent.nEventId, [&spreadEvent](CPeerlessEvent &plEvent) {
         plEvent.nSpreadPoints    = spreadEvent.nPoints;
         plEvent.nSpreadHomeOdds  = spreadEvent.nHomeOdds;
         plEvent.nSpreadAwayOdds  = spreadEvent.nAwayOdds;
-
-        // Update the event in the event index.
-        eventIndex[spreadEvent.nEventId] = plEvent;
-        CEventDB::SetEvents(eventIndex);
-    }
+    });
 }
 
 /**
@@ -932,24 +987,12 @@ bool CPeerlessTotalsEvent::ToOpCode(CPeerlessTotalsEvent pte, std::string &opCod
  * Updates a peerless event object with totals odds.
  */
 void SetEventTotalOdds (CPeerlessTotalsEvent totalsEvent) {
-    CEventDB edb;
-    eventIndex_t eventIndex;
-    edb.GetEvents(eventIndex);
-
-    // First check a peerless event exists in the event index.
-    if (eventIndex.count(totalsEvent.nEventId) > 0) {
-
-        // Get the event object from the index and update the totals odds values.
-        CPeerlessEvent plEvent = eventIndex.find(totalsEvent.nEventId)->second;
-
+    // Update the totals odds values of the event, if it exists in the event index.
+    CEventDB::UpdateEvent(totalsEvent.nEventId, [&totalsEvent](CPeerlessEvent &plEvent) {
         plEvent.nTotalPoints    = totalsEvent.nPoints;
         plEvent.nTotalOverOdds  = totalsEvent.nOverOdds;
         plEvent.nTotalUnderOdds = totalsEvent.nUnderOdds;
-
-        // Update the event in the event index.
-        eventIndex[totalsEvent.nEventId] = plEvent;
-        CEventDB::SetEvents(eventIndex);
-    }
+    });
 }
 
 
@@ -958,17 +1001,16 @@ void SetEventTotalOdds (CPeerlessTotalsEvent totalsEvent) {
  */
 void SetEventAccummulators (CPeerlessBet plBet, CAmount betAmount) {
 
-    CEventDB edb;
-    eventIndex_t eventsIndex;
-    edb.GetEvents(eventsIndex);
-
     uint64_t oddsDivisor  = Params().OddsDivisor();
     uint64_t betXPermille = Params().BetXPermille();
 
-    // Check the events index actually has events
-    if (eventsIndex.size() > 0) {
+    // The market of the bet and what it pays out in satoshis, for the liability book.
+    int nMarket = -1;
+    CAmount nMarketPayout = 0;
+    int nPushMarket = -1;
 
-        CPeerlessEvent pe = eventsIndex.find(plBet.nEventId)->second;
+    // Add to the accumulators of the event the bet was placed on, if the events index has it.
+    bool fEventFound = CEventDB::UpdateEvent(plBet.nEventId, [&](CPeerlessEvent &pe) {
         CAmount payout = 0 * COIN;
         CAmount burn = 0;
         CAmount winnings = 0;
@@ -982,6 +1024,8 @@ void SetEventAccummulators (CPeerlessBet plBet, CAmount betAmount) {
             burn = (winnings - betAmount * oddsDivisor) / 2000 * betXPermille;
             payout = winnings - burn;
             pe.nMoneyLineHomePotentialLiability += payout / COIN ;
+            nMarket = liabilityMoneyLineHome;
+            nMarketPayout = payout / oddsDivisor;
             pe.nMoneyLineHomeBets += 1;
 
         }else if (plBet.nOutcome == moneyLineLose){
@@ -989,6 +1033,8 @@ void SetEventAccummulators (CPeerlessBet plBet, CAmount betAmount) {
             burn = (winnings - betAmount*oddsDivisor) / 2000 * betXPermille;
             payout = winnings - burn;
             pe.nMoneyLineAwayPotentialLiability += payout / COIN ;
+            nMarket = liabilityMoneyLineAway;
+            nMarketPayout = payout / oddsDivisor;
             pe.nMoneyLineAwayBets += 1;
 
         }else if (plBet.nOutcome == moneyLineDraw){
@@ -996,6 +1042,8 @@ void SetEventAccummulators (CPeerlessBet plBet, CAmount betAmount) {
             burn = (winnings - betAmount*oddsDivisor) / 2000 * betXPermille;
             payout = winnings - burn;
             pe.nMoneyLineDrawPotentialLiability += payout / COIN ;
+            nMarket = liabilityMoneyLineDraw;
+            nMarketPayout = payout / oddsDivisor;
             pe.nMoneyLineDrawBets += 1;
 
         }else if (plBet.nOutcome == spreadHome){
@@ -1004,6 +1052,9 @@ void SetEventAccummulators (CPeerlessBet plBet, CAmount betAmount) {
             payout = winnings - burn;
 
             pe.nSpreadHomePotentialLiability += payout / COIN ;
+            nMarket = liabilitySpreadHome;
+            nMarketPayout = payout / oddsDivisor;
+            nPushMarket = liabilitySpreadPush;
             pe.nSpreadPushPotentialLiability += betAmount / COIN;
             pe.nSpreadHomeBets += 1;
             pe.nSpreadPushBets += 1;
@@ -1014,6 +1065,9 @@ void SetEventAccummulators (CPeerlessBet plBet, CAmount betAmount) {
             payout = winnings - burn;
 
             pe.nSpreadAwayPotentialLiability += payout / COIN ;
+            nMarket = liabilitySpreadAway;
+            nMarketPayout = payout / oddsDivisor;
+            nPushMarket = liabilitySpreadPush;
             pe.nSpreadPushPotentialLiability += betAmount / COIN;
             pe.nSpreadAwayBets += 1;
             pe.nSpreadPushBets += 1;
@@ -1024,6 +1078,9 @@ void SetEventAccummulators (CPeerlessBet plBet, CAmount betAmount) {
             payout = winnings - burn;
 
             pe.nTotalOverPotentialLiability += payout / COIN ;
+            nMarket = liabilityTotalOver;
+            nMarketPayout = payout / oddsDivisor;
+            nPushMarket = liabilityTotalPush;
             pe.nTotalPushPotentialLiability += betAmount / COIN;
             pe.nTotalOverBets += 1;
             pe.nTotalPushBets += 1;
@@ -1034,16 +1091,21 @@ void SetEventAccummulators (CPeerlessBet plBet, CAmount betAmount) {
             payout = winnings - burn;
 
             pe.nTotalUnderPotentialLiability += payout / COIN;
+            nMarket = liabilityTotalUnder;
+            nMarketPayout = payout / oddsDivisor;
+            nPushMarket = liabilityTotalPush;
             pe.nTotalPushPotentialLiability += betAmount / COIN;
             pe.nTotalUnderBets += 1;
             pe.nTotalPushBets += 1;
 
         }
+    });
 
-        eventsIndex[plBet.nEventId] = pe;
-        CEventDB::SetEvents(eventsIndex);
+    if (fEventFound && nMarket >= 0) {
+        CLiabilityDB::AddBet(plBet.nEventId, (LiabilityMarket) nMarket, nMarketPayout);
+        if (nPushMarket >= 0)
+            CLiabilityDB::AddBet(plBet.nEventId, (LiabilityMarket) nPushMarket, betAmount);
     }
-
 }
 
 /**
@@ -1094,6 +1156,132 @@ bool CMapping::FromOpCode(std::string opCode, CMapping &cm)
     return true;
 }
 
+/**
+ * Get the op code carried by an OP_RETURN output script.
+ *
+ * Betting op codes have always been read by hex parsing the string form of the script. Scripts
+ * holding a single data push of more than four bytes, which is how all betting transactions are
+ * built, give back exactly the pushed bytes that way, so those are read straight from the script.
+ * Anything else still goes through the string form, so that the op code stays the same for
+ * every script.
+ *
+ * @param script The output script.
+ * @param opCode The op code bytes.
+ * @return       Bool, false if the script is not an OP_RETURN script.
+ */
+bool GetBetOpCode(const CScript& script, std::string& opCode)
+{
+    if (script.empty() || script[0] != OP_RETURN) {
+        return false;
+    }
+
+    size_t nPos = 1;
+    if (nPos < script.size()) {
+        unsigned int opcode = script[nPos++];
+        size_t nSize = 0;
+
+        if (opcode < OP_PUSHDATA1) {
+            nSize = opcode;
+        }
+        else if (opcode == OP_PUSHDATA1 && script.size() - nPos >= 1) {
+            nSize = script[nPos];
+            nPos += 1;
+        }
+        else if (opcode == OP_PUSHDATA2 && script.size() - nPos >= 2) {
+            nSize = script[nPos] | (script[nPos + 1] << 8);
+            nPos += 2;
+        }
+        else if (opcode == OP_PUSHDATA4 && script.size() - nPos >= 4) {
+            nSize = ReadLE32(&script[nPos]);
+            nPos += 4;
+        }
+
+        // Shorter pushes are shown as numbers in the string form.
+        if (nSize > 4 && script.size() - nPos == nSize) {
+            opCode.assign((const char*) &script[nPos], nSize);
+            return true;
+        }
+    }
+
+    std::vector<unsigned char> vOpCode = ParseHex(script.ToString().substr(9, std::string::npos));
+    opCode.assign(vOpCode.begin(), vOpCode.end());
+
+    return true;
+}
+
+template <typename T>
+static bool DecodeBetOpCodeAs(const std::string& opCode, CBetOpCode& betOpCode)
+{
+    T obj;
+    if (!T::FromOpCode(opCode, obj)) {
+        return false;
+    }
+
+    betOpCode = obj;
+    return true;
+}
+
+/**
+ * Decode a betting op code into the object of its transaction type. Only the parser of the
+ * transaction type given in the op code is run, as no other parser accepts it.
+ *
+ * @param opCode    The op code string.
+ * @param betOpCode The decoded object, CNoBetOpCode if the op code is not a valid betting op code.
+ * @return          Bool
+ */
+bool DecodeBetOpCode(const std::string& opCode, CBetOpCode& betOpCode)
+{
+    betOpCode = CNoBetOpCode();
+
+    // All betting op codes start with the BTX prefix, the format version and the transaction type.
+    if (opCode.length() < 3 || opCode[0] != 'B') {
+        return false;
+    }
+
+    switch (opCode[2]) {
+        case mappingTxType:
+            return DecodeBetOpCodeAs<CMapping>(opCode, betOpCode);
+        case plEventTxType:
+            return DecodeBetOpCodeAs<CPeerlessEvent>(opCode, betOpCode);
+        case plBetTxType:
+            return DecodeBetOpCodeAs<CPeerlessBet>(opCode, betOpCode);
+        case plResultTxType:
+            return DecodeBetOpCodeAs<CPeerlessResult>(opCode, betOpCode);
+        case plUpdateOddsTxType:
+            return DecodeBetOpCodeAs<CPeerlessUpdateOdds>(opCode, betOpCode);
+        case cgEventTxType:
+            return DecodeBetOpCodeAs<CChainGamesEvent>(opCode, betOpCode);
+        case cgBetTxType:
+            return DecodeBetOpCodeAs<CChainGamesBet>(opCode, betOpCode);
+        case cgResultTxType:
+            return DecodeBetOpCodeAs<CChainGamesResult>(opCode, betOpCode);
+        case plSpreadsEventTxType:
+            return DecodeBetOpCodeAs<CPeerlessSpreadsEvent>(opCode, betOpCode);
+        case plTotalsEventTxType:
+            return DecodeBetOpCodeAs<CPeerlessTotalsEvent>(opCode, betOpCode);
+        default:
+            return false;
+    }
+}
+
+/**
+ * Decode the betting op code of an output script.
+ *
+ * @param script    The output script.
+ * @param betOpCode The decoded object, CNoBetOpCode if the script carries no valid betting op code.
+ * @return          Bool
+ */
+bool DecodeBetOpCode(const CScript& script, CBetOpCode& betOpCode)
+{
+    std::string opCode;
+    if (!GetBetOpCode(script, opCode)) {
+        betOpCode = CNoBetOpCode();
+        return false;
+    }
+
+    return DecodeBetOpCode(opCode, betOpCode);
+}
+
 /**
  * Constructor for the CMapping database object.
  */
@@ -1246,6 +1434,65 @@ void CMappingDB::AddTournament(const CMapping tm)
     mTournamentsIndex.insert(std::make_pair(tm.nId, tm));
 }
 
+/**
+ * Look up a single mapping of the given type.
+ *
+ * @param nMType   The mapping type.
+ * @param nId      The mapping ID.
+ * @param mapping  The mapping object, if found.
+ * @return         Bool
+ */
+bool CMappingDB::GetMapping(uint32_t nMType, uint32_t nId, CMapping &mapping)
+{
+    mappingIndex_t mappingIndex;
+    if (nMType == sportMapping) {
+        GetSports(mappingIndex);
+    }
+    else if (nMType == roundMapping) {
+        GetRounds(mappingIndex);
+    }
+    else if (nMType == teamMapping) {
+        GetTeams(mappingIndex);
+    }
+    else if (nMType == tournamentMapping) {
+        GetTournaments(mappingIndex);
+    }
+
+    mappingIndex_t::const_iterator it = mappingIndex.find(nId);
+    if (it == mappingIndex.end()) {
+        return false;
+    }
+
+    mapping = it->second;
+    return true;
+}
+
+/**
+ * Remove a mapping from the index of its type.
+ *
+ * @param nMType  The mapping type.
+ * @param nId     The mapping ID.
+ */
+void CMappingDB::RemoveMapping(uint32_t nMType, uint32_t nId)
+{
+    if (nMType == sportMapping) {
+        LOCK(cs_setSports);
+        mSportsIndex.erase(nId);
+    }
+    else if (nMType == roundMapping) {
+        LOCK(cs_setRounds);
+        mRoundsIndex.erase(nId);
+    }
+    else if (nMType == teamMapping) {
+        LOCK(cs_setTeams);
+        mTeamsIndex.erase(nId);
+    }
+    else if (nMType == tournamentMapping) {
+        LOCK(cs_setTournaments);
+        mTournamentsIndex.erase(nId);
+    }
+}
+
 /**
  * Serialise a mapping index map into binary format and write to the related .dat file.
  *
@@ -1360,6 +1607,7 @@ CEventDB::CEventDB()
 
 /** The global events index. **/
 eventIndex_t CEventDB::eventsIndex;
+eventIndexSnapshot_t CEventDB::eventsSnapshot;
 CCriticalSection CEventDB::cs_setEvents;
 
 /**
@@ -1382,6 +1630,67 @@ void CEventDB::SetEvents(const eventIndex_t &eventIndex)
 {
     LOCK(cs_setEvents);
     eventsIndex = eventIndex;
+    eventsSnapshot.reset();
+}
+
+/**
+ * Returns a read only copy of the current events list. The copy is only made on the first call
+ * after the events change, later calls share it, so readers don't copy the list each time and
+ * never hold the events lock while they use it.
+ *
+ * @return The events list.
+ */
+eventIndexSnapshot_t CEventDB::GetEventsSnapshot()
+{
+    LOCK(cs_setEvents);
+    if (!eventsSnapshot) {
+        eventsSnapshot = std::make_shared<const eventIndex_t>(eventsIndex);
+    }
+    return eventsSnapshot;
+}
+
+/**
+ * Look up a single event in the event index.
+ *
+ * @param nEventId  The event ID.
+ * @param pe        The CPeerless Event object, if found.
+ * @return          Bool
+ */
+bool CEventDB::GetEvent(uint32_t nEventId, CPeerlessEvent &pe)
+{
+    LOCK(cs_setEvents);
+
+    eventIndex_t::const_iterator it = eventsIndex.find(nEventId);
+    if (it == eventsIndex.end()) {
+        return false;
+    }
+
+    pe = it->second;
+    return true;
+}
+
+/**
+ * Add an event to the event index, replacing any event stored under the same ID.
+ *
+ * @param pe CPeerless Event object.
+ */
+void CEventDB::SetEvent(const CPeerlessEvent &pe)
+{
+    LOCK(cs_setEvents);
+    eventsIndex[pe.nEventId] = pe;
+    eventsSnapshot.reset();
+}
+
+/**
+ * Remove an event from the event index.
+ *
+ * @param nEventId The event ID.
+ */
+void CEventDB::EraseEvent(uint32_t nEventId)
+{
+    LOCK(cs_setEvents);
+    eventsIndex.erase(nEventId);
+    eventsSnapshot.reset();
 }
 
 /**
@@ -1391,18 +1700,17 @@ void CEventDB::SetEvents(const eventIndex_t &eventIndex)
  */
 void CEventDB::AddEvent(CPeerlessEvent pe)
 {
-    if (eventsIndex.count(pe.nEventId) > 0) {
-        CPeerlessEvent saved_pe = eventsIndex.find(pe.nEventId)->second;
+    LOCK(cs_setEvents);
+
+    std::pair<eventIndex_t::iterator, bool> ret = eventsIndex.insert(std::make_pair(pe.nEventId, pe));
+    if (!ret.second) {
+        CPeerlessEvent &saved_pe = ret.first->second;
         saved_pe.nStartTime = pe.nStartTime;
         saved_pe.nHomeOdds = pe.nHomeOdds;
         saved_pe.nAwayOdds = pe.nAwayOdds;
         saved_pe.nDrawOdds = pe.nDrawOdds;
-        eventsIndex[saved_pe.nEventId] = saved_pe;
-        CEventDB::SetEvents(eventsIndex);
-    } else {
-        LOCK(cs_setEvents);
-        eventsIndex.insert(std::make_pair(pe.nEventId, pe));
     }
+    eventsSnapshot.reset();
 }
 
 /**
@@ -1414,8 +1722,8 @@ void CEventDB::RemoveEvent(CPeerlessResult pr)
 {
     LOCK(cs_setEvents);
 
-    if (eventsIndex.count(pr.nEventId)) {
-        eventsIndex.erase(pr.nEventId);
+    if (eventsIndex.erase(pr.nEventId)) {
+        eventsSnapshot.reset();
     }
 }
 
@@ -1559,6 +1867,26 @@ void CResultDB::SetResults(const resultsIndex_t &resultIndex)
     resultsIndex = resultIndex;
 }
 
+/**
+ * Look up the result of a single event.
+ *
+ * @param nEventId  The event ID.
+ * @param pr        The CPeerlessResult object, if found.
+ * @return          Bool
+ */
+bool CResultDB::GetResult(uint32_t nEventId, CPeerlessResult &pr)
+{
+    LOCK(cs_setResults);
+
+    resultsIndex_t::const_iterator it = resultsIndex.find(nEventId);
+    if (it == resultsIndex.end()) {
+        return false;
+    }
+
+    pr = it->second;
+    return true;
+}
+
 /**
  * Add a new result to the result index.
  *
@@ -1694,6 +2022,152 @@ bool CResultDB::Read(resultsIndex_t& resultsIndex, uint256& lastBlockHash)
     return true;
 }
 
+bool CEventLiability::IsEmpty() const
+{
+    for (uint32_t nBets : vBets) {
+        if (nBets)
+            return false;
+    }
+    return true;
+}
+
+CAmount CEventLiability::GetExposure() const
+{
+    CAmount nMoneyLine = std::max(vLiability[liabilityMoneyLineHome], std::max(vLiability[liabilityMoneyLineAway], vLiability[liabilityMoneyLineDraw]));
+    CAmount nSpreads = std::max(vLiability[liabilitySpreadHome], std::max(vLiability[liabilitySpreadAway], vLiability[liabilitySpreadPush]));
+    CAmount nTotals = std::max(vLiability[liabilityTotalOver], std::max(vLiability[liabilityTotalUnder], vLiability[liabilityTotalPush]));
+    return nMoneyLine + nSpreads + nTotals;
+}
+
+liabilityIndex_t CLiabilityDB::liabilityIndex;
+std::set<std::pair<CAmount, uint32_t> > CLiabilityDB::setExposures;
+CAmount CLiabilityDB::nTotalExposure = 0;
+CCriticalSection CLiabilityDB::cs_setLiabilities;
+
+void CLiabilityDB::Update(uint32_t nEventId, const CEventLiability* pLiability)
+{
+    liabilityIndex_t::iterator it = liabilityIndex.find(nEventId);
+    if (it != liabilityIndex.end()) {
+        CAmount nExposure = it->second.GetExposure();
+        setExposures.erase(std::make_pair(nExposure, nEventId));
+        nTotalExposure -= nExposure;
+    }
+
+    if (!pLiability || pLiability->IsEmpty()) {
+        if (it != liabilityIndex.end())
+            liabilityIndex.erase(it);
+        return;
+    }
+
+    CAmount nExposure = pLiability->GetExposure();
+    liabilityIndex[nEventId] = *pLiability;
+    setExposures.insert(std::make_pair(nExposure, nEventId));
+    nTotalExposure += nExposure;
+}
+
+/**
+ * Replace the whole liability book, as when the betting state is loaded.
+ *
+ * @param liabilities The liabilities by event ID.
+ */
+void CLiabilityDB::SetLiabilities(const liabilityIndex_t &liabilities)
+{
+    LOCK(cs_setLiabilities);
+    liabilityIndex.clear();
+    setExposures.clear();
+    nTotalExposure = 0;
+    for (const auto& liability : liabilities)
+        Update(liability.first, &liability.second);
+}
+
+/**
+ * Look up the liability of a single event.
+ *
+ * @param nEventId  The event ID.
+ * @param liability The liability, if the event has any bets.
+ * @return          Bool
+ */
+bool CLiabilityDB::GetLiability(uint32_t nEventId, CEventLiability &liability)
+{
+    LOCK(cs_setLiabilities);
+
+    liabilityIndex_t::const_iterator it = liabilityIndex.find(nEventId);
+    if (it == liabilityIndex.end()) {
+        return false;
+    }
+
+    liability = it->second;
+    return true;
+}
+
+/**
+ * Replace the liability of an event, as when a block is disconnected. An empty liability removes the event.
+ *
+ * @param nEventId  The event ID.
+ * @param liability The liability.
+ */
+void CLiabilityDB::SetLiability(uint32_t nEventId, const CEventLiability &liability)
+{
+    LOCK(cs_setLiabilities);
+    Update(nEventId, &liability);
+}
+
+/**
+ * Add a bet to the liability of an event.
+ *
+ * @param nEventId The event ID.
+ * @param market   The market the bet was placed on.
+ * @param nPayout  What the bet pays out if it wins.
+ */
+void CLiabilityDB::AddBet(uint32_t nEventId, LiabilityMarket market, CAmount nPayout)
+{
+    LOCK(cs_setLiabilities);
+
+    CEventLiability liability;
+    liabilityIndex_t::const_iterator it = liabilityIndex.find(nEventId);
+    if (it != liabilityIndex.end())
+        liability = it->second;
+
+    liability.vLiability[market] += nPayout;
+    liability.vBets[market] += 1;
+    Update(nEventId, &liability);
+}
+
+/**
+ * The exposure of the whole book.
+ *
+ * @param nEvents The number of events in the book.
+ * @return        The exposure of every event added up.
+ */
+CAmount CLiabilityDB::GetTotalExposure(size_t &nEvents)
+{
+    LOCK(cs_setLiabilities);
+    nEvents = liabilityIndex.size();
+    return nTotalExposure;
+}
+
+/**
+ * The events with the largest exposure, and the exposure of the whole book read under the same lock.
+ *
+ * @param nCount     The most events to return.
+ * @param nThreshold The smallest exposure to return.
+ * @param nEvents    The number of events in the book.
+ * @param vTop       The events and their liabilities, largest exposure first.
+ * @return           The exposure of every event added up.
+ */
+CAmount CLiabilityDB::GetTopExposures(size_t nCount, CAmount nThreshold, size_t &nEvents, std::vector<std::pair<uint32_t, CEventLiability> > &vTop)
+{
+    LOCK(cs_setLiabilities);
+
+    nEvents = liabilityIndex.size();
+    for (std::set<std::pair<CAmount, uint32_t> >::const_reverse_iterator it = setExposures.rbegin(); it != setExposures.rend(); ++it) {
+        if (vTop.size() >= nCount || it->first < nThreshold)
+            break;
+        vTop.emplace_back(it->second, liabilityIndex[it->second]);
+    }
+    return nTotalExposure;
+}
+
 /**
  * Check a given block to see if it contains a Peerless result TX.
  *
@@ -1720,15 +2194,10 @@ std::vector<CPeerlessResult> getEventResults( int height )
             for (unsigned int i = 0; i < tx.vout.size(); i++) {
 
                 const CTxOut &txout = tx.vout[i];
-                std::string scriptPubKey = txout.scriptPubKey.ToString();
+                std::string opCode;
 
                 // TODO Remove hard-coded values from this block.
-                if (scriptPubKey.length() > 0 && strncmp(scriptPubKey.c_str(), "OP_RETURN", 9) == 0) {
-
-                    // Get OP CODE from transactions.
-                    std::vector<unsigned char> v = ParseHex(scriptPubKey.substr(9, std::string::npos));
-                    std::string opCode(v.begin(), v.end());
-
+                if (GetBetOpCode(txout.scriptPubKey, opCode)) {
                     CPeerlessResult plResult;
                     if (!CPeerlessResult::FromOpCode(opCode, plResult)) {
                         continue;
@@ -1746,355 +2215,69 @@ std::vector<CPeerlessResult> getEventResults( int height )
     return results;
 }
 
-// TODO function will need to be refactored and cleaned up at a later stage as we have had to make rapid and frequent code changes.
 /**
- * Creates the bet payout vector for all winning CPeerless bets.
+ * Settles a single peerless result against the bet index entries of its event.
  *
- * @return payout vector.
+ * @param result   The result to settle.
+ * @param vEntries The bet index entries of the event in chain order.
+ * @param vPayouts The payouts of the winning bets, added in chain order.
+ * @return         True if a result of the event was found in the entries, which ends the settlement of the block.
  */
-std::vector<CBetOut> GetBetPayouts(int height)
+static bool SettlePeerlessResult(const CPeerlessResult& result, const bettingIndexEntries_t& vEntries, std::vector<CBetOut>& vPayouts)
 {
-    std::vector<CBetOut> vExpectedPayouts;
-    int nCurrentHeight = chainActive.Height();
-
-    // Get all the results posted in the latest block.
-    std::vector<CPeerlessResult> results = getEventResults(height);
-
-    // Traverse the blockchain for an event to match a result and all the bets on a result.
-    for (const auto& result : results) {
-        // Look back the chain 14 days for any events and bets.
-        CBlockIndex *BlocksIndex = NULL;
-        BlocksIndex = chainActive[nCurrentHeight - Params().BetBlocksIndexTimespan()];
-
-        uint64_t oddsDivisor  = Params().OddsDivisor();
-        uint64_t betXPermille = Params().BetXPermille();
-
-        OutcomeType nMoneylineResult = (OutcomeType) 0;
-        std::vector<OutcomeType> vSpreadsResult;
-        std::vector<OutcomeType> vTotalsResult;
-
-        uint64_t nMoneylineOdds     = 0;
-        uint64_t nSpreadsOdds       = 0;
-        uint64_t nTotalsOdds        = 0;
-        uint64_t nTotalsPoints      = result.nHomeScore + result.nAwayScore;
-        uint64_t nSpreadsDifference = 0;
-        bool HomeFavorite               = false;
-
-        // We keep temp values as we can't be sure of the order of the TX's being stored in a block.
-        // This can lead to a case were some bets don't
-        uint64_t nTempMoneylineOdds = 0;
-        uint64_t nTempSpreadsOdds   = 0;
-        uint64_t nTempTotalsOdds    = 0;
-
-        bool UpdateMoneyLine = false;
-        bool UpdateSpreads   = false;
-        bool UpdateTotals    = false;
-        uint64_t nSpreadsWinner = 0;
-        uint64_t nTotalsWinner  = 0;
-
-        time_t tempEventStartTime   = 0;
-        time_t latestEventStartTime = 0;
-        bool eventFound = false;
-        bool spreadsFound = false;
-        bool totalsFound = false;
-
-        // Find MoneyLine outcome (result).
-        if (result.nHomeScore > result.nAwayScore) {
-            nMoneylineResult = moneyLineWin;
-        }
-        else if (result.nHomeScore < result.nAwayScore) {
-            nMoneylineResult = moneyLineLose;
-        }
-        else if (result.nHomeScore == result.nAwayScore) {
-            nMoneylineResult = moneyLineDraw;
-        }
-
-        // Traverse the block chain to find events and bets.
-        while (BlocksIndex) {
-            CBlock block;
-            ReadBlockFromDisk(block, BlocksIndex);
-            time_t transactionTime = block.nTime;
-
-            for (CTransaction &tx : block.vtx) {
-                // Check all TX vouts for an OP RETURN.
-                for (unsigned int i = 0; i < tx.vout.size(); i++) {
-
-                    const CTxOut &txout = tx.vout[i];
-                    std::string scriptPubKey = txout.scriptPubKey.ToString();
-                    CAmount betAmount = txout.nValue;
-
-                    if (scriptPubKey.length() > 0 && 0 == strncmp(scriptPubKey.c_str(), "OP_RETURN", 9)) {
-
-                        // Ensure TX has it been posted by Oracle wallet.
-                        const CTxIn &txin = tx.vin[0];
-                        bool validOracleTx = IsValidOracleTx(txin);
-
-                        // Get the OP CODE from the transaction scriptPubKey.
-                        std::vector<unsigned char> vOpCode = ParseHex(scriptPubKey.substr(9, std::string::npos));
-                        std::string opCode(vOpCode.begin(), vOpCode.end());
-
-                        // Peerless event OP RETURN transaction.
-                        CPeerlessEvent pe;
-                        if (validOracleTx && CPeerlessEvent::FromOpCode(opCode, pe)) {
-
-                            // If the current event matches the result we can now set the odds.
-                            if (result.nEventId == pe.nEventId) {
-
-                                LogPrintf("EVENT OP CODE - %s \n", opCode.c_str());
-
-                                UpdateMoneyLine    = true;
-                                eventFound         = true;
-                                tempEventStartTime = pe.nStartTime;
-
-                                // Set the temp moneyline odds.
-                                if (nMoneylineResult == moneyLineWin) {
-                                    nTempMoneylineOdds = pe.nHomeOdds;
-                                }
-                                else if (nMoneylineResult == moneyLineLose) {
-                                    nTempMoneylineOdds = pe.nAwayOdds;
-                                }
-                                else if (nMoneylineResult == moneyLineDraw) {
-                                    nTempMoneylineOdds = pe.nDrawOdds;
-                                }
-
-                                // Set which team is the favorite, used for calculating spreads difference & winner.
-                                if (pe.nHomeOdds < pe.nAwayOdds) {
-                                    HomeFavorite = true;
-                                    if (result.nHomeScore > result.nAwayScore) {
-                                        nSpreadsDifference = result.nHomeScore - result.nAwayScore;
-                                    }
-                                    else{
-                                        nSpreadsDifference = 0;
-                                    }
-                                }
-                                else {
-                                    HomeFavorite = false;
-                                    if (result.nAwayScore > result.nHomeScore) {
-                                        nSpreadsDifference = result.nAwayScore - result.nHomeScore;
-                                    }
-
-                                    else{
-                                        nSpreadsDifference = 0;
-                                    }
-                                }
-                            }
-                        }
-
-                        // Peerless update odds OP RETURN transaction.
-                        CPeerlessUpdateOdds puo;
-                        if (eventFound && validOracleTx && CPeerlessUpdateOdds::FromOpCode(opCode, puo) && result.nEventId == puo.nEventId ) {
-
-                            LogPrintf("PUO EVENT OP CODE - %s \n", opCode.c_str());
-
-                            UpdateMoneyLine = true;
-
-                            // If current event ID matches result ID set the odds.
-                            if (nMoneylineResult == moneyLineWin) {
-                                nTempMoneylineOdds = puo.nHomeOdds;
-                            }
-                            else if (nMoneylineResult == moneyLineLose) {
-                                nTempMoneylineOdds = puo.nAwayOdds;
-                            }
-                            else if (nMoneylineResult == moneyLineDraw) {
-                                nTempMoneylineOdds = puo.nDrawOdds;
-                            }
-                        }
-
-                        // Handle PSE, when we find a Spreads event on chain we need to update the Spreads odds.
-                        CPeerlessSpreadsEvent pse;
-                        if (eventFound && validOracleTx && CPeerlessSpreadsEvent::FromOpCode(opCode, pse) && result.nEventId == pse.nEventId) {
-
-                            LogPrintf("PSE EVENT OP CODE - %s \n", opCode.c_str());
-
-                            UpdateSpreads = true;
-
-                            // If the home team is the favourite.
-                            if (HomeFavorite){
-                                //  Choose the spreads winner.
-                                if (nSpreadsDifference == 0) {
-                                    nSpreadsWinner = WinnerType::awayWin;
-                                }
-                                else if (pse.nPoints < nSpreadsDifference) {
-                                    nSpreadsWinner = WinnerType::homeWin;
-                                }
-                                else if (pse.nPoints > nSpreadsDifference) {
-                                    nSpreadsWinner = WinnerType::awayWin;
-                                }
-                                else {
-                                    nSpreadsWinner = WinnerType::push;
-                                }
-                            }
-                            // If the away team is the favourite.
-                            else {
-                                // Cho0se the winner.
-                                if (nSpreadsDifference == 0) {
-                                    nSpreadsWinner = WinnerType::homeWin;
-                                }
-                                else if (pse.nPoints > nSpreadsDifference) {
-                                    nSpreadsWinner = WinnerType::homeWin;
-                                }
-                                else if (pse.nPoints < nSpreadsDifference) {
-                                    nSpreadsWinner = WinnerType::awayWin;
-                                }
-                                else {
-                                    nSpreadsWinner = WinnerType::push;
-                                }
-                            }
-
-                            // Set the temp spread odds.
-                            if (nSpreadsWinner == WinnerType::push) {
-                                nTempSpreadsOdds = Params().OddsDivisor();
-                            }
-                            else if (nSpreadsWinner == WinnerType::awayWin) {
-                                nTempSpreadsOdds = pse.nAwayOdds;
-                            }
-                            else if (nSpreadsWinner == WinnerType::homeWin) {
-                                nTempSpreadsOdds = pse.nHomeOdds;
-                            }
-                        }
-
-                        // Handle PTE, when we find an Totals event on chain we need to update the Totals odds.
-                        CPeerlessTotalsEvent pte;
-                        if (eventFound && validOracleTx && CPeerlessTotalsEvent::FromOpCode(opCode, pte) && result.nEventId == pte.nEventId) {
+    uint64_t oddsDivisor  = Params().OddsDivisor();
+    uint64_t betXPermille = Params().BetXPermille();
 
-                            LogPrintf("PTE EVENT OP CODE - %s \n", opCode.c_str());
+    OutcomeType nMoneylineResult = (OutcomeType) 0;
+    std::vector<OutcomeType> vSpreadsResult;
+    std::vector<OutcomeType> vTotalsResult;
 
-                            UpdateTotals = true;
+    uint64_t nMoneylineOdds     = 0;
+    uint64_t nSpreadsOdds       = 0;
+    uint64_t nTotalsOdds        = 0;
+    uint64_t nTotalsPoints      = result.nHomeScore + result.nAwayScore;
+    uint64_t nSpreadsDifference = 0;
+    bool HomeFavorite               = false;
 
-                            // Find totals outcome (result).
-                            if (pte.nPoints == nTotalsPoints) {
-                                nTotalsWinner = WinnerType::push;
-                            }
-                            else if (pte.nPoints > nTotalsPoints) {
-                                nTotalsWinner = WinnerType::awayWin;
-                            }
-                            else {
-                                nTotalsWinner = WinnerType::homeWin;
-                            }
+    // We keep temp values as we can't be sure of the order of the TX's being stored in a block.
+    // This can lead to a case were some bets don't
+    uint64_t nTempMoneylineOdds = 0;
+    uint64_t nTempSpreadsOdds   = 0;
+    uint64_t nTempTotalsOdds    = 0;
 
-                            // Set the totals temp odds.
-                            if (nTotalsWinner == WinnerType::push) {
-                                nTempTotalsOdds = Params().OddsDivisor();
-                            }
-                            else if (nTotalsWinner == WinnerType::awayWin) {
-                                nTempTotalsOdds = pte.nUnderOdds;
-                            }
-                            else if (nTotalsWinner == WinnerType::homeWin) {
-                                nTempTotalsOdds = pte.nOverOdds;
-                            }
-                        }
+    bool UpdateMoneyLine = false;
+    bool UpdateSpreads   = false;
+    bool UpdateTotals    = false;
+    uint64_t nSpreadsWinner = 0;
+    uint64_t nTotalsWinner  = 0;
 
-                        // If we encounter the result after cycling the chain then we dont need go any furture so finish the payout.
-                        CPeerlessResult pr;
-                        if (eventFound && validOracleTx && CPeerlessResult::FromOpCode(opCode, pr) && result.nEventId == pr.nEventId ) {
+    time_t tempEventStartTime   = 0;
+    time_t latestEventStartTime = 0;
+    bool eventFound = false;
+    bool spreadsFound = false;
+    bool totalsFound = false;
 
-                            LogPrintf("Result found ending search \n");
+    // Find MoneyLine outcome (result).
+    if (result.nHomeScore > result.nAwayScore) {
+        nMoneylineResult = moneyLineWin;
+    }
+    else if (result.nHomeScore < result.nAwayScore) {
+        nMoneylineResult = moneyLineLose;
+    }
+    else if (result.nHomeScore == result.nAwayScore) {
+        nMoneylineResult = moneyLineDraw;
+    }
 
-                            return vExpectedPayouts;
-                        }
+    // Traverse the indexed entries to find events and bets.
+    uint32_t nEntriesHeight = 0;
+    for (const auto& indexEntry : vEntries) {
+        const CBettingIndexKey &key     = indexEntry.first;
+        const CBettingIndexEntry &entry = indexEntry.second;
 
-                        // Only payout bets that are between 25 - 10000 WRG inclusive (MaxBetPayoutRange).
-                        if (eventFound && betAmount >= (Params().MinBetPayoutRange() * COIN) && betAmount <= (Params().MaxBetPayoutRange() * COIN)) {
-
-                            // Bet OP RETURN transaction.
-                            CPeerlessBet pb;
-                            if (CPeerlessBet::FromOpCode(opCode, pb)) {
-
-                                CAmount payout = 0 * COIN;
-
-                                // If bet was placed less than 20 mins before event start or after event start discard it.
-                                if (latestEventStartTime > 0 && (unsigned int) transactionTime > (latestEventStartTime - Params().BetPlaceTimeoutBlocks())) {
-                                    continue;
-                                }
-
-                                // Is the bet a winning bet?
-                                if (result.nEventId == pb.nEventId) {
-                                    CAmount winnings = 0;
-
-                                    // If bet payout result.
-                                    if (result.nResultType ==  ResultType::standardResult) {
-
-                                        // Calculate winnings.
-                                        if (pb.nOutcome == nMoneylineResult) {
-                                            winnings = betAmount * nMoneylineOdds;
-                                        }
-                                        else if (spreadsFound && (pb.nOutcome == vSpreadsResult.at(0) || pb.nOutcome == vSpreadsResult.at(1))) {
-                                            winnings = betAmount * nSpreadsOdds;
-                                        }
-                                        else if (totalsFound && (pb.nOutcome == vTotalsResult.at(0) || pb.nOutcome == vTotalsResult.at(1))) {
-                                           winnings = betAmount * nTotalsOdds;
-                                        }
-
-                                        // Calculate the bet winnings for the current bet.
-                                        if (winnings > 0) {
-                                            payout = (winnings - ((winnings - betAmount*oddsDivisor) / 1000 * betXPermille)) / oddsDivisor;
-                                        }
-                                        else {
-                                            payout = 0;
-                                        }
-                                    }
-                                    // Bet refund result.
-                                    else if (result.nResultType ==  ResultType::eventRefund){
-                                        payout = betAmount;
-                                    } else if (result.nResultType == ResultType::mlRefund){
-                                        // Calculate winnings.
-                                        if (pb.nOutcome == OutcomeType::moneyLineDraw ||
-                                                pb.nOutcome == OutcomeType::moneyLineLose ||
-                                                pb.nOutcome == OutcomeType::moneyLineWin) {
-                                            payout = betAmount;
-                                        }
-                                        else if (spreadsFound && (pb.nOutcome == vSpreadsResult.at(0) || pb.nOutcome == vSpreadsResult.at(1))) {
-                                            winnings = betAmount * nSpreadsOdds;
-
-                                            // Calculate the bet winnings for the current bet.
-                                            if (winnings > 0) {
-                                                payout = (winnings - ((winnings - betAmount*oddsDivisor) / 1000 * betXPermille)) / oddsDivisor;
-                                            }
-                                            else {
-                                                payout = 0;
-                                            }
-                                        }
-                                        else if (totalsFound && (pb.nOutcome == vTotalsResult.at(0) || pb.nOutcome == vTotalsResult.at(1))) {
-                                           winnings = betAmount * nTotalsOdds;
-
-                                            // Calculate the bet winnings for the current bet.
-                                            if (winnings > 0) {
-                                                payout = (winnings - ((winnings - betAmount*oddsDivisor) / 1000 * betXPermille)) / oddsDivisor;
-                                            }
-                                            else {
-                                                payout = 0;
-                                            }
-                                        }
-                                    }
-
-                                    // Get the users payout address from the vin of the bet TX they used to place the bet.
-                                    CTxDestination payoutAddress;
-                                    const CTxIn &txin = tx.vin[0];
-                                    COutPoint prevout = txin.prevout;
-
-                                    uint256 hashBlock;
-                                    CTransaction txPrev;
-                                    if (GetTransaction(prevout.hash, txPrev, hashBlock, true)) {
-                                        ExtractDestination( txPrev.vout[prevout.n].scriptPubKey, payoutAddress );
-                                    }
-
-                                    LogPrintf("MoneyLine Refund - PAYOUT\n");
-                                    LogPrintf("AMOUNT: %li \n", payout);
-                                    LogPrintf("ADDRESS: %s \n", CBitcoinAddress( payoutAddress ).ToString().c_str());
-
-                                    // Only add valid payouts to the vector.
-                                    if (payout > 0) {
-                                        // Add winning bet payout to the bet vector.
-                                        vExpectedPayouts.emplace_back(payout, GetScriptForDestination(CBitcoinAddress(payoutAddress).Get()), betAmount);
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
+        if (key.nHeight != nEntriesHeight) {
+            nEntriesHeight = key.nHeight;
 
-            // If an update transaction came in on this block, the bool would be set to true and the odds/winners will be updated (below) for the next block
+            // If an update transaction came in on an earlier block, the bool would be set to true and the odds/winners are updated (below) from this block on
             if (UpdateMoneyLine){
                 UpdateMoneyLine      = false;
                 nMoneylineOdds       = nTempMoneylineOdds;
@@ -2151,14 +2334,371 @@ std::vector<CBetOut> GetBetPayouts(int height)
 
                 nTotalsWinner = 0;
             }
+        }
+
+        time_t transactionTime   = entry.nBlockTime;
+        CAmount betAmount        = entry.nValue;
+        const std::string opCode = entry.opCode;
+
+        // Decode the OP CODE once, into the object of its transaction type.
+        CBetOpCode betOpCode;
+        DecodeBetOpCode(opCode, betOpCode);
+
+        // Whether the TX has been posted by Oracle wallet, checked when the block was indexed.
+        bool validOracleTx = entry.fOracleTx;
+
+        // Peerless event OP RETURN transaction.
+        const CPeerlessEvent* pe = boost::get<CPeerlessEvent>(&betOpCode);
+        if (validOracleTx && pe) {
+
+            // If the current event matches the result we can now set the odds.
+            if (result.nEventId == pe->nEventId) {
+
+                LogPrintf("EVENT OP CODE - %s \n", opCode.c_str());
+
+                UpdateMoneyLine    = true;
+                eventFound         = true;
+                tempEventStartTime = pe->nStartTime;
+
+                // Set the temp moneyline odds.
+                if (nMoneylineResult == moneyLineWin) {
+                    nTempMoneylineOdds = pe->nHomeOdds;
+                }
+                else if (nMoneylineResult == moneyLineLose) {
+                    nTempMoneylineOdds = pe->nAwayOdds;
+                }
+                else if (nMoneylineResult == moneyLineDraw) {
+                    nTempMoneylineOdds = pe->nDrawOdds;
+                }
+
+                // Set which team is the favorite, used for calculating spreads difference & winner.
+                if (pe->nHomeOdds < pe->nAwayOdds) {
+                    HomeFavorite = true;
+                    if (result.nHomeScore > result.nAwayScore) {
+                        nSpreadsDifference = result.nHomeScore - result.nAwayScore;
+                    }
+                    else{
+                        nSpreadsDifference = 0;
+                    }
+                }
+                else {
+                    HomeFavorite = false;
+                    if (result.nAwayScore > result.nHomeScore) {
+                        nSpreadsDifference = result.nAwayScore - result.nHomeScore;
+                    }
+
+                    else{
+                        nSpreadsDifference = 0;
+                    }
+                }
+            }
+        }
+
+        // Peerless update odds OP RETURN transaction.
+        const CPeerlessUpdateOdds* puo = boost::get<CPeerlessUpdateOdds>(&betOpCode);
+        if (eventFound && validOracleTx && puo && result.nEventId == puo->nEventId ) {
+
+            LogPrintf("PUO EVENT OP CODE - %s \n", opCode.c_str());
+
+            UpdateMoneyLine = true;
+
+            // If current event ID matches result ID set the odds.
+            if (nMoneylineResult == moneyLineWin) {
+                nTempMoneylineOdds = puo->nHomeOdds;
+            }
+            else if (nMoneylineResult == moneyLineLose) {
+                nTempMoneylineOdds = puo->nAwayOdds;
+            }
+            else if (nMoneylineResult == moneyLineDraw) {
+                nTempMoneylineOdds = puo->nDrawOdds;
+            }
+        }
+
+        // Handle PSE, when we find a Spreads event on chain we need to update the Spreads odds.
+        const CPeerlessSpreadsEvent* pse = boost::get<CPeerlessSpreadsEvent>(&betOpCode);
+        if (eventFound && validOracleTx && pse && result.nEventId == pse->nEventId) {
+
+            LogPrintf("PSE EVENT OP CODE - %s \n", opCode.c_str());
+
+            UpdateSpreads = true;
+
+            // If the home team is the favourite.
+            if (HomeFavorite){
+                //  Choose the spreads winner.
+                if (nSpreadsDifference == 0) {
+                    nSpreadsWinner = WinnerType::awayWin;
+                }
+                else if (pse->nPoints < nSpreadsDifference) {
+                    nSpreadsWinner = WinnerType::homeWin;
+                }
+                else if (pse->nPoints > nSpreadsDifference) {
+                    nSpreadsWinner = WinnerType::awayWin;
+                }
+                else {
+                    nSpreadsWinner = WinnerType::push;
+                }
+            }
+            // If the away team is the favourite.
+            else {
+                // Cho0se the winner.
+                if (nSpreadsDifference == 0) {
+                    nSpreadsWinner = WinnerType::homeWin;
+                }
+                else if (pse->nPoints > nSpreadsDifference) {
+                    nSpreadsWinner = WinnerType::homeWin;
+                }
+                else if (pse->nPoints < nSpreadsDifference) {
+                    nSpreadsWinner = WinnerType::awayWin;
+                }
+                else {
+                    nSpreadsWinner = WinnerType::push;
+                }
+            }
+
+            // Set the temp spread odds.
+            if (nSpreadsWinner == WinnerType::push) {
+                nTempSpreadsOdds = Params().OddsDivisor();
+            }
+            else if (nSpreadsWinner == WinnerType::awayWin) {
+                nTempSpreadsOdds = pse->nAwayOdds;
+            }
+            else if (nSpreadsWinner == WinnerType::homeWin) {
+                nTempSpreadsOdds = pse->nHomeOdds;
+            }
+        }
+
+        // Handle PTE, when we find an Totals event on chain we need to update the Totals odds.
+        const CPeerlessTotalsEvent* pte = boost::get<CPeerlessTotalsEvent>(&betOpCode);
+        if (eventFound && validOracleTx && pte && result.nEventId == pte->nEventId) {
+
+            LogPrintf("PTE EVENT OP CODE - %s \n", opCode.c_str());
+
+            UpdateTotals = true;
+
+            // Find totals outcome (result).
+            if (pte->nPoints == nTotalsPoints) {
+                nTotalsWinner = WinnerType::push;
+            }
+            else if (pte->nPoints > nTotalsPoints) {
+                nTotalsWinner = WinnerType::awayWin;
+            }
+            else {
+                nTotalsWinner = WinnerType::homeWin;
+            }
+
+            // Set the totals temp odds.
+            if (nTotalsWinner == WinnerType::push) {
+                nTempTotalsOdds = Params().OddsDivisor();
+            }
+            else if (nTotalsWinner == WinnerType::awayWin) {
+                nTempTotalsOdds = pte->nUnderOdds;
+            }
+            else if (nTotalsWinner == WinnerType::homeWin) {
+                nTempTotalsOdds = pte->nOverOdds;
+            }
+        }
+
+        // If we encounter the result after cycling the chain then we dont need go any furture so finish the payout.
+        const CPeerlessResult* pr = boost::get<CPeerlessResult>(&betOpCode);
+        if (eventFound && validOracleTx && pr && result.nEventId == pr->nEventId ) {
+
+            LogPrintf("Result found ending search \n");
+
+            return true;
+        }
+
+        // Only payout bets that are between 25 - 10000 WRG inclusive (MaxBetPayoutRange).
+        if (eventFound && betAmount >= (Params().MinBetPayoutRange() * COIN) && betAmount <= (Params().MaxBetPayoutRange() * COIN)) {
+
+            // Bet OP RETURN transaction.
+            const CPeerlessBet* pb = boost::get<CPeerlessBet>(&betOpCode);
+            if (pb) {
+
+                CAmount payout = 0 * COIN;
+
+                // If bet was placed less than 20 mins before event start or after event start discard it.
+                if (latestEventStartTime > 0 && (unsigned int) transactionTime > (latestEventStartTime - Params().BetPlaceTimeoutBlocks())) {
+                    continue;
+                }
+
+                // Is the bet a winning bet?
+                if (result.nEventId == pb->nEventId) {
+                    CAmount winnings = 0;
+
+                    // If bet payout result.
+                    if (result.nResultType ==  ResultType::standardResult) {
+
+                        // Calculate winnings.
+                        if (pb->nOutcome == nMoneylineResult) {
+                            winnings = betAmount * nMoneylineOdds;
+                        }
+                        else if (spreadsFound && (pb->nOutcome == vSpreadsResult.at(0) || pb->nOutcome == vSpreadsResult.at(1))) {
+                            winnings = betAmount * nSpreadsOdds;
+                        }
+                        else if (totalsFound && (pb->nOutcome == vTotalsResult.at(0) || pb->nOutcome == vTotalsResult.at(1))) {
+                           winnings = betAmount * nTotalsOdds;
+                        }
+
+                        // Calculate the bet winnings for the current bet.
+                        if (winnings > 0) {
+                            payout = (winnings - ((winnings - betAmount*oddsDivisor) / 1000 * betXPermille)) / oddsDivisor;
+                        }
+                        else {
+                            payout = 0;
+                        }
+                    }
+                    // Bet refund result.
+                    else if (result.nResultType ==  ResultType::eventRefund){
+                        payout = betAmount;
+                    } else if (result.nResultType == ResultType::mlRefund){
+                        // Calculate winnings.
+                        if (pb->nOutcome == OutcomeType::moneyLineDraw ||
+                                pb->nOutcome == OutcomeType::moneyLineLose ||
+                                pb->nOutcome == OutcomeType::moneyLineWin) {
+                            payout = betAmount;
+                        }
+                        else if (spreadsFound && (pb->nOutcome == vSpreadsResult.at(0) || pb->nOutcome == vSpreadsResult.at(1))) {
+                            winnings = betAmount * nSpreadsOdds;
+
+                            // Calculate the bet winnings for the current bet.
+                            if (winnings > 0) {
+                                payout = (winnings - ((winnings - betAmount*oddsDivisor) / 1000 * betXPermille)) / oddsDivisor;
+                            }
+                            else {
+                                payout = 0;
+                            }
+                        }
+                        else if (totalsFound && (pb->nOutcome == vTotalsResult.at(0) || pb->nOutcome == vTotalsResult.at(1))) {
+                           winnings = betAmount * nTotalsOdds;
+
+                            // Calculate the bet winnings for the current bet.
+                            if (winnings > 0) {
+                                payout = (winnings - ((winnings - betAmount*oddsDivisor) / 1000 * betXPermille)) / oddsDivisor;
+                            }
+                            else {
+                                payout = 0;
+                            }
+                        }
+                    }
+
+                    // The users payout address was taken from the vin of the bet TX when the block was indexed.
+                    CTxDestination payoutAddress;
+                    ExtractDestination(entry.payoutScript, payoutAddress);
+
+                    LogPrintf("MoneyLine Refund - PAYOUT\n");
+                    LogPrintf("AMOUNT: %li \n", payout);
+                    LogPrintf("ADDRESS: %s \n", CBitcoinAddress( payoutAddress ).ToString().c_str());
+
+                    // Only add valid payouts to the vector.
+                    if (payout > 0) {
+                        // Add winning bet payout to the bet vector.
+                        vPayouts.emplace_back(payout, entry.payoutScript, betAmount);
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+bool CPeerlessSettlementCheck::operator()()
+{
+    pSettlement->fResultFound = SettlePeerlessResult(*pResult, *pEntries, pSettlement->vPayouts);
+    return true;
+}
+
+static CCheckQueue<CPeerlessSettlementCheck> settlementqueue(16);
+
+void ThreadBetSettlement()
+{
+    RenameThread("wagerr-betsettle");
+    settlementqueue.Thread();
+}
+
+/**
+ * Settles the peerless results of a block, on the worker threads of the queue if one is given.
+ * The payouts are merged in result order and the merge stops after the first result whose
+ * search found a result of its event, so the vector is the same as when settling in order.
+ *
+ * @param vResults       The results of the block.
+ * @param vResultEntries The bet index entries of the event of each result.
+ * @param pqueue         The queue to settle the results on, NULL to settle them on this thread.
+ * @return               payout vector.
+ */
+std::vector<CBetOut> SettlePeerlessResults(const std::vector<CPeerlessResult>& vResults, const std::vector<bettingIndexEntries_t>& vResultEntries, CCheckQueue<CPeerlessSettlementCheck>* pqueue)
+{
+    std::vector<CPeerlessSettlement> vSettlements(vResults.size());
+
+    if (pqueue) {
+        CCheckQueueControl<CPeerlessSettlementCheck> control(pqueue);
+        std::vector<CPeerlessSettlementCheck> vChecks;
+        vChecks.reserve(vResults.size());
+        for (unsigned int i = 0; i < vResults.size(); i++) {
+            vChecks.push_back(CPeerlessSettlementCheck(vResults[i], vResultEntries[i], vSettlements[i]));
+        }
+        control.Add(vChecks);
+        control.Wait();
+    }
+    else {
+        for (unsigned int i = 0; i < vResults.size(); i++) {
+            vSettlements[i].fResultFound = SettlePeerlessResult(vResults[i], vResultEntries[i], vSettlements[i].vPayouts);
+            if (vSettlements[i].fResultFound) {
+                break;
+            }
+        }
+    }
 
-            BlocksIndex = chainActive.Next(BlocksIndex);
+    std::vector<CBetOut> vExpectedPayouts;
+    for (const CPeerlessSettlement& settlement : vSettlements) {
+        vExpectedPayouts.insert(vExpectedPayouts.end(), settlement.vPayouts.begin(), settlement.vPayouts.end());
+        if (settlement.fResultFound) {
+            break;
         }
     }
 
     return vExpectedPayouts;
 }
 
+// TODO function will need to be refactored and cleaned up at a later stage as we have had to make rapid and frequent code changes.
+/**
+ * Creates the bet payout vector for all winning CPeerless bets.
+ *
+ * @param height   The height of the block the results are read from.
+ * @param vPayouts The payout vector.
+ * @return         False if the bet index of a result's event can't be read.
+ */
+bool GetBetPayouts(int height, std::vector<CBetOut>& vPayouts)
+{
+    vPayouts.clear();
+
+    int nCurrentHeight = chainActive.Height();
+
+    // Get all the results posted in the latest block.
+    std::vector<CPeerlessResult> results = getEventResults(height);
+
+    // Look back the chain 14 days for any events and bets.
+    CBlockIndex *BlocksIndex = NULL;
+    BlocksIndex = chainActive[nCurrentHeight - Params().BetBlocksIndexTimespan()];
+
+    // Nothing to look through if the chain is shorter than the look back window.
+    if (!BlocksIndex) {
+        return true;
+    }
+
+    // Read the events, odds updates, results and bets of each result's event from the bet index rather than the blocks.
+    std::vector<bettingIndexEntries_t> vResultEntries(results.size());
+    for (unsigned int i = 0; i < results.size(); i++) {
+        if (!bettingDB->ReadEventEntries(results[i].nEventId, BlocksIndex->nHeight, nCurrentHeight, vResultEntries[i]))
+            return error("%s - failed to read the bet index for event %d", __func__, results[i].nEventId);
+    }
+
+    // The results don't depend on each other, so settle them on the worker threads when there are any.
+    vPayouts = SettlePeerlessResults(results, vResultEntries, nScriptCheckThreads ? &settlementqueue : NULL);
+    return true;
+}
+
+
 bool CChainGamesResult::FromScript(CScript script) {
     // LogPrintf("%s - %s\n", __func__, script.ToString());
 
@@ -2261,102 +2801,16 @@ std::vector<CBetOut> GetCGLottoBetPayouts (int height)
 
         totalValueOfBlock = stoll(blockSizeArray[0]);
 
-        //reset total bet amount and candidate array for this event
-        std::vector<std::string> candidates;
-        CAmount totalBetAmount = 0 * COIN;
-
-        // Look back the chain 10 days for any events and bets.
+        // Look back the chain 10 days for the event and the entries placed on it.
         CBlockIndex *BlocksIndex = NULL;
         BlocksIndex = chainActive[nCurrentHeight - 14400];
 
-        time_t eventStart = 0;
-        bool eventStartedFlag = false;
-        bool currentEventFound = false;
-
-        while (BlocksIndex) {
-
-            CBlock block;
-            ReadBlockFromDisk(block, BlocksIndex);
-            time_t transactionTime = block.nTime;
-
-            for (CTransaction &tx : block.vtx) {
-
-                // Ensure if event TX that has it been posted by Oracle wallet.
-                const CTxIn &txin = tx.vin[0];
-                COutPoint prevout = txin.prevout;
-
-                uint256 hashBlock;
-                CTransaction txPrev;
-
-                bool validTX = IsValidOracleTx(txin);
-
-                // Check all TX vouts for an OP RETURN.
-                for (unsigned int i = 0; i < tx.vout.size(); i++) {
-
-                    const CTxOut &txout = tx.vout[i];
-                    std::string scriptPubKey = txout.scriptPubKey.ToString();
-                    CAmount betAmount = txout.nValue;
-
-                    if (scriptPubKey.length() > 0 && 0 == strncmp(scriptPubKey.c_str(), "OP_RETURN", 9)) {
-                        // Get the OP CODE from the transaction scriptPubKey.
-                        std::vector<unsigned char> vOpCode = ParseHex(scriptPubKey.substr(9, std::string::npos));
-                        std::string opCode(vOpCode.begin(), vOpCode.end());
-
-                        // If bet was placed less than 20 mins before event start or after event start discard it.
-                        if (eventStart > 0 && transactionTime > (eventStart - Params().BetPlaceTimeoutBlocks())) {
-                            eventStartedFlag = true;
-                            break;
-                        }
-
-                        // Find most recent CGLotto event
-                        CChainGamesEvent chainGameEvt;
-                        if (validTX && CChainGamesEvent::FromOpCode(opCode, chainGameEvt)){
-                            if (chainGameEvt.nEventId == currentEventID) {
-                                eventFee = chainGameEvt.nEntryFee * COIN;
-                                currentEventFound = true;
-                            }
-                        }
-
-                        // Find most recent CGLotto bet once the event has been found
-                        CChainGamesBet chainGamesBet;
-                        if (currentEventFound && CChainGamesBet::FromOpCode(opCode, chainGamesBet)) {
-
-                            uint32_t eventId = chainGamesBet.nEventId;
-
-                            // If current event ID matches result ID add bettor to candidate array
-                            if (eventId == currentEventID) {
-
-                                CTxDestination address;
-                                ExtractDestination(tx.vout[0].scriptPubKey, address);
-
-                                //Check Entry fee matches the bet amount
-                                if (eventFee == betAmount) {
-
-                                    totalBetAmount = totalBetAmount + betAmount;
-                                    CTxDestination payoutAddress;
-
-                                    if (GetTransaction(prevout.hash, txPrev, hashBlock, true)) {
-                                        ExtractDestination( txPrev.vout[prevout.n].scriptPubKey, payoutAddress );
-                                    }
-
-                                    // Add the payout address of each candidate to array
-                                    candidates.push_back(CBitcoinAddress( payoutAddress ).ToString().c_str());
-                                }
-                            }
-                        }
-                    }
-                }
-
-                if (eventStartedFlag) {
-                    break;
-                }
-            }
-
-            if (eventStartedFlag) {
-                break;
-            }
-
-            BlocksIndex = chainActive.Next(BlocksIndex);
+        // The entrants are kept in the running pot of the event rather than read from the blocks.
+        std::vector<std::string> candidates;
+        if (BlocksIndex) {
+            CChainGamesPot pot;
+            bettingDB->ReadChainGamesPot(currentEventID, pot);
+            pot.GetEntrants(BlocksIndex->nHeight, eventFee, candidates);
         }
 
         // Choose winner from candidates who entered the lotto and payout their winnings.
@@ -2412,3 +2866,62 @@ std::vector<CBetOut> GetCGLottoBetPayouts (int height)
 
     return vexpectedCGLottoBetPayouts;
 }
+
+/** The expected payouts of the block on top of the tip they were computed for. */
+static int nExpectedPayoutsHeight = -1;
+static uint256 hashExpectedPayoutsBlock;
+static std::vector<CBetOut> vCachedPLPayouts;
+static std::vector<CBetOut> vCachedCGLottoPayouts;
+static CCriticalSection cs_expectedPayouts;
+
+/**
+ * Gets the peerless and chain games payouts expected in the block on top of pindexPrev.
+ * They are settled once per tip and shared by the miner and block validation, so
+ * every competing block at a height is checked against the same vectors.
+ *
+ * @param pindexPrev      The block the payouts are paid on top of.
+ * @param vPLPayouts      The peerless payouts, as returned by GetBetPayouts.
+ * @param vCGLottoPayouts The chain games payouts, as returned by GetCGLottoBetPayouts.
+ * @return                False if the peerless payouts can't be settled.
+ */
+bool GetExpectedBetPayouts(const CBlockIndex* pindexPrev, std::vector<CBetOut>& vPLPayouts, std::vector<CBetOut>& vCGLottoPayouts)
+{
+    AssertLockHeld(cs_main);
+
+    // The payouts are settled against the active chain, so only those on top of its tip are kept.
+    bool fTip = pindexPrev == chainActive.Tip();
+    if (fTip) {
+        LOCK(cs_expectedPayouts);
+        if (nExpectedPayoutsHeight == pindexPrev->nHeight && hashExpectedPayoutsBlock == pindexPrev->GetBlockHash()) {
+            vPLPayouts = vCachedPLPayouts;
+            vCGLottoPayouts = vCachedCGLottoPayouts;
+            return true;
+        }
+    }
+
+    if (!GetBetPayouts(pindexPrev->nHeight, vPLPayouts))
+        return false;
+    vCGLottoPayouts = GetCGLottoBetPayouts(pindexPrev->nHeight);
+
+    if (fTip) {
+        LOCK(cs_expectedPayouts);
+        nExpectedPayoutsHeight = pindexPrev->nHeight;
+        hashExpectedPayoutsBlock = pindexPrev->GetBlockHash();
+        vCachedPLPayouts = vPLPayouts;
+        vCachedCGLottoPayouts = vCGLottoPayouts;
+    }
+    return true;
+}
+
+/**
+ * Settles the payouts of the next block as soon as a new tip is connected.
+ *
+ * @param pindexTip The new tip.
+ */
+void CacheExpectedBetPayouts(const CBlockIndex* pindexTip)
+{
+    std::vector<CBetOut> vPLPayouts;
+    std::vector<CBetOut> vCGLottoPayouts;
+    if (!GetExpectedBetPayouts(pindexTip, vPLPayouts, vCGLottoPayouts))
+        LogPrintf("%s: failed to settle the payouts on top of block %d\n", __func__, pindexTip->nHeight);
+}
@@ -9,7 +9,12 @@
 #include "chainparams.h"
 
 #include <boost/filesystem/path.hpp>
+#include <boost/variant.hpp>
 #include <map>
+#include <memory>
+#include <set>
+
+class CBlockIndex;
 
 // The supported bet outcome types.
 typedef enum OutcomeType {
@@ -97,9 +102,18 @@ class CBetOut : public CTxOut {
     }
 };
 
+/** Maximum number of prevouts whose oracle status is cached by IsValidOracleTx(). **/
+static const unsigned int MAX_ORACLE_TX_CACHE_SIZE = 100000;
+
 /** Ensures a TX has come from an OMNO wallet. **/
 bool IsValidOracleTx(const CTxIn &txin);
 
+/** Drops the cached oracle status of the outputs of a transaction. **/
+void UncacheOracleTx(const CTransaction& tx);
+
+/** Gets the size and hit/miss counts of the oracle TX cache. **/
+void GetOracleTxCacheStats(size_t& nSize, uint64_t& nHits, uint64_t& nMisses);
+
 /** Aggregates the amount of WGR to be minted to pay out all bets as well as dev and OMNO rewards. **/
 int64_t GetBlockPayouts(std::vector<CBetOut>& vExpectedPayouts, CAmount& nMNBetReward);
 
@@ -107,7 +121,7 @@ int64_t GetBlockPayouts(std::vector<CBetOut>& vExpectedPayouts, CAmount& nMNBetR
 int64_t GetCGBlockPayouts(std::vector<CBetOut>& vexpectedCGPayouts, CAmount& nMNBetReward);
 
 /** Validating the payout block using the payout vector. **/
-bool IsBlockPayoutsValid(std::vector<CBetOut> vExpectedPayouts, CBlock block);
+bool IsBlockPayoutsValid(const std::vector<CBetOut>& vExpectedPayouts, const CBlock& block);
 
 class CPeerlessEvent
 {
@@ -386,6 +400,28 @@ public:
 // Define new map type to store Wagerr mappings.
 typedef std::map<uint32_t, CMapping> mappingIndex_t;
 
+// Returned by DecodeBetOpCode() for outputs that don't carry a betting op code.
+class CNoBetOpCode
+{
+};
+
+/**
+ * A decoded betting op code:
+ *  * CNoBetOpCode: no betting op code
+ *  * one of the betting transaction objects, picked by the op code's transaction type
+ */
+typedef boost::variant<CNoBetOpCode, CMapping, CPeerlessEvent, CPeerlessBet, CPeerlessResult, CPeerlessUpdateOdds,
+        CChainGamesEvent, CChainGamesBet, CChainGamesResult, CPeerlessSpreadsEvent, CPeerlessTotalsEvent> CBetOpCode;
+
+/** Get the op code carried by an OP_RETURN output script. **/
+bool GetBetOpCode(const CScript& script, std::string& opCode);
+
+/** Decode a betting op code into the object of its transaction type. **/
+bool DecodeBetOpCode(const std::string& opCode, CBetOpCode& betOpCode);
+
+/** Decode the betting op code of an output script. **/
+bool DecodeBetOpCode(const CScript& script, CBetOpCode& betOpCode);
+
 class CMappingDB
 {
 protected:
@@ -429,16 +465,23 @@ public:
     static void GetTournaments(mappingIndex_t &tournamentsIndex);
     static void SetTournaments(const mappingIndex_t &tournamentsIndex);
     static void AddTournament(CMapping ts);
+
+    static bool GetMapping(uint32_t nMType, uint32_t nId, CMapping &mapping);
+    static void RemoveMapping(uint32_t nMType, uint32_t nId);
 };
 
 // Define new map type to store Wagerr events.
 typedef std::map<uint32_t, CPeerlessEvent> eventIndex_t;
 
+// Read only copy of the event index, shared by readers until the index next changes.
+typedef std::shared_ptr<const eventIndex_t> eventIndexSnapshot_t;
+
 class CEventDB
 {
 protected:
     // Global variable that stores the current live Wagerr events.
     static eventIndex_t eventsIndex;
+    static eventIndexSnapshot_t eventsSnapshot;
     static CCriticalSection cs_setEvents;
 
 private:
@@ -453,9 +496,36 @@ public:
 
     static void GetEvents(eventIndex_t &eventIndex);
     static void SetEvents(const eventIndex_t &eventIndex);
+    static eventIndexSnapshot_t GetEventsSnapshot();
+
+    static bool GetEvent(uint32_t nEventId, CPeerlessEvent &pe);
+    static void SetEvent(const CPeerlessEvent &pe);
+    static void EraseEvent(uint32_t nEventId);
 
     static void AddEvent(CPeerlessEvent pe);
     static void RemoveEvent(CPeerlessResult pr);
+
+    /**
+     * Apply an update to a single event in place.
+     *
+     * @param nEventId The event ID.
+     * @param update   Called with the event while the index is locked.
+     * @return         Bool, false if there is no such event.
+     */
+    template <typename Update>
+    static bool UpdateEvent(uint32_t nEventId, Update update)
+    {
+        LOCK(cs_setEvents);
+
+        eventIndex_t::iterator it = eventsIndex.find(nEventId);
+        if (it == eventsIndex.end()) {
+            return false;
+        }
+
+        update(it->second);
+        eventsSnapshot.reset();
+        return true;
+    }
 };
 
 // Define new map type to store Wagerr results.
@@ -481,10 +551,86 @@ public:
     static void GetResults(resultsIndex_t &resultsIndex);
     static void SetResults(const resultsIndex_t &resultsIndex);
 
+    static bool GetResult(uint32_t nEventId, CPeerlessResult &pr);
+
     static void AddResult(CPeerlessResult pe);
     static void RemoveResult(CPeerlessResult pe);
 };
 
+// The markets of a peerless event, each with its own liability.
+typedef enum LiabilityMarket {
+    liabilityMoneyLineHome = 0,
+    liabilityMoneyLineAway = 1,
+    liabilityMoneyLineDraw = 2,
+    liabilitySpreadHome    = 3,
+    liabilitySpreadAway    = 4,
+    liabilitySpreadPush    = 5,
+    liabilityTotalOver     = 6,
+    liabilityTotalUnder    = 7,
+    liabilityTotalPush     = 8,
+    LIABILITY_MARKETS      = 9
+} LiabilityMarket;
+
+/** What the bets on a peerless event would pay out, by market, in satoshis. */
+class CEventLiability
+{
+public:
+    int nVersion;
+    std::vector<CAmount> vLiability;    // Potential payout of each market.
+    std::vector<uint32_t> vBets;        // Number of bets on each market.
+
+    CEventLiability() : nVersion(1), vLiability(LIABILITY_MARKETS, 0), vBets(LIABILITY_MARKETS, 0) {}
+
+    bool IsEmpty() const;
+
+    /** The most the event can pay out: the worst money line, spreads and totals outcomes added up. */
+    CAmount GetExposure() const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(this->nVersion);
+        nVersion = this->nVersion;
+        READWRITE(vLiability);
+        READWRITE(vBets);
+    }
+};
+
+typedef std::map<uint32_t, CEventLiability> liabilityIndex_t;
+
+/**
+ * The liability book: the potential payouts of the bets on each event. Bets are added one at a
+ * time and the events are kept ordered by exposure, so the largest ones and the total are found
+ * without going through the whole book.
+ */
+class CLiabilityDB
+{
+protected:
+    static liabilityIndex_t liabilityIndex;
+    static std::set<std::pair<CAmount, uint32_t> > setExposures;
+    static CAmount nTotalExposure;
+    static CCriticalSection cs_setLiabilities;
+
+    /** Replace the liability of an event, or remove it if pLiability is NULL or empty. Requires cs_setLiabilities. */
+    static void Update(uint32_t nEventId, const CEventLiability* pLiability);
+
+public:
+    static void SetLiabilities(const liabilityIndex_t &liabilities);
+
+    static bool GetLiability(uint32_t nEventId, CEventLiability &liability);
+    static void SetLiability(uint32_t nEventId, const CEventLiability &liability);
+
+    /** Add a bet with the given potential payout to a market of an event. */
+    static void AddBet(uint32_t nEventId, LiabilityMarket market, CAmount nPayout);
+
+    /** The exposure of all the events in the book added up, and the number of events. */
+    static CAmount GetTotalExposure(size_t &nEvents);
+    /** Up to nCount events with an exposure of at least nThreshold, largest first, along with the total from the same state. */
+    static CAmount GetTopExposures(size_t nCount, CAmount nThreshold, size_t &nEvents, std::vector<std::pair<uint32_t, CEventLiability> > &vTop);
+};
+
 /** Find peerless events. **/
 std::vector<CPeerlessResult> getEventResults(int height);
 
@@ -492,11 +638,20 @@ std::vector<CPeerlessResult> getEventResults(int height);
 std::pair<std::vector<CChainGamesResult>,std::vector<std::string>> getCGLottoEventResults(int height);
 
 /** Get the peerless winning bets from the block chain and return the payout vector. **/
-std::vector<CBetOut> GetBetPayouts(int height);
+bool GetBetPayouts(int height, std::vector<CBetOut>& vPayouts);
+
+/** Worker thread settling peerless results for GetBetPayouts. **/
+void ThreadBetSettlement();
 
 /** Get the chain games winner and return the payout vector. **/
 std::vector<CBetOut> GetCGLottoBetPayouts(int height);
 
+/** Get the peerless and chain games payouts of the next block, settled once per tip. **/
+bool GetExpectedBetPayouts(const CBlockIndex* pindexPrev, std::vector<CBetOut>& vPLPayouts, std::vector<CBetOut>& vCGLottoPayouts);
+
+/** Settle the payouts of the block on top of a newly connected tip. **/
+void CacheExpectedBetPayouts(const CBlockIndex* pindexTip);
+
 /** Set a peerless event spread odds **/
 void SetEventSpreadOdds(CPeerlessSpreadsEvent sEventOdds);
 
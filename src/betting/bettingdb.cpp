@@ -0,0 +1,1318 @@
+// Copyright (c) 2018 The Wagerr developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "betting/bettingdb.h"
+
+#include "base58.h"
+#include "betting/bet.h"
+#include "main.h"
+#include "script/standard.h"
+#include "guiinterface.h"
+#include "util.h"
+#include "validationinterface.h"
+
+#include <algorithm>
+#include <set>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+bool fBetIndex = false;
+
+CBettingDB::CBettingDB(size_t nCacheSize, bool fMemory, bool fWipe) : CLevelDBWrapper(GetDataDir() / "betting", nCacheSize, fMemory, fWipe)
+{
+}
+
+bool CBettingDB::ReadBestBlock(uint256& hashBlock)
+{
+    if (!Read('B', hashBlock))
+        hashBlock = uint256(0);
+    return true;
+}
+
+bool CBettingDB::WriteBestBlock(const uint256& hashBlock)
+{
+    return Write('B', hashBlock);
+}
+
+bool CBettingDB::ReadIndexVersion(int& nVersion)
+{
+    if (!Read('V', nVersion))
+        nVersion = 0;
+    return true;
+}
+
+bool CBettingDB::WriteIndexVersion(int nVersion)
+{
+    return Write('V', nVersion);
+}
+
+/**
+ * Add the Chain Games pots changed by a block to a batch. Pots left without entries are erased.
+ *
+ * @param batch   The batch to add to.
+ * @param mapPots The changed pots, by event id.
+ */
+static void WriteChainGamesPots(CLevelDBBatch& batch, const chainGamesPots_t& mapPots)
+{
+    for (const auto& pot : mapPots) {
+        if (pot.second.vEntries.empty())
+            batch.Erase(std::make_pair('g', pot.first));
+        else
+            batch.Write(std::make_pair('g', pot.first), pot.second);
+    }
+}
+
+/**
+ * Key of a bet in the payout address index.
+ *
+ * @param key          The bet index key of the bet.
+ * @param payoutScript The script the winnings of the bet are paid to.
+ */
+static CBetAddressKey BetAddressKey(const CBettingIndexKey& key, const CScript& payoutScript)
+{
+    return CBetAddressKey(Hash160(payoutScript.begin(), payoutScript.end()), key.nHeight, key.nTxIndex, key.nOutIndex);
+}
+
+bool CBettingDB::WriteIndexEntries(const bettingIndexEntries_t& vEntries, const uint256& hashBlock, const chainGamesPots_t& mapPots)
+{
+    CLevelDBBatch batch;
+    for (const auto& entry : vEntries) {
+        batch.Write(entry.first, entry.second);
+        if (fBetIndex && entry.second.nTxType == plBetTxType)
+            batch.Write(BetAddressKey(entry.first, entry.second.payoutScript), entry.first.nEventId);
+    }
+    WriteChainGamesPots(batch, mapPots);
+    batch.Write('B', hashBlock);
+
+    return WriteBatch(batch);
+}
+
+bool CBettingDB::EraseIndexEntries(const bettingIndexEntries_t& vEntries, const uint256& hashPrevBlock, const chainGamesPots_t& mapPots)
+{
+    CLevelDBBatch batch;
+    for (const auto& entry : vEntries) {
+        // The entries of a disconnected block don't have their payout script, so take it from the index.
+        CBettingIndexEntry entryStored;
+        if (fBetIndex && entry.second.nTxType == plBetTxType && Read(entry.first, entryStored))
+            batch.Erase(BetAddressKey(entry.first, entryStored.payoutScript));
+        batch.Erase(entry.first);
+    }
+    WriteChainGamesPots(batch, mapPots);
+    batch.Write('B', hashPrevBlock);
+
+    return WriteBatch(batch);
+}
+
+bool CBettingDB::ReadEventEntries(uint32_t nEventId, int nStartHeight, int nEndHeight, bettingIndexEntries_t& vEntries)
+{
+    if (nEndHeight < nStartHeight)
+        return true;
+
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << CBettingIndexKey(nEventId, std::max(nStartHeight, 0), 0, 0);
+    pcursor->Seek(ssKeySet.str());
+
+    while (pcursor->Valid()) {
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            if (slKey.size() != ssKeySet.size() || slKey.data()[0] != 'e')
+                break;
+
+            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            CBettingIndexKey key;
+            ssKey >> key;
+            if (key.nEventId != nEventId || key.nHeight > (uint32_t)nEndHeight)
+                break;
+
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            CBettingIndexEntry entry;
+            ssValue >> entry;
+
+            vEntries.emplace_back(key, entry);
+            pcursor->Next();
+        } catch (std::exception& e) {
+            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+
+    return true;
+}
+
+bool CBettingDB::ReadChainGamesPot(uint32_t nEventId, CChainGamesPot& pot)
+{
+    return Read(std::make_pair('g', nEventId), pot);
+}
+
+bool CBettingDB::ReadAddressIndexFlag(bool& fAddressIndex)
+{
+    if (!Read('A', fAddressIndex))
+        fAddressIndex = false;
+    return true;
+}
+
+bool CBettingDB::WriteAddressIndexFlag(bool fAddressIndex)
+{
+    return Write('A', fAddressIndex);
+}
+
+/**
+ * Whether a bet index entry is a peerless bet on the given outcome.
+ *
+ * @param entry    The entry.
+ * @param nOutcome The outcome, 0 for any.
+ * @return         Bool
+ */
+static bool IsBetOnOutcome(const CBettingIndexEntry& entry, int nOutcome)
+{
+    if (entry.nTxType != plBetTxType)
+        return false;
+
+    CPeerlessBet pb;
+    return nOutcome == 0 || (CPeerlessBet::FromOpCode(entry.opCode, pb) && pb.nOutcome == nOutcome);
+}
+
+bool CBettingDB::ReadEventBets(uint32_t nEventId, const CBettingIndexKey& posStart, int nEndHeight, int nOutcome, size_t nCount, bettingIndexEntries_t& vEntries, CBettingIndexKey& posNext)
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << CBettingIndexKey(nEventId, posStart.nHeight, posStart.nTxIndex, posStart.nOutIndex);
+    pcursor->Seek(ssKeySet.str());
+
+    posNext = CBettingIndexKey();
+    for (unsigned int nScanned = 0; pcursor->Valid(); nScanned++) {
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            if (slKey.size() != ssKeySet.size() || slKey.data()[0] != 'e')
+                break;
+
+            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            CBettingIndexKey key;
+            ssKey >> key;
+            if (key.nEventId != nEventId || key.nHeight > (uint32_t)nEndHeight)
+                break;
+            if (vEntries.size() >= nCount || nScanned >= MAX_BET_PAGE_SCAN) {
+                posNext = key;
+                break;
+            }
+
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            CBettingIndexEntry entry;
+            ssValue >> entry;
+
+            if (IsBetOnOutcome(entry, nOutcome))
+                vEntries.emplace_back(key, entry);
+            pcursor->Next();
+        } catch (std::exception& e) {
+            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+
+    return true;
+}
+
+bool CBettingDB::ReadAddressBets(const CScript& payoutScript, const CBettingIndexKey& posStart, int nEndHeight, int nOutcome, size_t nCount, bettingIndexEntries_t& vEntries, CBettingIndexKey& posNext)
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    CBetAddressKey keyStart = BetAddressKey(posStart, payoutScript);
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << keyStart;
+    pcursor->Seek(ssKeySet.str());
+
+    posNext = CBettingIndexKey();
+    for (unsigned int nScanned = 0; pcursor->Valid(); nScanned++) {
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            if (slKey.size() != ssKeySet.size() || slKey.data()[0] != 'a')
+                break;
+
+            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            CBetAddressKey addressKey;
+            ssKey >> addressKey;
+            if (addressKey.scriptHash != keyStart.scriptHash || addressKey.nHeight > (uint32_t)nEndHeight)
+                break;
+            if (vEntries.size() >= nCount || nScanned >= MAX_BET_PAGE_SCAN) {
+                posNext = CBettingIndexKey(0, addressKey.nHeight, addressKey.nTxIndex, addressKey.nOutIndex);
+                break;
+            }
+
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            uint32_t nEventId;
+            ssValue >> nEventId;
+
+            CBettingIndexKey key(nEventId, addressKey.nHeight, addressKey.nTxIndex, addressKey.nOutIndex);
+            CBettingIndexEntry entry;
+            if (!Read(key, entry))
+                return error("%s : bet %d/%d/%d missing from the bet index", __func__, key.nHeight, key.nTxIndex, key.nOutIndex);
+
+            if (IsBetOnOutcome(entry, nOutcome))
+                vEntries.emplace_back(key, entry);
+            pcursor->Next();
+        } catch (std::exception& e) {
+            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+
+    return true;
+}
+
+bool CBettingDB::WipeIndex()
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << CBettingIndexKey();
+    pcursor->Seek(ssKeySet.str());
+
+    CLevelDBBatch batch;
+    size_t count = 0;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        leveldb::Slice slKey = pcursor->key();
+        if (slKey.size() != ssKeySet.size() || slKey.data()[0] != 'e')
+            break;
+
+        CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+        CBettingIndexKey key;
+        ssKey >> key;
+        batch.Erase(key);
+
+        // Don't let the batch grow without bounds on a large index.
+        if (++count % 10000 == 0) {
+            if (!WriteBatch(batch))
+                return false;
+            batch = CLevelDBBatch();
+        }
+        pcursor->Next();
+    }
+
+    // The Chain Games pots are built along with the index.
+    CDataStream ssPotKeySet(SER_DISK, CLIENT_VERSION);
+    ssPotKeySet << std::make_pair('g', (uint32_t)0);
+    pcursor->Seek(ssPotKeySet.str());
+
+    while (pcursor->Valid()) {
+        leveldb::Slice slKey = pcursor->key();
+        if (slKey.size() != ssPotKeySet.size() || slKey.data()[0] != 'g')
+            break;
+
+        CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+        std::pair<char, uint32_t> key;
+        ssKey >> key;
+        batch.Erase(key);
+        pcursor->Next();
+    }
+
+    // So are the bets by payout address.
+    CDataStream ssAddressKeySet(SER_DISK, CLIENT_VERSION);
+    ssAddressKeySet << CBetAddressKey();
+    pcursor->Seek(ssAddressKeySet.str());
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        leveldb::Slice slKey = pcursor->key();
+        if (slKey.size() != ssAddressKeySet.size() || slKey.data()[0] != 'a')
+            break;
+
+        CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+        CBetAddressKey key;
+        ssKey >> key;
+        batch.Erase(key);
+
+        if (++count % 10000 == 0) {
+            if (!WriteBatch(batch))
+                return false;
+            batch = CLevelDBBatch();
+        }
+        pcursor->Next();
+    }
+    batch.Write('B', uint256(0));
+
+    LogPrintf("%s: erased %u bet index entries\n", __func__, (unsigned int)count);
+    return WriteBatch(batch, true);
+}
+
+bool CBettingDB::ReadBettingUndo(const uint256& hashBlock, CBettingUndo& undo)
+{
+    return Read(std::make_pair('u', hashBlock), undo);
+}
+
+bool CBettingDB::WriteBettingUndo(const uint256& hashBlock, const CBettingUndo& undo)
+{
+    return Write(std::make_pair('u', hashBlock), undo);
+}
+
+bool CBettingDB::EraseBettingUndo(const uint256& hashBlock)
+{
+    return Erase(std::make_pair('u', hashBlock));
+}
+
+bool CBettingDB::ReadStateBlock(uint256& hashBlock)
+{
+    return Read('S', hashBlock);
+}
+
+bool CBettingDB::WriteStateBlock(const uint256& hashBlock)
+{
+    return Write('S', hashBlock);
+}
+
+/**
+ * Read every record stored under a one byte key prefix.
+ *
+ * @param pcursor   A cursor on the database.
+ * @param chPrefix  The key prefix.
+ * @param vValues   The records found.
+ * @return          Bool
+ */
+template <typename K, typename V>
+static bool ReadPrefixed(leveldb::Iterator* pcursor, char chPrefix, std::vector<V>& vValues)
+{
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << std::make_pair(chPrefix, K());
+    pcursor->Seek(ssKeySet.str());
+
+    while (pcursor->Valid()) {
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            if (slKey.size() == 0 || slKey.data()[0] != chPrefix)
+                break;
+
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            V value;
+            ssValue >> value;
+
+            vValues.push_back(value);
+            pcursor->Next();
+        } catch (std::exception& e) {
+            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+
+    return true;
+}
+
+bool CBettingDB::ReadBettingState(eventIndex_t& eventIndex, resultsIndex_t& resultsIndex, std::vector<CMapping>& vMappings)
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    std::vector<CPeerlessEvent> vEvents;
+    std::vector<CPeerlessResult> vResults;
+    if (!ReadPrefixed<uint32_t>(pcursor.get(), 'v', vEvents) ||
+        !ReadPrefixed<uint32_t>(pcursor.get(), 'r', vResults) ||
+        !ReadPrefixed<std::pair<uint32_t, uint32_t> >(pcursor.get(), 'm', vMappings))
+        return false;
+
+    for (const CPeerlessEvent& pe : vEvents)
+        eventIndex[pe.nEventId] = pe;
+    for (const CPeerlessResult& pr : vResults)
+        resultsIndex[pr.nEventId] = pr;
+
+    return true;
+}
+
+bool CBettingDB::ReadLiabilities(liabilityIndex_t& liabilityIndex)
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << std::make_pair('l', (uint32_t)0);
+    pcursor->Seek(ssKeySet.str());
+
+    while (pcursor->Valid()) {
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            if (slKey.size() != ssKeySet.size() || slKey.data()[0] != 'l')
+                break;
+
+            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            uint32_t nEventId;
+            ssKey >> chType >> nEventId;
+
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> liabilityIndex[nEventId];
+
+            pcursor->Next();
+        } catch (std::exception& e) {
+            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+
+    return true;
+}
+
+bool CBettingDB::WriteBettingState(const eventIndex_t& eventIndex, const resultsIndex_t& resultsIndex, const std::vector<CMapping>& vMappings, const uint256& hashBlock)
+{
+    // Drop whatever state is stored first.
+    eventIndex_t eventIndexOld;
+    resultsIndex_t resultsIndexOld;
+    std::vector<CMapping> vMappingsOld;
+    liabilityIndex_t liabilityIndexOld;
+    if (!ReadBettingState(eventIndexOld, resultsIndexOld, vMappingsOld) || !ReadLiabilities(liabilityIndexOld))
+        return false;
+
+    CLevelDBBatch batch;
+    for (const auto& event : eventIndexOld)
+        batch.Erase(std::make_pair('v', event.first));
+    for (const auto& result : resultsIndexOld)
+        batch.Erase(std::make_pair('r', result.first));
+    for (const CMapping& mapping : vMappingsOld)
+        batch.Erase(std::make_pair('m', std::make_pair(mapping.nMType, mapping.nId)));
+    for (const auto& liability : liabilityIndexOld)
+        batch.Erase(std::make_pair('l', liability.first));
+
+    for (const auto& event : eventIndex)
+        batch.Write(std::make_pair('v', event.first), event.second);
+    for (const auto& result : resultsIndex)
+        batch.Write(std::make_pair('r', result.first), result.second);
+    for (const CMapping& mapping : vMappings)
+        batch.Write(std::make_pair('m', std::make_pair(mapping.nMType, mapping.nId)), mapping);
+    batch.Write('S', hashBlock);
+
+    return WriteBatch(batch, true);
+}
+
+/**
+ * Add the current state of the events, results and mappings changed by a block to a batch.
+ *
+ * @param batch The batch to add to.
+ * @param undo  The undo record of the block, which lists everything the block changed.
+ */
+static void WriteChangedState(CLevelDBBatch& batch, const CBettingUndo& undo)
+{
+    std::vector<uint32_t> vEvents = undo.vNewEvents;
+    for (const CPeerlessEvent& pe : undo.vPrevEvents)
+        vEvents.push_back(pe.nEventId);
+    for (uint32_t nEventId : vEvents) {
+        CPeerlessEvent pe;
+        if (CEventDB::GetEvent(nEventId, pe))
+            batch.Write(std::make_pair('v', nEventId), pe);
+        else
+            batch.Erase(std::make_pair('v', nEventId));
+
+        CEventLiability liability;
+        if (CLiabilityDB::GetLiability(nEventId, liability))
+            batch.Write(std::make_pair('l', nEventId), liability);
+        else
+            batch.Erase(std::make_pair('l', nEventId));
+    }
+
+    std::vector<uint32_t> vResults = undo.vNewResults;
+    for (const CPeerlessResult& pr : undo.vPrevResults)
+        vResults.push_back(pr.nEventId);
+    for (uint32_t nEventId : vResults) {
+        CPeerlessResult pr;
+        if (CResultDB::GetResult(nEventId, pr))
+            batch.Write(std::make_pair('r', nEventId), pr);
+        else
+            batch.Erase(std::make_pair('r', nEventId));
+    }
+
+    for (const auto& mappingKey : undo.vNewMappings) {
+        CMapping mapping;
+        if (CMappingDB::GetMapping(mappingKey.first, mappingKey.second, mapping))
+            batch.Write(std::make_pair('m', mappingKey), mapping);
+        else
+            batch.Erase(std::make_pair('m', mappingKey));
+    }
+}
+
+bool CBettingDB::ConnectBettingState(const CBettingUndo& undo, const uint256& hashBlock)
+{
+    CLevelDBBatch batch;
+    WriteChangedState(batch, undo);
+    batch.Write(std::make_pair('u', hashBlock), undo);
+    batch.Write('S', hashBlock);
+
+    return WriteBatch(batch);
+}
+
+bool CBettingDB::DisconnectBettingState(const CBettingUndo& undo, const uint256& hashBlock, const uint256& hashPrevBlock)
+{
+    CLevelDBBatch batch;
+    WriteChangedState(batch, undo);
+    batch.Erase(std::make_pair('u', hashBlock));
+    batch.Write('S', hashPrevBlock);
+
+    return WriteBatch(batch);
+}
+
+void CBettingUndo::SaveEvent(uint32_t nEventId)
+{
+    // Only the state before the first change made by the block is of interest.
+    if (std::find(vNewEvents.begin(), vNewEvents.end(), nEventId) != vNewEvents.end())
+        return;
+    for (const CPeerlessEvent& pe : vPrevEvents) {
+        if (pe.nEventId == nEventId)
+            return;
+    }
+
+    CPeerlessEvent pe;
+    if (CEventDB::GetEvent(nEventId, pe))
+        vPrevEvents.push_back(pe);
+    else
+        vNewEvents.push_back(nEventId);
+
+    // An event without bets has an empty liability, which removes it from the book again on disconnect.
+    CEventLiability liability;
+    CLiabilityDB::GetLiability(nEventId, liability);
+    vPrevLiabilities.emplace_back(nEventId, liability);
+}
+
+void CBettingUndo::SaveResult(uint32_t nEventId)
+{
+    if (std::find(vNewResults.begin(), vNewResults.end(), nEventId) != vNewResults.end())
+        return;
+    for (const CPeerlessResult& pr : vPrevResults) {
+        if (pr.nEventId == nEventId)
+            return;
+    }
+
+    CPeerlessResult pr;
+    if (CResultDB::GetResult(nEventId, pr))
+        vPrevResults.push_back(pr);
+    else
+        vNewResults.push_back(nEventId);
+}
+
+void CChainGamesPot::GetEntrants(int nStartHeight, CAmount& nEntryFee, std::vector<std::string>& vEntrants) const
+{
+    bool fEventFound = false;
+    nEntryFee = 0;
+
+    for (const CChainGamesPotEntry& entry : vEntries) {
+        if (entry.nHeight < (uint32_t)std::max(nStartHeight, 0))
+            continue;
+
+        if (entry.nTxType == cgEventTxType) {
+            nEntryFee = entry.nValue;
+            fEventFound = true;
+        }
+        else if (entry.nTxType == cgBetTxType && fEventFound && entry.nValue == nEntryFee) {
+            vEntrants.push_back(entry.address);
+        }
+    }
+}
+
+void CChainGamesPot::RemoveBlock(int nHeight)
+{
+    while (!vEntries.empty() && vEntries.back().nHeight >= (uint32_t)nHeight)
+        vEntries.pop_back();
+}
+
+/**
+ * Collect the bet index entries of a block: every peerless bet, and every peerless event,
+ * odds update and result posted by an oracle wallet. Chain Games entries, and Chain Games
+ * events and results posted by an oracle wallet, are collected for the pots of their events.
+ *
+ * @param block       The block to look through.
+ * @param nHeight     The height of the block.
+ * @param fConnect    When false only the keys are needed: the oracle and payout address lookups are
+ *                    skipped and every betting output is returned, so that none is left behind.
+ * @param vEntries    The entries found, in chain order.
+ * @param vPotEntries The Chain Games entries found and the ids of their events, in chain order.
+ */
+static void GetBlockIndexEntries(const CBlock& block, int nHeight, bool fConnect, bettingIndexEntries_t& vEntries,
+                                 std::vector<std::pair<uint32_t, CChainGamesPotEntry> >& vPotEntries)
+{
+    for (unsigned int nTx = 0; nTx < block.vtx.size(); nTx++) {
+        const CTransaction& tx = block.vtx[nTx];
+
+        // Only look up the oracle status once per transaction, and only when it is needed.
+        int nValidOracleTx = -1;
+
+        for (unsigned int nOut = 0; nOut < tx.vout.size(); nOut++) {
+            const CTxOut& txout = tx.vout[nOut];
+
+            // Decode the OP CODE from the transaction scriptPubKey.
+            CBetOpCode betOpCode;
+            std::string opCode;
+            if (!GetBetOpCode(txout.scriptPubKey, opCode))
+                continue;
+
+            // Chain Games results are read from the script, the same way the lotto payouts find them.
+            CChainGamesResult cgResult;
+            bool fCGResult = cgResult.FromScript(txout.scriptPubKey);
+            if (!fCGResult && !DecodeBetOpCode(opCode, betOpCode))
+                continue;
+
+            const CChainGamesEvent* cge = boost::get<CChainGamesEvent>(&betOpCode);
+            const CChainGamesBet* cgb = boost::get<CChainGamesBet>(&betOpCode);
+            if (fCGResult || cge || cgb) {
+                CChainGamesPotEntry potEntry;
+                potEntry.nTxType    = cge ? cgEventTxType : cgb ? cgBetTxType : cgResultTxType;
+                potEntry.nHeight    = nHeight;
+                potEntry.nBlockTime = block.nTime;
+
+                if (fConnect) {
+                    if (nValidOracleTx < 0)
+                        nValidOracleTx = IsValidOracleTx(tx.vin[0]) ? 1 : 0;
+
+                    // Events and results only count when they come from an oracle wallet.
+                    if (!cgb && !nValidOracleTx)
+                        continue;
+
+                    if (cge) {
+                        potEntry.nValue = cge->nEntryFee * COIN;
+                    }
+                    else if (cgb) {
+                        potEntry.nValue = txout.nValue;
+
+                        // Get the users payout address from the vin of the bet TX they used to place the bet.
+                        CTxDestination payoutAddress;
+                        const CTxIn& txin = tx.vin[0];
+
+                        uint256 hashBlock;
+                        CTransaction txPrev;
+                        if (GetTransaction(txin.prevout.hash, txPrev, hashBlock, true)) {
+                            ExtractDestination(txPrev.vout[txin.prevout.n].scriptPubKey, payoutAddress);
+                        }
+                        potEntry.address = CBitcoinAddress(payoutAddress).ToString();
+                    }
+                }
+
+                vPotEntries.emplace_back(cge ? cge->nEventId : cgb ? cgb->nEventId : (uint32_t)cgResult.nEventId, potEntry);
+                continue;
+            }
+
+            CBettingIndexEntry entry;
+            uint32_t nEventId = 0;
+
+            if (const CPeerlessBet* pb = boost::get<CPeerlessBet>(&betOpCode)) {
+                entry.nTxType = plBetTxType;
+                nEventId = pb->nEventId;
+            }
+            else if (const CPeerlessEvent* pe = boost::get<CPeerlessEvent>(&betOpCode)) {
+                entry.nTxType = plEventTxType;
+                nEventId = pe->nEventId;
+            }
+            else if (const CPeerlessUpdateOdds* puo = boost::get<CPeerlessUpdateOdds>(&betOpCode)) {
+                entry.nTxType = plUpdateOddsTxType;
+                nEventId = puo->nEventId;
+            }
+            else if (const CPeerlessSpreadsEvent* pse = boost::get<CPeerlessSpreadsEvent>(&betOpCode)) {
+                entry.nTxType = plSpreadsEventTxType;
+                nEventId = pse->nEventId;
+            }
+            else if (const CPeerlessTotalsEvent* pte = boost::get<CPeerlessTotalsEvent>(&betOpCode)) {
+                entry.nTxType = plTotalsEventTxType;
+                nEventId = pte->nEventId;
+            }
+            else if (const CPeerlessResult* pr = boost::get<CPeerlessResult>(&betOpCode)) {
+                entry.nTxType = plResultTxType;
+                nEventId = pr->nEventId;
+            }
+            else {
+                continue;
+            }
+
+            if (fConnect) {
+                if (nValidOracleTx < 0)
+                    nValidOracleTx = IsValidOracleTx(tx.vin[0]) ? 1 : 0;
+
+                // Events, odds and results only count when they come from an oracle wallet.
+                if (entry.nTxType != plBetTxType && !nValidOracleTx)
+                    continue;
+            }
+
+            if (fConnect && entry.nTxType == plBetTxType) {
+                // Get the users payout address from the vin of the bet TX they used to place the bet.
+                CTxDestination payoutAddress;
+                const CTxIn& txin = tx.vin[0];
+
+                uint256 hashBlock;
+                CTransaction txPrev;
+                if (GetTransaction(txin.prevout.hash, txPrev, hashBlock, true)) {
+                    ExtractDestination(txPrev.vout[txin.prevout.n].scriptPubKey, payoutAddress);
+                }
+                entry.payoutScript = GetScriptForDestination(CBitcoinAddress(payoutAddress).Get());
+            }
+
+            entry.fOracleTx  = nValidOracleTx > 0;
+            entry.nBlockTime = block.nTime;
+            entry.nValue     = txout.nValue;
+            entry.opCode     = opCode;
+            entry.txHash     = tx.GetHash();
+
+            vEntries.emplace_back(CBettingIndexKey(nEventId, nHeight, nTx, nOut), entry);
+        }
+    }
+}
+
+/**
+ * Add the betting transactions of a block to the bet index.
+ *
+ * @param block  The block.
+ * @param pindex The block index of the block.
+ * @return       Bool
+ */
+static bool WriteBlockIndexEntries(const CBlock& block, const CBlockIndex* pindex)
+{
+    bettingIndexEntries_t vEntries;
+    std::vector<std::pair<uint32_t, CChainGamesPotEntry> > vPotEntries;
+    GetBlockIndexEntries(block, pindex->nHeight, true, vEntries, vPotEntries);
+
+    // Add the Chain Games entries of the block to the pots of their events.
+    chainGamesPots_t mapPots;
+    for (const auto& potEntry : vPotEntries) {
+        if (!mapPots.count(potEntry.first))
+            bettingDB->ReadChainGamesPot(potEntry.first, mapPots[potEntry.first]);
+        mapPots[potEntry.first].vEntries.push_back(potEntry.second);
+    }
+
+    return bettingDB->WriteIndexEntries(vEntries, pindex->GetBlockHash(), mapPots);
+}
+
+/**
+ * Add the betting transactions of a newly connected block to the bet index. An empty index
+ * starts at the block, as it does on -reindex where the genesis block is never connected.
+ * An index behind the block is caught up from the blocks in between first.
+ *
+ * @param block  The connected block.
+ * @param pindex The block index of the connected block.
+ * @return       False if the block doesn't extend the index or the index can't be written.
+ */
+bool ConnectBettingIndex(const CBlock& block, const CBlockIndex* pindex)
+{
+    uint256 hashBest;
+    bettingDB->ReadBestBlock(hashBest);
+
+    uint256 hashPrev = pindex->pprev ? pindex->pprev->GetBlockHash() : uint256(0);
+    if (hashBest != 0 && hashBest != hashPrev) {
+        BlockMap::iterator mi = mapBlockIndex.find(hashBest);
+        if (mi == mapBlockIndex.end() || pindex->GetAncestor(mi->second->nHeight) != mi->second)
+            return error("%s: bet index best block %s is not an ancestor of block %s", __func__, hashBest.GetHex(), pindex->GetBlockHash().GetHex());
+
+        LogPrintf("%s: catching the bet index up from block %d to %d\n", __func__, mi->second->nHeight, pindex->nHeight);
+        for (int nHeight = mi->second->nHeight + 1; nHeight < pindex->nHeight; nHeight++) {
+            const CBlockIndex* pindexMissing = pindex->GetAncestor(nHeight);
+            CBlock blockMissing;
+            if (!ReadBlockFromDisk(blockMissing, pindexMissing))
+                return error("%s: failed to read block %s", __func__, pindexMissing->GetBlockHash().GetHex());
+            if (!WriteBlockIndexEntries(blockMissing, pindexMissing))
+                return false;
+        }
+    }
+
+    return WriteBlockIndexEntries(block, pindex);
+}
+
+/**
+ * Remove the betting transactions of a disconnected block from the bet index.
+ *
+ * @param block  The disconnected block.
+ * @param pindex The block index of the disconnected block.
+ * @return       Bool
+ */
+bool DisconnectBettingIndex(const CBlock& block, const CBlockIndex* pindex)
+{
+    uint256 hashBest;
+    bettingDB->ReadBestBlock(hashBest);
+
+    // Nothing to undo for a block the index hasn't reached, anything else means the index is off the chain.
+    if (hashBest != pindex->GetBlockHash()) {
+        BlockMap::iterator mi = mapBlockIndex.find(hashBest);
+        if (hashBest == 0 || (mi != mapBlockIndex.end() && pindex->GetAncestor(mi->second->nHeight) == mi->second))
+            return true;
+        return error("%s: bet index best block %s doesn't lead to block %s", __func__, hashBest.GetHex(), pindex->GetBlockHash().GetHex());
+    }
+
+    bettingIndexEntries_t vEntries;
+    std::vector<std::pair<uint32_t, CChainGamesPotEntry> > vPotEntries;
+    GetBlockIndexEntries(block, pindex->nHeight, false, vEntries, vPotEntries);
+
+    // Take the Chain Games entries of the block back out of the pots of their events.
+    chainGamesPots_t mapPots;
+    for (const auto& potEntry : vPotEntries) {
+        if (mapPots.count(potEntry.first))
+            continue;
+        if (!bettingDB->ReadChainGamesPot(potEntry.first, mapPots[potEntry.first])) {
+            mapPots.erase(potEntry.first);
+            continue;
+        }
+        mapPots[potEntry.first].RemoveBlock(pindex->nHeight);
+    }
+
+    uint256 hashPrev = pindex->pprev ? pindex->pprev->GetBlockHash() : uint256(0);
+    return bettingDB->EraseIndexEntries(vEntries, hashPrev, mapPots);
+}
+
+/**
+ * Look through a connected block for any events, results, odds updates, mappings or bets and
+ * apply them to the betting state. The state each change replaces is recorded in an undo
+ * record, so that DisconnectBettingBlock() can revert it. Once the changes are stored, the
+ * events, results and odds the block changed are announced to the validation interfaces.
+ *
+ * @param block  The connected block.
+ * @param pindex The block index of the connected block.
+ * @return       Bool
+ */
+bool ConnectBettingBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // The state block is moved along for every block, so SyncBettingState() can tell where the state is.
+    if (pindex->nHeight <= Params().BetStartHeight())
+        return bettingDB->WriteStateBlock(block.GetHash());
+
+    CBettingUndo undo;
+    // The events, odds and results to announce, in the order the block changed them.
+    std::vector<uint32_t> vChangedEvents, vChangedOdds;
+    std::vector<CPeerlessResult> vNewResults;
+
+    for (const CTransaction& tx : block.vtx) {
+
+        // Decode the betting op codes of the TX outputs once.
+        std::vector<std::pair<CBetOpCode, CAmount> > vBetOpCodes;
+        for (const CTxOut& txout : tx.vout) {
+            CBetOpCode betOpCode;
+            if (DecodeBetOpCode(txout.scriptPubKey, betOpCode))
+                vBetOpCodes.emplace_back(betOpCode, txout.nValue);
+        }
+
+        if (vBetOpCodes.empty())
+            continue;
+
+        // Search for any new bets
+        for (const auto& betOpCode : vBetOpCodes) {
+            if (const CPeerlessBet* plBet = boost::get<CPeerlessBet>(&betOpCode.first)) {
+                undo.SaveEvent(plBet->nEventId);
+                SetEventAccummulators(*plBet, betOpCode.second);
+            }
+        }
+
+        // Ensure the event TX has come from Oracle wallet, only the Oracle wallet can post events,
+        // results, odds and mappings.
+        const CTxIn &txin = tx.vin[0];
+        if (!IsValidOracleTx(txin))
+            continue;
+
+        for (const auto& betOpCode : vBetOpCodes) {
+
+            // If events found in block add them to the events index.
+            if (const CPeerlessEvent* plEvent = boost::get<CPeerlessEvent>(&betOpCode.first)) {
+                undo.SaveEvent(plEvent->nEventId);
+                CEventDB::AddEvent(*plEvent);
+                vChangedEvents.push_back(plEvent->nEventId);
+            }
+
+            // If results found in block add the result to the result index.
+            else if (const CPeerlessResult* plResult = boost::get<CPeerlessResult>(&betOpCode.first)) {
+                undo.SaveResult(plResult->nEventId);
+                CResultDB::AddResult(*plResult);
+                vNewResults.push_back(*plResult);
+            }
+
+            // If update money line odds TX found in block, update the event index.
+            else if (const CPeerlessUpdateOdds* puo = boost::get<CPeerlessUpdateOdds>(&betOpCode.first)) {
+                undo.SaveEvent(puo->nEventId);
+                SetEventMLOdds(*puo);
+                vChangedOdds.push_back(puo->nEventId);
+            }
+
+            // If spread odds TX found then update the spread odds for that event object.
+            else if (const CPeerlessSpreadsEvent* spreadEvent = boost::get<CPeerlessSpreadsEvent>(&betOpCode.first)) {
+                undo.SaveEvent(spreadEvent->nEventId);
+                SetEventSpreadOdds(*spreadEvent);
+                vChangedOdds.push_back(spreadEvent->nEventId);
+            }
+
+            // If total odds TX found then update the total odds for that event object.
+            else if (const CPeerlessTotalsEvent* totalsEvent = boost::get<CPeerlessTotalsEvent>(&betOpCode.first)) {
+                undo.SaveEvent(totalsEvent->nEventId);
+                SetEventTotalOdds(*totalsEvent);
+                vChangedOdds.push_back(totalsEvent->nEventId);
+            }
+
+            // If mapping found then add it to the relating mapping index. Existing mappings are never overwritten.
+            else if (const CMapping* cMapping = boost::get<CMapping>(&betOpCode.first)) {
+                CMapping existing;
+                if (CMappingDB::GetMapping(cMapping->nMType, cMapping->nId, existing))
+                    continue;
+
+                if (cMapping->nMType == sportMapping) {
+                    CMappingDB::AddSport(*cMapping);
+                }
+                else if (cMapping->nMType == roundMapping) {
+                    CMappingDB::AddRound(*cMapping);
+                }
+                else if (cMapping->nMType == teamMapping) {
+                    CMappingDB::AddTeam(*cMapping);
+                }
+                else if (cMapping->nMType == tournamentMapping) {
+                    CMappingDB::AddTournament(*cMapping);
+                }
+                else {
+                    continue;
+                }
+
+                undo.vNewMappings.emplace_back(cMapping->nMType, cMapping->nId);
+            }
+        }
+    }
+
+    if (undo.IsEmpty())
+        return bettingDB->WriteStateBlock(block.GetHash());
+
+    // Store what the block changed, and how to revert it, in one batch.
+    if (!bettingDB->ConnectBettingState(undo, block.GetHash()))
+        return false;
+
+    // Listeners get the latest state of each event once per notification type, even if the block changed it several times.
+    std::set<uint32_t> setEventsNotified, setOddsNotified;
+    for (uint32_t nEventId : vChangedEvents) {
+        CPeerlessEvent pe;
+        if (setEventsNotified.insert(nEventId).second && CEventDB::GetEvent(nEventId, pe))
+            GetMainSignals().NotifyBetEvent(pe);
+    }
+    for (uint32_t nEventId : vChangedOdds) {
+        CPeerlessEvent pe;
+        if (setOddsNotified.insert(nEventId).second && CEventDB::GetEvent(nEventId, pe))
+            GetMainSignals().NotifyBetOdds(pe);
+    }
+    for (const CPeerlessResult& pr : vNewResults)
+        GetMainSignals().NotifyBetResult(pr);
+
+    return true;
+}
+
+/**
+ * Rebuild the liability of an event from its whole WGR counters, for events stored before the
+ * liability book existed.
+ *
+ * @param pe The event.
+ * @return   The liability, rounded down to whole WGR.
+ */
+static CEventLiability LegacyEventLiability(const CPeerlessEvent& pe)
+{
+    // The counters hold whole WGR, with the payouts still scaled by the odds divisor.
+    CAmount nOddsDivisor = Params().OddsDivisor();
+
+    CEventLiability liability;
+    liability.vLiability[liabilityMoneyLineHome] = (CAmount)pe.nMoneyLineHomePotentialLiability * COIN / nOddsDivisor;
+    liability.vLiability[liabilityMoneyLineAway] = (CAmount)pe.nMoneyLineAwayPotentialLiability * COIN / nOddsDivisor;
+    liability.vLiability[liabilityMoneyLineDraw] = (CAmount)pe.nMoneyLineDrawPotentialLiability * COIN / nOddsDivisor;
+    liability.vLiability[liabilitySpreadHome] = (CAmount)pe.nSpreadHomePotentialLiability * COIN / nOddsDivisor;
+    liability.vLiability[liabilitySpreadAway] = (CAmount)pe.nSpreadAwayPotentialLiability * COIN / nOddsDivisor;
+    liability.vLiability[liabilitySpreadPush] = (CAmount)pe.nSpreadPushPotentialLiability * COIN;
+    liability.vLiability[liabilityTotalOver] = (CAmount)pe.nTotalOverPotentialLiability * COIN / nOddsDivisor;
+    liability.vLiability[liabilityTotalUnder] = (CAmount)pe.nTotalUnderPotentialLiability * COIN / nOddsDivisor;
+    liability.vLiability[liabilityTotalPush] = (CAmount)pe.nTotalPushPotentialLiability * COIN;
+    liability.vBets[liabilityMoneyLineHome] = pe.nMoneyLineHomeBets;
+    liability.vBets[liabilityMoneyLineAway] = pe.nMoneyLineAwayBets;
+    liability.vBets[liabilityMoneyLineDraw] = pe.nMoneyLineDrawBets;
+    liability.vBets[liabilitySpreadHome] = pe.nSpreadHomeBets;
+    liability.vBets[liabilitySpreadAway] = pe.nSpreadAwayBets;
+    liability.vBets[liabilitySpreadPush] = pe.nSpreadPushBets;
+    liability.vBets[liabilityTotalOver] = pe.nTotalOverBets;
+    liability.vBets[liabilityTotalUnder] = pe.nTotalUnderBets;
+    liability.vBets[liabilityTotalPush] = pe.nTotalPushBets;
+    return liability;
+}
+
+/**
+ * Revert the betting state changes of a disconnected block using its undo record.
+ *
+ * @param block  The disconnected block.
+ * @param pindex The block index of the disconnected block.
+ * @return       Bool
+ */
+bool DisconnectBettingBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // The outputs of a disconnected block may not exist on the new chain, so stop caching them.
+    for (const CTransaction& tx : block.vtx)
+        UncacheOracleTx(tx);
+
+    uint256 hashPrev = pindex->pprev ? pindex->pprev->GetBlockHash() : uint256(0);
+
+    CBettingUndo undo;
+    // Blocks without betting changes, and blocks connected before undo records existed, have no record.
+    if (!bettingDB->ReadBettingUndo(block.GetHash(), undo))
+        return bettingDB->WriteStateBlock(hashPrev);
+
+    for (const CPeerlessEvent& pe : undo.vPrevEvents)
+        CEventDB::SetEvent(pe);
+    for (uint32_t nEventId : undo.vNewEvents)
+        CEventDB::EraseEvent(nEventId);
+
+    for (const auto& liability : undo.vPrevLiabilities)
+        CLiabilityDB::SetLiability(liability.first, liability.second);
+    // Undo records written before the liability book only have the counters of the events to go back to.
+    if (undo.nVersion < 2) {
+        for (const CPeerlessEvent& pe : undo.vPrevEvents)
+            CLiabilityDB::SetLiability(pe.nEventId, LegacyEventLiability(pe));
+        for (uint32_t nEventId : undo.vNewEvents)
+            CLiabilityDB::SetLiability(nEventId, CEventLiability());
+    }
+
+    for (const CPeerlessResult& pr : undo.vPrevResults)
+        CResultDB::AddResult(pr);
+    for (uint32_t nEventId : undo.vNewResults) {
+        CPeerlessResult pr;
+        pr.nEventId = nEventId;
+        CResultDB::RemoveResult(pr);
+    }
+
+    for (const auto& mapping : undo.vNewMappings)
+        CMappingDB::RemoveMapping(mapping.first, mapping.second);
+
+    return bettingDB->DisconnectBettingState(undo, block.GetHash(), hashPrev);
+}
+
+/**
+ * Roll the bet index back to the active chain and then forward to its tip. A missing
+ * index is built from the start of the bet lookback window, which is all that the
+ * payout calculation reads.
+ *
+ * @return Bool
+ */
+bool SyncBettingIndex()
+{
+    LOCK(cs_main);
+
+    uint256 hashBest;
+    bettingDB->ReadBestBlock(hashBest);
+
+    // An index built by an older version lacks what has been added to it since.
+    int nIndexVersion;
+    bettingDB->ReadIndexVersion(nIndexVersion);
+    if (hashBest != 0 && nIndexVersion < BETTING_INDEX_VERSION) {
+        LogPrintf("%s: bet index version %d is outdated, rebuilding\n", __func__, nIndexVersion);
+        if (!bettingDB->WipeIndex())
+            return error("%s: failed to wipe the bet index", __func__);
+        hashBest = 0;
+    }
+    if (!bettingDB->WriteIndexVersion(BETTING_INDEX_VERSION))
+        return error("%s: failed to write the bet index version", __func__);
+
+    // The bets by payout address cover the whole chain, so turning -betindex on or off rebuilds the index.
+    bool fAddressIndex;
+    bettingDB->ReadAddressIndexFlag(fAddressIndex);
+    if (hashBest != 0 && fAddressIndex != fBetIndex) {
+        LogPrintf("%s: -betindex changed, rebuilding\n", __func__);
+        if (!bettingDB->WipeIndex())
+            return error("%s: failed to wipe the bet index", __func__);
+        hashBest = 0;
+    }
+    if (!bettingDB->WriteAddressIndexFlag(fBetIndex))
+        return error("%s: failed to write the -betindex flag", __func__);
+
+    CBlockIndex* pindexBest = NULL;
+    if (hashBest != 0) {
+        BlockMap::iterator mi = mapBlockIndex.find(hashBest);
+        if (mi == mapBlockIndex.end()) {
+            LogPrintf("%s: bet index best block %s unknown, rebuilding\n", __func__, hashBest.GetHex());
+            if (!bettingDB->WipeIndex())
+                return error("%s: failed to wipe the bet index", __func__);
+        } else {
+            pindexBest = mi->second;
+        }
+    }
+
+    // Undo blocks that are no longer part of the active chain.
+    while (pindexBest && !chainActive.Contains(pindexBest)) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindexBest))
+            return error("%s: failed to read block %s", __func__, pindexBest->GetBlockHash().GetHex());
+        if (!DisconnectBettingIndex(block, pindexBest))
+            return error("%s: failed to disconnect block %s", __func__, pindexBest->GetBlockHash().GetHex());
+        pindexBest = pindexBest->pprev;
+    }
+
+    CBlockIndex* pindex = NULL;
+    if (pindexBest) {
+        pindex = chainActive.Next(pindexBest);
+    } else if (chainActive.Tip()) {
+        // Settlement only looks back BetBlocksIndexTimespan blocks, the bet explorer needs every bet.
+        int nStartHeight = chainActive.Height() - Params().BetBlocksIndexTimespan();
+        if (fBetIndex)
+            nStartHeight = std::min(nStartHeight, Params().BetStartHeight());
+        pindex = chainActive[std::max(0, nStartHeight)];
+        if (!bettingDB->WriteBestBlock(pindex->pprev ? pindex->pprev->GetBlockHash() : uint256(0)))
+            return error("%s: failed to write the bet index best block", __func__);
+    }
+
+    if (pindex) {
+        LogPrintf("%s: indexing bets from block %d to %d\n", __func__, pindex->nHeight, chainActive.Height());
+        uiInterface.InitMessage(_("Building bet index..."));
+    }
+
+    for (; pindex; pindex = chainActive.Next(pindex)) {
+        boost::this_thread::interruption_point();
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex))
+            return error("%s: failed to read block %s", __func__, pindex->GetBlockHash().GetHex());
+        if (!ConnectBettingIndex(block, pindex))
+            return error("%s: failed to connect block %s", __func__, pindex->GetBlockHash().GetHex());
+    }
+
+    return true;
+}
+
+/**
+ * Read a mapping index from its .dat file and add its mappings to a list.
+ *
+ * @param strFileName The .dat file.
+ * @param nMType      The mapping type the file holds.
+ * @param vMappings   The mappings read.
+ */
+static void ReadMappingsDat(const std::string& strFileName, uint32_t nMType, std::vector<CMapping>& vMappings)
+{
+    mappingIndex_t mappingIndex;
+    uint256 hashBlock;
+    if (!CMappingDB(strFileName).Read(mappingIndex, hashBlock))
+        LogPrintf("%s: invalid or missing %s\n", __func__, strFileName);
+
+    for (const auto& mapping : mappingIndex) {
+        vMappings.push_back(mapping.second);
+        vMappings.back().nMType = nMType;
+        vMappings.back().nId = mapping.first;
+    }
+}
+
+/**
+ * Load the events, results and mappings into their indexes. Older versions kept them in .dat
+ * files that were rewritten whole for every change; when the betting database doesn't hold
+ * any state yet those files are imported into it once, and are not used after that.
+ *
+ * @param fImportDatFiles Whether to import the .dat files, false when the betting state is
+ *                        rebuilt from the start of the chain.
+ * @return                Bool
+ */
+bool LoadBettingState(bool fImportDatFiles)
+{
+    eventIndex_t eventIndex;
+    resultsIndex_t resultsIndex;
+    std::vector<CMapping> vMappings;
+
+    uint256 hashBlock;
+    if (bettingDB->ReadStateBlock(hashBlock)) {
+        if (!bettingDB->ReadBettingState(eventIndex, resultsIndex, vMappings))
+            return error("%s: failed to read the betting state", __func__);
+    } else if (fImportDatFiles) {
+        uint256 hashDatBlock, hashResultsBlock;
+        if (!CEventDB().Read(eventIndex, hashDatBlock))
+            LogPrintf("%s: invalid or missing events.dat\n", __func__);
+        if (!CResultDB().Read(resultsIndex, hashResultsBlock))
+            LogPrintf("%s: invalid or missing results.dat\n", __func__);
+        ReadMappingsDat("sports.dat", sportMapping, vMappings);
+        ReadMappingsDat("rounds.dat", roundMapping, vMappings);
+        ReadMappingsDat("teams.dat", teamMapping, vMappings);
+        ReadMappingsDat("tournaments.dat", tournamentMapping, vMappings);
+
+        LogPrintf("%s: importing %u events, %u results and %u mappings from the .dat files\n", __func__,
+                  (unsigned int)eventIndex.size(), (unsigned int)resultsIndex.size(), (unsigned int)vMappings.size());
+        if (!bettingDB->WriteBettingState(eventIndex, resultsIndex, vMappings, hashDatBlock))
+            return error("%s: failed to write the betting state", __func__);
+    }
+
+    // Events stored before the liability book existed get theirs from the whole WGR counters.
+    liabilityIndex_t liabilityIndex;
+    if (!bettingDB->ReadLiabilities(liabilityIndex))
+        return error("%s: failed to read the liabilities", __func__);
+    for (const auto& event : eventIndex) {
+        if (!liabilityIndex.count(event.first))
+            liabilityIndex[event.first] = LegacyEventLiability(event.second);
+    }
+
+    mappingIndex_t sportsIndex, roundsIndex, teamsIndex, tournamentsIndex;
+    for (const CMapping& mapping : vMappings) {
+        if (mapping.nMType == sportMapping)
+            sportsIndex[mapping.nId] = mapping;
+        else if (mapping.nMType == roundMapping)
+            roundsIndex[mapping.nId] = mapping;
+        else if (mapping.nMType == teamMapping)
+            teamsIndex[mapping.nId] = mapping;
+        else if (mapping.nMType == tournamentMapping)
+            tournamentsIndex[mapping.nId] = mapping;
+    }
+
+    CEventDB::SetEvents(eventIndex);
+    CResultDB::SetResults(resultsIndex);
+    CLiabilityDB::SetLiabilities(liabilityIndex);
+    CMappingDB::SetSports(sportsIndex);
+    CMappingDB::SetRounds(roundsIndex);
+    CMappingDB::SetTeams(teamsIndex);
+    CMappingDB::SetTournaments(tournamentsIndex);
+
+    return true;
+}
+
+/**
+ * Roll the betting state back to the active chain and then forward to its tip. The state is
+ * written without syncing and apart from the chainstate, so after an unclean shutdown it can
+ * be behind or ahead of the chain. A state whose block is unknown is rebuilt from the start.
+ *
+ * @return Bool
+ */
+bool SyncBettingState()
+{
+    LOCK(cs_main);
+
+    // On a reindex the state is rebuilt as the blocks are connected.
+    if (!chainActive.Tip())
+        return true;
+
+    uint256 hashState;
+    if (!bettingDB->ReadStateBlock(hashState))
+        hashState = 0;
+
+    CBlockIndex* pindexState = NULL;
+    if (hashState != 0) {
+        BlockMap::iterator mi = mapBlockIndex.find(hashState);
+        if (mi == mapBlockIndex.end()) {
+            LogPrintf("%s: betting state block %s unknown, rebuilding\n", __func__, hashState.GetHex());
+            if (!bettingDB->WriteBettingState(eventIndex_t(), resultsIndex_t(), std::vector<CMapping>(), uint256(0)) || !LoadBettingState(false))
+                return error("%s: failed to wipe the betting state", __func__);
+        } else {
+            pindexState = mi->second;
+        }
+    }
+
+    // Undo blocks that are no longer part of the active chain.
+    while (pindexState && !chainActive.Contains(pindexState)) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindexState))
+            return error("%s: failed to read block %s", __func__, pindexState->GetBlockHash().GetHex());
+        if (!DisconnectBettingBlock(block, pindexState))
+            return error("%s: failed to disconnect block %s", __func__, pindexState->GetBlockHash().GetHex());
+        pindexState = pindexState->pprev;
+    }
+
+    CBlockIndex* pindex = pindexState ? chainActive.Next(pindexState) : chainActive.Genesis();
+
+    // Blocks up to the bet start height don't change the state, so they aren't read.
+    if (pindex && pindex->nHeight <= Params().BetStartHeight()) {
+        pindex = chainActive[std::min(Params().BetStartHeight(), chainActive.Height())];
+        if (!bettingDB->WriteStateBlock(pindex->GetBlockHash()))
+            return error("%s: failed to write the betting state block", __func__);
+        pindex = chainActive.Next(pindex);
+    }
+
+    if (pindex) {
+        LogPrintf("%s: applying blocks %d to %d to the betting state\n", __func__, pindex->nHeight, chainActive.Height());
+        uiInterface.InitMessage(_("Updating the betting state..."));
+    }
+
+    for (; pindex; pindex = chainActive.Next(pindex)) {
+        boost::this_thread::interruption_point();
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex))
+            return error("%s: failed to read block %s", __func__, pindex->GetBlockHash().GetHex());
+        if (!ConnectBettingBlock(block, pindex))
+            return error("%s: failed to connect block %s", __func__, pindex->GetBlockHash().GetHex());
+    }
+
+    return true;
+}
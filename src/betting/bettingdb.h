@@ -0,0 +1,400 @@
+// Copyright (c) 2018 The Wagerr developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef WAGERR_BETTINGDB_H
+#define WAGERR_BETTINGDB_H
+
+#include "amount.h"
+#include "betting/bet.h"
+#include "crypto/common.h"
+#include "leveldbwrapper.h"
+#include "script/script.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+class CBlock;
+class CBlockIndex;
+
+template <typename T>
+class CCheckQueue;
+
+/** Version of the bet index. Version 2 adds the Chain Games pots, version 3 the transaction of each entry. */
+static const int BETTING_INDEX_VERSION = 3;
+
+/** Most index entries ReadEventBets() and ReadAddressBets() look at in one call, which bounds an outcome filtered page. */
+static const unsigned int MAX_BET_PAGE_SCAN = 10000;
+
+/** Whether the bets are also indexed by payout address (-betindex). */
+extern bool fBetIndex;
+
+/**
+ * Key of a bet index entry.
+ *
+ * The numeric fields are serialized big endian so that LevelDB keeps all the
+ * entries of an event together and ordered the same way the chain is: by
+ * height, then by transaction and output position within the block.
+ */
+class CBettingIndexKey
+{
+public:
+    uint32_t nEventId;
+    uint32_t nHeight;
+    uint32_t nTxIndex;
+    uint32_t nOutIndex;
+
+    CBettingIndexKey() : nEventId(0), nHeight(0), nTxIndex(0), nOutIndex(0) {}
+
+    CBettingIndexKey(uint32_t nEventIdIn, uint32_t nHeightIn, uint32_t nTxIndexIn, uint32_t nOutIndexIn) :
+            nEventId(nEventIdIn), nHeight(nHeightIn), nTxIndex(nTxIndexIn), nOutIndex(nOutIndexIn) {}
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return 1 + 4 * 4;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        unsigned char buf[1 + 4 * 4];
+        buf[0] = 'e';
+        WriteBE32(buf + 1, nEventId);
+        WriteBE32(buf + 5, nHeight);
+        WriteBE32(buf + 9, nTxIndex);
+        WriteBE32(buf + 13, nOutIndex);
+        s.write((char*)buf, sizeof(buf));
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        unsigned char buf[1 + 4 * 4];
+        s.read((char*)buf, sizeof(buf));
+        nEventId  = ReadBE32(buf + 1);
+        nHeight   = ReadBE32(buf + 5);
+        nTxIndex  = ReadBE32(buf + 9);
+        nOutIndex = ReadBE32(buf + 13);
+    }
+};
+
+/**
+ * A betting operation (event, odds update, result or bet) found in a block,
+ * stored in the bet index under the event it refers to.
+ */
+class CBettingIndexEntry
+{
+public:
+    int nVersion;
+
+    uint8_t nTxType;        // The BetTxTypes of the op code.
+    bool fOracleTx;         // Whether the transaction has been posted by an oracle wallet.
+    uint32_t nBlockTime;    // Time of the block holding the transaction.
+    CAmount nValue;         // Value of the OP_RETURN output, i.e. the bet amount.
+    std::string opCode;     // The decoded OP_RETURN op code.
+    CScript payoutScript;   // Bets only: the script the winnings are paid to.
+    uint256 txHash;         // The transaction holding the op code.
+
+    CBettingIndexEntry() : nVersion(2), nTxType(0), fOracleTx(false), nBlockTime(0), nValue(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(this->nVersion);
+        nVersion = this->nVersion;
+        READWRITE(nTxType);
+        READWRITE(fOracleTx);
+        READWRITE(nBlockTime);
+        READWRITE(nValue);
+        READWRITE(opCode);
+        READWRITE(payoutScript);
+        if (this->nVersion >= 2)
+            READWRITE(txHash);
+    }
+};
+
+typedef std::vector<std::pair<CBettingIndexKey, CBettingIndexEntry> > bettingIndexEntries_t;
+
+/**
+ * Key of a bet in the payout address index kept with -betindex. It points to the
+ * bet index entry of the bet, and its value is the event the bet was placed on.
+ *
+ * Like CBettingIndexKey it is serialized big endian, keeping the bets of a payout
+ * script together and in chain order.
+ */
+class CBetAddressKey
+{
+public:
+    uint160 scriptHash;     // Hash160 of the payout script.
+    uint32_t nHeight;
+    uint32_t nTxIndex;
+    uint32_t nOutIndex;
+
+    CBetAddressKey() : nHeight(0), nTxIndex(0), nOutIndex(0) {}
+
+    CBetAddressKey(const uint160& scriptHashIn, uint32_t nHeightIn, uint32_t nTxIndexIn, uint32_t nOutIndexIn) :
+            scriptHash(scriptHashIn), nHeight(nHeightIn), nTxIndex(nTxIndexIn), nOutIndex(nOutIndexIn) {}
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return 1 + 20 + 4 * 3;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        unsigned char buf[1 + 20 + 4 * 3];
+        buf[0] = 'a';
+        memcpy(buf + 1, scriptHash.begin(), 20);
+        WriteBE32(buf + 21, nHeight);
+        WriteBE32(buf + 25, nTxIndex);
+        WriteBE32(buf + 29, nOutIndex);
+        s.write((char*)buf, sizeof(buf));
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        unsigned char buf[1 + 20 + 4 * 3];
+        s.read((char*)buf, sizeof(buf));
+        memcpy(scriptHash.begin(), buf + 1, 20);
+        nHeight   = ReadBE32(buf + 21);
+        nTxIndex  = ReadBE32(buf + 25);
+        nOutIndex = ReadBE32(buf + 29);
+    }
+};
+
+/** A Chain Games event posting, entry or result, kept in the pot of the event it refers to. */
+class CChainGamesPotEntry
+{
+public:
+    uint8_t nTxType;        // cgEventTxType, cgBetTxType or cgResultTxType.
+    uint32_t nHeight;       // Height of the block holding the transaction.
+    uint32_t nBlockTime;    // Time of the block holding the transaction.
+    CAmount nValue;         // Events: the entry fee. Bets: the value of the OP_RETURN output.
+    std::string address;    // Bets only: the address the winnings are paid to.
+
+    CChainGamesPotEntry() : nTxType(0), nHeight(0), nBlockTime(0), nValue(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(nTxType);
+        READWRITE(nHeight);
+        READWRITE(nBlockTime);
+        READWRITE(nValue);
+        READWRITE(address);
+    }
+};
+
+/**
+ * Running pot of a Chain Games event: the oracle postings and results of the event and the
+ * entries placed on it, in chain order. It is kept up to date along with the bet index, so
+ * that settling a lotto doesn't need to scan the blocks for its entrants.
+ */
+class CChainGamesPot
+{
+public:
+    int nVersion;
+
+    std::vector<CChainGamesPotEntry> vEntries;
+
+    CChainGamesPot() : nVersion(1) {}
+
+    /**
+     * Collect the entrants of the lotto from a given height on. Entries only count once the
+     * event has been posted and only if they pay the entry fee posted last before them.
+     */
+    void GetEntrants(int nStartHeight, CAmount& nEntryFee, std::vector<std::string>& vEntrants) const;
+
+    /** Drop the entries of a disconnected block, which are the last ones in the pot. */
+    void RemoveBlock(int nHeight);
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(this->nVersion);
+        nVersion = this->nVersion;
+        READWRITE(vEntries);
+    }
+};
+
+typedef std::map<uint32_t, CChainGamesPot> chainGamesPots_t;
+
+/** The payouts of a settled peerless result. */
+class CPeerlessSettlement
+{
+public:
+    std::vector<CBetOut> vPayouts;  // Payouts of the winning bets in chain order.
+    bool fResultFound;              // Whether a result of the event was found in its entries.
+
+    CPeerlessSettlement() : fResultFound(false) {}
+};
+
+/** Settlement of a peerless result against the bet index entries of its event, to be run on a CCheckQueue. */
+class CPeerlessSettlementCheck
+{
+private:
+    const CPeerlessResult* pResult;
+    const bettingIndexEntries_t* pEntries;
+    CPeerlessSettlement* pSettlement;
+
+public:
+    CPeerlessSettlementCheck() : pResult(NULL), pEntries(NULL), pSettlement(NULL) {}
+    CPeerlessSettlementCheck(const CPeerlessResult& resultIn, const bettingIndexEntries_t& entriesIn, CPeerlessSettlement& settlementIn) :
+            pResult(&resultIn), pEntries(&entriesIn), pSettlement(&settlementIn) {}
+
+    bool operator()();
+
+    void swap(CPeerlessSettlementCheck& check)
+    {
+        std::swap(pResult, check.pResult);
+        std::swap(pEntries, check.pEntries);
+        std::swap(pSettlement, check.pSettlement);
+    }
+};
+
+/**
+ * Undo information for the betting state changes of a block, the betting counterpart of
+ * CBlockUndo. It holds the state of every event and result the block changed as it was
+ * before the block, and the mappings the block added.
+ */
+class CBettingUndo
+{
+public:
+    int nVersion;
+
+    std::vector<CPeerlessEvent> vPrevEvents;       // Events changed by the block.
+    std::vector<uint32_t> vNewEvents;              // Events added by the block.
+    std::vector<CPeerlessResult> vPrevResults;     // Results replaced by the block.
+    std::vector<uint32_t> vNewResults;             // Results added by the block.
+    std::vector<std::pair<uint32_t, uint32_t> > vNewMappings; // Type and ID of the mappings added by the block.
+    std::vector<std::pair<uint32_t, CEventLiability> > vPrevLiabilities; // Liabilities of the events changed or added by the block.
+
+    CBettingUndo() : nVersion(2) {}
+
+    /** Record the current state of an event before the block changes it. */
+    void SaveEvent(uint32_t nEventId);
+    /** Record the current state of a result before the block changes it. */
+    void SaveResult(uint32_t nEventId);
+
+    bool IsEmpty() const
+    {
+        return vPrevEvents.empty() && vNewEvents.empty() && vPrevResults.empty() && vNewResults.empty() && vNewMappings.empty();
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(this->nVersion);
+        nVersion = this->nVersion;
+        READWRITE(vPrevEvents);
+        READWRITE(vNewEvents);
+        READWRITE(vPrevResults);
+        READWRITE(vNewResults);
+        READWRITE(vNewMappings);
+        if (this->nVersion >= 2)
+            READWRITE(vPrevLiabilities);
+    }
+};
+
+/** Betting database (betting/) */
+class CBettingDB : public CLevelDBWrapper
+{
+public:
+    CBettingDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+private:
+    CBettingDB(const CBettingDB&);
+    void operator=(const CBettingDB&);
+
+public:
+    /** The block up to which the bet index has been built. */
+    bool ReadBestBlock(uint256& hashBlock);
+    bool WriteBestBlock(const uint256& hashBlock);
+    /** The version of the bet index, 0 if it was built before the index had a version. */
+    bool ReadIndexVersion(int& nVersion);
+    bool WriteIndexVersion(int nVersion);
+
+    /** Add the entries of a block to the bet index, store the Chain Games pots it changed and move the best block to it. */
+    bool WriteIndexEntries(const bettingIndexEntries_t& vEntries, const uint256& hashBlock, const chainGamesPots_t& mapPots = chainGamesPots_t());
+    /** Remove the entries of a block from the bet index, store the Chain Games pots it changed and move the best block back to its parent. */
+    bool EraseIndexEntries(const bettingIndexEntries_t& vEntries, const uint256& hashPrevBlock, const chainGamesPots_t& mapPots = chainGamesPots_t());
+    /** Return all the entries of an event between two heights (inclusive) in chain order. */
+    bool ReadEventEntries(uint32_t nEventId, int nStartHeight, int nEndHeight, bettingIndexEntries_t& vEntries);
+    /** The Chain Games pot of an event, false if nothing refers to the event. */
+    bool ReadChainGamesPot(uint32_t nEventId, CChainGamesPot& pot);
+    /** Whether the bet index has been built with the payout address index of -betindex. */
+    bool ReadAddressIndexFlag(bool& fAddressIndex);
+    bool WriteAddressIndexFlag(bool fAddressIndex);
+    /**
+     * Return up to nCount peerless bets on an event in chain order, starting at the height, transaction
+     * and output of posStart and ending at nEndHeight (inclusive). nOutcome, when not 0, selects one outcome.
+     * The entries of other outcomes are skipped one by one, so at most MAX_BET_PAGE_SCAN entries are looked
+     * at and a filtered page can come back short. posNext is set to where the next page starts, and has a
+     * zero height when the range has been read to its end.
+     */
+    bool ReadEventBets(uint32_t nEventId, const CBettingIndexKey& posStart, int nEndHeight, int nOutcome, size_t nCount, bettingIndexEntries_t& vEntries, CBettingIndexKey& posNext);
+    /** Like ReadEventBets(), for the bets paid out to a script. Requires -betindex. */
+    bool ReadAddressBets(const CScript& payoutScript, const CBettingIndexKey& posStart, int nEndHeight, int nOutcome, size_t nCount, bettingIndexEntries_t& vEntries, CBettingIndexKey& posNext);
+    /** Remove every entry and Chain Games pot from the bet index. */
+    bool WipeIndex();
+
+    /** Undo information for the betting state changes of a block. */
+    bool ReadBettingUndo(const uint256& hashBlock, CBettingUndo& undo);
+    bool WriteBettingUndo(const uint256& hashBlock, const CBettingUndo& undo);
+    bool EraseBettingUndo(const uint256& hashBlock);
+
+    /** The last block applied to the stored betting state, false if no state has been stored yet. */
+    bool ReadStateBlock(uint256& hashBlock);
+    /** Record a block that left the stored betting state unchanged as applied to it. */
+    bool WriteStateBlock(const uint256& hashBlock);
+    /** Read the stored events, results and mappings. */
+    bool ReadBettingState(eventIndex_t& eventIndex, resultsIndex_t& resultsIndex, std::vector<CMapping>& vMappings);
+    /** Read the stored liabilities, which are kept for the events that have bets. */
+    bool ReadLiabilities(liabilityIndex_t& liabilityIndex);
+    /** Replace the stored betting state with the given one. */
+    bool WriteBettingState(const eventIndex_t& eventIndex, const resultsIndex_t& resultsIndex, const std::vector<CMapping>& vMappings, const uint256& hashBlock);
+    /** Store the events, results and mappings a connected block changed, along with its undo record. */
+    bool ConnectBettingState(const CBettingUndo& undo, const uint256& hashBlock);
+    /** Store the events, results and mappings a disconnected block had changed, and drop its undo record. */
+    bool DisconnectBettingState(const CBettingUndo& undo, const uint256& hashBlock, const uint256& hashPrevBlock);
+};
+
+/** Settle the peerless results of a block against the bet index entries of their events, on the queue if one is given. */
+std::vector<CBetOut> SettlePeerlessResults(const std::vector<CPeerlessResult>& vResults, const std::vector<bettingIndexEntries_t>& vResultEntries, CCheckQueue<CPeerlessSettlementCheck>* pqueue);
+
+/** Add a connected block to the bet index. */
+bool ConnectBettingIndex(const CBlock& block, const CBlockIndex* pindex);
+
+/** Remove a disconnected block from the bet index. */
+bool DisconnectBettingIndex(const CBlock& block, const CBlockIndex* pindex);
+
+/** Apply the events, odds, results, mappings and bets of a connected block to the betting state. */
+bool ConnectBettingBlock(const CBlock& block, const CBlockIndex* pindex);
+
+/** Revert the betting state changes of a disconnected block. */
+bool DisconnectBettingBlock(const CBlock& block, const CBlockIndex* pindex);
+
+/** Bring the bet index in line with the active chain, e.g. after an upgrade or an unclean shutdown. */
+bool SyncBettingIndex();
+
+/** Load the betting state from the betting database, importing the .dat files of older versions once. */
+bool LoadBettingState(bool fImportDatFiles);
+
+/** Bring the betting state in line with the active chain, e.g. after an unclean shutdown. */
+bool SyncBettingState();
+
+#endif // WAGERR_BETTINGDB_H
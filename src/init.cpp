@@ -24,6 +24,7 @@
 #include "key.h"
 #include "main.h"
 #include "betting/bet.h"
+#include "betting/bettingdb.h"
 #include "masternode-budget.h"
 #include "masternode-payments.h"
 #include "masternodeconfig.h"
@@ -192,66 +193,6 @@ void PrepareShutdown()
     if (!lockShutdown)
         return;
 
-    // TODO - We are assuming that the use of locks will not be required when
-    // writing a map index to a .dat file because all writing to a
-    // .dat should happen on the same thread. If this is not the case
-    // then a lock mechanism will have to be implemented to ensure we don't
-    // corrupt any .dat when we want the write to it.
-    // Get the latest block hash.
-    CBlockIndex *blockIndex = chainActive[chainActive.Height()];
-
-    CBlock block;
-    ReadBlockFromDisk(block, blockIndex);
-    uint256 lastBlockHash = block.GetHash();
-
-    // Write the events index to disk.
-    eventIndex_t eventIndex;
-    CEventDB::GetEvents(eventIndex);
-    CEventDB edb;
-
-    if (!edb.Write(eventIndex, lastBlockHash))
-        LogPrintf("Failed to write to the events.dat\n");
-
-    // Write the sports mapping index to sports.dat.
-    mappingIndex_t sportsIndex;
-    CMappingDB msdb("sports.dat");
-    msdb.GetSports(sportsIndex);
-
-    if (!msdb.Write(sportsIndex, lastBlockHash))
-        LogPrintf("Failed to write to the sports.dat\n");
-
-    // Write the rounds mapping index to rounds.dat.
-    mappingIndex_t roundsIndex;
-    CMappingDB mrdb("rounds.dat");
-    mrdb.GetRounds(roundsIndex);
-
-    if (!mrdb.Write(roundsIndex, lastBlockHash))
-        LogPrintf("Failed to write to the rounds.dat\n");
-
-    // Write the teams mapping index to teams.dat.
-    mappingIndex_t teamsIndex;
-    CMappingDB mtdb("teams.dat");
-    mtdb.GetTeams(teamsIndex);
-
-    if (!mtdb.Write(teamsIndex, lastBlockHash))
-        LogPrintf("Failed to write to the teams.dat\n");
-
-    // Write the tournaments mapping index to tournaments.dat.
-    mappingIndex_t tournamentsIndex;
-    CMappingDB mtodb("tournaments.dat");
-    mtodb.GetTournaments(tournamentsIndex);
-
-    if (!mtodb.Write(tournamentsIndex, lastBlockHash))
-        LogPrintf("Failed to write to the tournaments.dat\n");
-
-    // Write the results index to results.dat.
-    CResultDB rdb;
-    resultsIndex_t resultsIndex;
-    rdb.GetResults(resultsIndex);
-
-    if (!rdb.Write(resultsIndex, lastBlockHash))
-        LogPrintf("Failed to write to the results.dat\n");
-
     /// Note: Shutdown() must be able to handle cases in which AppInit2() failed part of the way,
     /// for example if the data directory was found to be locked.
     /// Be sure that anything that writes files or flushes caches only does this if the respective
@@ -273,6 +214,11 @@ void PrepareShutdown()
     DumpMasternodePayments();
     UnregisterNodeSignals(GetNodeSignals());
 
+    // Shutdown witness thread if it's enabled, before the databases its requests read go away
+    if (nLocalServices == NODE_BLOOM_LIGHT_ZC) {
+        lightWorker.StopLightZwgrThread();
+    }
+
     // After everything has been shut down, but before things get flushed, stop the
     // CScheduler/checkqueue threadGroup
     threadGroup.interrupt_all();
@@ -308,6 +254,8 @@ void PrepareShutdown()
         zerocoinDB = NULL;
         delete pSporkDB;
         pSporkDB = NULL;
+        delete bettingDB;
+        bettingDB = NULL;
     }
 #ifdef ENABLE_WALLET
     if (pwalletMain)
@@ -349,10 +297,6 @@ void Shutdown()
     }
     // Shutdown part 2: Stop TOR thread and delete wallet instance
     StopTorControl();
-    // Shutdown witness thread if it's enabled
-    if (nLocalServices == NODE_BLOOM_LIGHT_ZC) {
-        lightWorker.StopLightZwgrThread();
-    }
 #ifdef ENABLE_WALLET
     delete pwalletMain;
     pwalletMain = NULL;
@@ -464,6 +408,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
     strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), 0));
+    strUsage += HelpMessageOpt("-betindex", strprintf(_("Maintain an index of all bets by payout address, used by the listbetsbyaddress rpc call (default: %u)"), 0));
     strUsage += HelpMessageOpt("-forcestart", _("Attempt to force blockchain corruption recovery") + " " + _("on startup"));
 
     strUsage += HelpMessageGroup(_("Connection options:"));
@@ -487,6 +432,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), 1));
     strUsage += HelpMessageOpt("-peerbloomfilters", strprintf(_("Support filtering of blocks and transaction with bloom filters (default: %u)"), DEFAULT_PEERBLOOMFILTERS));
     strUsage += HelpMessageOpt("-peerbloomfilterszc", strprintf(_("Support the zerocoin light node protocol (default: %u)"), DEFAULT_PEERBLOOMFILTERS_ZC));
+    strUsage += HelpMessageOpt("-lightzwgrthreads=<n>", strprintf(_("Number of threads computing witnesses for zerocoin light nodes (default: %u)"), DEFAULT_LIGHTZWGR_THREADS));
     strUsage += HelpMessageOpt("-port=<port>", strprintf(_("Listen for connections on <port> (default: %u or testnet: %u)"), 55002, 55004));
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf(_("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"), 1));
@@ -542,6 +488,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtxlock=<address>", _("Enable publish raw transaction (locked via SwiftX) in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubbetevent=<address>", _("Enable publish betting events added or replaced by a block in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubbetresult=<address>", _("Enable publish betting results added by a block in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubbetodds=<address>", _("Enable publish betting events whose odds a block updated in <address>"));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -622,7 +571,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zeromintpercentage=<n>", strprintf(_("Percentage of automatically minted Zerocoin  (1-100, default: %u)"), 10));
     strUsage += HelpMessageOpt("-preferredDenom=<n>", strprintf(_("Preferred Denomination for automatically minted Zerocoin  (1/5/10/50/100/500/1000/5000), 0 for no preference. default: %u)"), 0));
     strUsage += HelpMessageOpt("-backupzwgr=<n>", strprintf(_("Enable automatic wallet backups triggered after each zWGR minting (0-1, default: %u)"), 1));
-    strUsage += HelpMessageOpt("-precompute=<n>", strprintf(_("Enable precomputation of zWGR spends and stakes (0-1, default %u)"), 1));
+    strUsage += HelpMessageOpt("-precompute=<n>", strprintf(_("Enable precomputation of zWGR spends and stakes (0-1, default %u)"), DEFAULT_PRECOMPUTE));
     strUsage += HelpMessageOpt("-precomputecachelength=<n>", strprintf(_("Set the number of included blocks to precompute per cycle. (minimum: %d) (maximum: %d) (default: %d)"), MIN_PRECOMPUTE_LENGTH, MAX_PRECOMPUTE_LENGTH, DEFAULT_PRECOMPUTE_LENGTH));
     strUsage += HelpMessageOpt("-zwgrbackuppath=<dir|file>", _("Specify custom backup path to add a copy of any automatic zWGR backup. If set as dir, every backup generates a timestamped file. If set as file, will rewrite to that file every backup. If backuppath is set as well, 4 backups will happen"));
 #endif // ENABLE_WALLET
@@ -1129,8 +1078,14 @@ bool AppInit2()
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
-        for (int i = 0; i < nScriptCheckThreads - 1; i++)
+        for (int i = 0; i < nScriptCheckThreads - 1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadZerocoinSpendCheck);
+            threadGroup.create_thread(&ThreadBetSettlement);
+#ifdef ENABLE_WALLET
+            threadGroup.create_thread(&ThreadWalletScan);
+#endif
+        }
     }
 
     if (mapArgs.count("-sporkkey")) // spork priv key
@@ -1234,6 +1189,7 @@ bool AppInit2()
             boost::filesystem::path chainstateDir = GetDataDir() / "chainstate";
             boost::filesystem::path sporksDir = GetDataDir() / "sporks";
             boost::filesystem::path zerocoinDir = GetDataDir() / "zerocoin";
+            boost::filesystem::path bettingDir = GetDataDir() / "betting";
             boost::filesystem::path eventsDat = GetDataDir() / "events.dat";
             boost::filesystem::path sportsDat = GetDataDir() / "sports.dat";
             boost::filesystem::path roundsDat = GetDataDir() / "rounds.dat";
@@ -1241,7 +1197,7 @@ bool AppInit2()
             boost::filesystem::path tournamentsDat = GetDataDir() / "tournaments.dat";
             boost::filesystem::path resultsDat = GetDataDir() / "results.dat";
 
-            LogPrintf("Deleting blockchain folders blocks, chainstate, sporks and zerocoin\n");
+            LogPrintf("Deleting blockchain folders blocks, chainstate, sporks, zerocoin and betting\n");
             // We delete in 4 individual steps in case one of the folder is missing already
             try {
                 if (boost::filesystem::exists(blocksDir)){
@@ -1264,6 +1220,11 @@ bool AppInit2()
                     LogPrintf("-resync: folder deleted: %s\n", zerocoinDir.string().c_str());
                 }
 
+                if (boost::filesystem::exists(bettingDir)){
+                    boost::filesystem::remove_all(bettingDir);
+                    LogPrintf("-resync: folder deleted: %s\n", bettingDir.string().c_str());
+                }
+
                 // Remove betting .dat files on resync.
                 if (boost::filesystem::exists(eventsDat)) {
                     boost::filesystem::remove(eventsDat);
@@ -1510,75 +1471,24 @@ bool AppInit2()
                 delete pblocktree;
                 delete zerocoinDB;
                 delete pSporkDB;
+                delete bettingDB;
 
-                //WAGERR specific: zerocoin and spork DB's
+                //WAGERR specific: zerocoin, spork and betting DB's
                 zerocoinDB = new CZerocoinDB(0, false, fReindex);
                 pSporkDB = new CSporkDB(0, false, false);
+                bettingDB = new CBettingDB(0, false, fReindex);
 
                 pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex);
                 pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex);
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
 
-                // TODO - When reading from the events.dat we also return the
-                // last block hash. The idea was to use this to cycle the block chain
-                // from that block and update the event index with any missing data.
-                // AcceptBlock() already does this, but if this is not good enough
-                // then we may have to implement the solution outlined above.
-                // Load up the events from the events.dat.
-                eventIndex_t eventIndex;
-                uint256 lastBlockHash;
-                CEventDB edb;
-
-                if (!edb.Read(eventIndex, lastBlockHash))
-                    LogPrintf("Invalid or missing events.dat; recreating\n");
-
-                CEventDB::SetEvents(eventIndex);
-
-                // Load up the sports from the sports.dat.
-                CMappingDB cmSportsDb("sports.dat");
-                mappingIndex_t sportsIndex;
-                uint256 sportsLastBlockHash;
-                if (!cmSportsDb.Read(sportsIndex, sportsLastBlockHash))
-                    LogPrintf("Invalid or missing sports.dat; recreating\n");
-
-                cmSportsDb.SetSports(sportsIndex);
-
-                // Load up the rounds from the rounds.dat.
-                CMappingDB cmRoundsDb("rounds.dat");
-                mappingIndex_t roundsIndex;
-                uint256 roundsLastBlockHash;
-                if (!cmRoundsDb.Read(roundsIndex, roundsLastBlockHash))
-                    LogPrintf("Invalid or missing rounds.dat; recreating\n");
-
-                cmRoundsDb.SetRounds(roundsIndex);
-
-                // Load up the teams from the teams.dat.
-                CMappingDB cmTeamsDb("teams.dat");
-                mappingIndex_t teamsIndex;
-                uint256 teamsLastBlockHash;
-                if (!cmTeamsDb.Read(teamsIndex, teamsLastBlockHash))
-                    LogPrintf("Invalid or missing teams.dat; recreating\n");
-
-                cmTeamsDb.SetTeams(teamsIndex);
-
-                // Load up the tournaments from the tournaments.dat.
-                CMappingDB cmTournamentsDb("tournaments.dat");
-                mappingIndex_t tournamentsIndex;
-                uint256 tournamentsLastBlockHash;
-                if (!cmTournamentsDb.Read(tournamentsIndex, tournamentsLastBlockHash))
-                    LogPrintf("Invalid or missing tournaments.dat; recreating\n");
-
-                cmTournamentsDb.SetTournaments(tournamentsIndex);
-
-                // Load up the results from the results.dat.
-                CResultDB rdb;
-                resultsIndex_t resultsIndex;
-                uint256 resultsLastBlockHash;
-                if (!rdb.Read(resultsIndex, resultsLastBlockHash))
-                    LogPrintf("Invalid or missing results.dat; recreating\n");
-
-                rdb.SetResults(resultsIndex);
+                // Load the events, results and mappings. On a reindex they are rebuilt as the
+                // blocks are connected again, so the .dat files of older versions are not imported.
+                if (!LoadBettingState(!fReindex)) {
+                    strLoadError = _("Error loading the betting database");
+                    break;
+                }
 
                 if (fReindex)
                     pblocktree->WriteReindexing(true);
@@ -1727,6 +1637,18 @@ bool AppInit2()
             }
 
             fVerifyingBlocks = false;
+
+            // Bring the betting state and the bet index in line with the chain that was just loaded.
+            if (!SyncBettingState()) {
+                strLoadError = _("Error loading the betting database");
+                break;
+            }
+            fBetIndex = GetBoolArg("-betindex", false);
+            if (!SyncBettingIndex()) {
+                strLoadError = _("Error building the bet index");
+                break;
+            }
+
             fLoaded = true;
         } while (false);
 
@@ -2108,7 +2030,7 @@ bool AppInit2()
 
     if (nLocalServices & NODE_BLOOM_LIGHT_ZC) {
         // Run a thread to compute witnesses
-        lightWorker.StartLightZwgrThread(threadGroup);
+        lightWorker.StartLightZwgrThread(threadGroup, std::max(1, (int)GetArg("-lightzwgrthreads", DEFAULT_LIGHTZWGR_THREADS)));
     }
 
 #ifdef ENABLE_WALLET
@@ -2130,7 +2052,7 @@ bool AppInit2()
         // Run a thread to flush wallet periodically
         threadGroup.create_thread(boost::bind(&ThreadFlushWalletDB, boost::ref(pwalletMain->strWalletFile)));
 
-        if (GetBoolArg("-precompute", false)) {
+        if (GetBoolArg("-precompute", DEFAULT_PRECOMPUTE)) {
             // Run a thread to precompute any zWGR spends
             threadGroup.create_thread(boost::bind(&ThreadPrecomputeSpends));
         }
@@ -7,6 +7,7 @@
 #include <boost/assign/list_of.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include "crypto/common.h"
 #include "db.h"
 #include "kernel.h"
 #include "script/interpreter.h"
@@ -23,6 +24,35 @@ static const int64_t OLD_MODIFIER_INTERVAL = 2087;
 static std::map<int, unsigned int> mapStakeModifierCheckpoints =
     boost::assign::map_list_of(0, 0xfd11f4e7u);
 
+// Bound on the number of stake origin blocks whose kernel stake modifier is cached
+static const size_t MAX_STAKE_MODIFIER_CACHE = 20000;
+
+// A kernel stake modifier found by GetKernelStakeModifier. It stays valid for as
+// long as the origin block and the last block walked to are in the active chain.
+struct CStakeModifierCacheEntry {
+    uint64_t nStakeModifier;
+    int nStakeModifierHeight;
+    int64_t nStakeModifierTime;
+    const CBlockIndex* pindexLast;
+};
+
+static CCriticalSection cs_stakeModifierCache;
+static std::map<uint256, CStakeModifierCacheEntry> mapStakeModifierCache;
+static CStakeModifierCacheStats stakeModifierCacheStats;
+
+void GetStakeModifierCacheStats(CStakeModifierCacheStats& stats)
+{
+    LOCK(cs_stakeModifierCache);
+    stats = stakeModifierCacheStats;
+    stats.nSize = mapStakeModifierCache.size();
+}
+
+void ClearStakeModifierCache()
+{
+    LOCK(cs_stakeModifierCache);
+    mapStakeModifierCache.clear();
+}
+
 // Get the last stake modifier and its generation time from a given block
 static bool GetLastStakeModifier(const CBlockIndex* pindex, uint64_t& nStakeModifier, int64_t& nModifierTime)
 {
@@ -252,6 +282,26 @@ bool GetKernelStakeModifier(uint256 hashBlockFrom, uint64_t& nStakeModifier, int
         nStakeModifier = pindexFrom->nStakeModifier;
         return true;
     }
+    const bool fCacheable = chainActive.Contains(pindexFrom);
+    if (fCacheable) {
+        LOCK(cs_stakeModifierCache);
+        std::map<uint256, CStakeModifierCacheEntry>::iterator it = mapStakeModifierCache.find(hashBlockFrom);
+        if (it != mapStakeModifierCache.end()) {
+            const CStakeModifierCacheEntry& entry = it->second;
+            if (chainActive.Contains(entry.pindexLast)) {
+                stakeModifierCacheStats.nHits++;
+                nStakeModifier = entry.nStakeModifier;
+                nStakeModifierHeight = entry.nStakeModifierHeight;
+                nStakeModifierTime = entry.nStakeModifierTime;
+                return true;
+            }
+            // The blocks the selection interval walked over were reorganized away
+            stakeModifierCacheStats.nInvalidated++;
+            mapStakeModifierCache.erase(it);
+        }
+        stakeModifierCacheStats.nMisses++;
+    }
+
     const CBlockIndex* pindex = pindexFrom;
     CBlockIndex* pindexNext = chainActive[pindex->nHeight + 1];
 
@@ -270,6 +320,17 @@ bool GetKernelStakeModifier(uint256 hashBlockFrom, uint64_t& nStakeModifier, int
     } while (nStakeModifierTime < pindexFrom->GetBlockTime() + OLD_MODIFIER_INTERVAL);
 
     nStakeModifier = pindex->nStakeModifier;
+
+    if (fCacheable) {
+        LOCK(cs_stakeModifierCache);
+        if (mapStakeModifierCache.size() >= MAX_STAKE_MODIFIER_CACHE)
+            mapStakeModifierCache.erase(mapStakeModifierCache.begin()); // evict an arbitrary entry by hash
+        CStakeModifierCacheEntry& entry = mapStakeModifierCache[hashBlockFrom];
+        entry.nStakeModifier = nStakeModifier;
+        entry.nStakeModifierHeight = nStakeModifierHeight;
+        entry.nStakeModifierTime = nStakeModifierTime;
+        entry.pindexLast = pindex;
+    }
     return true;
 }
 
@@ -308,15 +369,9 @@ bool CheckStakeKernelHash(const CBlockIndex* pindexPrev, const unsigned int nBit
     return res;
 }
 
-bool GetHashProofOfStake(const CBlockIndex* pindexPrev, CStakeInput* stake, const unsigned int nTimeTx, const bool fVerify, uint256& hashProofOfStakeRet) {
-    // Grab the stake data
-    CBlockIndex* pindexfrom = stake->GetIndexFrom();
-    if (!pindexfrom) return error("%s : Failed to find the block index for stake origin", __func__);
-    const CDataStream& ssUniqueID = stake->GetUniqueness();
-    const unsigned int nTimeBlockFrom = pindexfrom->nTime;
-    CDataStream modifier_ss(SER_GETHASH, 0);
-
-    // Hash the modifier
+// Serialize the stake modifier that kernels on top of pindexPrev are hashed with
+static bool GetKernelModifier(const CBlockIndex* pindexPrev, CStakeInput* stake, CDataStream& modifier_ss)
+{
     if (!Params().IsStakeModifierV2(pindexPrev->nHeight + 1)) {
         // Modifier v1
         uint64_t nStakeModifier = 0;
@@ -327,6 +382,20 @@ bool GetHashProofOfStake(const CBlockIndex* pindexPrev, CStakeInput* stake, cons
         // Modifier v2
         modifier_ss << pindexPrev->nStakeModifierV2;
     }
+    return true;
+}
+
+bool GetHashProofOfStake(const CBlockIndex* pindexPrev, CStakeInput* stake, const unsigned int nTimeTx, const bool fVerify, uint256& hashProofOfStakeRet) {
+    // Grab the stake data
+    CBlockIndex* pindexfrom = stake->GetIndexFrom();
+    if (!pindexfrom) return error("%s : Failed to find the block index for stake origin", __func__);
+    const CDataStream& ssUniqueID = stake->GetUniqueness();
+    const unsigned int nTimeBlockFrom = pindexfrom->nTime;
+    CDataStream modifier_ss(SER_GETHASH, 0);
+
+    // Hash the modifier
+    if (!GetKernelModifier(pindexPrev, stake, modifier_ss))
+        return false;
 
     CDataStream ss(modifier_ss);
     // Calculate hash
@@ -342,6 +411,41 @@ bool GetHashProofOfStake(const CBlockIndex* pindexPrev, CStakeInput* stake, cons
     return true;
 }
 
+CStakeKernel::CStakeKernel(const CBlockIndex* pindexPrev, CStakeInput* stake, const unsigned int nBits) : fValid(false)
+{
+    CBlockIndex* pindexfrom = stake->GetIndexFrom();
+    if (!pindexfrom) {
+        error("%s : Failed to find the block index for stake origin", __func__);
+        return;
+    }
+    CDataStream ss(SER_GETHASH, 0);
+    if (!GetKernelModifier(pindexPrev, stake, ss))
+        return;
+
+    // Everything GetHashProofOfStake() hashes before the block time
+    const CDataStream& ssUniqueID = stake->GetUniqueness();
+    ss << pindexfrom->nTime << ssUniqueID;
+    hasherPrefix.Write((const unsigned char*)&ss[0], ss.size());
+
+    // Weighted target, as in CheckStakeKernelHash()
+    bnTarget.SetCompact(nBits);
+    bnTarget *= uint256(stake->GetValue()) / 100;
+    fValid = true;
+}
+
+bool CStakeKernel::CheckTime(const unsigned int nTimeTx, uint256& hashProofOfStake) const
+{
+    unsigned char vchTime[4];
+    WriteLE32(vchTime, nTimeTx);
+
+    // Double SHA-256 of the prefix and the time, as Hash() would compute it
+    unsigned char vchHash[CSHA256::OUTPUT_SIZE];
+    CSHA256(hasherPrefix).Write(vchTime, sizeof(vchTime)).Finalize(vchHash);
+    CSHA256().Write(vchHash, sizeof(vchHash)).Finalize((unsigned char*)&hashProofOfStake);
+
+    return hashProofOfStake < bnTarget;
+}
+
 bool Stake(const CBlockIndex* pindexPrev, CStakeInput* stakeInput, unsigned int nBits, unsigned int& nTimeTx, uint256& hashProofOfStake)
 {
     int prevHeight = pindexPrev->nHeight;
@@ -358,6 +462,11 @@ bool Stake(const CBlockIndex* pindexPrev, CStakeInput* stakeInput, unsigned int
         return error("%s : min age violation - height=%d - nTimeTx=%d, nTimeBlockFrom=%d, nHeightBlockFrom=%d",
                          __func__, prevHeight + 1, nTimeTx, nTimeBlockFrom, nHeightBlockFrom);
 
+    // the modifier, the input and the target are the same for every try
+    const CStakeKernel kernel(pindexPrev, stakeInput, nBits);
+    if (!kernel.IsValid())
+        return error("%s : Failed to prepare the stake kernel", __func__);
+
     // iterate the hashing
     bool fSuccess = false;
     const unsigned int nHashDrift = 60;
@@ -375,10 +484,12 @@ bool Stake(const CBlockIndex* pindexPrev, CStakeInput* stakeInput, unsigned int
         ++nTryTime;
 
         // if stake hash does not meet the target then continue to next iteration
-        if (!CheckStakeKernelHash(pindexPrev, nBits, stakeInput, nTryTime, hashProofOfStake))
+        if (!kernel.CheckTime(nTryTime, hashProofOfStake))
             continue;
 
         // if we made it this far, then we have successfully found a valid kernel hash
+        LogPrint("staking", "%s : Proof Of Stake:\nssUniqueID=%s\nnTimeTx=%d\nhashProofOfStake=%s\nnBits=%d\nweight=%d\n\n",
+            __func__, HexStr(stakeInput->GetUniqueness()), nTryTime, hashProofOfStake.GetHex(), nBits, stakeInput->GetValue());
         fSuccess = true;
         nTimeTx = nTryTime;
         break;
@@ -6,6 +6,7 @@
 #ifndef BITCOIN_KERNEL_H
 #define BITCOIN_KERNEL_H
 
+#include "crypto/sha256.h"
 #include "main.h"
 #include "stakeinput.h"
 
@@ -17,10 +18,46 @@ static const unsigned int MODIFIER_INTERVAL = 60;
 // ratio of group interval length between the last group and the first group
 static const int MODIFIER_INTERVAL_RATIO = 3;
 
+// Counters of the kernel stake modifier cache used by GetKernelStakeModifier
+struct CStakeModifierCacheStats {
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nInvalidated;
+    size_t nSize;
+
+    CStakeModifierCacheStats() : nHits(0), nMisses(0), nInvalidated(0), nSize(0) {}
+};
+void GetStakeModifierCacheStats(CStakeModifierCacheStats& stats);
+// Drop the cached stake modifiers, which point into the block index
+void ClearStakeModifierCache();
+
 // Compute the hash modifier for proof-of-stake
 bool GetKernelStakeModifier(uint256 hashBlockFrom, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime, bool fPrintProofOfStake);
 bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeModifier, bool& fGeneratedStakeModifier);
 uint256 ComputeStakeModifier(const CBlockIndex* pindexPrev, const uint256& kernel);
+
+/**
+ * A stake input prepared for hashing kernels on top of one block. Stake() tries
+ * every second of its drift window for the same input, so the modifier, the
+ * origin block time and the input uniqueness are hashed into a SHA-256 midstate
+ * once, and the weighted target is computed once. Each try then only hashes the
+ * time on top of the midstate.
+ */
+class CStakeKernel
+{
+private:
+    CSHA256 hasherPrefix;
+    uint256 bnTarget;
+    bool fValid;
+
+public:
+    CStakeKernel(const CBlockIndex* pindexPrev, CStakeInput* stake, const unsigned int nBits);
+
+    bool IsValid() const { return fValid; }
+    // Same hash and result as CheckStakeKernelHash() for nTimeTx, without logging
+    bool CheckTime(const unsigned int nTimeTx, uint256& hashProofOfStake) const;
+};
+
 bool Stake(const CBlockIndex* pindexPrev, CStakeInput* stakeInput, unsigned int nBits, unsigned int& nTimeTx, uint256& hashProofOfStake);
 
 // Initialize the stake input object
@@ -118,14 +118,20 @@ bool AccumulatorProofOfKnowledge:: Verify(const Accumulator& a, const CBigNum& v
 
 	CBigNum c = CBigNum(hasher.GetHash()); //this hash should be of length k_prime bits
 
-	CBigNum st_1_prime = (valueOfCommitmentToCoin.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) * sg.pow_mod(s_alpha, params->accumulatorPoKCommitmentGroup.modulus) * sh.pow_mod(s_phi, params->accumulatorPoKCommitmentGroup.modulus)) % params->accumulatorPoKCommitmentGroup.modulus;
-	CBigNum st_2_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) * ((valueOfCommitmentToCoin * sg.inverse(params->accumulatorPoKCommitmentGroup.modulus)).pow_mod(s_gamma, params->accumulatorPoKCommitmentGroup.modulus)) * sh.pow_mod(s_psi, params->accumulatorPoKCommitmentGroup.modulus)) % params->accumulatorPoKCommitmentGroup.modulus;
-	CBigNum st_3_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) * (sg * valueOfCommitmentToCoin).pow_mod(s_sigma, params->accumulatorPoKCommitmentGroup.modulus) * sh.pow_mod(s_xi, params->accumulatorPoKCommitmentGroup.modulus)) % params->accumulatorPoKCommitmentGroup.modulus;
-
-	CBigNum t_1_prime = (C_r.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_zeta, params->accumulatorModulus) * g_n.pow_mod(s_epsilon, params->accumulatorModulus)) % params->accumulatorModulus;
-	CBigNum t_2_prime = (C_e.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_eta, params->accumulatorModulus) * g_n.pow_mod(s_alpha, params->accumulatorModulus)) % params->accumulatorModulus;
-	CBigNum t_3_prime = ((a.getValue()).pow_mod(c, params->accumulatorModulus) * C_u.pow_mod(s_alpha, params->accumulatorModulus) * ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) % params->accumulatorModulus;
-	CBigNum t_4_prime = (C_r.pow_mod(s_alpha, params->accumulatorModulus) * ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_delta, params->accumulatorModulus)) * ((g_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) % params->accumulatorModulus;
+	// Powers of the fixed generators come from the precomputed tables.
+	const IntegerGroupParams& pok = params->accumulatorPoKCommitmentGroup;
+	const IntegerGroupParams& qrn = params->accumulatorQRNCommitmentGroup;
+	CBigNum sg_c = pok.powG(c, pok.modulus);
+
+	CBigNum st_1_prime = (valueOfCommitmentToCoin.pow_mod(c, pok.modulus) * pok.powG(s_alpha, pok.modulus) * pok.powH(s_phi, pok.modulus)) % pok.modulus;
+	CBigNum st_2_prime = (sg_c * ((valueOfCommitmentToCoin * sg.inverse(pok.modulus)).pow_mod(s_gamma, pok.modulus)) * pok.powH(s_psi, pok.modulus)) % pok.modulus;
+	CBigNum st_3_prime = (sg_c * (sg * valueOfCommitmentToCoin).pow_mod(s_sigma, pok.modulus) * pok.powH(s_xi, pok.modulus)) % pok.modulus;
+
+	// (h_n^-1)^s is served as h_n^-s.
+	CBigNum t_1_prime = (C_r.pow_mod(c, params->accumulatorModulus) * qrn.powH(s_zeta, params->accumulatorModulus) * qrn.powG(s_epsilon, params->accumulatorModulus)) % params->accumulatorModulus;
+	CBigNum t_2_prime = (C_e.pow_mod(c, params->accumulatorModulus) * qrn.powH(s_eta, params->accumulatorModulus) * qrn.powG(s_alpha, params->accumulatorModulus)) % params->accumulatorModulus;
+	CBigNum t_3_prime = ((a.getValue()).pow_mod(c, params->accumulatorModulus) * C_u.pow_mod(s_alpha, params->accumulatorModulus) * qrn.powH(-s_beta, params->accumulatorModulus)) % params->accumulatorModulus;
+	CBigNum t_4_prime = (C_r.pow_mod(s_alpha, params->accumulatorModulus) * qrn.powH(-s_delta, params->accumulatorModulus) * qrn.powG(-s_beta, params->accumulatorModulus)) % params->accumulatorModulus;
 
 	bool result_st1 = (st_1 == st_1_prime);
 	bool result_st2 = (st_2 == st_2_prime);
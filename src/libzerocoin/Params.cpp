@@ -28,6 +28,23 @@ ZerocoinParams::ZerocoinParams(CBigNum N, uint32_t securityLevel) {
 
 	this->accumulatorParams.initialized = true;
 	this->initialized = true;
+
+	BuildFixedBaseTables();
+}
+
+void ZerocoinParams::BuildFixedBaseTables() {
+	this->coinCommitmentGroup.BuildFixedBaseTables(this->coinCommitmentGroup.modulus);
+	this->serialNumberSoKCommitmentGroup.BuildFixedBaseTables(this->serialNumberSoKCommitmentGroup.modulus);
+	this->accumulatorParams.accumulatorPoKCommitmentGroup.BuildFixedBaseTables(this->accumulatorParams.accumulatorPoKCommitmentGroup.modulus);
+	// The QRN generators have no modulus of their own, they live mod N.
+	this->accumulatorParams.accumulatorQRNCommitmentGroup.BuildFixedBaseTables(this->accumulatorParams.accumulatorModulus);
+}
+
+void ZerocoinParams::ClearFixedBaseTables() {
+	this->coinCommitmentGroup.ClearFixedBaseTables();
+	this->serialNumberSoKCommitmentGroup.ClearFixedBaseTables();
+	this->accumulatorParams.accumulatorPoKCommitmentGroup.ClearFixedBaseTables();
+	this->accumulatorParams.accumulatorQRNCommitmentGroup.ClearFixedBaseTables();
 }
 
 AccumulatorAndProofParams::AccumulatorAndProofParams() {
@@ -38,6 +55,32 @@ IntegerGroupParams::IntegerGroupParams() {
 	this->initialized = false;
 }
 
+void IntegerGroupParams::BuildFixedBaseTables(const CBigNum& m) {
+	// Proof responses have the form r + c*x and stay within twice the
+	// modulus width plus the challenge and security margins. Anything
+	// wider falls back to a plain pow_mod.
+	unsigned int nMaxExponentBits = 2 * m.bitSize() + 512;
+	this->gPowers = CBigNumFixedBase(this->g, m, nMaxExponentBits);
+	this->hPowers = CBigNumFixedBase(this->h, m, nMaxExponentBits);
+}
+
+void IntegerGroupParams::ClearFixedBaseTables() {
+	this->gPowers = CBigNumFixedBase();
+	this->hPowers = CBigNumFixedBase();
+}
+
+CBigNum IntegerGroupParams::powG(const CBigNum& e, const CBigNum& m) const {
+	if (this->gPowers.IsNull() || this->gPowers.getModulus() != m)
+		return this->g.pow_mod(e, m);
+	return this->gPowers.pow_mod(e);
+}
+
+CBigNum IntegerGroupParams::powH(const CBigNum& e, const CBigNum& m) const {
+	if (this->hPowers.IsNull() || this->hPowers.getModulus() != m)
+		return this->h.pow_mod(e, m);
+	return this->hPowers.pow_mod(e);
+}
+
 CBigNum IntegerGroupParams::randomElement() const {
 	// The generator of the group raised
 	// to a random number less than the order of the group
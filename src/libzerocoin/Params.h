@@ -56,6 +56,32 @@ public:
 	 */
 	CBigNum groupOrder;
 
+	/**
+	 * Precomputed powers of g and h, see BuildFixedBaseTables.
+	 * These are not serialized.
+	 */
+	CBigNumFixedBase gPowers;
+	CBigNumFixedBase hPowers;
+
+	/**
+	 * Builds the fixed-base tables for g and h
+	 * @param m the modulus the generators are used with
+	 */
+	void BuildFixedBaseTables(const CBigNum& m);
+	void ClearFixedBaseTables();
+
+	/**
+	 * g^e mod m, served from the fixed-base table when it was built for m.
+	 * Only use for public exponents: the table lookups depend on e.
+	 */
+	CBigNum powG(const CBigNum& e, const CBigNum& m) const;
+
+	/**
+	 * h^e mod m, served from the fixed-base table when it was built for m.
+	 * Only use for public exponents: the table lookups depend on e.
+	 */
+	CBigNum powH(const CBigNum& e, const CBigNum& m) const;
+
 	ADD_SERIALIZE_METHODS;
   template <typename Stream, typename Operation>  inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
 		    READWRITE(initialized);
@@ -203,6 +229,13 @@ public:
 	 * proofs.
 	 */
 	uint32_t zkp_hash_len;
+
+	/**
+	 * Precomputes the generator powers used by proof verification.
+	 * Called by the constructor once the groups are derived.
+	 */
+	void BuildFixedBaseTables();
+	void ClearFixedBaseTables();
 	
 	ADD_SERIALIZE_METHODS;
   template <typename Stream, typename Operation>  inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
@@ -109,7 +109,7 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const
 }
 
 inline CBigNum SerialNumberSignatureOfKnowledge::challengeCalculation(const CBigNum& a_exp,const CBigNum& b_exp,
-        const CBigNum& h_exp) const {
+        const CBigNum& h_exp, bool fFixedBase) const {
 
     CBigNum a = params->coinCommitmentGroup.g;
     CBigNum b = params->coinCommitmentGroup.h;
@@ -119,6 +119,13 @@ inline CBigNum SerialNumberSignatureOfKnowledge::challengeCalculation(const CBig
     CBigNum exponent = (a.pow_mod(a_exp, params->serialNumberSoKCommitmentGroup.groupOrder) *
             b.pow_mod(b_exp, params->serialNumberSoKCommitmentGroup.groupOrder)) % params->serialNumberSoKCommitmentGroup.groupOrder;
 
+    // The prover's exponents are secret and keep the constant time pow_mod,
+    // the verifier's are public and can use the fixed-base tables.
+    if (fFixedBase) {
+        const IntegerGroupParams& group = params->serialNumberSoKCommitmentGroup;
+        return (group.powG(exponent, group.modulus) * group.powH(h_exp, group.modulus)) % group.modulus;
+    }
+
     return (g.pow_mod(exponent, params->serialNumberSoKCommitmentGroup.modulus) * h.pow_mod(h_exp, params->serialNumberSoKCommitmentGroup.modulus)) % params->serialNumberSoKCommitmentGroup.modulus;
 }
 
@@ -156,13 +163,12 @@ bool SerialNumberSignatureOfKnowledge::Verify(const CBigNum& coinSerialNumber, c
                 CBigNum bn = SeedTo1024(sprime[i].getuint256());
                 if (bn > params->serialNumberSoKCommitmentGroup.groupOrder && isInParamsValidationRange)
                     return error("SoK Verify() :: sprime in pos %d not in valid range", i);
-                tprime[i] = challengeCalculation(coinSerialNumber, s_notprime[i], bn);
+                tprime[i] = challengeCalculation(coinSerialNumber, s_notprime[i], bn, true);
             } else {
                 CBigNum exp = b.pow_mod(s_notprime[i], params->serialNumberSoKCommitmentGroup.groupOrder);
                 tprime[i] = ((valueOfCommitmentToCoin.pow_mod(exp, params->serialNumberSoKCommitmentGroup.modulus) %
                               params->serialNumberSoKCommitmentGroup.modulus) *
-                             (h.pow_mod(sprime[i], params->serialNumberSoKCommitmentGroup.modulus) %
-                              params->serialNumberSoKCommitmentGroup.modulus)) %
+                             params->serialNumberSoKCommitmentGroup.powH(sprime[i], params->serialNumberSoKCommitmentGroup.modulus)) %
                             params->serialNumberSoKCommitmentGroup.modulus;
             }
         }
@@ -61,3 +61,86 @@ const CBigNum CBigNum::operator--(int)
     --(*this);
     return ret;
 }
+
+CBigNumFixedBase::CBigNumFixedBase(const CBigNum& baseIn, const CBigNum& modulusIn, unsigned int nMaxExponentBits)
+    : base(baseIn), modulus(modulusIn), nWindowBits(1)
+{
+    // A window of w bits costs bits/w table multiplications plus about
+    // 2^(w+1) to combine the digit buckets, pick the cheapest.
+    unsigned int nBestCost = UINT_MAX;
+    for (unsigned int w = 1; w <= 8; w++) {
+        unsigned int nCost = (nMaxExponentBits + w - 1) / w + (2u << w);
+        if (nCost < nBestCost) {
+            nBestCost = nCost;
+            nWindowBits = w;
+        }
+    }
+
+    unsigned int nDigits = (nMaxExponentBits + nWindowBits - 1) / nWindowBits;
+    vPowers.reserve(nDigits);
+    CBigNum power = base % modulus;
+    for (unsigned int i = 0; i < nDigits; i++) {
+        if (i > 0) {
+            for (unsigned int j = 0; j < nWindowBits; j++)
+                power = power.mul_mod(power, modulus);
+        }
+        vPowers.push_back(power);
+    }
+}
+
+CBigNum CBigNumFixedBase::pow_mod(const CBigNum& e) const
+{
+    if (IsNull())
+        throw bignum_error("CBigNumFixedBase::pow_mod : table not built");
+
+    if (e < CBigNum(0)) {
+        // g^-x = (g^x)^-1
+        return pow_mod(-e).inverse(modulus);
+    }
+
+    unsigned int nBits = e.bitSize();
+    if (nBits > vPowers.size() * nWindowBits)
+        return base.pow_mod(e, modulus);
+
+    // Multiply every table entry into the bucket of its exponent digit d,
+    // the result is then the product of bucket_d^d over all digits.
+    std::vector<CBigNum> vBuckets((1u << nWindowBits) - 1);
+    std::vector<bool> vUsed(vBuckets.size(), false);
+    for (unsigned int i = 0; i * nWindowBits < nBits; i++) {
+        unsigned int nDigit = 0;
+        for (unsigned int j = 0; j < nWindowBits; j++) {
+            if (e.isBitSet(i * nWindowBits + j))
+                nDigit |= 1u << j;
+        }
+        if (nDigit == 0)
+            continue;
+        if (vUsed[nDigit - 1])
+            vBuckets[nDigit - 1] = vBuckets[nDigit - 1].mul_mod(vPowers[i], modulus);
+        else
+            vBuckets[nDigit - 1] = vPowers[i];
+        vUsed[nDigit - 1] = true;
+    }
+
+    // Running products from the highest digit down raise each bucket to
+    // its digit without any exponentiation.
+    CBigNum running;
+    CBigNum result;
+    bool fRunning = false;
+    for (size_t d = vBuckets.size(); d > 0; d--) {
+        if (!fRunning && !vUsed[d - 1])
+            continue;
+        if (!fRunning) {
+            running = vBuckets[d - 1];
+            result = running;
+            fRunning = true;
+            continue;
+        }
+        if (vUsed[d - 1])
+            running = running.mul_mod(vBuckets[d - 1], modulus);
+        result = result.mul_mod(running, modulus);
+    }
+
+    if (!fRunning)
+        return CBigNum(1) % modulus;
+    return result;
+}
@@ -81,6 +81,13 @@ public:
      * @return the size
      */
     int bitSize() const;
+
+    /**Returns whether bit n of a non-negative bignum is set.
+     *
+     * @param n the bit index, counting from the least significant bit
+     * @return true if the bit is set
+     */
+    bool isBitSet(unsigned int n) const;
     void setulong(unsigned long n);
     unsigned long getulong() const;
     unsigned int getuint() const;
@@ -343,6 +350,40 @@ inline bool operator<(const CBigNum& a, const CBigNum& b)  { return (mpz_cmp(a.b
 inline bool operator>(const CBigNum& a, const CBigNum& b)  { return (mpz_cmp(a.bn, b.bn) > 0); }
 #endif
 
+/**
+ * Fixed-base modular exponentiation (HAC algorithm 14.109).
+ * Keeps base^(2^(w*i)) mod m so that raising the same base to many
+ * exponents costs about bits/w multiplications and no squarings.
+ */
+class CBigNumFixedBase
+{
+    CBigNum base;
+    CBigNum modulus;
+    unsigned int nWindowBits;
+    std::vector<CBigNum> vPowers;
+
+public:
+    CBigNumFixedBase() : nWindowBits(0) {}
+
+    /**
+     * Builds the table of powers of base
+     * @param baseIn the fixed base
+     * @param modulusIn the modulus
+     * @param nMaxExponentBits the widest exponent served from the table
+     */
+    CBigNumFixedBase(const CBigNum& baseIn, const CBigNum& modulusIn, unsigned int nMaxExponentBits);
+
+    bool IsNull() const { return vPowers.empty(); }
+    const CBigNum& getModulus() const { return modulus; }
+
+    /**
+     * modular exponentiation: base^e mod modulus. Exponents wider than
+     * the table fall back to CBigNum::pow_mod.
+     * @param e exponent
+     */
+    CBigNum pow_mod(const CBigNum& e) const;
+};
+
 inline std::ostream& operator<<(std::ostream &strm, const CBigNum &b) { return strm << b.ToString(10); }
 
 typedef CBigNum Bignum;
@@ -88,6 +88,11 @@ int CBigNum::bitSize() const
     return  BN_num_bits(bn);
 }
 
+bool CBigNum::isBitSet(unsigned int n) const
+{
+    return BN_is_bit_set(bn, n);
+}
+
 void CBigNum::setulong(unsigned long n)
 {
     if (!BN_set_word(bn, n))
@@ -8,110 +8,178 @@
 #include "lightzwgrthread.h"
 #include "main.h"
 
+bool CLightWorker::addWitWork(CGenWit wit) {
+    if (!wit.getPfrom())
+        return false;
+    {
+        // Checked under the lock, so nothing is queued after StopLightZwgrThread drained the queues
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (!isWorkerRunning) {
+            LogPrintf("%s not running trying to add wit work \n", "wagerr-light-thread");
+            return false;
+        }
+        std::deque<CGenWit>& queue = mapPeerRequests[wit.getPfrom()->GetId()];
+        if (queue.size() >= MAX_GENWIT_PER_PEER) {
+            LogPrint("zwgr", "%s too many requests waiting for peer=%d \n", "wagerr-light-thread", wit.getPfrom()->GetId());
+            return false;
+        }
+        // Keep the peer around until its request is answered
+        wit.getPfrom()->AddRef();
+        queue.push_back(wit);
+    }
+    condition.notify_one();
+    return true;
+}
+
+std::vector<CGenWit> CLightWorker::popWork() {
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (mapPeerRequests.empty())
+        condition.wait(lock);
+
+    // Serve the peer after the one served last
+    std::map<NodeId, std::deque<CGenWit> >::iterator it = mapPeerRequests.upper_bound(nLastPeer);
+    if (it == mapPeerRequests.end())
+        it = mapPeerRequests.begin();
+    nLastPeer = it->first;
+
+    std::vector<CGenWit> vWork;
+    vWork.push_back(it->second.front());
+    it->second.pop_front();
+    const libzerocoin::CoinDenomination den = vWork[0].getDen();
+    const int nStartingHeight = vWork[0].getStartingHeight();
+    const CBigNum bnAccWitValue = vWork[0].getAccWitValue();
+
+    // Requests with the same denomination, starting height and accumulator are computed together
+    it = mapPeerRequests.begin();
+    while (it != mapPeerRequests.end()) {
+        std::deque<CGenWit>& queue = it->second;
+        std::deque<CGenWit>::iterator wit = queue.begin();
+        while (wit != queue.end() && vWork.size() < MAX_GENWIT_BATCH) {
+            if (wit->getDen() == den && wit->getStartingHeight() == nStartingHeight && wit->getAccWitValue() == bnAccWitValue) {
+                vWork.push_back(*wit);
+                wit = queue.erase(wit);
+            } else {
+                ++wit;
+            }
+        }
+        if (queue.empty())
+            mapPeerRequests.erase(it++);
+        else
+            ++it;
+    }
+    return vWork;
+}
+
+void CLightWorker::StopLightZwgrThread() {
+    isWorkerRunning = false;
+    threadsIns.interrupt_all();
+    threadsIns.join_all();
+
+    // Let go of the peers whose requests were never computed
+    boost::unique_lock<boost::mutex> lock(mutex);
+    for (std::pair<const NodeId, std::deque<CGenWit> >& peerRequests : mapPeerRequests) {
+        for (CGenWit& wit : peerRequests.second)
+            wit.getPfrom()->Release();
+    }
+    mapPeerRequests.clear();
+    LogPrintf("%s thread interrupted\n", "wagerr-light-thread");
+}
+
 /****** Thread ********/
 void CLightWorker::ThreadLightZWGRSimplified() {
     RenameThread("wagerr-light-thread");
-    isWorkerRunning = true;
     while (true) {
+        std::vector<CGenWit> vWork = popWork();
+        LogPrint("zero", "%s pop work for %s and %d similar requests\n", "wagerr-light-thread", vWork[0].toString(), vWork.size() - 1);
         try {
-
-            // Take a breath between requests.. TODO: Add processor usage check here
-            MilliSleep(2000);
-
-            // TODO: Future: join several similar requests into one calculation if the filter and denom match..
-            CGenWit genWit = requestsQueue.pop();
-            LogPrintf("%s pop work for %s \n\n", "wagerr-light-thread", genWit.toString());
-
-            libzerocoin::ZerocoinParams *params = Params().Zerocoin_Params(false);
-            CBlockIndex *pIndex = chainActive[genWit.getStartingHeight()];
-            if (!pIndex) {
-                // Rejects only the failed height
-                rejectWork(genWit, genWit.getStartingHeight(), NON_DETERMINED);
-            } else {
-                LogPrintf("%s calculating work for %s \n\n", "wagerr-light-thread", genWit.toString());
-                int blockHeight = pIndex->nHeight;
-                if (blockHeight >= Params().Zerocoin_Block_V2_Start()) {
-
-                    // TODO: The protocol actually doesn't care about the Accumulator..
-                    libzerocoin::Accumulator accumulator(params, genWit.getDen(), genWit.getAccWitValue());
-                    libzerocoin::PublicCoin temp(params);
-                    libzerocoin::AccumulatorWitness witness(params, accumulator, temp);
-                    std::string strFailReason = "";
-                    int nMintsAdded = 0;
-                    CZerocoinSpendReceipt receipt;
-
-                    std::list<CBigNum> ret;
-                    int heightStop;
-
-                    bool res;
-                    try {
-
-                        res = CalculateAccumulatorWitnessFor(
-                                params,
-                                blockHeight,
-                                COMP_MAX_AMOUNT,
-                                genWit.getDen(),
-                                genWit.getFilter(),
-                                accumulator,
-                                witness,
-                                nMintsAdded,
-                                strFailReason,
-                                ret,
-                                heightStop
-                        );
-
-                    } catch (NotEnoughMintsException e) {
-                        LogPrintStr(std::string("ThreadLightZWGRSimplified: ") + e.message + "\n");
-                        rejectWork(genWit, blockHeight, NOT_ENOUGH_MINTS);
-                        continue;
-                    }
-
-                    if (!res) {
-                        // TODO: Check if the GenerateAccumulatorWitnessFor can fail for node's fault or it's just because the peer sent an illegal request..
-                        rejectWork(genWit, blockHeight, NON_DETERMINED);
-                    } else {
-                        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                        ss.reserve(ret.size() * 32);
-
-                        ss << genWit.getRequestNum();
-                        ss << accumulator.getValue(); // TODO: ---> this accumulator value is not necessary. The light node should get it using the other message..
-                        ss << witness.getValue();
-                        uint32_t size = ret.size();
-                        ss << size;
-                        for (CBigNum bnValue : ret) {
-                            ss << bnValue;
-                        }
-                        ss << heightStop;
-                        if (genWit.getPfrom()) {
-                            LogPrintf("%s pushing message to %s \n", "wagerr-light-thread", genWit.getPfrom()->addrName);
-                            genWit.getPfrom()->PushMessage("pubcoins", ss);
-                        } else
-                            LogPrintf("%s NOT pushing message to %s \n", "wagerr-light-thread", genWit.getPfrom()->addrName);
-                    }
-                } else {
-                    // Rejects only the failed height
-                    rejectWork(genWit, blockHeight, NON_DETERMINED);
-                }
-            }
+            processWork(vWork);
+        } catch (const boost::thread_interrupted&) {
+            for (CGenWit& genWit : vWork)
+                genWit.getPfrom()->Release();
+            throw;
         } catch (std::exception& e) {
-            //std::cout << "exception in light loop, closing it. " << e.what() << std::endl;
             PrintExceptionContinue(&e, "lightzwgrthread");
-            break;
         }
+        for (CGenWit& genWit : vWork)
+            genWit.getPfrom()->Release();
     }
+}
 
+void CLightWorker::processWork(std::vector<CGenWit>& vWork) {
+    const CGenWit& genWit = vWork[0];
+    libzerocoin::ZerocoinParams *params = Params().Zerocoin_Params(false);
+    CBlockIndex *pIndex = chainActive[genWit.getStartingHeight()];
+    if (!pIndex || pIndex->nHeight < Params().Zerocoin_Block_V2_Start()) {
+        for (CGenWit& wit : vWork)
+            rejectWork(wit, NON_DETERMINED);
+        return;
+    }
 
-}
+    LogPrintf("%s calculating work for %s \n\n", "wagerr-light-thread", genWit.toString());
+    int blockHeight = pIndex->nHeight;
+
+    // TODO: The protocol actually doesn't care about the Accumulator..
+    libzerocoin::Accumulator accumulator(params, genWit.getDen(), genWit.getAccWitValue());
+    std::vector<CBloomFilter> vFilters;
+    for (const CGenWit& wit : vWork)
+        vFilters.push_back(wit.getFilter());
+    std::string strFailReason = "";
+    std::vector<CBigNum> vWitnessValues;
+    std::vector<int> vMintsAdded;
+    std::vector<std::list<CBigNum> > vRet;
+    int heightStop;
+
+    const bool res = CalculateAccumulatorWitnessesFor(
+            params,
+            blockHeight,
+            COMP_MAX_AMOUNT,
+            genWit.getDen(),
+            vFilters,
+            accumulator,
+            vWitnessValues,
+            vMintsAdded,
+            strFailReason,
+            vRet,
+            heightStop
+    );
+
+    for (unsigned int i = 0; i < vWork.size(); i++) {
+        CGenWit& wit = vWork[i];
+        if (!res) {
+            // TODO: Check if the GenerateAccumulatorWitnessFor can fail for node's fault or it's just because the peer sent an illegal request..
+            rejectWork(wit, NON_DETERMINED);
+            continue;
+        }
+
+        // A certain amount of accumulated coins are required
+        if (vMintsAdded[i] < Params().Zerocoin_RequiredAccumulation()) {
+            LogPrintf("ThreadLightZWGRSimplified: Less than %d mints added, unable to create spend\n", Params().Zerocoin_RequiredAccumulation());
+            rejectWork(wit, NOT_ENOUGH_MINTS);
+            continue;
+        }
 
-// TODO: Think more the peer misbehaving policy..
-void CLightWorker::rejectWork(CGenWit& wit, int blockHeight, uint32_t errorNumber) {
-    if (wit.getStartingHeight() == blockHeight){
-        LogPrintf("%s rejecting work %s , error code: %s\n", "wagerr-light-thread", wit.toString(), errorNumber);
         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss.reserve(vRet[i].size() * 32);
+
         ss << wit.getRequestNum();
-        ss << errorNumber;
+        ss << accumulator.getValue(); // TODO: ---> this accumulator value is not necessary. The light node should get it using the other message..
+        ss << vWitnessValues[i];
+        uint32_t size = vRet[i].size();
+        ss << size;
+        for (CBigNum bnValue : vRet[i]) {
+            ss << bnValue;
+        }
+        ss << heightStop;
+        LogPrintf("%s pushing message to %s \n", "wagerr-light-thread", wit.getPfrom()->addrName);
         wit.getPfrom()->PushMessage("pubcoins", ss);
-    } else {
-        requestsQueue.push(wit);
     }
-}
\ No newline at end of file
+}
+
+// TODO: Think more the peer misbehaving policy..
+void CLightWorker::rejectWork(CGenWit& wit, uint32_t errorNumber) {
+    LogPrintf("%s rejecting work %s , error code: %s\n", "wagerr-light-thread", wit.toString(), errorNumber);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << wit.getRequestNum();
+    ss << errorNumber;
+    wit.getPfrom()->PushMessage("pubcoins", ss);
+}
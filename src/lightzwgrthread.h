@@ -8,9 +8,10 @@
 #define WAGERR_LIGHTZWGRTHREAD_H
 
 #include <atomic>
+#include <deque>
+#include <map>
 #include "genwit.h"
 #include "zwgr/accumulators.h"
-#include "concurrentqueue.h"
 #include "chainparams.h"
 #include <boost/function.hpp>
 #include <boost/thread.hpp>
@@ -18,6 +19,12 @@
 extern CChain chainActive;
 // Max amount of computation for a single request
 const int COMP_MAX_AMOUNT = 60 * 24 * 60;
+// Max requests of a single peer waiting to be computed
+const size_t MAX_GENWIT_PER_PEER = 10;
+// Max requests answered from a single computation
+const size_t MAX_GENWIT_BATCH = 100;
+// Default number of threads computing witnesses
+const int DEFAULT_LIGHTZWGR_THREADS = 2;
 
 
 /****** Thread ********/
@@ -26,14 +33,19 @@ class CLightWorker{
 
 private:
 
-    concurrentqueue<CGenWit> requestsQueue;
+    // Requests waiting per peer, taken round robin so one peer can't starve the others
+    std::map<NodeId, std::deque<CGenWit> > mapPeerRequests;
+    NodeId nLastPeer;
+    boost::mutex mutex;
+    boost::condition_variable condition;
     std::atomic<bool> isWorkerRunning;
-    boost::thread threadIns;
+    boost::thread_group threadsIns;
 
 public:
 
     CLightWorker() {
         isWorkerRunning = false;
+        nLastPeer = -1;
     }
 
     enum ERROR_CODES {
@@ -41,30 +53,29 @@ public:
         NON_DETERMINED = 1
     };
 
-    bool addWitWork(CGenWit wit) {
-        if (!isWorkerRunning) {
-            LogPrintf("%s not running trying to add wit work \n", "wagerr-light-thread");
-            return false;
-        }
-        requestsQueue.push(wit);
-        return true;
-    }
+    bool addWitWork(CGenWit wit);
 
-    void StartLightZwgrThread(boost::thread_group& threadGroup) {
-        LogPrintf("%s thread start\n", "wagerr-light-thread");
-        threadIns = boost::thread(boost::bind(&CLightWorker::ThreadLightZWGRSimplified, this));
+    void StartLightZwgrThread(boost::thread_group& threadGroup, int nThreads) {
+        LogPrintf("%s thread start, %d threads\n", "wagerr-light-thread", nThreads);
+        isWorkerRunning = true;
+        for (int i = 0; i < nThreads; i++)
+            threadsIns.create_thread(boost::bind(&CLightWorker::ThreadLightZWGRSimplified, this));
     }
 
-    void StopLightZwgrThread() {
-        threadIns.interrupt();
-        LogPrintf("%s thread interrupted\n", "wagerr-light-thread");
-    }
+    // Stop and join the threads, releasing the peers of the requests still waiting
+    void StopLightZwgrThread();
+
+    /** Public only for unit testing */
+    // Wait for the next request and take the waiting requests that can be computed with it
+    std::vector<CGenWit> popWork();
+
+    void processWork(std::vector<CGenWit>& vWork);
 
 private:
 
     void ThreadLightZWGRSimplified();
 
-    void rejectWork(CGenWit& wit, int blockHeight, uint32_t errorNumber);
+    void rejectWork(CGenWit& wit, uint32_t errorNumber);
 
 };
 
@@ -13,6 +13,7 @@
 #include "addrman.h"
 #include "alert.h"
 #include "betting/bet.h"
+#include "betting/bettingdb.h"
 #include "blocksignature.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -616,6 +617,7 @@ CCoinsViewCache* pcoinsTip = NULL;
 CBlockTreeDB* pblocktree = NULL;
 CZerocoinDB* zerocoinDB = NULL;
 CSporkDB* pSporkDB = NULL;
+CBettingDB* bettingDB = NULL;
 
 //////////////////////////////////////////////////////////////////////////////
 //
@@ -759,6 +761,7 @@ bool IsStandardTx(const CTransaction& tx, std::string& reason)
     }
 
     unsigned int nDataOut = 0;
+    unsigned int nBetOut = 0;
     txnouttype whichType;
     for (const CTxOut& txout : tx.vout) {
         if (!::IsStandard(txout.scriptPubKey, whichType)) {
@@ -766,9 +769,14 @@ bool IsStandardTx(const CTransaction& tx, std::string& reason)
             return false;
         }
 
-        if (whichType == TX_NULL_DATA)
-            nDataOut++;
-        else if ((whichType == TX_MULTISIG) && (!fIsBareMultisigStd)) {
+        if (whichType == TX_NULL_DATA) {
+            // Several peerless bets can be placed in one transaction, see placebets.
+            CBetOpCode betOpCode;
+            if (!DecodeBetOpCode(txout.scriptPubKey, betOpCode) || !boost::get<CPeerlessBet>(&betOpCode))
+                nDataOut++;
+            else
+                nBetOut++;
+        } else if ((whichType == TX_MULTISIG) && (!fIsBareMultisigStd)) {
             reason = "bare-multisig";
             return false;
         } else if (txout.IsDust(::minRelayTxFee)) {
@@ -777,8 +785,8 @@ bool IsStandardTx(const CTransaction& tx, std::string& reason)
         }
     }
 
-    // only one OP_RETURN txout is permitted
-    if (nDataOut > 1) {
+    // only one OP_RETURN txout is permitted, unless they are all peerless bets
+    if (nDataOut > 1 || (nDataOut == 1 && nBetOut > 0)) {
         reason = "multi-op-return";
         return false;
     }
@@ -1070,7 +1078,7 @@ bool ContextualCheckZerocoinSpendNoSerialCheck(const CTransaction& tx, const lib
 }
 
 
-bool CheckZerocoinSpend(const CTransaction& tx, bool fVerifySignature, CValidationState& state, bool fFakeSerialAttack)
+bool CheckZerocoinSpend(const CTransaction& tx, bool fVerifySignature, CValidationState& state, bool fFakeSerialAttack, std::vector<CZerocoinSpendCheck>* pvChecks)
 {
     //max needed non-mint outputs should be 2 - one for redemption address and a possible 2nd for change
     if (tx.vout.size() > 2) {
@@ -1145,12 +1153,19 @@ bool CheckZerocoinSpend(const CTransaction& tx, bool fVerifySignature, CValidati
                     return state.DoS(100, error("%s: Zerocoinspend could not find accumulator associated with checksum %s", __func__, HexStr(BEGIN(nChecksum), END(nChecksum))));
                 }
 
-                libzerocoin::Accumulator accumulator(Params().Zerocoin_Params(chainActive.Height() < Params().Zerocoin_Block_V2_Start()),
-                                        newSpend.getDenomination(), bnAccumulatorValue);
+                libzerocoin::ZerocoinParams* params = Params().Zerocoin_Params(chainActive.Height() < Params().Zerocoin_Block_V2_Start());
+                if (pvChecks) {
+                    // Verified by the caller, together with the other spends of the block
+                    pvChecks->push_back(CZerocoinSpendCheck());
+                    CZerocoinSpendCheck check(newSpend, params, bnAccumulatorValue, !fFakeSerialAttack);
+                    check.swap(pvChecks->back());
+                } else {
+                    libzerocoin::Accumulator accumulator(params, newSpend.getDenomination(), bnAccumulatorValue);
 
-                //Check that the coin has been accumulated
-                if(!newSpend.Verify(accumulator, !fFakeSerialAttack))
-                        return state.DoS(100, error("CheckZerocoinSpend(): zerocoin spend did not verify"));
+                    //Check that the coin has been accumulated
+                    if(!newSpend.Verify(accumulator, !fFakeSerialAttack))
+                            return state.DoS(100, error("CheckZerocoinSpend(): zerocoin spend did not verify"));
+                }
             }
 
         if (serials.count(newSpend.getCoinSerialNumber()))
@@ -1170,7 +1185,7 @@ bool CheckZerocoinSpend(const CTransaction& tx, bool fVerifySignature, CValidati
     return fValidated;
 }
 
-bool CheckTransaction(const CTransaction& tx, bool fZerocoinActive, bool fRejectBadUTXO, CValidationState& state, bool fFakeSerialAttack)
+bool CheckTransaction(const CTransaction& tx, bool fZerocoinActive, bool fRejectBadUTXO, CValidationState& state, bool fFakeSerialAttack, std::vector<CZerocoinSpendCheck>* pvZerocoinChecks)
 {
     // Basic checks that don't depend on any context
     if (tx.vin.empty())
@@ -1241,7 +1256,7 @@ bool CheckTransaction(const CTransaction& tx, bool fZerocoinActive, bool fReject
 
             // Do not require signature verification if this is initial sync and a block over 24 hours old
             bool fVerifySignature = !IsInitialBlockDownload() && (GetTime() - chainActive.Tip()->GetBlockTime() < (60*60*24));
-            if (!CheckZerocoinSpend(tx, fVerifySignature, state, fFakeSerialAttack))
+            if (!CheckZerocoinSpend(tx, fVerifySignature, state, fFakeSerialAttack, pvZerocoinChecks))
                 return state.DoS(100, error("CheckTransaction() : invalid zerocoin spend"));
         }
     }
@@ -2600,6 +2615,9 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
         }
     }
 
+    if (pindex->nHeight >= Params().Zerocoin_StartHeight() && !zerocoinDB->EraseBlockPubcoins(pindex->nHeight))
+        return error("DisconnectBlock(): Failed to erase pubcoin index");
+
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
@@ -2610,6 +2628,12 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
             if(!EraseAccumulatorValues(nCheckpoint, pindex->pprev->nAccumulatorCheckpoint))
                 return error("DisconnectBlock(): failed to erase checkpoint");
         }
+
+        // revert the betting state changes of the block and remove it from the bet index
+        if (!DisconnectBettingBlock(block, pindex))
+            return error("DisconnectBlock(): failed to undo betting state");
+        if (!DisconnectBettingIndex(block, pindex))
+            return error("DisconnectBlock(): failed to update the bet index");
     }
 
     if (pfClean) {
@@ -2653,6 +2677,38 @@ void ThreadScriptCheck()
     scriptcheckqueue.Thread();
 }
 
+bool CZerocoinSpendCheck::operator()()
+{
+    libzerocoin::Accumulator accumulator(params, spend.getDenomination(), bnAccumulatorValue);
+    return spend.Verify(accumulator, fVerifyParams);
+}
+
+// A spend proof takes far longer than a script, so the workers take one at a time
+static CCheckQueue<CZerocoinSpendCheck> zerocoincheckqueue(1);
+// CheckBlock runs outside cs_main, so blocks take turns with the queue
+static CCriticalSection cs_zerocoincheckqueue;
+
+void ThreadZerocoinSpendCheck()
+{
+    RenameThread("wagerr-zcspendch");
+    zerocoincheckqueue.Thread();
+}
+
+bool VerifyZerocoinSpendChecks(std::vector<CZerocoinSpendCheck>& vChecks)
+{
+    if (!nScriptCheckThreads) {
+        for (CZerocoinSpendCheck& check : vChecks)
+            if (!check())
+                return false;
+        return true;
+    }
+
+    LOCK(cs_zerocoincheckqueue);
+    CCheckQueueControl<CZerocoinSpendCheck> control(&zerocoincheckqueue);
+    control.Add(vChecks);
+    return control.Wait();
+}
+
 void AddWrappedSerialsInflation()
 {
     CBlockIndex* pindex = chainActive[Params().Zerocoin_Block_EndFakeSerial()];
@@ -3233,8 +3289,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         //const char * BetNetExpectedTxtConst = strBetNetExpectedTxt.c_str();
 
         // Get the PL and CG bet payout TX's so we can calculate the winning bet vector which is used to mint coins and payout bets.
-        vExpectedPLPayouts = GetBetPayouts(pindex->nHeight - 1);
-        vExpectedCGLottoPayouts = GetCGLottoBetPayouts(pindex->nHeight - 1);
+        if (!GetExpectedBetPayouts(pindex->pprev, vExpectedPLPayouts, vExpectedCGLottoPayouts))
+            return state.Abort("Failed to read the bet index");
 
         // Get the total amount of WGR that needs to be minted to payout all winning bets.
         nExpectedMint += GetBlockPayouts(vExpectedPLPayouts, nMNBetReward);
@@ -3351,6 +3407,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     if (!zerocoinDB->WriteCoinSpendBatch(vSpends)) return state.Abort(("Failed to record coin serials to database"));
     if (!zerocoinDB->WriteCoinMintBatch(vMints)) return state.Abort(("Failed to record new mints to database"));
 
+    //Index the block's pubcoins by denomination for witness and checkpoint computation
+    if (pindex->nHeight >= Params().Zerocoin_StartHeight()) {
+        std::map<libzerocoin::CoinDenomination, CBlockPubcoins> mapPubcoins;
+        if (!BlockToPubcoinIndex(block, mapPubcoins) || !zerocoinDB->WriteBlockPubcoins(pindex->nHeight, pindex->GetBlockHash(), mapPubcoins))
+            return state.Abort(("Failed to record pubcoin index to database"));
+    }
+
     //Record accumulator checksums
     DatabaseChecksums(mapAccumulators);
 
@@ -3358,6 +3421,14 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (!pblocktree->WriteTxIndex(vPos))
             return state.Abort("Failed to write transaction index");
 
+    // The bet index looks up the payout addresses of bets through the transaction index, so write it afterwards.
+    if (!fVerifyingBlocks && !ConnectBettingIndex(block, pindex))
+        return state.Abort("Failed to write bet index");
+
+    // Apply the events, results, odds, mappings and bets of the block to the betting state.
+    if (!fVerifyingBlocks && !ConnectBettingBlock(block, pindex))
+        return state.Abort("Failed to write betting undo data");
+
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
@@ -3611,6 +3682,9 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, CBlock*
     mempool.check(pcoinsTip);
     // Update chainActive & related variables.
     UpdateTip(pindexNew);
+    // Settle the bets paid out by the next block once, for both the miner and its validation.
+    if (pindexNew->nHeight + 1 > Params().BetStartHeight())
+        CacheExpectedBetPayouts(pindexNew);
     // Tell wallet about transactions that went from mempool
     // to conflicted:
     for (const CTransaction& tx : txConflicted) {
@@ -4333,13 +4407,15 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
     std::vector<CBigNum> vBlockSerials;
     // TODO: Check if this is ok... blockHeight is always the tip or should we look for the prevHash and get the height?
     int blockHeight = chainActive.Height() + 1;
+    std::vector<CZerocoinSpendCheck> vZerocoinChecks;
     for (const CTransaction& tx : block.vtx) {
         if (!CheckTransaction(
                 tx,
                 fZerocoinActive,
                 blockHeight >= Params().Zerocoin_Block_EnforceSerialRange(),
                 state,
-                isBlockBetweenFakeSerialAttackRange(blockHeight)
+                isBlockBetweenFakeSerialAttackRange(blockHeight),
+                &vZerocoinChecks
         ))
             return error("%s : CheckTransaction failed", __func__);
 
@@ -4378,6 +4454,10 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
         return state.DoS(100, error("%s : out-of-bounds SigOpCount", __func__),
             REJECT_INVALID, "bad-blk-sigops", true);
 
+    // Check that the coins spent by the zerocoin spends have been accumulated
+    if (!vZerocoinChecks.empty() && !VerifyZerocoinSpendChecks(vZerocoinChecks))
+        return state.DoS(100, error("%s : zerocoin spend did not verify", __func__));
+
     return true;
 }
 
@@ -4853,136 +4933,6 @@ bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex** ppindex,
         return state.Abort(std::string("System error: ") + e.what());
     }
 
-    bool eiUpdated = false;
-    // Look through the block for any events, results or mapping TX.
-    if (pindex->nHeight > Params().BetStartHeight()) {
-        for (CTransaction& tx : block.vtx) {
-
-            // Ensure the event TX has come from Oracle wallet.
-            const CTxIn &txin = tx.vin[0];
-            bool validOracleTx = IsValidOracleTx(txin);
-
-            // Search for any new bets
-            for (unsigned int i = 0; i < tx.vout.size(); i++) {
-                const CTxOut& txout = tx.vout[i];
-                std::string s = txout.scriptPubKey.ToString();
-
-                if (0 == strncmp(s.c_str(), "OP_RETURN", 9)) {
-                    std::vector<unsigned char> v = ParseHex(s.substr(9, std::string::npos));
-                    std::string opCode(v.begin(), v.end());
-
-                    CPeerlessBet plBet;
-                    if (CPeerlessBet::FromOpCode(opCode, plBet)) {
-                        CAmount betAmount = txout.nValue;
-                        SetEventAccummulators(plBet, betAmount);
-                        eiUpdated = true;
-                    }
-                }
-            }
-
-            // If a valid OMNO transaction.
-            if (validOracleTx) {
-
-                for (unsigned int i = 0; i < tx.vout.size(); i++) {
-                    const CTxOut& txout = tx.vout[i];
-                    std::string s = txout.scriptPubKey.ToString();
-
-                    if (0 == strncmp(s.c_str(), "OP_RETURN", 9)) {
-                        std::vector<unsigned char> v = ParseHex(s.substr(9, std::string::npos));
-                        std::string opCode(v.begin(), v.end());
-
-                        // TODO - Optimise the OP code validation, we don't need to compare current OP code against all TX types.
-                        // if it matches any TX type the rest should be skipped.
-
-                        // If events found in block add them to the events index.
-                        CPeerlessEvent plEvent;
-                        if (CPeerlessEvent::FromOpCode(opCode, plEvent)) {
-                            CEventDB::AddEvent(plEvent);
-                            eiUpdated = true;
-                        }
-
-                        // If results found in block remove event from event index and add result to result index.
-                        CPeerlessResult plResult;
-                        if (CPeerlessResult::FromOpCode(opCode, plResult)) {
-//                            CEventDB::RemoveEvent(plResult);
-                            CResultDB::AddResult(plResult);
-                            eiUpdated = true;
-                        }
-
-                        // If update money line odds TX found in block, update the event index.
-                        CPeerlessUpdateOdds puo;
-                        if (CPeerlessUpdateOdds::FromOpCode(opCode, puo)) {
-                            SetEventMLOdds(puo);
-                            eiUpdated = true;
-                        }
-
-                        // If spread odds TX found then update the spread odds for that event object.
-                        CPeerlessSpreadsEvent spreadEvent;
-                        if (CPeerlessSpreadsEvent::FromOpCode(opCode, spreadEvent)) {
-                            SetEventSpreadOdds(spreadEvent);
-                            eiUpdated = true;
-                        }
-
-                        // If total odds TX found then update the total odds for that event object.
-                        CPeerlessTotalsEvent totalsEvent;
-                        if (CPeerlessTotalsEvent::FromOpCode(opCode, totalsEvent)) {
-                            SetEventTotalOdds(totalsEvent);
-                            eiUpdated = true;
-                        }
-
-                        // If mapping found then add it to the relating std::map index and write the std::map index to disk.
-                        CMapping cMapping;
-                        if (CMapping::FromOpCode(opCode, cMapping)) {
-                            if (cMapping.nMType == sportMapping) {
-                                CMappingDB::AddSport(cMapping);
-
-                                mappingIndex_t sportsIndex;
-                                CMappingDB mdb("sports.dat");
-                                mdb.Write(sportsIndex, block.GetHash());
-                            }
-                            else if (cMapping.nMType == roundMapping) {
-                                CMappingDB::AddRound(cMapping);
-
-                                mappingIndex_t roundsIndex;
-                                CMappingDB mdb("rounds.dat");
-                                mdb.Write(roundsIndex, block.GetHash());
-                            }
-                            else if (cMapping.nMType == teamMapping) {
-                                CMappingDB::AddTeam(cMapping);
-
-                                mappingIndex_t teamsIndex;
-                                CMappingDB mdb("teams.dat");
-                                mdb.Write(teamsIndex, block.GetHash());
-                            }
-                            else if (cMapping.nMType == tournamentMapping) {
-                                CMappingDB::AddTournament(cMapping);
-
-                                mappingIndex_t tournamentsIndex;
-                                CMappingDB mdb("tournaments.dat");
-                                mdb.Write(tournamentsIndex, block.GetHash());
-                            }
-                        }
-                    }
-                }
-
-                // Write event and result indexes to events.dat and results.dat respectively.
-                if (eiUpdated) {
-                    // Update the global event index.
-                    CEventDB edb;
-                    eventIndex_t eventIndex;
-                    edb.GetEvents(eventIndex);
-                    edb.Write(eventIndex, block.GetHash());
-
-                    // Update the global results index.
-                    CResultDB rdb;
-                    resultsIndex_t resultsIndex;
-                    rdb.GetResults(resultsIndex);
-                    rdb.Write(resultsIndex, block.GetHash());
-                }
-            }
-        }
-    }
-
     return true;
 }
 
@@ -5457,6 +5407,7 @@ void UnloadBlockIndex()
     setDirtyBlockIndex.clear();
     setDirtyFileInfo.clear();
     mapNodeState.clear();
+    ClearStakeModifierCache();
 
     for (BlockMap::value_type& entry : mapBlockIndex) {
         delete entry.second;
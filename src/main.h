@@ -50,9 +50,11 @@ class CBlockIndex;
 class CBlockTreeDB;
 class CZerocoinDB;
 class CSporkDB;
+class CBettingDB;
 class CBloomFilter;
 class CInv;
 class CScriptCheck;
+class CZerocoinSpendCheck;
 class CValidationInterface;
 class CValidationState;
 
@@ -131,7 +133,9 @@ static const unsigned char REJECT_INSUFFICIENTFEE = 0x42;
 static const unsigned char REJECT_CHECKPOINT = 0x43;
 
 /** zWGR precomputing variables
- * Set the number of included blocks to precompute per cycle. */
+ * Whether the precompute thread keeps zWGR witnesses current. */
+static const bool DEFAULT_PRECOMPUTE = true;
+/** Set the number of included blocks to precompute per cycle. */
 static const int DEFAULT_PRECOMPUTE_LENGTH = 1000;
 static const int MIN_PRECOMPUTE_LENGTH = 500;
 static const int MAX_PRECOMPUTE_LENGTH = 2000;
@@ -230,6 +234,8 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto, bool fSendTrickle);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the zerocoin spend checking thread */
+void ThreadZerocoinSpendCheck();
 
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
@@ -356,9 +362,10 @@ bool CheckInputs(const CTransaction& tx, CValidationState& state, const CCoinsVi
 void UpdateCoins(const CTransaction& tx, CValidationState& state, CCoinsViewCache& inputs, CTxUndo& txundo, int nHeight);
 
 /** Context-independent validity checks */
-bool CheckTransaction(const CTransaction& tx, bool fZerocoinActive, bool fRejectBadUTXO, CValidationState& state, bool fFakeSerialAttack = false);
+bool CheckTransaction(const CTransaction& tx, bool fZerocoinActive, bool fRejectBadUTXO, CValidationState& state, bool fFakeSerialAttack = false, std::vector<CZerocoinSpendCheck>* pvZerocoinChecks = NULL);
 bool CheckZerocoinMint(const uint256& txHash, const CTxOut& txout, CValidationState& state, bool fCheckOnly = false);
-bool CheckZerocoinSpend(const CTransaction& tx, bool fVerifySignature, CValidationState& state, bool fFakeSerialAttack = false);
+/** Check a zerocoin spend; if pvChecks is not NULL, the spend proofs are appended to it instead of being verified */
+bool CheckZerocoinSpend(const CTransaction& tx, bool fVerifySignature, CValidationState& state, bool fFakeSerialAttack = false, std::vector<CZerocoinSpendCheck>* pvChecks = NULL);
 bool ContextualCheckZerocoinSpend(const CTransaction& tx, const libzerocoin::CoinSpend* spend, CBlockIndex* pindex, const uint256& hashBlock);
 bool ContextualCheckZerocoinSpendNoSerialCheck(const CTransaction& tx, const libzerocoin::CoinSpend* spend, CBlockIndex* pindex, const uint256& hashBlock);
 bool IsTransactionInChain(const uint256& txId, int& nHeightTx, CTransaction& tx);
@@ -446,6 +453,37 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure representing one zerocoin spend proof verification.
+ * CheckBlock collects them for a whole block and runs them on the check threads.
+ */
+class CZerocoinSpendCheck
+{
+private:
+    libzerocoin::CoinSpend spend;
+    const libzerocoin::ZerocoinParams* params;
+    CBigNum bnAccumulatorValue;
+    bool fVerifyParams;
+
+public:
+    CZerocoinSpendCheck() : params(NULL), fVerifyParams(true) {}
+    CZerocoinSpendCheck(const libzerocoin::CoinSpend& spendIn, const libzerocoin::ZerocoinParams* paramsIn, const CBigNum& bnAccumulatorValueIn, bool fVerifyParamsIn) :
+        spend(spendIn), params(paramsIn), bnAccumulatorValue(bnAccumulatorValueIn), fVerifyParams(fVerifyParamsIn) {}
+
+    bool operator()();
+
+    void swap(CZerocoinSpendCheck& check)
+    {
+        std::swap(spend, check.spend);
+        std::swap(params, check.params);
+        std::swap(bnAccumulatorValue, check.bnAccumulatorValue);
+        std::swap(fVerifyParams, check.fVerifyParams);
+    }
+};
+
+/** Verify the zerocoin spend proofs of a block on the check threads, or serially without them */
+bool VerifyZerocoinSpendChecks(std::vector<CZerocoinSpendCheck>& vChecks);
+
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos);
@@ -648,6 +686,9 @@ extern CZerocoinDB* zerocoinDB;
 /** Global variable that points to the spork database (protected by cs_main) */
 extern CSporkDB* pSporkDB;
 
+/** Global variable that points to the betting database (protected by cs_main) */
+extern CBettingDB* bettingDB;
+
 struct CBlockTemplate {
     CBlock block;
     std::vector<CAmount> vTxFees;
@@ -490,8 +490,10 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet,
 
             if( nHeight > Params().BetStartHeight()) {
                 // Get the PL and CG bet payout TX's so we can calculate the winning bet vector which is used to mint coins and payout bets.
-                vPLPayouts = GetBetPayouts(nHeight - 1);
-                vCGLottoPayouts = GetCGLottoBetPayouts(nHeight - 1);
+                if (!GetExpectedBetPayouts(pindexPrev, vPLPayouts, vCGLottoPayouts)) {
+                    LogPrintf("%s: failed to get the bet payouts\n", __func__);
+                    return NULL;
+                }
 
                 // Get the total amount of WGR that needs to be minted to payout all winning bets.
                 GetBlockPayouts(vPLPayouts, nMNBetReward);
@@ -718,11 +720,13 @@ void BitcoinMiner(CWallet* pwallet, bool fProofOfStake)
     CReserveKey reservekey(pwallet);
     unsigned int nExtraNonce = 0;
     bool fLastLoopOrphan = false;
+    // The wallet wakes the staker on a new tip or a transaction of ours
+    uint64_t nStakeNotifications = pwallet->stakeNotifier.GetCount();
     while (fGenerateBitcoins || fProofOfStake) {
         if (fProofOfStake) {
             if (chainActive.Tip()->nHeight < Params().LAST_POW_BLOCK()) {
                 //  The last PoW block hasn't even been mined yet.
-                MilliSleep(Params().TargetSpacing() * 1000);       // sleep a block
+                pwallet->stakeNotifier.Wait(nStakeNotifications, Params().TargetSpacing() * 1000);       // wait up to a block
                 continue;
             }
 
@@ -736,9 +740,10 @@ void BitcoinMiner(CWallet* pwallet, bool fProofOfStake)
             while (vNodes.empty() || pwallet->IsLocked() || !fMintableCoins ||
                    (pwallet->GetBalance() > 0 && nReserveBalance >= pwallet->GetBalance()) || !masternodeSync.IsSynced()) {
                 nLastCoinStakeSearchInterval = 0;
-                MilliSleep(5000);
-                // Do a separate 1 minute check here to ensure fMintableCoins is updated
-                if (!fMintableCoins && (GetTime() - nMintableLastCheck > 1 * 60)) // 1 minute check time
+                const bool fNotified = pwallet->stakeNotifier.Wait(nStakeNotifications, 5000);
+                // Do a separate check here to ensure fMintableCoins is updated, when the
+                // tip or the wallet changed or at least every minute
+                if (!fMintableCoins && (fNotified || GetTime() - nMintableLastCheck > 1 * 60)) // 1 minute check time
                 {
                     nMintableLastCheck = GetTime();
                     fMintableCoins = pwallet->MintableCoins();
@@ -748,13 +753,15 @@ void BitcoinMiner(CWallet* pwallet, bool fProofOfStake)
             //search our map of hashed blocks, see if bestblock has been hashed yet
             if (mapHashedBlocks.count(chainActive.Tip()->nHeight) && !fLastLoopOrphan)
             {
-                // wait half of the nHashDrift with max wait of 3 minutes
-                if (GetTime() - mapHashedBlocks[chainActive.Tip()->nHeight] < std::max(pwallet->nHashInterval, (unsigned int)1))
+                // wait half of the nHashDrift with max wait of 3 minutes, or until a new tip comes in
+                const int64_t nNextSearch = mapHashedBlocks[chainActive.Tip()->nHeight] + std::max(pwallet->nHashInterval, (unsigned int)1);
+                if (GetTime() < nNextSearch)
                 {
-                    MilliSleep(5000);
+                    pwallet->stakeNotifier.Wait(nStakeNotifications, (nNextSearch - GetTime()) * 1000);
                     continue;
                 }
             }
+            fLastLoopOrphan = false;
         } else { // PoW
             if ((chainActive.Tip()->nHeight - 6) > Params().LAST_POW_BLOCK())
             {
@@ -776,8 +783,12 @@ void BitcoinMiner(CWallet* pwallet, bool fProofOfStake)
         std::unique_ptr<CBlockTemplate> pblocktemplate(
                 fProofOfStake ? CreateNewBlock(CScript(), pwallet, fProofOfStake) : CreateNewBlockWithKey(reservekey, pwallet)
                         );
-        if (!pblocktemplate.get())
+        if (!pblocktemplate.get()) {
+            // Nothing was hashed on this tip, e.g. there were no stake inputs: wait for the wallet or the tip to change
+            if (fProofOfStake && !mapHashedBlocks.count(pindexPrev->nHeight))
+                pwallet->stakeNotifier.Wait(nStakeNotifications, std::max(pwallet->nHashInterval, (unsigned int)1) * 1000);
             continue;
+        }
 
         CBlock* pblock = &pblocktemplate->block;
         IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
@@ -28,6 +28,7 @@
 #include "transactionview.h"
 #include "walletmodel.h"
 
+#include "betting/bet.h"
 #include "guiinterface.h"
 
 #include <QAction>
@@ -407,13 +408,10 @@ void WalletView::gotoPlaceBetPage(QString addr)
             for (unsigned int i = 0; i < tx.vout.size(); i++) {
 
                 const CTxOut& txout = tx.vout[i];
-                std::string scriptPubKey = txout.scriptPubKey.ToString();
+                std::string evtDescr;
 
                 // TODO Remove hard-coded values from this block.
-                if ( validEventTx && scriptPubKey.length() > 0 && strncmp(scriptPubKey.c_str(), "OP_RETURN", 9) == 0) {
-
-                    std::vector<unsigned char> v = ParseHex(scriptPubKey.substr(9, std::string::npos));
-                    std::string evtDescr(v.begin(), v.end());
+                if ( validEventTx && GetBetOpCode(txout.scriptPubKey, evtDescr)) {
                     std::vector<std::string> strs;
                     boost::split(strs, evtDescr, boost::is_any_of("|"));
 
@@ -7,7 +7,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "net.h"
+#include "base58.h"
 #include "betting/bet.h"
+#include "betting/bettingdb.h"
+#include "main.h"
 #include "rpc/server.h"
 
 #include <univalue.h>
@@ -209,4 +212,367 @@ UniValue getmappingname(const UniValue& params, bool fHelp)
     ret.push_back(mapping);
 
     return ret;
-}
\ No newline at end of file
+}
+
+/**
+ * Reports how well the oracle transaction cache is doing.
+ *
+ * @param params The RPC params, none.
+ * @param fHelp  Help text
+ * @return
+ */
+UniValue getoracletxcacheinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw std::runtime_error(
+                "getoracletxcacheinfo\n"
+                "\nReturns the state of the cache of oracle transaction inputs.\n"
+
+                "\nResult:\n"
+                "{\n"
+                "  \"size\": xxxxx,       (numeric) The number of cached inputs\n"
+                "  \"maxsize\": xxxxx,    (numeric) The maximum number of cached inputs\n"
+                "  \"hits\": xxxxx,       (numeric) Lookups answered by the cache\n"
+                "  \"misses\": xxxxx      (numeric) Lookups that read the previous transaction\n"
+                "}\n"
+
+                "\nExamples:\n" +
+                HelpExampleCli("getoracletxcacheinfo", "") + HelpExampleRpc("getoracletxcacheinfo", ""));
+
+    size_t nSize;
+    uint64_t nHits, nMisses;
+    GetOracleTxCacheStats(nSize, nHits, nMisses);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("size", (uint64_t) nSize));
+    ret.push_back(Pair("maxsize", (uint64_t) MAX_ORACLE_TX_CACHE_SIZE));
+    ret.push_back(Pair("hits", nHits));
+    ret.push_back(Pair("misses", nMisses));
+
+    return ret;
+}
+
+/** Largest page of bets the bet index RPCs return. */
+static const int MAX_BET_PAGE_SIZE = 1000;
+
+/**
+ * Reads the paging arguments shared by the bet index RPCs: count, cursor, from and to height and outcome.
+ *
+ * @param params     The RPC params, the paging arguments starting at the second one.
+ * @param nCount     The number of bets to return.
+ * @param posStart   The position (height, transaction and output) of the first bet to return.
+ * @param nEndHeight The last height to return bets from.
+ * @param nOutcome   The outcome to return bets on, 0 for any.
+ */
+static void ParseBetPageParams(const UniValue& params, int& nCount, CBettingIndexKey& posStart, int& nEndHeight, int& nOutcome)
+{
+    nCount = 10;
+    if (params.size() > 1)
+        nCount = params[1].get_int();
+    if (nCount < 1 || nCount > MAX_BET_PAGE_SIZE)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("count must be between 1 and %d", MAX_BET_PAGE_SIZE));
+
+    int nStartHeight = 0;
+    if (params.size() > 3)
+        nStartHeight = params[3].get_int();
+    nEndHeight = chainActive.Height();
+    if (params.size() > 4)
+        nEndHeight = params[4].get_int();
+    if (nStartHeight < 0 || nEndHeight < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative height");
+    nOutcome = 0;
+    if (params.size() > 5)
+        nOutcome = params[5].get_int();
+    posStart = CBettingIndexKey(0, nStartHeight, 0, 0);
+
+    // The cursor is the position of the next bet, as returned by the previous page.
+    if (params.size() > 2 && !params[2].get_str().empty()) {
+        unsigned int nHeight, nTxIndex, nOutIndex;
+        char c;
+        if (sscanf(params[2].get_str().c_str(), "%u-%u-%u%c", &nHeight, &nTxIndex, &nOutIndex, &c) != 3)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        if (nHeight >= posStart.nHeight)
+            posStart = CBettingIndexKey(0, nHeight, nTxIndex, nOutIndex);
+    }
+}
+
+/**
+ * Whether a peerless bet has won, lost or is still waiting for the result of its event.
+ *
+ * @param plBet The bet.
+ * @return      The bet result as listbets reports it.
+ */
+static std::string GetBetResult(const CPeerlessBet& plBet)
+{
+    CPeerlessResult plResult;
+    if (!CResultDB::GetResult(plBet.nEventId, plResult))
+        return "pending";
+
+    switch (plBet.nOutcome) {
+        case OutcomeType::moneyLineWin:
+            return plResult.nHomeScore > plResult.nAwayScore ? "win" : "lose";
+        case OutcomeType::moneyLineLose:
+            return plResult.nAwayScore > plResult.nHomeScore ? "win" : "lose";
+        case OutcomeType::moneyLineDraw:
+            return plResult.nHomeScore == plResult.nAwayScore ? "win" : "lose";
+        default:
+            return "Check block explorer for result.";
+    }
+}
+
+/**
+ * Builds a page of bets read from the bet index.
+ *
+ * @param vEntries The bets read.
+ * @param posNext  Where the next page starts, a zero height on the last page.
+ * @return         The page
+ */
+static UniValue BetPageToJSON(const bettingIndexEntries_t& vEntries, const CBettingIndexKey& posNext)
+{
+    UniValue bets(UniValue::VARR);
+
+    for (unsigned int i = 0; i < vEntries.size(); i++) {
+        const CBettingIndexKey& key = vEntries[i].first;
+        const CBettingIndexEntry& entry = vEntries[i].second;
+
+        CPeerlessBet plBet;
+        if (!CPeerlessBet::FromOpCode(entry.opCode, plBet))
+            continue;
+
+        UniValue bet(UniValue::VOBJ);
+        bet.push_back(Pair("tx-id", entry.txHash.ToString()));
+        bet.push_back(Pair("n", (uint64_t) key.nOutIndex));
+        bet.push_back(Pair("height", (uint64_t) key.nHeight));
+        bet.push_back(Pair("time", (uint64_t) entry.nBlockTime));
+        bet.push_back(Pair("event-id", (uint64_t) plBet.nEventId));
+
+        // Look up the event and its names one by one rather than copying their indexes.
+        CPeerlessEvent plEvent;
+        if (CEventDB::GetEvent(plBet.nEventId, plEvent)) {
+            CMapping mapping;
+            bet.push_back(Pair("starting", plEvent.nStartTime));
+            if (CMappingDB::GetMapping(teamMapping, plEvent.nHomeTeam, mapping))
+                bet.push_back(Pair("home", mapping.sName));
+            if (CMappingDB::GetMapping(teamMapping, plEvent.nAwayTeam, mapping))
+                bet.push_back(Pair("away", mapping.sName));
+            if (CMappingDB::GetMapping(tournamentMapping, plEvent.nTournament, mapping))
+                bet.push_back(Pair("tournament", mapping.sName));
+        }
+
+        CTxDestination payoutAddress;
+        ExtractDestination(entry.payoutScript, payoutAddress);
+        bet.push_back(Pair("team-to-win", (uint64_t) plBet.nOutcome));
+        bet.push_back(Pair("amount", ValueFromAmount(entry.nValue)));
+        bet.push_back(Pair("address", CBitcoinAddress(payoutAddress).ToString()));
+        bet.push_back(Pair("result", GetBetResult(plBet)));
+
+        bets.push_back(bet);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("bets", bets));
+    if (posNext.nHeight != 0)
+        ret.push_back(Pair("cursor", strprintf("%u-%u-%u", posNext.nHeight, posNext.nTxIndex, posNext.nOutIndex)));
+
+    return ret;
+}
+
+/**
+ * Lists the bets on an event from the bet index, a page at a time.
+ *
+ * @param params The RPC params: event id, count, cursor, from height, to height and outcome.
+ * @param fHelp  Help text
+ * @return
+ */
+UniValue listbetsbyevent(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 6)
+        throw std::runtime_error(
+                "listbetsbyevent event-id ( count \"cursor\" from-height to-height outcome )\n"
+                "\nReturns the bets placed on an event in chain order, a page at a time.\n"
+
+                "\nArguments:\n"
+                "1. event-id      (numeric, required) The event id.\n"
+                "2. count         (numeric, optional, default=10) The number of bets to return, at most 1000.\n"
+                "3. \"cursor\"      (string, optional) The cursor returned with the previous page.\n"
+                "4. from-height   (numeric, optional, default=0) The first block height to return bets from.\n"
+                "5. to-height     (numeric, optional, default=tip) The last block height to return bets from.\n"
+                "6. outcome       (numeric, optional, default=0) Only return bets on this outcome, 0 for any.\n"
+
+                "\nResult:\n"
+                "{\n"
+                "  \"bets\": [\n"
+                "    {\n"
+                "      \"tx-id\": \"xxx\",        (string) The transaction id.\n"
+                "      \"n\": n,                (numeric) The output of the bet.\n"
+                "      \"height\": n,           (numeric) The height of the block holding the bet.\n"
+                "      \"time\": n,             (numeric) The time of the block holding the bet.\n"
+                "      \"event-id\": n,         (numeric) The ID of the event being bet on.\n"
+                "      \"starting\": n,         (numeric) The event start time.\n"
+                "      \"home\": \"xxx\",         (string) The home team name.\n"
+                "      \"away\": \"xxx\",         (string) The away team name.\n"
+                "      \"tournament\": \"xxx\",   (string) The tournament name.\n"
+                "      \"team-to-win\": n,      (numeric) The outcome bet on.\n"
+                "      \"amount\": x.xxx,       (numeric) The amount bet in WGR.\n"
+                "      \"address\": \"xxx\",      (string) The payout address.\n"
+                "      \"result\": \"xxx\"        (string) The bet result i.e win/lose/pending.\n"
+                "    }\n"
+                "  ],\n"
+                "  \"cursor\": \"xxx\"           (string) Pass to get the next page, missing on the last page.\n"
+                "                              With an outcome a page is cut short after scanning " + std::to_string(MAX_BET_PAGE_SCAN) + " bets,\n"
+                "                              so it can hold fewer bets than count and still have a cursor.\n"
+                "}\n"
+
+                "\nExamples:\n" +
+                HelpExampleCli("listbetsbyevent", "1021") + HelpExampleCli("listbetsbyevent", "1021 100 \"312000-5-1\"") +
+                HelpExampleRpc("listbetsbyevent", "1021, 100"));
+
+    LOCK(cs_main);
+
+    int nCount, nEndHeight, nOutcome;
+    CBettingIndexKey posStart;
+    ParseBetPageParams(params, nCount, posStart, nEndHeight, nOutcome);
+
+    bettingIndexEntries_t vEntries;
+    CBettingIndexKey posNext;
+    if (!bettingDB->ReadEventBets(params[0].get_int(), posStart, nEndHeight, nOutcome, nCount, vEntries, posNext))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the bet index");
+
+    return BetPageToJSON(vEntries, posNext);
+}
+
+/**
+ * Lists the bets paid out to an address from the -betindex index, a page at a time.
+ *
+ * @param params The RPC params: address, count, cursor, from height, to height and outcome.
+ * @param fHelp  Help text
+ * @return
+ */
+UniValue listbetsbyaddress(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 6)
+        throw std::runtime_error(
+                "listbetsbyaddress \"address\" ( count \"cursor\" from-height to-height outcome )\n"
+                "\nReturns the bets paid out to an address in chain order, a page at a time. Requires -betindex.\n"
+
+                "\nArguments:\n"
+                "1. \"address\"     (string, required) The payout address.\n"
+                "2. count         (numeric, optional, default=10) The number of bets to return, at most 1000.\n"
+                "3. \"cursor\"      (string, optional) The cursor returned with the previous page.\n"
+                "4. from-height   (numeric, optional, default=0) The first block height to return bets from.\n"
+                "5. to-height     (numeric, optional, default=tip) The last block height to return bets from.\n"
+                "6. outcome       (numeric, optional, default=0) Only return bets on this outcome, 0 for any.\n"
+
+                "\nResult:\n"
+                "Same as listbetsbyevent.\n"
+
+                "\nExamples:\n" +
+                HelpExampleCli("listbetsbyaddress", "\"WcsijutAF46tSLTcojk9mR9zV9wqwUUYpC\"") +
+                HelpExampleCli("listbetsbyaddress", "\"WcsijutAF46tSLTcojk9mR9zV9wqwUUYpC\" 100 \"312000-5-1\"") +
+                HelpExampleRpc("listbetsbyaddress", "\"WcsijutAF46tSLTcojk9mR9zV9wqwUUYpC\", 100"));
+
+    if (!fBetIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Bets are not indexed by address, restart with -betindex to enable it");
+
+    CBitcoinAddress address(params[0].get_str());
+    if (!address.IsValid())
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid Wagerr address");
+
+    LOCK(cs_main);
+
+    int nCount, nEndHeight, nOutcome;
+    CBettingIndexKey posStart;
+    ParseBetPageParams(params, nCount, posStart, nEndHeight, nOutcome);
+
+    bettingIndexEntries_t vEntries;
+    CBettingIndexKey posNext;
+    if (!bettingDB->ReadAddressBets(GetScriptForDestination(address.Get()), posStart, nEndHeight, nOutcome, nCount, vEntries, posNext))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the bet index");
+
+    return BetPageToJSON(vEntries, posNext);
+}
+
+/**
+ * Returns the total exposure of the liability book and the events with the largest exposure.
+ *
+ * @param params The RPC params: the number of events and the smallest exposure to return.
+ * @param fHelp  Help text
+ * @return
+ */
+UniValue getliabilitysummary(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 2)
+        throw std::runtime_error(
+                "getliabilitysummary ( count threshold )\n"
+                "\nReturns what the bets placed so far could pay out, and the events that could pay out the most.\n"
+                "The exposure of an event is its largest money line, spread and totals payouts added up.\n"
+
+                "\nArguments:\n"
+                "1. count         (numeric, optional, default=10) The number of events to return, at most 1000.\n"
+                "2. threshold     (numeric, optional, default=0) Only return events with at least this exposure in WGR.\n"
+
+                "\nResult:\n"
+                "{\n"
+                "  \"total-exposure\": x.xxx,   (numeric) The exposure of every event added up in WGR.\n"
+                "  \"events-count\": n,         (numeric) The number of events with bets.\n"
+                "  \"events\": [\n"
+                "    {\n"
+                "      \"event-id\": n,                   (numeric) The event id.\n"
+                "      \"exposure\": x.xxx,               (numeric) The exposure of the event in WGR.\n"
+                "      \"moneyline-home-liability\": x.xxx,\n"
+                "      \"moneyline-away-liability\": x.xxx,\n"
+                "      \"moneyline-draw-liability\": x.xxx,\n"
+                "      \"spreads-home-liability\": x.xxx,\n"
+                "      \"spreads-away-liability\": x.xxx,\n"
+                "      \"spreads-push-liability\": x.xxx,\n"
+                "      \"total-over-liability\": x.xxx,\n"
+                "      \"total-under-liability\": x.xxx,\n"
+                "      \"total-push-liability\": x.xxx,\n"
+                "      \"event-bet-count\": n             (numeric) The number of bets on the event.\n"
+                "    }\n"
+                "  ]\n"
+                "}\n"
+
+                "\nExamples:\n" +
+                HelpExampleCli("getliabilitysummary", "") + HelpExampleCli("getliabilitysummary", "20 1000") +
+                HelpExampleRpc("getliabilitysummary", "20, 1000"));
+
+    int nCount = params.size() > 0 ? params[0].get_int() : 10;
+    if (nCount < 1 || nCount > MAX_BET_PAGE_SIZE)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("count must be between 1 and %d", MAX_BET_PAGE_SIZE));
+    CAmount nThreshold = params.size() > 1 ? AmountFromValue(params[1]) : 0;
+
+    size_t nEvents;
+    std::vector<std::pair<uint32_t, CEventLiability> > vTop;
+    CAmount nTotalExposure = CLiabilityDB::GetTopExposures(nCount, nThreshold, nEvents, vTop);
+
+    static const char* const marketNames[LIABILITY_MARKETS] = {
+        "moneyline-home-liability", "moneyline-away-liability", "moneyline-draw-liability",
+        "spreads-home-liability", "spreads-away-liability", "spreads-push-liability",
+        "total-over-liability", "total-under-liability", "total-push-liability"};
+
+    UniValue events(UniValue::VARR);
+    for (const auto& top : vTop) {
+        const CEventLiability& liability = top.second;
+
+        UniValue event(UniValue::VOBJ);
+        event.push_back(Pair("event-id", (uint64_t) top.first));
+        event.push_back(Pair("exposure", ValueFromAmount(liability.GetExposure())));
+        uint32_t nBets = 0;
+        for (int i = 0; i < LIABILITY_MARKETS; i++) {
+            event.push_back(Pair(marketNames[i], ValueFromAmount(liability.vLiability[i])));
+            // Spreads and totals bets are also counted on the push market.
+            if (i != liabilitySpreadPush && i != liabilityTotalPush)
+                nBets += liability.vBets[i];
+        }
+        event.push_back(Pair("event-bet-count", (uint64_t) nBets));
+        events.push_back(event);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("total-exposure", ValueFromAmount(nTotalExposure)));
+    ret.push_back(Pair("events-count", (uint64_t) nEvents));
+    ret.push_back(Pair("events", events));
+
+    return ret;
+}
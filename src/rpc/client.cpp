@@ -39,10 +39,22 @@ static const CRPCConvertParam vRPCConvertParams[] =
         {"placebet", 0},
         {"placebet", 1},
         {"placebet", 2},
+        {"placebets", 0},
         {"listbets", 1},
         {"listbets", 2},
         {"listbets", 3},
         {"getbet", 1},
+        {"listbetsbyevent", 0},
+        {"listbetsbyevent", 1},
+        {"listbetsbyevent", 3},
+        {"listbetsbyevent", 4},
+        {"listbetsbyevent", 5},
+        {"listbetsbyaddress", 1},
+        {"listbetsbyaddress", 3},
+        {"listbetsbyaddress", 4},
+        {"listbetsbyaddress", 5},
+        {"getliabilitysummary", 0},
+        {"getliabilitysummary", 1},
         {"placechaingamesbet", 0},
         {"placechaingamesbet", 1},
         {"placechaingamesbet", 2},
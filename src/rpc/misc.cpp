@@ -9,6 +9,7 @@
 #include "base58.h"
 #include "clientversion.h"
 #include "init.h"
+#include "kernel.h"
 #include "main.h"
 #include "masternode-sync.h"
 #include "net.h"
@@ -600,6 +601,12 @@ UniValue getstakingstatus(const UniValue& params, bool fHelp)
             "  \"enoughcoins\": true|false,        (boolean) if available coins are greater than reserve balance\n"
             "  \"mnsync\": true|false,             (boolean) if masternode data is synced\n"
             "  \"staking status\": true|false,     (boolean) if the wallet is staking or not\n"
+            "  \"modifiercache\": {                (object) the kernel stake modifier cache\n"
+            "    \"size\": n,                      (numeric) the number of cached stake modifiers\n"
+            "    \"hits\": n,                      (numeric) the lookups answered from the cache\n"
+            "    \"misses\": n,                    (numeric) the lookups that walked the chain\n"
+            "    \"invalidated\": n                (numeric) the entries dropped after a reorganization\n"
+            "  }\n"
             "}\n"
 
             "\nExamples:\n" +
@@ -628,6 +635,15 @@ UniValue getstakingstatus(const UniValue& params, bool fHelp)
         nStaking = true;
     obj.push_back(Pair("staking status", nStaking));
 
+    CStakeModifierCacheStats stats;
+    GetStakeModifierCacheStats(stats);
+    UniValue cache(UniValue::VOBJ);
+    cache.push_back(Pair("size", (uint64_t)stats.nSize));
+    cache.push_back(Pair("hits", stats.nHits));
+    cache.push_back(Pair("misses", stats.nMisses));
+    cache.push_back(Pair("invalidated", stats.nInvalidated));
+    obj.push_back(Pair("modifiercache", cache));
+
     return obj;
 }
 #endif // ENABLE_WALLET
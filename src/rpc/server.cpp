@@ -398,6 +398,10 @@ static const CRPCCommand vRPCCommands[] =
         {"wagerr", "geteventsliability", &geteventsliability, false, false, true},
         {"wagerr", "getmappingid", &getmappingid, false, false, true},
         {"wagerr", "getmappingname", &getmappingname, false, false, true},
+        {"wagerr", "getoracletxcacheinfo", &getoracletxcacheinfo, true, true, false},
+        {"wagerr", "listbetsbyevent", &listbetsbyevent, false, false, false},
+        {"wagerr", "listbetsbyaddress", &listbetsbyaddress, false, false, false},
+        {"wagerr", "getliabilitysummary", &getliabilitysummary, true, false, false},
 
 
 #ifdef ENABLE_WALLET
@@ -445,6 +449,7 @@ static const CRPCCommand vRPCCommands[] =
         {"wallet", "move", &movecmd, false, false, true},
         {"wallet", "multisend", &multisend, false, false, true},
         {"wallet", "placebet", &placebet, false, false, true},
+        {"wallet", "placebets", &placebets, false, false, true},
         {"wallet", "sendfrom", &sendfrom, false, false, true},
         {"wallet", "sendmany", &sendmany, false, false, true},
         {"wallet", "sendtoaddress", &sendtoaddress, false, false, true},
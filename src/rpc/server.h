@@ -283,9 +283,14 @@ extern UniValue getchaingamesinfo(const UniValue& params, bool fHelp);
 extern UniValue placechaingamesbet(const UniValue& params, bool fHelp);
 extern UniValue geteventsliability(const UniValue& params, bool fHelp);
 extern UniValue placebet(const UniValue& params, bool fHelp);
+extern UniValue placebets(const UniValue& params, bool fHelp);
 extern UniValue listbets(const UniValue& params, bool fHelp);
 extern UniValue getmappingid(const UniValue& params, bool fHelp);
 extern UniValue getmappingname(const UniValue& params, bool fHelp);
+extern UniValue getoracletxcacheinfo(const UniValue& params, bool fHelp);
+extern UniValue listbetsbyevent(const UniValue& params, bool fHelp);
+extern UniValue listbetsbyaddress(const UniValue& params, bool fHelp);
+extern UniValue getliabilitysummary(const UniValue& params, bool fHelp);
 extern UniValue getbet(const UniValue& params, bool fHelp);
 
 extern UniValue getrawtransaction(const UniValue& params, bool fHelp); // in rpc/rawtransaction.cpp
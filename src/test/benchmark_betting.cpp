@@ -0,0 +1,491 @@
+// Copyright (c) 2018 The Wagerr developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "base58.h"
+#include "betting/bet.h"
+#include "betting/bettingdb.h"
+#include "main.h"
+#include "txmempool.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
+#include "test/betting_legacy.h"
+#include "test/test_wagerr.h"
+
+#include <boost/test/unit_test.hpp>
+#include <iostream>
+
+BOOST_FIXTURE_TEST_SUITE(benchmark_betting, TestingSetup)
+
+namespace
+{
+
+const int BENCHMARK_BETTING_ROUNDS = 20000;
+
+CScript OpReturnScript(const std::string& hexOpCode)
+{
+    return CScript() << OP_RETURN << ParseHex(hexOpCode);
+}
+
+/** The bet op code scripts of each transaction type, as built by the wallet and the oracles. */
+std::vector<CScript> BetOpCodeScripts()
+{
+    std::vector<CScript> vScripts;
+    std::string opCode;
+
+    CPeerlessEvent pe;
+    pe.nEventId = 1021;
+    pe.nStartTime = 1546300800;
+    pe.nSport = 1;
+    pe.nTournament = 3;
+    pe.nStage = 2;
+    pe.nHomeTeam = 17;
+    pe.nAwayTeam = 18;
+    pe.nHomeOdds = 15000;
+    pe.nAwayOdds = 32000;
+    pe.nDrawOdds = 41000;
+    BOOST_REQUIRE(CPeerlessEvent::ToOpCode(pe, opCode));
+    vScripts.push_back(OpReturnScript(opCode));
+
+    BOOST_REQUIRE(CPeerlessBet::ToOpCode(CPeerlessBet(1021, moneyLineWin), opCode));
+    vScripts.push_back(OpReturnScript(opCode));
+
+    BOOST_REQUIRE(CPeerlessResult::ToOpCode(CPeerlessResult(1021, standardResult, 3, 1), opCode));
+    vScripts.push_back(OpReturnScript(opCode));
+
+    CPeerlessUpdateOdds puo;
+    puo.nEventId = 1021;
+    puo.nHomeOdds = 16000;
+    puo.nAwayOdds = 30000;
+    puo.nDrawOdds = 40000;
+    BOOST_REQUIRE(CPeerlessUpdateOdds::ToOpCode(puo, opCode));
+    vScripts.push_back(OpReturnScript(opCode));
+
+    CPeerlessSpreadsEvent pse;
+    pse.nEventId = 1021;
+    pse.nPoints = 15;
+    pse.nHomeOdds = 19000;
+    pse.nAwayOdds = 21000;
+    BOOST_REQUIRE(CPeerlessSpreadsEvent::ToOpCode(pse, opCode));
+    vScripts.push_back(OpReturnScript(opCode));
+
+    CPeerlessTotalsEvent pte;
+    pte.nEventId = 1021;
+    pte.nPoints = 25;
+    pte.nOverOdds = 19500;
+    pte.nUnderOdds = 20500;
+    BOOST_REQUIRE(CPeerlessTotalsEvent::ToOpCode(pte, opCode));
+    vScripts.push_back(OpReturnScript(opCode));
+
+    CChainGamesEvent cge;
+    cge.nEventId = 42;
+    cge.nEntryFee = 10;
+    BOOST_REQUIRE(CChainGamesEvent::ToOpCode(cge, opCode));
+    vScripts.push_back(OpReturnScript(opCode));
+
+    BOOST_REQUIRE(CChainGamesBet::ToOpCode(CChainGamesBet(42), opCode));
+    vScripts.push_back(OpReturnScript(opCode));
+
+    BOOST_REQUIRE(CChainGamesResult::ToOpCode(CChainGamesResult(42), opCode));
+    vScripts.push_back(OpReturnScript(opCode));
+
+    // Team mapping "High Fives FC".
+    vScripts.push_back(OpReturnScript("420101" "03" "11000000" "4869676820466976657320464300"));
+
+    return vScripts;
+}
+
+/** The op code as it used to be decoded: by trying each transaction type in turn. */
+int LegacyDecodeBetOpCode(const CScript& script)
+{
+    std::string opCode;
+    if (!LegacyBetOpCode(script, opCode))
+        return -1;
+
+    CPeerlessEvent pe;
+    CPeerlessBet pb;
+    CPeerlessResult pr;
+    CPeerlessUpdateOdds puo;
+    CPeerlessSpreadsEvent pse;
+    CPeerlessTotalsEvent pte;
+    CChainGamesEvent cge;
+    CChainGamesBet cgb;
+    CChainGamesResult cgr;
+    CMapping cm;
+
+    if (CPeerlessEvent::FromOpCode(opCode, pe)) return 2;
+    if (CPeerlessBet::FromOpCode(opCode, pb)) return 3;
+    if (CPeerlessResult::FromOpCode(opCode, pr)) return 4;
+    if (CPeerlessUpdateOdds::FromOpCode(opCode, puo)) return 5;
+    if (CChainGamesEvent::FromOpCode(opCode, cge)) return 6;
+    if (CChainGamesBet::FromOpCode(opCode, cgb)) return 7;
+    if (CChainGamesResult::FromOpCode(opCode, cgr)) return 8;
+    if (CPeerlessSpreadsEvent::FromOpCode(opCode, pse)) return 9;
+    if (CPeerlessTotalsEvent::FromOpCode(opCode, pte)) return 10;
+    if (CMapping::FromOpCode(opCode, cm)) return 1;
+    return 0;
+}
+
+
+const int BENCHMARK_SETTLEMENT_ROUNDS = 10;
+
+/** The size of a synthetic betting chain: events, bets per block and results. */
+struct BettingChainShape
+{
+    uint32_t nEvents;
+    int nBetBlocks;
+    int nBetsPerBlock;
+    uint32_t nResults;
+};
+
+/** A chain with events and bets in the bet index, its tip holding the results to settle. */
+struct SyntheticBettingChain
+{
+    CTransaction txOracleFunding;
+    CTransaction txStakeFunding;
+    CBlock resultBlock;
+    std::vector<std::pair<CPeerlessBet, CAmount> > vBets;
+    size_t nIndexEntries;
+};
+
+const uint32_t BENCHMARK_CG_EVENT_ID = 42;
+
+CScript BettorScript(uint32_t nBettor)
+{
+    return GetScriptForDestination(CKeyID(Hash160(BEGIN(nBettor), END(nBettor))));
+}
+
+/** A bet index entry holding the given hex op code, stored as the bytes the index reads from the script. */
+std::pair<CBettingIndexKey, CBettingIndexEntry> IndexEntry(uint32_t nEventId, const CBlockIndex* pindex, uint32_t nTxIndex, const std::string& hexOpCode, CAmount nValue, const CScript& payoutScript)
+{
+    std::vector<unsigned char> vOpCode = ParseHex(hexOpCode);
+
+    CBettingIndexEntry entry;
+    entry.nTxType = vOpCode[2];
+    entry.fOracleTx = payoutScript.empty();
+    entry.nBlockTime = pindex->nTime;
+    entry.nValue = nValue;
+    entry.opCode = std::string(vOpCode.begin(), vOpCode.end());
+    entry.payoutScript = payoutScript;
+    return std::make_pair(CBettingIndexKey(nEventId, pindex->nHeight, nTxIndex, 0), entry);
+}
+
+CChainGamesPotEntry PotEntry(uint8_t nTxType, const CBlockIndex* pindex, CAmount nValue, const std::string& address)
+{
+    CChainGamesPotEntry entry;
+    entry.nTxType = nTxType;
+    entry.nHeight = pindex->nHeight;
+    entry.nBlockTime = pindex->nTime;
+    entry.nValue = nValue;
+    entry.address = address;
+    return entry;
+}
+
+/** Adds a transaction to the mempool so GetTransaction finds it as a prevout. */
+CTransaction FundingTx(uint32_t nSeed, const CScript& scriptPubKey)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(Hash(BEGIN(nSeed), END(nSeed)), 0);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 1000 * COIN;
+    tx.vout[0].scriptPubKey = scriptPubKey;
+    mempool.addUnchecked(tx.GetHash(), CTxMemPoolEntry(tx, 0, GetTime(), 0, 1));
+    return tx;
+}
+
+/** Extends the active chain by one block index, without a block on disk. */
+CBlockIndex* AppendBlockIndex(const uint256& hash, uint32_t nTime)
+{
+    CBlockIndex* pindex = new CBlockIndex();
+    BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(hash, pindex)).first;
+    pindex->phashBlock = &mi->first;
+    pindex->pprev = chainActive.Tip();
+    pindex->nHeight = chainActive.Height() + 1;
+    pindex->nTime = nTime;
+    chainActive.SetTip(pindex);
+    return pindex;
+}
+
+/**
+ * Builds the chain: padding blocks up to the settlement look back, blocks whose
+ * events and bets go straight into the bet index and a result block on disk.
+ */
+void GenerateBettingChain(const BettingChainShape& shape, SyntheticBettingChain& chain)
+{
+    LOCK(cs_main);
+
+    chain.txOracleFunding = FundingTx(1, GetScriptForDestination(CBitcoinAddress(Params().OracleWalletAddrs()[0]).Get()));
+    chain.txStakeFunding = FundingTx(2, BettorScript(0));
+    chain.vBets.clear();
+    chain.nIndexEntries = 0;
+
+    // Only the last BetBlocksIndexTimespan blocks are looked through, so the events and bets go at its start.
+    uint32_t nTime = chainActive.Tip()->nTime;
+    while (chainActive.Height() < Params().BetBlocksIndexTimespan()) {
+        int nHeight = chainActive.Height() + 1;
+        AppendBlockIndex(Hash(BEGIN(nHeight), END(nHeight)), nTime += 60);
+    }
+    BOOST_REQUIRE(bettingDB->WriteBestBlock(chainActive.Tip()->GetBlockHash()));
+
+    int64_t nStartTime = nTime + 60 * (shape.nBetBlocks + 10) + Params().BetPlaceTimeoutBlocks();
+    const OutcomeType outcomes[] = {moneyLineWin, moneyLineLose, moneyLineDraw, spreadHome, spreadAway, totalOver, totalUnder};
+    chainGamesPots_t mapPots;
+
+    for (int nBlock = 0; nBlock <= shape.nBetBlocks; nBlock++) {
+        int nHeight = chainActive.Height() + 1;
+        CBlockIndex* pindex = AppendBlockIndex(Hash(BEGIN(nHeight), END(nHeight)), nTime += 60);
+        bettingIndexEntries_t vEntries;
+        std::string opCode;
+
+        // The first block posts the events, each with its spreads and totals, and the Chain Games event.
+        if (nBlock == 0) {
+            for (uint32_t nEventId = 1; nEventId <= shape.nEvents; nEventId++) {
+                CPeerlessEvent pe;
+                pe.nEventId = nEventId;
+                pe.nStartTime = nStartTime;
+                pe.nSport = 1;
+                pe.nTournament = 3;
+                pe.nStage = 2;
+                pe.nHomeTeam = 17;
+                pe.nAwayTeam = 18;
+                pe.nHomeOdds = 15000 + nEventId % 5 * 1000;
+                pe.nAwayOdds = 32000;
+                pe.nDrawOdds = 41000;
+                BOOST_REQUIRE(CPeerlessEvent::ToOpCode(pe, opCode));
+                vEntries.push_back(IndexEntry(nEventId, pindex, 3 * nEventId, opCode, 0, CScript()));
+                CEventDB::AddEvent(pe);
+
+                CPeerlessSpreadsEvent pse;
+                pse.nEventId = nEventId;
+                pse.nPoints = nEventId % 4;
+                pse.nHomeOdds = 19000;
+                pse.nAwayOdds = 21000;
+                BOOST_REQUIRE(CPeerlessSpreadsEvent::ToOpCode(pse, opCode));
+                vEntries.push_back(IndexEntry(nEventId, pindex, 3 * nEventId + 1, opCode, 0, CScript()));
+
+                CPeerlessTotalsEvent pte;
+                pte.nEventId = nEventId;
+                pte.nPoints = nEventId % 7;
+                pte.nOverOdds = 18000;
+                pte.nUnderOdds = 23000;
+                BOOST_REQUIRE(CPeerlessTotalsEvent::ToOpCode(pte, opCode));
+                vEntries.push_back(IndexEntry(nEventId, pindex, 3 * nEventId + 2, opCode, 0, CScript()));
+            }
+            mapPots[BENCHMARK_CG_EVENT_ID].vEntries.push_back(PotEntry(cgEventTxType, pindex, 10 * COIN, ""));
+        }
+        // The other blocks each hold bets spread over the events and outcomes, and a Chain Games entry.
+        else {
+            for (int nBet = 0; nBet < shape.nBetsPerBlock; nBet++) {
+                uint32_t nBettor = nBlock * shape.nBetsPerBlock + nBet;
+                CPeerlessBet pb(nBettor % shape.nEvents + 1, outcomes[nBettor % 7]);
+                CAmount nValue = (25 + nBettor % 100) * COIN;
+                BOOST_REQUIRE(CPeerlessBet::ToOpCode(pb, opCode));
+                vEntries.push_back(IndexEntry(pb.nEventId, pindex, nBet + 2, opCode, nValue, BettorScript(nBettor)));
+                chain.vBets.push_back(std::make_pair(pb, nValue));
+            }
+            CBitcoinAddress address(CKeyID(Hash160(BEGIN(nBlock), END(nBlock))));
+            mapPots[BENCHMARK_CG_EVENT_ID].vEntries.push_back(PotEntry(cgBetTxType, pindex, 10 * COIN, address.ToString()));
+        }
+
+        BOOST_REQUIRE(bettingDB->WriteIndexEntries(vEntries, pindex->GetBlockHash(), mapPots));
+        chain.nIndexEntries += vEntries.size();
+    }
+
+    // The result block is proof of stake, so it is read back without a proof of work check.
+    CMutableTransaction txCoinBase;
+    txCoinBase.vin.resize(1);
+    txCoinBase.vin[0].prevout.SetNull();
+    txCoinBase.vout.resize(1);
+    txCoinBase.vout[0].SetEmpty();
+
+    CMutableTransaction txCoinStake;
+    txCoinStake.vin.resize(1);
+    txCoinStake.vin[0].prevout = COutPoint(chain.txStakeFunding.GetHash(), 0);
+    txCoinStake.vout.resize(2);
+    txCoinStake.vout[0].SetEmpty();
+    txCoinStake.vout[1] = chain.txStakeFunding.vout[0];
+
+    CMutableTransaction txResults;
+    txResults.vin.resize(1);
+    txResults.vin[0].prevout = COutPoint(chain.txOracleFunding.GetHash(), 0);
+    for (uint32_t nEventId = 1; nEventId <= shape.nResults; nEventId++) {
+        std::string opCode;
+        BOOST_REQUIRE(CPeerlessResult::ToOpCode(CPeerlessResult(nEventId, standardResult, nEventId % 4, nEventId % 3), opCode));
+        txResults.vout.push_back(CTxOut(0, OpReturnScript(opCode)));
+    }
+    std::string opCode;
+    BOOST_REQUIRE(CChainGamesResult::ToOpCode(CChainGamesResult(BENCHMARK_CG_EVENT_ID), opCode));
+    txResults.vout.push_back(CTxOut(0, OpReturnScript(opCode)));
+
+    CBlock& block = chain.resultBlock;
+    block.SetNull();
+    block.nVersion = 4;
+    block.hashPrevBlock = chainActive.Tip()->GetBlockHash();
+    block.nTime = nTime += 60;
+    block.vtx.push_back(txCoinBase);
+    block.vtx.push_back(txCoinStake);
+    block.vtx.push_back(txResults);
+    block.hashMerkleRoot = block.BuildMerkleTree();
+
+    CDiskBlockPos pos(1, 0);
+    BOOST_REQUIRE(WriteBlockToDisk(block, pos));
+    CBlockIndex* pindex = AppendBlockIndex(block.GetHash(), block.nTime);
+    pindex->nFile = pos.nFile;
+    pindex->nDataPos = pos.nPos;
+    pindex->nStatus |= BLOCK_HAVE_DATA;
+}
+
+/** Copy of the result block whose coin stake pays the stake back, then the payouts, then the masternode. */
+CBlock PayoutBlock(const SyntheticBettingChain& chain, const std::vector<CBetOut>& vPayouts)
+{
+    CBlock block = chain.resultBlock;
+    CMutableTransaction txCoinStake(block.vtx[1]);
+    for (const CBetOut& payout : vPayouts)
+        txCoinStake.vout.push_back(CTxOut(payout.nValue, payout.scriptPubKey));
+    txCoinStake.vout.push_back(CTxOut(COIN, BettorScript(0)));
+    block.vtx[1] = txCoinStake;
+    return block;
+}
+
+void PrintTiming(const std::string& strName, int64_t nTime, int nCalls, uint64_t nItems, const std::string& strItems)
+{
+    std::cout << strName << ": " << (double)nTime / nCalls << "us per call, "
+              << (nTime ? (double)nItems * 1000000 / nTime : 0) << " " << strItems << "/s" << std::endl;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(benchmark_bet_opcode_decode)
+{
+    std::vector<CScript> vScripts = BetOpCodeScripts();
+
+    // Both paths have to agree on every transaction type before their timings mean anything.
+    for (const CScript& script : vScripts) {
+        CBetOpCode betOpCode;
+        BOOST_CHECK(DecodeBetOpCode(script, betOpCode));
+        BOOST_CHECK_EQUAL(LegacyDecodeBetOpCode(script), betOpCode.which());
+    }
+
+    for (const CScript& script : vScripts) {
+        int nLegacyCount = 0, nDecodeCount = 0;
+
+        int64_t nStart = GetTimeMicros();
+        for (int i = 0; i < BENCHMARK_BETTING_ROUNDS; i++)
+            nLegacyCount += LegacyDecodeBetOpCode(script) > 0;
+        int64_t nLegacyTime = GetTimeMicros() - nStart;
+
+        nStart = GetTimeMicros();
+        for (int i = 0; i < BENCHMARK_BETTING_ROUNDS; i++) {
+            CBetOpCode betOpCode;
+            nDecodeCount += DecodeBetOpCode(script, betOpCode);
+        }
+        int64_t nDecodeTime = GetTimeMicros() - nStart;
+
+        BOOST_CHECK_EQUAL(nLegacyCount, nDecodeCount);
+
+        CBetOpCode betOpCode;
+        DecodeBetOpCode(script, betOpCode);
+        std::cout << "Bet op code type " << betOpCode.which() << ": string form "
+                  << (double)nLegacyTime * 1000 / BENCHMARK_BETTING_ROUNDS << "ns, decoder "
+                  << (double)nDecodeTime * 1000 / BENCHMARK_BETTING_ROUNDS << "ns per op code" << std::endl;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(benchmark_bet_settlement)
+{
+    BettingChainShape shape;
+    shape.nEvents = 200;
+    shape.nBetBlocks = 50;
+    shape.nBetsPerBlock = 100;
+    shape.nResults = 100;
+
+    SyntheticBettingChain chain;
+    GenerateBettingChain(shape, chain);
+
+    // Settlement reads the active chain, so hold cs_main as the block validation and the miner do.
+    LOCK(cs_main);
+    int nHeight = chainActive.Height();
+    std::cout << "Synthetic betting chain: " << shape.nEvents << " events, " << chain.vBets.size() << " bets in "
+              << shape.nBetBlocks << " blocks, " << shape.nResults << " results, " << chain.nIndexEntries << " index entries" << std::endl;
+
+    // Settle the results serially first, then on the settlement threads.
+    std::vector<CBetOut> vBetPayouts;
+    int nThreads = nScriptCheckThreads;
+    nScriptCheckThreads = 0;
+    int64_t nStart = GetTimeMicros();
+    for (int i = 0; i < BENCHMARK_SETTLEMENT_ROUNDS; i++)
+        BOOST_CHECK(GetBetPayouts(nHeight, vBetPayouts));
+    int64_t nSerialTime = GetTimeMicros() - nStart;
+    nScriptCheckThreads = nThreads;
+
+    std::vector<CBetOut> vParallelPayouts;
+    nStart = GetTimeMicros();
+    for (int i = 0; i < BENCHMARK_SETTLEMENT_ROUNDS; i++)
+        BOOST_CHECK(GetBetPayouts(nHeight, vParallelPayouts));
+    int64_t nParallelTime = GetTimeMicros() - nStart;
+
+    BOOST_CHECK(!vBetPayouts.empty());
+    BOOST_CHECK(vBetPayouts == vParallelPayouts);
+    PrintTiming("GetBetPayouts, serial", nSerialTime, BENCHMARK_SETTLEMENT_ROUNDS, (uint64_t)shape.nResults * BENCHMARK_SETTLEMENT_ROUNDS, "results");
+    PrintTiming("GetBetPayouts, " + std::to_string(nThreads) + " threads", nParallelTime, BENCHMARK_SETTLEMENT_ROUNDS, (uint64_t)shape.nResults * BENCHMARK_SETTLEMENT_ROUNDS, "results");
+
+    std::vector<CBetOut> vCGPayouts;
+    nStart = GetTimeMicros();
+    for (int i = 0; i < BENCHMARK_SETTLEMENT_ROUNDS; i++)
+        vCGPayouts = GetCGLottoBetPayouts(nHeight);
+    int64_t nCGTime = GetTimeMicros() - nStart;
+
+    BOOST_CHECK_EQUAL(vCGPayouts.size(), 2U);
+    PrintTiming("GetCGLottoBetPayouts", nCGTime, BENCHMARK_SETTLEMENT_ROUNDS, (uint64_t)shape.nBetBlocks * BENCHMARK_SETTLEMENT_ROUNDS, "entrants");
+
+    // After the first call the expected payouts of the tip are copied from the cache.
+    std::vector<CBetOut> vCachedPayouts, vCachedCGPayouts;
+    nStart = GetTimeMicros();
+    for (int i = 0; i < BENCHMARK_SETTLEMENT_ROUNDS; i++)
+        BOOST_CHECK(GetExpectedBetPayouts(chainActive.Tip(), vCachedPayouts, vCachedCGPayouts));
+    int64_t nCachedTime = GetTimeMicros() - nStart;
+
+    BOOST_CHECK(vCachedPayouts == vBetPayouts);
+    BOOST_CHECK(vCachedCGPayouts == vCGPayouts);
+    PrintTiming("GetExpectedBetPayouts", nCachedTime, BENCHMARK_SETTLEMENT_ROUNDS, (uint64_t)shape.nResults * BENCHMARK_SETTLEMENT_ROUNDS, "results");
+
+    std::vector<CBetOut> vExpectedPayouts(vBetPayouts);
+    vExpectedPayouts.insert(vExpectedPayouts.end(), vCGPayouts.begin(), vCGPayouts.end());
+    CBlock payoutBlock = PayoutBlock(chain, vExpectedPayouts);
+    bool fValid = true;
+    nStart = GetTimeMicros();
+    for (int i = 0; i < BENCHMARK_SETTLEMENT_ROUNDS; i++)
+        fValid &= IsBlockPayoutsValid(vExpectedPayouts, payoutBlock);
+    int64_t nValidTime = GetTimeMicros() - nStart;
+
+    BOOST_CHECK(fValid);
+    PrintTiming("IsBlockPayoutsValid", nValidTime, BENCHMARK_SETTLEMENT_ROUNDS, (uint64_t)vExpectedPayouts.size() * BENCHMARK_SETTLEMENT_ROUNDS, "payouts");
+
+    nStart = GetTimeMicros();
+    for (const std::pair<CPeerlessBet, CAmount>& bet : chain.vBets)
+        SetEventAccummulators(bet.first, bet.second);
+    int64_t nAccumulatorTime = GetTimeMicros() - nStart;
+
+    CPeerlessEvent pe;
+    BOOST_CHECK(CEventDB::GetEvent(1, pe));
+    BOOST_CHECK(pe.nMoneyLineHomeBets + pe.nMoneyLineAwayBets + pe.nMoneyLineDrawBets > 0);
+    PrintTiming("SetEventAccummulators", nAccumulatorTime, chain.vBets.size(), chain.vBets.size(), "bets");
+
+    CEventDB edb;
+    eventIndex_t eventIndex;
+    CEventDB::GetEvents(eventIndex);
+    bool fWritten = true;
+    nStart = GetTimeMicros();
+    for (int i = 0; i < BENCHMARK_SETTLEMENT_ROUNDS; i++)
+        fWritten &= edb.Write(eventIndex, chainActive.Tip()->GetBlockHash());
+    int64_t nWriteTime = GetTimeMicros() - nStart;
+
+    BOOST_CHECK(fWritten);
+    PrintTiming("CEventDB::Write", nWriteTime, BENCHMARK_SETTLEMENT_ROUNDS, (uint64_t)eventIndex.size() * BENCHMARK_SETTLEMENT_ROUNDS, "events");
+
+    CEventDB::SetEvents(eventIndex_t());
+    CLiabilityDB::SetLiabilities(liabilityIndex_t());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -369,6 +369,83 @@ Testb_MintAndSpend()
     return false;
 }
 
+bool
+Testb_FixedBaseTables()
+{
+    try {
+        if (ggCoins[0] == NULL)
+        {
+            // No coins: mint some.
+            Testb_MintCoin();
+            if (ggCoins[0] == NULL) {
+                return false;
+            }
+        }
+
+        // Raw exponentiations of a fixed generator, plain versus table.
+        const libzerocoin::IntegerGroupParams& qrn = gg_Params->accumulatorParams.accumulatorQRNCommitmentGroup;
+        const CBigNum& N = gg_Params->accumulatorParams.accumulatorModulus;
+        std::vector<CBigNum> vExponents;
+        for (uint32_t i = 0; i < TESTS_COINS_TO_ACCUMULATE; i++) {
+            CBigNum e = CBigNum::randBignum(N);
+            vExponents.push_back(i % 2 ? e : -e);
+        }
+
+        std::vector<CBigNum> vPlain, vTable;
+        timer.start();
+        for (uint32_t i = 0; i < vExponents.size(); i++) {
+            vPlain.push_back(qrn.g.pow_mod(vExponents[i], N));
+        }
+        timer.stop();
+        std::cout << "\tPOW_MOD ELAPSED TIME: " << timer.duration() << " ms\t" << timer.duration()*0.001 << " s" << std::endl;
+
+        timer.start();
+        for (uint32_t i = 0; i < vExponents.size(); i++) {
+            vTable.push_back(qrn.powG(vExponents[i], N));
+        }
+        timer.stop();
+        std::cout << "\tFIXED-BASE POW_MOD ELAPSED TIME: " << timer.duration() << " ms\t" << timer.duration()*0.001 << " s" << std::endl;
+
+        if (vPlain != vTable) {
+            return false;
+        }
+
+        libzerocoin::Accumulator acc(&gg_Params->accumulatorParams, libzerocoin::CoinDenomination::ZQ_ONE);
+        libzerocoin::AccumulatorWitness wAcc(gg_Params, acc, ggCoins[0]->getPublicCoin());
+        for (uint32_t i = 0; i < TESTS_COINS_TO_ACCUMULATE; i++) {
+            acc += ggCoins[i]->getPublicCoin();
+            wAcc += ggCoins[i]->getPublicCoin();
+        }
+
+        // Spend creation and verification without and with the tables.
+        bool ret = true;
+        for (int nPass = 0; nPass < 2; nPass++) {
+            if (nPass == 0)
+                gg_Params->ClearFixedBaseTables();
+            else
+                gg_Params->BuildFixedBaseTables();
+            std::string strLabel = nPass == 0 ? "WITHOUT TABLES" : "WITH TABLES";
+
+            timer.start();
+            libzerocoin::CoinSpend spend(gg_Params, gg_Params, *(ggCoins[0]), acc, 0, wAcc, 0, libzerocoin::SpendType::SPEND);
+            timer.stop();
+            std::cout << "\tSPEND " << strLabel << " ELAPSED TIME: " << timer.duration() << " ms\t" << timer.duration()*0.001 << " s" << std::endl;
+
+            timer.start();
+            ret &= spend.Verify(acc);
+            timer.stop();
+            std::cout << "\tSPEND VERIFY " << strLabel << " ELAPSED TIME: " << timer.duration() << " ms\t" << timer.duration()*0.001 << " s" << std::endl;
+        }
+
+        return ret;
+    } catch (std::runtime_error &e) {
+        std::cout << e.what() << std::endl;
+        return false;
+    }
+
+    return false;
+}
+
 void
 Testb_RunAllTests()
 {
@@ -388,6 +465,7 @@ Testb_RunAllTests()
     gLogTestResult("coins can be minted", Testb_MintCoin);
     gLogTestResult("the accumulator works", Testb_Accumulator);
     gLogTestResult("a minted coin can be spent", Testb_MintAndSpend);
+    gLogTestResult("fixed-base tables speed up spend verification", Testb_FixedBaseTables);
 
     // Summarize test results
     if (ggSuccessfulTests < ggNumTests) {
@@ -0,0 +1,27 @@
+// Copyright (c) 2018 The Wagerr developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef WAGERR_TEST_BETTING_LEGACY_H
+#define WAGERR_TEST_BETTING_LEGACY_H
+
+#include "script/script.h"
+#include "utilstrencodings.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+/** The op code as it used to be read: by hex parsing the string form of the script. */
+inline bool LegacyBetOpCode(const CScript& script, std::string& opCode)
+{
+    std::string scriptPubKey = script.ToString();
+    if (scriptPubKey.length() == 0 || strncmp(scriptPubKey.c_str(), "OP_RETURN", 9) != 0)
+        return false;
+
+    std::vector<unsigned char> vOpCode = ParseHex(scriptPubKey.substr(9, std::string::npos));
+    opCode = std::string(vOpCode.begin(), vOpCode.end());
+    return true;
+}
+
+#endif // WAGERR_TEST_BETTING_LEGACY_H
@@ -0,0 +1,690 @@
+// Copyright (c) 2018 The Wagerr developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "base58.h"
+#include "betting/bet.h"
+#include "betting/bettingdb.h"
+#include "checkqueue.h"
+#include "main.h"
+#include "utilstrencodings.h"
+#include "test/betting_legacy.h"
+#include "test/test_wagerr.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(betting_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(bet_opcode_matches_string_form)
+{
+    std::vector<CScript> vScripts;
+    vScripts.push_back(CScript() << OP_RETURN << ParseHex("42010312345678" "01"));
+    vScripts.push_back(CScript() << OP_RETURN << ParseHex("420104" "12345678" "01" "0300" "0100"));
+    vScripts.push_back(CScript() << OP_RETURN << ParseHex("420101" "03" "01000000" "4869676820466976657320464300"));
+    vScripts.push_back(CScript() << OP_RETURN << std::vector<unsigned char>(80, 0x42));
+    vScripts.push_back(CScript() << OP_RETURN << std::vector<unsigned char>(300, 0x07));
+    vScripts.push_back(CScript() << OP_RETURN << ParseHex("420107"));
+    vScripts.push_back(CScript() << OP_RETURN << ParseHex("42010603"));
+    vScripts.push_back(CScript() << OP_RETURN << ParseHex("42010312345678") << ParseHex("0142010312345678"));
+    vScripts.push_back(CScript() << OP_RETURN << OP_1 << ParseHex("42010312345678"));
+    vScripts.push_back(CScript() << OP_RETURN << ParseHex("42010312345678") << OP_DUP);
+    vScripts.push_back(CScript() << OP_RETURN);
+    vScripts.push_back(CScript() << OP_RETURN << OP_0);
+
+    // A truncated push.
+    CScript truncated = CScript() << OP_RETURN << ParseHex("42010312345678" "01");
+    truncated.resize(truncated.size() - 1);
+    vScripts.push_back(truncated);
+
+    // An 8 byte push written with OP_PUSHDATA1 where a direct push would do.
+    CScript pushData1;
+    pushData1.push_back(OP_RETURN);
+    pushData1.push_back(OP_PUSHDATA1);
+    pushData1.push_back(8);
+    std::vector<unsigned char> vBet = ParseHex("42010312345678" "02");
+    pushData1.insert(pushData1.end(), vBet.begin(), vBet.end());
+    vScripts.push_back(pushData1);
+
+    for (const CScript& script : vScripts) {
+        std::string opCode, legacyOpCode;
+        BOOST_CHECK(GetBetOpCode(script, opCode));
+        BOOST_CHECK(LegacyBetOpCode(script, legacyOpCode));
+        BOOST_CHECK_EQUAL(HexStr(opCode), HexStr(legacyOpCode));
+    }
+
+    std::string opCode;
+    BOOST_CHECK(!GetBetOpCode(CScript(), opCode));
+    BOOST_CHECK(!GetBetOpCode(CScript() << OP_DUP << OP_RETURN << ParseHex("42010312345678" "01"), opCode));
+}
+
+BOOST_AUTO_TEST_CASE(bet_multi_op_return_standard)
+{
+    LOCK(cs_main);
+
+    std::string opCode;
+    BOOST_REQUIRE(CPeerlessBet::ToOpCode(CPeerlessBet(1021, moneyLineWin), opCode));
+    CScript betScript = CScript() << OP_RETURN << ParseHex(opCode);
+    BOOST_REQUIRE(CPeerlessBet::ToOpCode(CPeerlessBet(1022, moneyLineDraw), opCode));
+    CScript otherBetScript = CScript() << OP_RETURN << ParseHex(opCode);
+
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(uint256(1), 0);
+    tx.vin[0].scriptSig << std::vector<unsigned char>(65, 0);
+    tx.vout.emplace_back(COIN, GetScriptForDestination(CKeyID(uint160(1))));
+    tx.vout.emplace_back(25 * COIN, betScript);
+
+    std::string reason;
+    BOOST_CHECK(IsStandardTx(tx, reason));
+
+    // Several peerless bets in one transaction, as placebets builds them.
+    tx.vout.emplace_back(50 * COIN, otherBetScript);
+    tx.vout.emplace_back(75 * COIN, betScript);
+    BOOST_CHECK(IsStandardTx(tx, reason));
+
+    // Any other data output still has to be the only one.
+    tx.vout.emplace_back(0, CScript() << OP_RETURN << ParseHex("0102"));
+    BOOST_CHECK(!IsStandardTx(tx, reason));
+    BOOST_CHECK_EQUAL(reason, "multi-op-return");
+
+    tx.vout.resize(2);
+    tx.vout.emplace_back(0, CScript() << OP_RETURN);
+    BOOST_CHECK(!IsStandardTx(tx, reason));
+
+    // Other betting op codes don't count as bets.
+    BOOST_REQUIRE(CChainGamesBet::ToOpCode(CChainGamesBet(42), opCode));
+    tx.vout[2].scriptPubKey = CScript() << OP_RETURN << ParseHex(opCode);
+    BOOST_CHECK(!IsStandardTx(tx, reason));
+
+    tx.vout.resize(1);
+    tx.vout.emplace_back(0, CScript() << OP_RETURN << ParseHex("0102"));
+    tx.vout.emplace_back(0, CScript() << OP_RETURN << ParseHex("0304"));
+    BOOST_CHECK(!IsStandardTx(tx, reason));
+}
+
+BOOST_AUTO_TEST_CASE(bet_opcode_decode)
+{
+    CBetOpCode betOpCode;
+
+    BOOST_CHECK(DecodeBetOpCode(CScript() << OP_RETURN << ParseHex("42010312345678" "02"), betOpCode));
+    const CPeerlessBet* pb = boost::get<CPeerlessBet>(&betOpCode);
+    BOOST_CHECK(pb != NULL);
+    BOOST_CHECK_EQUAL(pb->nEventId, 0x78563412U);
+    BOOST_CHECK_EQUAL(pb->nOutcome, moneyLineLose);
+
+    BOOST_CHECK(DecodeBetOpCode(CScript() << OP_RETURN << ParseHex("420104" "12345678" "01" "0300" "0100"), betOpCode));
+    const CPeerlessResult* pr = boost::get<CPeerlessResult>(&betOpCode);
+    BOOST_CHECK(pr != NULL);
+    BOOST_CHECK_EQUAL(pr->nHomeScore, 3U);
+    BOOST_CHECK_EQUAL(pr->nAwayScore, 1U);
+
+    // Wrong length, version and transaction type.
+    BOOST_CHECK(!DecodeBetOpCode(CScript() << OP_RETURN << ParseHex("42010312345678"), betOpCode));
+    BOOST_CHECK(boost::get<CNoBetOpCode>(&betOpCode) != NULL);
+    BOOST_CHECK(!DecodeBetOpCode(CScript() << OP_RETURN << ParseHex("42020312345678" "02"), betOpCode));
+    BOOST_CHECK(!DecodeBetOpCode(CScript() << OP_RETURN << ParseHex("42017f12345678" "02"), betOpCode));
+    BOOST_CHECK(!DecodeBetOpCode(CScript() << OP_DUP, betOpCode));
+}
+
+BOOST_AUTO_TEST_CASE(oracle_tx_cache)
+{
+    CMutableTransaction txPrev;
+    txPrev.vin.resize(1);
+    txPrev.vout.resize(2);
+    txPrev.vout[0].nValue = COIN;
+    txPrev.vout[0].scriptPubKey = GetScriptForDestination(CBitcoinAddress(Params().OracleWalletAddrs()[0]).Get());
+    txPrev.vout[1].nValue = COIN;
+    txPrev.vout[1].scriptPubKey = CScript() << OP_TRUE;
+    CTransaction tx(txPrev);
+    mempool.addUnchecked(tx.GetHash(), CTxMemPoolEntry(tx, 0, 0, 0.0, 1));
+
+    size_t nSize;
+    uint64_t nHits, nMisses, nPrevHits, nPrevMisses;
+    GetOracleTxCacheStats(nSize, nPrevHits, nPrevMisses);
+
+    // The first lookup of each prevout reads the transaction, later ones are answered by the cache.
+    CTxIn txinOracle(COutPoint(tx.GetHash(), 0)), txinOther(COutPoint(tx.GetHash(), 1));
+    BOOST_CHECK(IsValidOracleTx(txinOracle));
+    BOOST_CHECK(!IsValidOracleTx(txinOther));
+    BOOST_CHECK(IsValidOracleTx(txinOracle));
+    BOOST_CHECK(!IsValidOracleTx(txinOther));
+    GetOracleTxCacheStats(nSize, nHits, nMisses);
+    BOOST_CHECK_EQUAL(nHits - nPrevHits, 2U);
+    BOOST_CHECK_EQUAL(nMisses - nPrevMisses, 2U);
+
+    // Unknown transactions aren't cached, they may still show up.
+    CTxIn txinUnknown(COutPoint(uint256(1), 0));
+    BOOST_CHECK(!IsValidOracleTx(txinUnknown));
+    BOOST_CHECK(!IsValidOracleTx(txinUnknown));
+    GetOracleTxCacheStats(nSize, nPrevHits, nPrevMisses);
+    BOOST_CHECK_EQUAL(nPrevHits, nHits);
+    BOOST_CHECK_EQUAL(nPrevMisses - nMisses, 2U);
+
+    UncacheOracleTx(tx);
+    BOOST_CHECK(IsValidOracleTx(txinOracle));
+    GetOracleTxCacheStats(nSize, nHits, nMisses);
+    BOOST_CHECK_EQUAL(nMisses - nPrevMisses, 1U);
+
+    std::list<CTransaction> removed;
+    mempool.remove(tx, removed);
+    UncacheOracleTx(tx);
+}
+
+BOOST_AUTO_TEST_CASE(event_index_snapshot)
+{
+    CPeerlessEvent pe;
+    pe.nEventId = 11;
+    pe.nHomeOdds = 15000;
+    pe.nMoneyLineHomePotentialLiability = 0;
+    pe.nMoneyLineHomeBets = 0;
+    CEventDB::SetEvent(pe);
+
+    // Readers share one copy until the index changes.
+    eventIndexSnapshot_t pSnapshot = CEventDB::GetEventsSnapshot();
+    BOOST_CHECK(pSnapshot == CEventDB::GetEventsSnapshot());
+    BOOST_CHECK_EQUAL(pSnapshot->count(11), 1U);
+
+    CPeerlessUpdateOdds puo;
+    puo.nEventId = 11;
+    puo.nHomeOdds = 17000;
+    puo.nAwayOdds = 20000;
+    puo.nDrawOdds = 30000;
+    SetEventMLOdds(puo);
+    SetEventAccummulators(CPeerlessBet(11, moneyLineWin), 10 * COIN);
+    BOOST_CHECK(!CEventDB::UpdateEvent(12, [](CPeerlessEvent &plEvent) { plEvent.nHomeOdds = 0; }));
+
+    // The events are updated in place, while the copy held by a reader stays as it was.
+    BOOST_CHECK(CEventDB::GetEvent(11, pe));
+    BOOST_CHECK_EQUAL(pe.nHomeOdds, 17000U);
+    BOOST_CHECK_EQUAL(pe.nMoneyLineHomeBets, 1U);
+    BOOST_CHECK_EQUAL(pSnapshot->find(11)->second.nHomeOdds, 15000U);
+    BOOST_CHECK(pSnapshot != CEventDB::GetEventsSnapshot());
+    BOOST_CHECK_EQUAL(CEventDB::GetEventsSnapshot()->find(11)->second.nHomeOdds, 17000U);
+
+    CEventDB::EraseEvent(11);
+    BOOST_CHECK_EQUAL(CEventDB::GetEventsSnapshot()->count(11), 0U);
+    CLiabilityDB::SetLiability(11, CEventLiability());
+}
+
+BOOST_AUTO_TEST_CASE(liability_book)
+{
+    // The book is process wide, so start from an empty one.
+    CLiabilityDB::SetLiabilities(liabilityIndex_t());
+
+    CPeerlessEvent pe;
+    pe.nEventId = 21;
+    pe.nHomeOdds = 20000;
+    pe.nAwayOdds = 30000;
+    pe.nSpreadHomeOdds = 19000;
+    CEventDB::SetEvent(pe);
+    pe.nEventId = 22;
+    CEventDB::SetEvent(pe);
+
+    // A 10 WGR bet at odds of 2 pays out 20 WGR less the fee on the 10 WGR profit, to the satoshi.
+    SetEventAccummulators(CPeerlessBet(21, moneyLineWin), 10 * COIN);
+    CEventLiability liability;
+    BOOST_CHECK(CLiabilityDB::GetLiability(21, liability));
+    BOOST_CHECK_EQUAL(liability.vLiability[liabilityMoneyLineHome], 1970000000);
+    BOOST_CHECK_EQUAL(liability.vBets[liabilityMoneyLineHome], 1U);
+    BOOST_CHECK(!CLiabilityDB::GetLiability(22, liability));
+
+    // Spreads bets are also refunded on a push.
+    SetEventAccummulators(CPeerlessBet(21, spreadHome), 1 * COIN);
+    SetEventAccummulators(CPeerlessBet(21, moneyLineLose), 1 * COIN);
+    SetEventAccummulators(CPeerlessBet(22, moneyLineLose), 20 * COIN);
+    BOOST_CHECK(CLiabilityDB::GetLiability(21, liability));
+    BOOST_CHECK_EQUAL(liability.vLiability[liabilitySpreadPush], 1 * COIN);
+    CAmount nExposure21 = CAmount(1970000000) + 187300000;
+    BOOST_CHECK_EQUAL(liability.GetExposure(), nExposure21);
+
+    size_t nEvents;
+    BOOST_CHECK_EQUAL(CLiabilityDB::GetTotalExposure(nEvents), nExposure21 + 5880000000);
+    BOOST_CHECK_EQUAL(nEvents, 2U);
+
+    // The largest exposure comes first, and the threshold cuts off the rest.
+    std::vector<std::pair<uint32_t, CEventLiability> > vTop;
+    BOOST_CHECK_EQUAL(CLiabilityDB::GetTopExposures(10, 0, nEvents, vTop), nExposure21 + 5880000000);
+    BOOST_CHECK_EQUAL(nEvents, 2U);
+    BOOST_CHECK_EQUAL(vTop.size(), 2U);
+    BOOST_CHECK_EQUAL(vTop[0].first, 22U);
+    BOOST_CHECK_EQUAL(vTop[1].first, 21U);
+    vTop.clear();
+    CLiabilityDB::GetTopExposures(10, 30 * COIN, nEvents, vTop);
+    BOOST_CHECK_EQUAL(vTop.size(), 1U);
+
+    // Disconnecting the block restores the liability saved before it.
+    CBettingUndo undo;
+    undo.SaveEvent(21);
+    SetEventAccummulators(CPeerlessBet(21, moneyLineWin), 100 * COIN);
+    BOOST_CHECK(CLiabilityDB::GetLiability(21, liability));
+    BOOST_CHECK_EQUAL(liability.vBets[liabilityMoneyLineHome], 2U);
+    BOOST_CHECK_EQUAL(undo.vPrevLiabilities.size(), 1U);
+    CLiabilityDB::SetLiability(21, undo.vPrevLiabilities[0].second);
+    BOOST_CHECK_EQUAL(CLiabilityDB::GetTotalExposure(nEvents), nExposure21 + 5880000000);
+
+    CEventDB::EraseEvent(21);
+    CEventDB::EraseEvent(22);
+    CLiabilityDB::SetLiability(21, CEventLiability());
+    CLiabilityDB::SetLiability(22, CEventLiability());
+    BOOST_CHECK_EQUAL(CLiabilityDB::GetTotalExposure(nEvents), 0);
+    BOOST_CHECK_EQUAL(nEvents, 0U);
+}
+
+static std::pair<CBettingIndexKey, CBettingIndexEntry> IndexEntry(uint32_t nEventId, uint32_t nHeight, uint32_t nTxIndex, uint32_t nOutIndex)
+{
+    CBettingIndexEntry entry;
+    entry.nTxType = plBetTxType;
+    entry.nBlockTime = nHeight * 60;
+    entry.nValue = (nHeight + nTxIndex + nOutIndex) * COIN;
+    return std::make_pair(CBettingIndexKey(nEventId, nHeight, nTxIndex, nOutIndex), entry);
+}
+
+BOOST_AUTO_TEST_CASE(bettingdb_event_entries)
+{
+    uint256 hashBest;
+    BOOST_CHECK(bettingDB->ReadBestBlock(hashBest));
+    BOOST_CHECK(hashBest == 0);
+
+    // Written out of order, across event ids that share bytes with each other.
+    bettingIndexEntries_t vBlock;
+    vBlock.push_back(IndexEntry(0x100, 300, 1, 0));
+    vBlock.push_back(IndexEntry(0x1, 256, 0, 1));
+    vBlock.push_back(IndexEntry(0x100, 256, 2, 1));
+    vBlock.push_back(IndexEntry(0x100, 256, 0, 3));
+    vBlock.push_back(IndexEntry(0x100, 1, 7, 0));
+    vBlock.push_back(IndexEntry(0x101, 256, 0, 0));
+    BOOST_CHECK(bettingDB->WriteIndexEntries(vBlock, uint256(1)));
+
+    BOOST_CHECK(bettingDB->ReadBestBlock(hashBest));
+    BOOST_CHECK(hashBest == uint256(1));
+
+    // Entries come back in chain order and bounded by height.
+    bettingIndexEntries_t vEntries;
+    BOOST_CHECK(bettingDB->ReadEventEntries(0x100, 2, 300, vEntries));
+    BOOST_CHECK_EQUAL(vEntries.size(), 3U);
+    BOOST_CHECK_EQUAL(vEntries[0].first.nHeight, 256U);
+    BOOST_CHECK_EQUAL(vEntries[0].first.nTxIndex, 0U);
+    BOOST_CHECK_EQUAL(vEntries[1].first.nTxIndex, 2U);
+    BOOST_CHECK_EQUAL(vEntries[2].first.nHeight, 300U);
+    BOOST_CHECK_EQUAL(vEntries[2].second.nValue, 301 * COIN);
+    BOOST_CHECK_EQUAL(vEntries[2].second.nBlockTime, 300U * 60);
+
+    vEntries.clear();
+    BOOST_CHECK(bettingDB->ReadEventEntries(0x100, 257, 299, vEntries));
+    BOOST_CHECK(vEntries.empty());
+
+    vEntries.clear();
+    BOOST_CHECK(bettingDB->ReadEventEntries(0x1, 0, 1000, vEntries));
+    BOOST_CHECK_EQUAL(vEntries.size(), 1U);
+
+    // Erasing the block leaves nothing behind and moves the best block back.
+    BOOST_CHECK(bettingDB->EraseIndexEntries(vBlock, uint256(0)));
+    BOOST_CHECK(bettingDB->ReadBestBlock(hashBest));
+    BOOST_CHECK(hashBest == 0);
+
+    vEntries.clear();
+    BOOST_CHECK(bettingDB->ReadEventEntries(0x100, 0, 1000, vEntries));
+    BOOST_CHECK(vEntries.empty());
+
+    BOOST_CHECK(bettingDB->WriteIndexEntries(vBlock, uint256(1)));
+    BOOST_CHECK(bettingDB->WipeIndex());
+    vEntries.clear();
+    BOOST_CHECK(bettingDB->ReadEventEntries(0x101, 0, 1000, vEntries));
+    BOOST_CHECK(vEntries.empty());
+}
+
+static CChainGamesPotEntry PotEntry(uint8_t nTxType, uint32_t nHeight, CAmount nValue, const std::string& address)
+{
+    CChainGamesPotEntry entry;
+    entry.nTxType = nTxType;
+    entry.nHeight = nHeight;
+    entry.nBlockTime = nHeight * 60;
+    entry.nValue = nValue;
+    entry.address = address;
+    return entry;
+}
+
+BOOST_AUTO_TEST_CASE(chain_games_pot)
+{
+    CChainGamesPot pot;
+    pot.vEntries.push_back(PotEntry(cgBetTxType, 99, 10 * COIN, "early"));
+    pot.vEntries.push_back(PotEntry(cgEventTxType, 100, 10 * COIN, ""));
+    pot.vEntries.push_back(PotEntry(cgBetTxType, 101, 10 * COIN, "a"));
+    pot.vEntries.push_back(PotEntry(cgBetTxType, 101, 5 * COIN, "wrong fee"));
+    pot.vEntries.push_back(PotEntry(cgBetTxType, 102, 10 * COIN, "b"));
+    pot.vEntries.push_back(PotEntry(cgEventTxType, 103, 20 * COIN, ""));
+    pot.vEntries.push_back(PotEntry(cgBetTxType, 104, 20 * COIN, "c"));
+
+    // Entries only count after the event was posted, and must pay the fee posted last.
+    CAmount nEntryFee;
+    std::vector<std::string> vEntrants;
+    pot.GetEntrants(0, nEntryFee, vEntrants);
+    BOOST_CHECK_EQUAL(nEntryFee, 20 * COIN);
+    BOOST_CHECK_EQUAL(vEntrants.size(), 3U);
+    BOOST_CHECK_EQUAL(vEntrants[2], "c");
+
+    // Nothing counts until an event posting inside the window.
+    vEntrants.clear();
+    pot.GetEntrants(101, nEntryFee, vEntrants);
+    BOOST_CHECK_EQUAL(vEntrants.size(), 1U);
+
+    // The pots are stored with the index entries and reverted a block at a time.
+    chainGamesPots_t mapPots;
+    mapPots[7] = pot;
+    BOOST_CHECK(bettingDB->WriteIndexEntries(bettingIndexEntries_t(), uint256(1), mapPots));
+
+    CChainGamesPot potRead;
+    BOOST_CHECK(bettingDB->ReadChainGamesPot(7, potRead));
+    BOOST_CHECK_EQUAL(potRead.vEntries.size(), pot.vEntries.size());
+    BOOST_CHECK_EQUAL(potRead.vEntries[4].address, "b");
+
+    potRead.RemoveBlock(103);
+    BOOST_CHECK_EQUAL(potRead.vEntries.size(), 5U);
+    potRead.RemoveBlock(0);
+    mapPots[7] = potRead;
+    BOOST_CHECK(bettingDB->EraseIndexEntries(bettingIndexEntries_t(), uint256(0), mapPots));
+    BOOST_CHECK(!bettingDB->ReadChainGamesPot(7, potRead));
+
+    mapPots.clear();
+    mapPots[8] = pot;
+    BOOST_CHECK(bettingDB->WriteIndexEntries(bettingIndexEntries_t(), uint256(1), mapPots));
+    BOOST_CHECK(bettingDB->WipeIndex());
+    BOOST_CHECK(!bettingDB->ReadChainGamesPot(8, potRead));
+}
+
+BOOST_AUTO_TEST_CASE(bettingdb_undo)
+{
+    CPeerlessEvent pe;
+    pe.nEventId = 7;
+    pe.nHomeOdds = 15000;
+    CEventDB::SetEvent(pe);
+
+    // Only the state before the first change of each event is kept.
+    CBettingUndo undo;
+    BOOST_CHECK(undo.IsEmpty());
+    undo.SaveEvent(7);
+    pe.nHomeOdds = 21000;
+    CEventDB::SetEvent(pe);
+    undo.SaveEvent(7);
+    undo.SaveEvent(8);
+    undo.SaveResult(7);
+    undo.vNewMappings.emplace_back(teamMapping, 3);
+
+    BOOST_CHECK(bettingDB->WriteBettingUndo(uint256(2), undo));
+
+    CBettingUndo undoRead;
+    BOOST_CHECK(!bettingDB->ReadBettingUndo(uint256(3), undoRead));
+    BOOST_CHECK(bettingDB->ReadBettingUndo(uint256(2), undoRead));
+    BOOST_CHECK_EQUAL(undoRead.vPrevEvents.size(), 1U);
+    BOOST_CHECK_EQUAL(undoRead.vPrevEvents[0].nHomeOdds, 15000U);
+    BOOST_CHECK_EQUAL(undoRead.vNewEvents.size(), 1U);
+    BOOST_CHECK_EQUAL(undoRead.vNewEvents[0], 8U);
+    BOOST_CHECK(undoRead.vPrevResults.empty());
+    BOOST_CHECK_EQUAL(undoRead.vNewResults.size(), 1U);
+    BOOST_CHECK(undoRead.vNewMappings == undo.vNewMappings);
+
+    BOOST_CHECK(bettingDB->EraseBettingUndo(uint256(2)));
+    BOOST_CHECK(!bettingDB->ReadBettingUndo(uint256(2), undoRead));
+
+    CEventDB::EraseEvent(7);
+    BOOST_CHECK(!CEventDB::GetEvent(7, pe));
+}
+
+BOOST_AUTO_TEST_CASE(bettingdb_state)
+{
+    uint256 hashState;
+    BOOST_CHECK(!bettingDB->ReadStateBlock(hashState));
+
+    CPeerlessEvent pe;
+    pe.nEventId = 21;
+    pe.nHomeOdds = 15000;
+    CPeerlessResult pr(22, standardResult, 1, 0);
+    CMapping cm;
+    cm.nMType = teamMapping;
+    cm.nId = 5;
+    cm.sName = "High Fives FC";
+
+    eventIndex_t eventIndex;
+    eventIndex[pe.nEventId] = pe;
+    resultsIndex_t resultsIndex;
+    resultsIndex[pr.nEventId] = pr;
+    BOOST_CHECK(bettingDB->WriteBettingState(eventIndex, resultsIndex, std::vector<CMapping>(1, cm), uint256(1)));
+    BOOST_CHECK(LoadBettingState(false));
+    BOOST_CHECK(bettingDB->ReadStateBlock(hashState));
+    BOOST_CHECK(hashState == uint256(1));
+
+    // A block changes one event and adds another, only those are written.
+    CBettingUndo undo;
+    undo.SaveEvent(21);
+    undo.SaveEvent(23);
+    pe.nHomeOdds = 17000;
+    CEventDB::SetEvent(pe);
+    pe.nEventId = 23;
+    CEventDB::SetEvent(pe);
+    BOOST_CHECK(bettingDB->ConnectBettingState(undo, uint256(2)));
+
+    eventIndex.clear();
+    resultsIndex.clear();
+    std::vector<CMapping> vMappings;
+    BOOST_CHECK(bettingDB->ReadBettingState(eventIndex, resultsIndex, vMappings));
+    BOOST_CHECK_EQUAL(eventIndex.size(), 2U);
+    BOOST_CHECK_EQUAL(eventIndex[21].nHomeOdds, 17000U);
+    BOOST_CHECK_EQUAL(resultsIndex.size(), 1U);
+    BOOST_CHECK_EQUAL(vMappings.size(), 1U);
+    BOOST_CHECK_EQUAL(vMappings[0].sName, cm.sName);
+
+    CBettingUndo undoRead;
+    BOOST_CHECK(bettingDB->ReadBettingUndo(uint256(2), undoRead));
+
+    // Disconnecting it stores the reverted events and drops the undo record.
+    for (const CPeerlessEvent& pePrev : undoRead.vPrevEvents)
+        CEventDB::SetEvent(pePrev);
+    for (uint32_t nEventId : undoRead.vNewEvents)
+        CEventDB::EraseEvent(nEventId);
+    BOOST_CHECK(bettingDB->DisconnectBettingState(undoRead, uint256(2), uint256(1)));
+    BOOST_CHECK(!bettingDB->ReadBettingUndo(uint256(2), undoRead));
+
+    BOOST_CHECK(LoadBettingState(false));
+    BOOST_CHECK(CEventDB::GetEvent(21, pe));
+    BOOST_CHECK_EQUAL(pe.nHomeOdds, 15000U);
+    BOOST_CHECK(!CEventDB::GetEvent(23, pe));
+    BOOST_CHECK(CResultDB::GetResult(22, pr));
+    BOOST_CHECK(CMappingDB::GetMapping(teamMapping, 5, cm));
+
+    BOOST_CHECK(bettingDB->WriteBettingState(eventIndex_t(), resultsIndex_t(), std::vector<CMapping>(), uint256(0)));
+    BOOST_CHECK(LoadBettingState(false));
+    BOOST_CHECK(!CEventDB::GetEvent(21, pe));
+    BOOST_CHECK(!CMappingDB::GetMapping(teamMapping, 5, cm));
+}
+
+BOOST_AUTO_TEST_CASE(bettingdb_state_sync)
+{
+    LOCK(cs_main);
+    BOOST_REQUIRE(chainActive.Tip());
+    uint256 hashTip = chainActive.Tip()->GetBlockHash();
+
+    CPeerlessEvent pe;
+    pe.nEventId = 31;
+    eventIndex_t eventIndex;
+    eventIndex[pe.nEventId] = pe;
+
+    // A state at the tip is kept as it is.
+    BOOST_CHECK(bettingDB->WriteBettingState(eventIndex, resultsIndex_t(), std::vector<CMapping>(), hashTip));
+    BOOST_CHECK(LoadBettingState(false));
+    BOOST_CHECK(SyncBettingState());
+    BOOST_CHECK(CEventDB::GetEvent(31, pe));
+
+    // A state written for a block that isn't known is rebuilt from the chain.
+    BOOST_CHECK(bettingDB->WriteBettingState(eventIndex, resultsIndex_t(), std::vector<CMapping>(), uint256(7)));
+    BOOST_CHECK(LoadBettingState(false));
+    BOOST_CHECK(SyncBettingState());
+    BOOST_CHECK(!CEventDB::GetEvent(31, pe));
+
+    uint256 hashState;
+    BOOST_CHECK(bettingDB->ReadStateBlock(hashState));
+    BOOST_CHECK(hashState == hashTip);
+}
+
+/** A bet index entry holding the given hex op code. */
+static std::pair<CBettingIndexKey, CBettingIndexEntry> SettlementEntry(uint32_t nEventId, uint32_t nHeight, uint32_t nTxIndex, const std::string& hexOpCode, CAmount nValue, bool fOracleTx)
+{
+    std::vector<unsigned char> vOpCode = ParseHex(hexOpCode);
+
+    CBettingIndexEntry entry;
+    entry.nTxType = vOpCode[2];
+    entry.fOracleTx = fOracleTx;
+    entry.nBlockTime = nHeight * 60;
+    entry.nValue = nValue;
+    entry.opCode = std::string(vOpCode.begin(), vOpCode.end());
+    if (!fOracleTx)
+        entry.payoutScript = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, (unsigned char)(nEventId + nTxIndex)) << OP_EQUALVERIFY << OP_CHECKSIG;
+    return std::make_pair(CBettingIndexKey(nEventId, nHeight, nTxIndex, 0), entry);
+}
+
+BOOST_AUTO_TEST_CASE(settlement_parallel_matches_serial)
+{
+    const CAmount nMinBet = Params().MinBetPayoutRange() * COIN;
+    std::vector<CPeerlessResult> vResults;
+    std::vector<bettingIndexEntries_t> vResultEntries;
+
+    // Synthetic blocks: each event gets its odds, spreads and totals, an odds update and bets on every outcome.
+    for (uint32_t nEventId = 1; nEventId <= 200; nEventId++) {
+        bettingIndexEntries_t vEntries;
+        std::string opCode;
+
+        CPeerlessEvent pe;
+        pe.nEventId = nEventId;
+        pe.nStartTime = 2000000000;
+        pe.nSport = pe.nTournament = pe.nStage = 1;
+        pe.nHomeTeam = 2;
+        pe.nAwayTeam = 3;
+        pe.nHomeOdds = 15000 + nEventId * 10;
+        pe.nAwayOdds = 22000 - nEventId * 10;
+        pe.nDrawOdds = 30000;
+        BOOST_CHECK(CPeerlessEvent::ToOpCode(pe, opCode));
+        vEntries.push_back(SettlementEntry(nEventId, 100, 1, opCode, 0, true));
+
+        CPeerlessSpreadsEvent pse;
+        pse.nEventId = nEventId;
+        pse.nPoints = nEventId % 4;
+        pse.nHomeOdds = 19000;
+        pse.nAwayOdds = 21000;
+        BOOST_CHECK(CPeerlessSpreadsEvent::ToOpCode(pse, opCode));
+        vEntries.push_back(SettlementEntry(nEventId, 100, 2, opCode, 0, true));
+
+        CPeerlessTotalsEvent pte;
+        pte.nEventId = nEventId;
+        pte.nPoints = nEventId % 7;
+        pte.nOverOdds = 18000;
+        pte.nUnderOdds = 23000;
+        BOOST_CHECK(CPeerlessTotalsEvent::ToOpCode(pte, opCode));
+        vEntries.push_back(SettlementEntry(nEventId, 100, 3, opCode, 0, true));
+
+        for (uint32_t nHeight = 101; nHeight < 110; nHeight++) {
+            if (nHeight == 105) {
+                CPeerlessUpdateOdds puo;
+                puo.nEventId = nEventId;
+                puo.nHomeOdds = 16000;
+                puo.nAwayOdds = 20000;
+                puo.nDrawOdds = 31000;
+                BOOST_CHECK(CPeerlessUpdateOdds::ToOpCode(puo, opCode));
+                vEntries.push_back(SettlementEntry(nEventId, nHeight, 0, opCode, 0, true));
+            }
+            for (uint32_t nOutcome = moneyLineWin; nOutcome <= totalUnder; nOutcome++) {
+                BOOST_CHECK(CPeerlessBet::ToOpCode(CPeerlessBet(nEventId, (OutcomeType) nOutcome), opCode));
+                vEntries.push_back(SettlementEntry(nEventId, nHeight, nOutcome, opCode, nMinBet + nHeight * nOutcome * COIN, false));
+            }
+        }
+
+        // One event has already been settled in the look back window, which ends the settlement of the block.
+        if (nEventId == 150) {
+            BOOST_CHECK(CPeerlessResult::ToOpCode(CPeerlessResult(nEventId, standardResult, 0, 0), opCode));
+            vEntries.push_back(SettlementEntry(nEventId, 107, 0, opCode, 0, true));
+        }
+
+        vResults.push_back(CPeerlessResult(nEventId, standardResult + nEventId % 3, nEventId % 5, nEventId % 4));
+        vResultEntries.push_back(vEntries);
+    }
+
+    std::vector<CBetOut> vSerial = SettlePeerlessResults(vResults, vResultEntries, NULL);
+    BOOST_CHECK(!vSerial.empty());
+
+    CCheckQueue<CPeerlessSettlementCheck> queue(16);
+    boost::thread_group threadGroup;
+    for (int i = 0; i < 3; i++)
+        threadGroup.create_thread(boost::bind(&CCheckQueue<CPeerlessSettlementCheck>::Thread, &queue));
+
+    for (int nRun = 0; nRun < 10; nRun++) {
+        std::vector<CBetOut> vParallel = SettlePeerlessResults(vResults, vResultEntries, &queue);
+        BOOST_CHECK_EQUAL(vParallel.size(), vSerial.size());
+        for (unsigned int i = 0; i < vSerial.size() && i < vParallel.size(); i++) {
+            BOOST_CHECK(vParallel[i] == vSerial[i]);
+            BOOST_CHECK_EQUAL(vParallel[i].nBetValue, vSerial[i].nBetValue);
+        }
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    // The results after the settled event add nothing.
+    std::vector<CPeerlessResult> vTruncated(vResults.begin(), vResults.begin() + 150);
+    std::vector<bettingIndexEntries_t> vTruncatedEntries(vResultEntries.begin(), vResultEntries.begin() + 150);
+    BOOST_CHECK_EQUAL(SettlePeerlessResults(vTruncated, vTruncatedEntries, NULL).size(), vSerial.size());
+}
+
+BOOST_AUTO_TEST_CASE(bet_address_index)
+{
+    fBetIndex = true;
+
+    // Bets on two events from the same payout script, and a bet paid out elsewhere.
+    bettingIndexEntries_t vEntries;
+    std::string opCode;
+    for (uint32_t nHeight = 100; nHeight < 105; nHeight++) {
+        BOOST_CHECK(CPeerlessBet::ToOpCode(CPeerlessBet(1, nHeight % 2 ? moneyLineWin : moneyLineLose), opCode));
+        vEntries.push_back(SettlementEntry(1, nHeight, 1, opCode, 50 * COIN, false));
+        BOOST_CHECK(CPeerlessBet::ToOpCode(CPeerlessBet(0, moneyLineDraw), opCode));
+        vEntries.push_back(SettlementEntry(0, nHeight, 2, opCode, 50 * COIN, false));
+    }
+    vEntries.push_back(SettlementEntry(2, 104, 3, opCode, 50 * COIN, false));
+    BOOST_CHECK(bettingDB->WriteIndexEntries(vEntries, uint256(1)));
+    const CScript& payoutScript = vEntries[0].second.payoutScript;
+
+    // Pages follow each other in chain order, across events.
+    bettingIndexEntries_t vPage;
+    CBettingIndexKey posNext;
+    BOOST_CHECK(bettingDB->ReadAddressBets(payoutScript, CBettingIndexKey(), 1000, 0, 3, vPage, posNext));
+    BOOST_CHECK_EQUAL(vPage.size(), 3U);
+    BOOST_CHECK_EQUAL(vPage[1].first.nEventId, 0U);
+    BOOST_CHECK(posNext.nHeight == 101U && posNext.nTxIndex == 2U);
+
+    bettingIndexEntries_t vNextPage;
+    BOOST_CHECK(bettingDB->ReadAddressBets(payoutScript, posNext, 1000, 0, 100, vNextPage, posNext));
+    BOOST_CHECK_EQUAL(vNextPage.size(), 7U);
+    BOOST_CHECK(vNextPage[0].first.nHeight == 101U && vNextPage[0].first.nTxIndex == 2U);
+    BOOST_CHECK_EQUAL(posNext.nHeight, 0U);
+
+    // Height range and outcome.
+    vPage.clear();
+    BOOST_CHECK(bettingDB->ReadAddressBets(payoutScript, CBettingIndexKey(0, 101, 0, 0), 103, moneyLineWin, 100, vPage, posNext));
+    BOOST_CHECK_EQUAL(vPage.size(), 2U);
+    vPage.clear();
+    BOOST_CHECK(bettingDB->ReadEventBets(1, CBettingIndexKey(), 1000, moneyLineLose, 100, vPage, posNext));
+    BOOST_CHECK_EQUAL(vPage.size(), 3U);
+
+    // A full page with bets left in the range points at the next one, even if it is on another outcome.
+    vPage.clear();
+    BOOST_CHECK(bettingDB->ReadEventBets(1, CBettingIndexKey(), 1000, moneyLineLose, 1, vPage, posNext));
+    BOOST_CHECK_EQUAL(vPage.size(), 1U);
+    BOOST_CHECK_EQUAL(posNext.nHeight, 101U);
+
+    // Disconnected bets leave the address index along with the bet index.
+    BOOST_CHECK(bettingDB->EraseIndexEntries(vEntries, uint256(0)));
+    vPage.clear();
+    BOOST_CHECK(bettingDB->ReadAddressBets(payoutScript, CBettingIndexKey(), 1000, 0, 100, vPage, posNext));
+    BOOST_CHECK(vPage.empty());
+
+    fBetIndex = false;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
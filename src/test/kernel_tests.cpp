@@ -0,0 +1,127 @@
+// Copyright (c) 2018 The Wagerr developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "kernel.h"
+#include "test/test_wagerr.h"
+
+#include <boost/test/unit_test.hpp>
+
+// A stake input with a fixed origin, value, modifier and uniqueness
+class CTestStakeInput : public CStakeInput
+{
+public:
+    CTestStakeInput(CBlockIndex* pindex) { pindexFrom = pindex; }
+    CBlockIndex* GetIndexFrom() override { return pindexFrom; }
+    bool CreateTxIn(CWallet* pwallet, CTxIn& txIn, uint256 hashTxOut = 0) override { return false; }
+    bool GetTxFrom(CTransaction& tx) override { return false; }
+    CAmount GetValue() override { return 25000 * COIN; }
+    bool CreateTxOuts(CWallet* pwallet, std::vector<CTxOut>& vout, CAmount nTotal) override { return false; }
+    bool GetModifier(uint64_t& nStakeModifier) override
+    {
+        nStakeModifier = 0x0123456789abcdefULL;
+        return true;
+    }
+    bool IsZWGR() override { return false; }
+    CDataStream GetUniqueness() override
+    {
+        CDataStream ss(SER_GETHASH, 0);
+        ss << uint256(0x5eed) << (uint32_t)1;
+        return ss;
+    }
+    uint256 GetSerialHash() const override { return 0; }
+};
+
+BOOST_FIXTURE_TEST_SUITE(kernel_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(stake_kernel_matches_proof_of_stake_hash)
+{
+    CBlockIndex indexFrom;
+    indexFrom.nHeight = 1;
+    indexFrom.nTime = 1530000000;
+    CTestStakeInput stake(&indexFrom);
+
+    // Both the v1 and the v2 stake modifier
+    const int vHeights[] = {0, 100000000};
+    for (int nHeight : vHeights) {
+        CBlockIndex indexPrev;
+        indexPrev.nHeight = nHeight;
+        indexPrev.nStakeModifierV2 = uint256(0xfeed);
+
+        const unsigned int nBits = 0x1c00ffff;
+        const CStakeKernel kernel(&indexPrev, &stake, nBits);
+        BOOST_CHECK(kernel.IsValid());
+
+        int nHits = 0;
+        for (unsigned int nTimeTx = 1530000600; nTimeTx < 1530000600 + 500; nTimeTx++) {
+            uint256 hashKernel, hashProofOfStake;
+            const bool fKernel = kernel.CheckTime(nTimeTx, hashKernel);
+            BOOST_CHECK_EQUAL(fKernel, CheckStakeKernelHash(&indexPrev, nBits, &stake, nTimeTx, hashProofOfStake));
+            BOOST_CHECK(hashKernel == hashProofOfStake);
+            nHits += fKernel;
+        }
+        BOOST_CHECK(nHits > 0 && nHits < 500);
+    }
+}
+
+// Build a chain of blocks one minute apart that each generate a stake modifier
+static void BuildModifierChain(std::vector<CBlockIndex>& vIndex, std::vector<uint256>& vHashes, CBlockIndex* pindexFork, uint64_t nModifierBase)
+{
+    const int nStart = pindexFork ? pindexFork->nHeight + 1 : 0;
+    for (size_t i = 0; i < vIndex.size(); i++) {
+        CBlockIndex& index = vIndex[i];
+        index.nHeight = nStart + i;
+        index.nTime = 1530000000 + index.nHeight * 60;
+        index.pprev = i == 0 ? pindexFork : &vIndex[i - 1];
+        index.SetStakeModifier(nModifierBase + index.nHeight, true);
+        vHashes[i] = uint256(nModifierBase + index.nHeight);
+        index.phashBlock = &vHashes[i];
+        mapBlockIndex[vHashes[i]] = &index;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(stake_modifier_cache)
+{
+    std::vector<CBlockIndex> vMain(100), vFork(60);
+    std::vector<uint256> vMainHashes(vMain.size()), vForkHashes(vFork.size());
+    BuildModifierChain(vMain, vMainHashes, NULL, 0);
+    chainActive.SetTip(&vMain.back());
+
+    CStakeModifierCacheStats before, after;
+    GetStakeModifierCacheStats(before);
+
+    // The modifier is taken from the first block a selection interval after block 10
+    uint64_t nModifier = 0;
+    int nModifierHeight = 0;
+    int64_t nModifierTime = 0;
+    BOOST_CHECK(GetKernelStakeModifier(vMainHashes[10], nModifier, nModifierHeight, nModifierTime, false));
+    BOOST_CHECK_EQUAL(nModifier, 45U);
+    BOOST_CHECK_EQUAL(nModifierHeight, 45);
+    BOOST_CHECK(GetKernelStakeModifier(vMainHashes[10], nModifier, nModifierHeight, nModifierTime, false));
+    BOOST_CHECK_EQUAL(nModifier, 45U);
+
+    GetStakeModifierCacheStats(after);
+    BOOST_CHECK_EQUAL(after.nMisses - before.nMisses, 1U);
+    BOOST_CHECK_EQUAL(after.nHits - before.nHits, 1U);
+
+    // A reorganization of the blocks walked over invalidates the cached modifier
+    BuildModifierChain(vFork, vForkHashes, &vMain[39], 1000);
+    chainActive.SetTip(&vFork.back());
+    BOOST_CHECK(GetKernelStakeModifier(vMainHashes[10], nModifier, nModifierHeight, nModifierTime, false));
+    BOOST_CHECK_EQUAL(nModifier, 1045U);
+    BOOST_CHECK_EQUAL(nModifierHeight, 45);
+
+    GetStakeModifierCacheStats(after);
+    BOOST_CHECK_EQUAL(after.nInvalidated - before.nInvalidated, 1U);
+    BOOST_CHECK_EQUAL(after.nMisses - before.nMisses, 2U);
+
+    // The cached modifiers point at the blocks of this test
+    ClearStakeModifierCache();
+    chainActive.SetTip(NULL);
+    for (const uint256& hash : vMainHashes)
+        mapBlockIndex.erase(hash);
+    for (const uint256& hash : vForkHashes)
+        mapBlockIndex.erase(hash);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,353 @@
+// Copyright (c) 2018 The Wagerr developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "lightzwgrthread.h"
+#include "main.h"
+#include "net.h"
+#include "txdb.h"
+#include "zwgr/accumulators.h"
+
+#include "test/test_wagerr.h"
+
+#include <boost/test/unit_test.hpp>
+
+/** A peer reply to a witness request, as pushed by CLightWorker::processWork */
+struct CWitnessReply {
+    int nRequestNum;
+    bool fRejected;
+    uint32_t nError;
+    CBigNum bnWitness;
+    std::list<CBigNum> listMints;
+    int nHeightStop;
+
+    bool operator==(const CWitnessReply& reply) const
+    {
+        return nRequestNum == reply.nRequestNum && fRejected == reply.fRejected && nError == reply.nError &&
+               bnWitness == reply.bnWitness && listMints == reply.listMints && nHeightStop == reply.nHeightStop;
+    }
+};
+
+// The node has no socket, so every message it was sent stays in its send queue
+static std::vector<CWitnessReply> ReadReplies(CNode& node)
+{
+    std::vector<CWitnessReply> vReplies;
+    for (const CSerializeData& data : node.vSendMsg) {
+        CDataStream ss(data.begin() + CMessageHeader::HEADER_SIZE, data.end(), SER_NETWORK, PROTOCOL_VERSION);
+        CWitnessReply reply;
+        reply.nError = 0;
+        reply.nHeightStop = 0;
+        ss >> reply.nRequestNum;
+        reply.fRejected = ss.size() == sizeof(reply.nError);
+        if (reply.fRejected) {
+            ss >> reply.nError;
+        } else {
+            CBigNum bnAccValue;
+            uint32_t nSize;
+            ss >> bnAccValue >> reply.bnWitness >> nSize;
+            for (uint32_t i = 0; i < nSize; i++) {
+                CBigNum bnValue;
+                ss >> bnValue;
+                reply.listMints.push_back(bnValue);
+            }
+            ss >> reply.nHeightStop;
+        }
+        vReplies.push_back(reply);
+    }
+    node.vSendMsg.clear();
+    node.nSendSize = 0;
+    return vReplies;
+}
+
+static CBloomFilter MintFilter(const std::vector<CBigNum>& vMints)
+{
+    CBloomFilter filter(10, 0.000001, 0, BLOOM_UPDATE_NONE);
+    for (const CBigNum& bnValue : vMints)
+        filter.insert(bnValue.getvch());
+    return filter;
+}
+
+static void ReleaseWork(std::vector<CGenWit>& vWork)
+{
+    for (CGenWit& wit : vWork)
+        wit.getPfrom()->Release();
+}
+
+/**
+ * A chain of block indexes whose zWGR mints are served from the pubcoin index,
+ * with every checkpoint mapping to the same accumulator value.
+ */
+struct LightZwgrSetup : public TestingSetup {
+    static const int nChainHeight = 79;
+    static const int nStartingHeight = 30;
+
+    CZerocoinDB* pzerocoinDBSaved;
+    CBlockIndex* pindexTipSaved;
+    int nBlockZerocoinV2Saved;
+    std::vector<uint256> vHashes;
+    std::vector<CBlockIndex> vIndexes;
+    std::vector<CBigNum> vMints;
+    CBigNum bnCheckpointValue;
+
+    LightZwgrSetup() : vHashes(nChainHeight + 1), vIndexes(nChainHeight + 1)
+    {
+        pzerocoinDBSaved = zerocoinDB;
+        zerocoinDB = new CZerocoinDB(1 << 20, true);
+        pindexTipSaved = chainActive.Tip();
+        nBlockZerocoinV2Saved = Params().Zerocoin_Block_V2_Start();
+        ModifiableParams()->setZerocoinBlockV2Start(0);
+
+        libzerocoin::ZerocoinParams* params = Params().Zerocoin_Params(false);
+        bnCheckpointValue = libzerocoin::Accumulator(params, libzerocoin::ZQ_ONE).getValue();
+        uint256 nCheckpoint = uint256("0x1f2e3d4c5b6a79881f2e3d4c5b6a79881f2e3d4c5b6a79881f2e3d4c5b6a7988");
+        zerocoinDB->WriteAccumulatorValue(ParseChecksum(nCheckpoint, libzerocoin::ZQ_ONE), bnCheckpointValue);
+
+        for (int nHeight = 0; nHeight <= nChainHeight; nHeight++) {
+            vHashes[nHeight] = uint256(nHeight + 1);
+            CBlockIndex& index = vIndexes[nHeight];
+            index.phashBlock = &vHashes[nHeight];
+            index.nHeight = nHeight;
+            index.pprev = nHeight ? &vIndexes[nHeight - 1] : NULL;
+            index.nAccumulatorCheckpoint = nCheckpoint;
+
+            // Mints between the starting height and the height the witnesses stop at
+            std::map<libzerocoin::CoinDenomination, CBlockPubcoins> mapPubcoins;
+            if (nHeight == 31 || nHeight == 33 || nHeight == 36 || nHeight == 42 || nHeight == 47) {
+                CBlockPubcoins& blockPubcoins = mapPubcoins[libzerocoin::ZQ_ONE];
+                blockPubcoins.hashBlock = vHashes[nHeight];
+                for (int i = 0; i < 2; i++) {
+                    CBigNum bnValue = CBigNum(1000 * nHeight + 2 * i + 1);
+                    blockPubcoins.vPubcoins.emplace_back(bnValue, true);
+                    vMints.push_back(bnValue);
+                }
+                index.vMintDenominationsInBlock.push_back(libzerocoin::ZQ_ONE);
+            }
+            zerocoinDB->WriteBlockPubcoins(nHeight, vHashes[nHeight], mapPubcoins);
+        }
+        LOCK(cs_main);
+        chainActive.SetTip(&vIndexes[nChainHeight]);
+    }
+
+    ~LightZwgrSetup()
+    {
+        {
+            LOCK(cs_main);
+            chainActive.SetTip(pindexTipSaved);
+        }
+        ModifiableParams()->setZerocoinBlockV2Start(nBlockZerocoinV2Saved);
+        delete zerocoinDB;
+        zerocoinDB = pzerocoinDBSaved;
+    }
+
+    // The witness of a filter accumulates every mint it doesn't match
+    CBigNum ExpectedWitness(const std::vector<CBigNum>& vOwnMints) const
+    {
+        libzerocoin::Accumulator accumulator(Params().Zerocoin_Params(false), libzerocoin::ZQ_ONE, bnCheckpointValue);
+        for (const CBigNum& bnValue : vMints) {
+            if (std::find(vOwnMints.begin(), vOwnMints.end(), bnValue) == vOwnMints.end())
+                accumulator.increment(bnValue);
+        }
+        return accumulator.getValue();
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(lightzwgr_tests, LightZwgrSetup)
+
+BOOST_AUTO_TEST_CASE(lightzwgr_round_robin)
+{
+    CLightWorker worker;
+    boost::thread_group threadGroup;
+    CNode node1(INVALID_SOCKET, CAddress(), "", true);
+    CNode node2(INVALID_SOCKET, CAddress(), "", true);
+    CNode node3(INVALID_SOCKET, CAddress(), "", true);
+
+    // Nothing is queued before the worker runs; with no threads the requests stay queued
+    CGenWit wit(MintFilter(vMints), nStartingHeight, libzerocoin::ZQ_ONE, 0, 1);
+    wit.setPfrom(&node1);
+    BOOST_CHECK(!worker.addWitWork(wit));
+    worker.StartLightZwgrThread(threadGroup, 0);
+
+    // Requests of different starting heights are computed separately
+    int nRequestNum = 0;
+    CNode* vNodes[] = {&node1, &node1, &node1, &node2, &node2, &node3};
+    for (CNode* pnode : vNodes) {
+        CGenWit request(MintFilter(vMints), nStartingHeight + nRequestNum, libzerocoin::ZQ_ONE, nRequestNum, 1);
+        request.setPfrom(pnode);
+        BOOST_CHECK(worker.addWitWork(request));
+        nRequestNum++;
+    }
+
+    // Each peer gets a turn before any peer gets a second one
+    int vExpectedRequests[] = {0, 3, 5, 1, 4, 2};
+    for (int nExpected : vExpectedRequests) {
+        std::vector<CGenWit> vWork = worker.popWork();
+        BOOST_CHECK_EQUAL(vWork.size(), 1U);
+        BOOST_CHECK_EQUAL(vWork[0].getRequestNum(), nExpected);
+        BOOST_CHECK(vWork[0].getPfrom() == vNodes[nExpected]);
+        ReleaseWork(vWork);
+    }
+
+    // Requests with the same denomination, starting height and accumulator are taken together
+    for (CNode* pnode : {&node2, &node1, &node3}) {
+        CGenWit request(MintFilter(vMints), nStartingHeight, libzerocoin::ZQ_ONE, nRequestNum++, 1);
+        request.setPfrom(pnode);
+        BOOST_CHECK(worker.addWitWork(request));
+    }
+    CGenWit other(MintFilter(vMints), nStartingHeight + 1, libzerocoin::ZQ_ONE, nRequestNum++, 1);
+    other.setPfrom(&node1);
+    BOOST_CHECK(worker.addWitWork(other));
+    std::vector<CGenWit> vWork = worker.popWork();
+    BOOST_CHECK_EQUAL(vWork.size(), 3U);
+    for (const CGenWit& work : vWork)
+        BOOST_CHECK_EQUAL(work.getStartingHeight(), nStartingHeight);
+    ReleaseWork(vWork);
+    vWork = worker.popWork();
+    BOOST_CHECK_EQUAL(vWork.size(), 1U);
+    BOOST_CHECK_EQUAL(vWork[0].getRequestNum(), other.getRequestNum());
+    ReleaseWork(vWork);
+
+    worker.StopLightZwgrThread();
+}
+
+BOOST_AUTO_TEST_CASE(lightzwgr_max_per_peer)
+{
+    CLightWorker worker;
+    boost::thread_group threadGroup;
+    CNode node1(INVALID_SOCKET, CAddress(), "", true);
+    CNode node2(INVALID_SOCKET, CAddress(), "", true);
+    worker.StartLightZwgrThread(threadGroup, 0);
+
+    for (size_t i = 0; i < MAX_GENWIT_PER_PEER; i++) {
+        CGenWit request(MintFilter(vMints), nStartingHeight, libzerocoin::ZQ_ONE, i, 1);
+        request.setPfrom(&node1);
+        BOOST_CHECK(worker.addWitWork(request));
+    }
+    BOOST_CHECK_EQUAL(node1.GetRefCount(), (int)MAX_GENWIT_PER_PEER);
+
+    // The peer over its limit is refused without holding a reference, the others are still served
+    CGenWit request(MintFilter(vMints), nStartingHeight, libzerocoin::ZQ_ONE, MAX_GENWIT_PER_PEER, 1);
+    request.setPfrom(&node1);
+    BOOST_CHECK(!worker.addWitWork(request));
+    BOOST_CHECK_EQUAL(node1.GetRefCount(), (int)MAX_GENWIT_PER_PEER);
+    request.setPfrom(&node2);
+    BOOST_CHECK(worker.addWitWork(request));
+
+    // A served request frees a place in the queue of its peer
+    std::vector<CGenWit> vWork = worker.popWork();
+    BOOST_CHECK_EQUAL(vWork.size(), MAX_GENWIT_PER_PEER + 1);
+    ReleaseWork(vWork);
+    request.setPfrom(&node1);
+    BOOST_CHECK(worker.addWitWork(request));
+
+    // Stopping lets go of the peers of the requests still waiting, and refuses new ones
+    worker.StopLightZwgrThread();
+    BOOST_CHECK_EQUAL(node1.GetRefCount(), 0);
+    BOOST_CHECK(!worker.addWitWork(request));
+}
+
+BOOST_AUTO_TEST_CASE(lightzwgr_batched_witnesses)
+{
+    libzerocoin::ZerocoinParams* params = Params().Zerocoin_Params(false);
+
+    // Own mints of each request: one, two, all of them and none
+    std::vector<std::vector<CBigNum> > vOwnMints;
+    vOwnMints.push_back({vMints[0]});
+    vOwnMints.push_back({vMints[0], vMints[7]});
+    vOwnMints.push_back(vMints);
+    vOwnMints.push_back({});
+    std::vector<CBloomFilter> vFilters;
+    for (const std::vector<CBigNum>& vOwn : vOwnMints)
+        vFilters.push_back(MintFilter(vOwn));
+
+    libzerocoin::Accumulator accumulator(params, libzerocoin::ZQ_ONE);
+    std::vector<CBigNum> vWitnessValues;
+    std::vector<int> vMintsAdded;
+    std::vector<std::list<CBigNum> > vRet;
+    std::string strError;
+    int nHeightStop;
+    BOOST_CHECK(CalculateAccumulatorWitnessesFor(params, nStartingHeight, COMP_MAX_AMOUNT, libzerocoin::ZQ_ONE, vFilters,
+                                                 accumulator, vWitnessValues, vMintsAdded, strError, vRet, nHeightStop));
+    BOOST_CHECK_EQUAL(nHeightStop, 50);
+    BOOST_CHECK_EQUAL(vWitnessValues.size(), vFilters.size());
+
+    for (unsigned int i = 0; i < vFilters.size(); i++) {
+        // The batch gives each request the witness it would get alone
+        libzerocoin::Accumulator singleAccumulator(params, libzerocoin::ZQ_ONE);
+        std::vector<CBigNum> vSingleWitness;
+        std::vector<int> vSingleMintsAdded;
+        std::vector<std::list<CBigNum> > vSingleRet;
+        int nSingleHeightStop;
+        BOOST_CHECK(CalculateAccumulatorWitnessesFor(params, nStartingHeight, COMP_MAX_AMOUNT, libzerocoin::ZQ_ONE, {vFilters[i]},
+                                                     singleAccumulator, vSingleWitness, vSingleMintsAdded, strError, vSingleRet, nSingleHeightStop));
+        BOOST_CHECK(vWitnessValues[i] == vSingleWitness[0]);
+        BOOST_CHECK_EQUAL(vMintsAdded[i], vSingleMintsAdded[0]);
+        BOOST_CHECK(vRet[i] == vSingleRet[0]);
+        BOOST_CHECK_EQUAL(nHeightStop, nSingleHeightStop);
+        BOOST_CHECK(accumulator.getValue() == singleAccumulator.getValue());
+
+        // The witness leaves out the own mints, which are returned to the request
+        BOOST_CHECK(vWitnessValues[i] == ExpectedWitness(vOwnMints[i]));
+        BOOST_CHECK_EQUAL(vMintsAdded[i], (int)(vMints.size() - vOwnMints[i].size()));
+        BOOST_CHECK(std::vector<CBigNum>(vRet[i].begin(), vRet[i].end()) == vOwnMints[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(lightzwgr_batched_replies)
+{
+    CLightWorker worker;
+    boost::thread_group threadGroup;
+    std::vector<std::vector<CBigNum> > vOwnMints;
+    vOwnMints.push_back({vMints[0]});
+    vOwnMints.push_back(vMints);
+    vOwnMints.push_back({vMints[3], vMints[9]});
+    std::vector<CNode*> vNodes;
+    for (unsigned int i = 0; i < vOwnMints.size(); i++)
+        vNodes.push_back(new CNode(INVALID_SOCKET, CAddress(), "", true));
+    worker.StartLightZwgrThread(threadGroup, 0);
+
+    // Every request alone
+    std::vector<CWitnessReply> vSingleReplies;
+    for (unsigned int i = 0; i < vOwnMints.size(); i++) {
+        CGenWit request(MintFilter(vOwnMints[i]), nStartingHeight, libzerocoin::ZQ_ONE, i, 1);
+        request.setPfrom(vNodes[i]);
+        BOOST_CHECK(worker.addWitWork(request));
+        std::vector<CGenWit> vWork = worker.popWork();
+        BOOST_CHECK_EQUAL(vWork.size(), 1U);
+        worker.processWork(vWork);
+        ReleaseWork(vWork);
+        std::vector<CWitnessReply> vReplies = ReadReplies(*vNodes[i]);
+        BOOST_CHECK_EQUAL(vReplies.size(), 1U);
+        vSingleReplies.push_back(vReplies[0]);
+    }
+
+    // A request that matches every mint has nothing added and is refused on its own
+    BOOST_CHECK(!vSingleReplies[0].fRejected);
+    BOOST_CHECK(vSingleReplies[0].bnWitness == ExpectedWitness(vOwnMints[0]));
+    BOOST_CHECK(vSingleReplies[1].fRejected);
+    BOOST_CHECK_EQUAL(vSingleReplies[1].nError, (uint32_t)CLightWorker::NOT_ENOUGH_MINTS);
+    BOOST_CHECK(!vSingleReplies[2].fRejected);
+    BOOST_CHECK(vSingleReplies[2].bnWitness == ExpectedWitness(vOwnMints[2]));
+
+    // All of them in one computation
+    for (unsigned int i = 0; i < vOwnMints.size(); i++) {
+        CGenWit request(MintFilter(vOwnMints[i]), nStartingHeight, libzerocoin::ZQ_ONE, i, 1);
+        request.setPfrom(vNodes[i]);
+        BOOST_CHECK(worker.addWitWork(request));
+    }
+    std::vector<CGenWit> vWork = worker.popWork();
+    BOOST_CHECK_EQUAL(vWork.size(), vOwnMints.size());
+    worker.processWork(vWork);
+    ReleaseWork(vWork);
+    for (unsigned int i = 0; i < vOwnMints.size(); i++) {
+        std::vector<CWitnessReply> vReplies = ReadReplies(*vNodes[i]);
+        BOOST_CHECK_EQUAL(vReplies.size(), 1U);
+        BOOST_CHECK_MESSAGE(vReplies[0] == vSingleReplies[i], "batched reply " << i << " differs from the single reply");
+    }
+
+    worker.StopLightZwgrThread();
+    for (CNode* pnode : vNodes)
+        delete pnode;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
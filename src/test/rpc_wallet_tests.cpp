@@ -184,4 +184,27 @@ BOOST_AUTO_TEST_CASE(rpc_wallet)
     BOOST_CHECK(CBitcoinAddress(arr[0].get_str()).Get() == demoAddress.Get());
 }
 
+BOOST_AUTO_TEST_CASE(rpc_placebets)
+{
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+
+    BOOST_CHECK_THROW(CallRPC("placebets"), std::runtime_error);
+    BOOST_CHECK_THROW(CallRPC("placebets []"), std::runtime_error);
+    BOOST_CHECK_THROW(CallRPC("placebets [1021]"), std::runtime_error);
+    /* missing or mistyped fields */
+    BOOST_CHECK_THROW(CallRPC("placebets [{\"event-id\":1021,\"outcome\":1}]"), std::runtime_error);
+    BOOST_CHECK_THROW(CallRPC("placebets [{\"event-id\":\"1021\",\"outcome\":1,\"amount\":25}]"), std::runtime_error);
+    /* every amount has to be in the bet range */
+    BOOST_CHECK_THROW(CallRPC("placebets [{\"event-id\":1021,\"outcome\":1,\"amount\":25},{\"event-id\":1022,\"outcome\":2,\"amount\":24}]"), std::runtime_error);
+    BOOST_CHECK_THROW(CallRPC("placebets [{\"event-id\":1021,\"outcome\":1,\"amount\":10001}]"), std::runtime_error);
+
+    /* Valid bets get as far as the wallet, which has nothing to pay for them with */
+    try {
+        CallRPC("placebets [{\"event-id\":1021,\"outcome\":1,\"amount\":25},{\"event-id\":1022,\"outcome\":2,\"amount\":30}] comment");
+        BOOST_ERROR("placebets succeeded with an empty wallet");
+    } catch (const std::runtime_error& e) {
+        BOOST_CHECK_EQUAL(std::string(e.what()), "Error: Not enough funds in wallet or account");
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -8,6 +8,7 @@
 
 #include "test_wagerr.h"
 
+#include "betting/bettingdb.h"
 #include "main.h"
 #include "random.h"
 #include "txdb.h"
@@ -50,6 +51,7 @@ TestingSetup::TestingSetup()
         mapArgs["-datadir"] = pathTemp.string();
         pblocktree = new CBlockTreeDB(1 << 20, true);
         pcoinsdbview = new CCoinsViewDB(1 << 23, true);
+        bettingDB = new CBettingDB(1 << 20, true);
         pcoinsTip = new CCoinsViewCache(pcoinsdbview);
         InitBlockIndex();
 #ifdef ENABLE_WALLET
@@ -59,8 +61,14 @@ TestingSetup::TestingSetup()
         RegisterValidationInterface(pwalletMain);
 #endif
         nScriptCheckThreads = 3;
-        for (int i=0; i < nScriptCheckThreads-1; i++)
+        for (int i=0; i < nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadZerocoinSpendCheck);
+            threadGroup.create_thread(&ThreadBetSettlement);
+#ifdef ENABLE_WALLET
+            threadGroup.create_thread(&ThreadWalletScan);
+#endif
+        }
         RegisterNodeSignals(GetNodeSignals());
 }
 
@@ -78,6 +86,7 @@ TestingSetup::~TestingSetup()
         delete pcoinsTip;
         delete pcoinsdbview;
         delete pblocktree;
+        delete bettingDB;
 #ifdef ENABLE_WALLET
         bitdb.Flush(true);
         bitdb.Reset();
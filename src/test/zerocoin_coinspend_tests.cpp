@@ -89,4 +89,88 @@ BOOST_AUTO_TEST_CASE(zerocoin_wrapped_serial_spend_test)
 
 }
 
+/**
+ * Check that a block with an invalid spend proof is rejected on the check threads and serially alike.
+ */
+BOOST_AUTO_TEST_CASE(zerocoin_spend_check_queue_test)
+{
+    unsigned int TESTS_COINS_TO_ACCUMULATE = 5;
+
+    SelectParams(CBaseChainParams::MAIN);
+    libzerocoin::ZerocoinParams *ZCParams = Params().Zerocoin_Params(false);
+
+    std::string strWalletFile = "unittestwallet.dat";
+    CWalletDB walletdb(strWalletFile, "cr+");
+    CWallet wallet(strWalletFile);
+    CzWGRWallet *czWGRWallet = new CzWGRWallet(wallet.strWalletFile);
+
+    libzerocoin::CoinDenomination denom = libzerocoin::CoinDenomination::ZQ_FIFTY;
+    std::vector<libzerocoin::PrivateCoin> vCoins;
+    for (unsigned int i = 0; i < TESTS_COINS_TO_ACCUMULATE; i++) {
+        libzerocoin::PrivateCoin coin(ZCParams, denom, false);
+        CDeterministicMint dMint;
+        czWGRWallet->GenerateDeterministicZWGR(denom, coin, dMint, true);
+        czWGRWallet->UpdateCount();
+        vCoins.emplace_back(coin);
+    }
+
+    // Spend the first two coins against the accumulator of all of them, and keep the value before the last mint.
+    libzerocoin::Accumulator acc(&ZCParams->accumulatorParams, denom);
+    libzerocoin::AccumulatorWitness accWitness0(ZCParams, acc, vCoins[0].getPublicCoin());
+    libzerocoin::AccumulatorWitness accWitness1(ZCParams, acc, vCoins[1].getPublicCoin());
+    CBigNum bnStaleValue;
+    for (uint32_t i = 0; i < TESTS_COINS_TO_ACCUMULATE; i++) {
+        if (i == TESTS_COINS_TO_ACCUMULATE - 1)
+            bnStaleValue = acc.getValue();
+        acc += vCoins[i].getPublicCoin();
+        if (i != 0)
+            accWitness0 += vCoins[i].getPublicCoin();
+        if (i != 1)
+            accWitness1 += vCoins[i].getPublicCoin();
+    }
+
+    libzerocoin::CoinSpend spend0(ZCParams, ZCParams, vCoins[0], acc, 0, accWitness0, 0, libzerocoin::SpendType::SPEND);
+    libzerocoin::CoinSpend spend1(ZCParams, ZCParams, vCoins[1], acc, 0, accWitness1, 0, libzerocoin::SpendType::SPEND);
+
+    libzerocoin::PrivateCoin wrappedCoin = vCoins[2];
+    libzerocoin::AccumulatorWitness accWitness2(ZCParams, acc, wrappedCoin.getPublicCoin());
+    for (uint32_t i = 0; i < TESTS_COINS_TO_ACCUMULATE; i++)
+        if (i != 2)
+            accWitness2 += vCoins[i].getPublicCoin();
+    wrappedCoin.setSerialNumber(wrappedCoin.getSerialNumber() + ZCParams->coinCommitmentGroup.groupOrder * CBigNum(2).pow(256) * 2);
+    libzerocoin::CoinSpend wrappedSerialSpend(ZCParams, ZCParams, wrappedCoin, acc, 0, accWitness2, 0, libzerocoin::SpendType::SPEND);
+
+    CZerocoinSpendCheck validCheck0(spend0, ZCParams, acc.getValue(), true);
+    CZerocoinSpendCheck validCheck1(spend1, ZCParams, acc.getValue(), true);
+    CZerocoinSpendCheck staleCheck(spend1, ZCParams, bnStaleValue, true);
+    CZerocoinSpendCheck wrappedCheck(wrappedSerialSpend, ZCParams, acc.getValue(), true);
+
+    std::vector<std::vector<CZerocoinSpendCheck> > vBlocks;
+    vBlocks.push_back({validCheck0, validCheck1});
+    vBlocks.push_back({validCheck0, staleCheck, validCheck1});
+    vBlocks.push_back({wrappedCheck, validCheck0});
+    vBlocks.push_back({validCheck0, validCheck1, wrappedCheck});
+    const bool fExpected[] = {true, false, false, false};
+
+    // The queue takes the checks, so every run gets its own copy of the block.
+    int nThreads = nScriptCheckThreads;
+    nScriptCheckThreads = 0;
+    std::vector<bool> vSerial;
+    for (const std::vector<CZerocoinSpendCheck>& vChecks : vBlocks) {
+        std::vector<CZerocoinSpendCheck> vCopy(vChecks);
+        vSerial.push_back(VerifyZerocoinSpendChecks(vCopy));
+    }
+    nScriptCheckThreads = nThreads;
+    BOOST_CHECK(nScriptCheckThreads > 1);
+
+    for (unsigned int i = 0; i < vBlocks.size(); i++) {
+        std::vector<CZerocoinSpendCheck> vCopy(vBlocks[i]);
+        bool fQueued = VerifyZerocoinSpendChecks(vCopy);
+        BOOST_CHECK_MESSAGE(vSerial[i] == fExpected[i], "serial spend check of block " << i << " returned " << vSerial[i]);
+        BOOST_CHECK_MESSAGE(fQueued == vSerial[i], "queued spend check of block " << i << " differs from the serial result");
+    }
+
+    delete czWGRWallet;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
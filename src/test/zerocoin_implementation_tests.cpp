@@ -12,6 +12,7 @@
 #include "key.h"
 #include "zwgr/accumulatorcheckpoints.h"
 #include "libzerocoin/bignum.h"
+#include "invalid.h"
 #include <boost/test/unit_test.hpp>
 #include <iostream>
 #include <zwgr/accumulators.h>
@@ -509,4 +510,133 @@ BOOST_AUTO_TEST_CASE(deterministic_tests)
 }
 
 
+//values of the pubcoins of one denomination, in block order
+static std::vector<CBigNum> PubcoinValues(const std::list<libzerocoin::PublicCoin>& listPubcoins, libzerocoin::CoinDenomination denom)
+{
+    std::vector<CBigNum> vValues;
+    for (const libzerocoin::PublicCoin& pubCoin : listPubcoins) {
+        if (pubCoin.getDenomination() == denom)
+            vValues.emplace_back(pubCoin.getValue());
+    }
+    return vValues;
+}
+
+static std::vector<CBigNum> PubcoinValues(const std::map<libzerocoin::CoinDenomination, CBlockPubcoins>& mapPubcoins, libzerocoin::CoinDenomination denom, bool fFilterInvalid)
+{
+    std::vector<CBigNum> vValues;
+    auto it = mapPubcoins.find(denom);
+    if (it == mapPubcoins.end())
+        return vValues;
+    for (const auto& pubcoin : it->second.vPubcoins) {
+        if (!fFilterInvalid || pubcoin.second)
+            vValues.emplace_back(pubcoin.first);
+    }
+    return vValues;
+}
+
+BOOST_AUTO_TEST_CASE(pubcoin_index_test)
+{
+    std::cout << "Running pubcoin_index_test...\n";
+
+    CZerocoinDB* pzerocoinDBSaved = zerocoinDB;
+    zerocoinDB = new CZerocoinDB(1 << 20, true);
+
+    //a proof of stake block holding the three raw mints, so it reads back from disk without a work check
+    CBlock block;
+    CMutableTransaction txCoinBase;
+    txCoinBase.vin.resize(1);
+    txCoinBase.vin[0].prevout.SetNull();
+    txCoinBase.vout.resize(1);
+    txCoinBase.vout[0].SetEmpty();
+    block.vtx.push_back(CTransaction(txCoinBase));
+    CMutableTransaction txCoinStake;
+    txCoinStake.vin.resize(1);
+    txCoinStake.vin[0].prevout = COutPoint(uint256(1), 0);
+    txCoinStake.vout.resize(2);
+    txCoinStake.vout[0].SetEmpty();
+    block.vtx.push_back(CTransaction(txCoinStake));
+    for (std::pair<std::string, std::string> raw : vecRawMints) {
+        CTransaction tx;
+        BOOST_CHECK_MESSAGE(DecodeHexTx(tx, raw.first), "Failed to deserialize hex transaction");
+        block.vtx.push_back(tx);
+    }
+    block.hashMerkleRoot = block.BuildMerkleTree();
+    BOOST_CHECK(block.IsProofOfStake());
+
+    //the second mint spends an invalid outpoint, so the filter drops it
+    COutPoint outInvalid = block.vtx[3].vin[0].prevout;
+    invalid_out::setInvalidOutPoints.insert(outInvalid);
+
+    std::map<libzerocoin::CoinDenomination, CBlockPubcoins> mapPubcoins;
+    BOOST_CHECK(BlockToPubcoinIndex(block, mapPubcoins));
+    std::list<libzerocoin::PublicCoin> listAll, listValid;
+    BOOST_CHECK(BlockToPubcoinList(block, listAll, false));
+    BOOST_CHECK(BlockToPubcoinList(block, listValid, true));
+    BOOST_CHECK_MESSAGE(listValid.size() < listAll.size(), "Invalid outpoint was not filtered");
+    for (auto denom : libzerocoin::zerocoinDenomList) {
+        BOOST_CHECK_MESSAGE(PubcoinValues(mapPubcoins, denom, false) == PubcoinValues(listAll, denom), "Unfiltered index differs for denom " << denom);
+        BOOST_CHECK_MESSAGE(PubcoinValues(mapPubcoins, denom, true) == PubcoinValues(listValid, denom), "Filtered index differs for denom " << denom);
+    }
+
+    //store the block where the index can read it back
+    CDiskBlockPos pos(1, 0);
+    BOOST_CHECK(WriteBlockToDisk(block, pos));
+    uint256 hashBlock = block.GetHash();
+    CBlockIndex index(block);
+    index.phashBlock = &hashBlock;
+    index.nHeight = Params().Zerocoin_StartHeight() + 1;
+    index.nFile = pos.nFile;
+    index.nDataPos = pos.nPos;
+    index.nStatus |= BLOCK_HAVE_DATA;
+
+    //a block that was never indexed is read from disk, and is not indexed off the active chain
+    uint256 hashStored;
+    BOOST_CHECK(!zerocoinDB->ReadBlockPubcoinsHash(index.nHeight, hashStored));
+    for (auto denom : libzerocoin::zerocoinDenomList) {
+        BOOST_CHECK(GetPubcoinValuesFromBlock(&index, denom, true) == PubcoinValues(listValid, denom));
+        BOOST_CHECK(GetPubcoinValuesFromBlock(&index, denom, false) == PubcoinValues(listAll, denom));
+    }
+    BOOST_CHECK(!zerocoinDB->ReadBlockPubcoinsHash(index.nHeight, hashStored));
+
+    //connecting the block writes its entries, and only for the denominations it mints
+    BOOST_CHECK(zerocoinDB->WriteBlockPubcoins(index.nHeight, hashBlock, mapPubcoins));
+    BOOST_CHECK(zerocoinDB->ReadBlockPubcoinsHash(index.nHeight, hashStored));
+    BOOST_CHECK(hashStored == hashBlock);
+    for (auto denom : libzerocoin::zerocoinDenomList) {
+        CBlockPubcoins blockPubcoins;
+        BOOST_CHECK_EQUAL(zerocoinDB->ReadBlockPubcoins(index.nHeight, denom, blockPubcoins), mapPubcoins.count(denom) > 0);
+        BOOST_CHECK(GetPubcoinValuesFromBlock(&index, denom, true) == PubcoinValues(listValid, denom));
+        BOOST_CHECK(GetPubcoinValuesFromBlock(&index, denom, false) == PubcoinValues(listAll, denom));
+    }
+
+    //entries under the block hash are served from the index rather than the block
+    std::map<libzerocoin::CoinDenomination, CBlockPubcoins> mapAltered = mapPubcoins;
+    for (auto& denomPubcoins : mapAltered) {
+        for (auto& pubcoin : denomPubcoins.second.vPubcoins)
+            pubcoin.second = false;
+    }
+    BOOST_CHECK(zerocoinDB->WriteBlockPubcoins(index.nHeight, hashBlock, mapAltered));
+    for (auto denom : libzerocoin::zerocoinDenomList)
+        BOOST_CHECK(GetPubcoinValuesFromBlock(&index, denom, true).empty());
+
+    //entries left behind by another block at the same height are ignored
+    BOOST_CHECK(zerocoinDB->WriteBlockPubcoins(index.nHeight, uint256(2), mapAltered));
+    for (auto denom : libzerocoin::zerocoinDenomList)
+        BOOST_CHECK(GetPubcoinValuesFromBlock(&index, denom, true) == PubcoinValues(listValid, denom));
+
+    //disconnecting the block erases all of its entries
+    BOOST_CHECK(zerocoinDB->WriteBlockPubcoins(index.nHeight, hashBlock, mapPubcoins));
+    BOOST_CHECK(zerocoinDB->EraseBlockPubcoins(index.nHeight));
+    BOOST_CHECK(!zerocoinDB->ReadBlockPubcoinsHash(index.nHeight, hashStored));
+    for (auto denom : libzerocoin::zerocoinDenomList) {
+        CBlockPubcoins blockPubcoins;
+        BOOST_CHECK(!zerocoinDB->ReadBlockPubcoins(index.nHeight, denom, blockPubcoins));
+        BOOST_CHECK(GetPubcoinValuesFromBlock(&index, denom, true) == PubcoinValues(listValid, denom));
+    }
+
+    invalid_out::setInvalidOutPoints.erase(outInvalid);
+    delete zerocoinDB;
+    zerocoinDB = pzerocoinDBSaved;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -426,16 +426,11 @@ std::vector<TransactionRecord> TransactionRecord::decomposeTransaction(const CWa
                     bool isBettingEntry = false;
                     bool isChainGameEntry = false;
                     if (txout.scriptPubKey.IsUnspendable()) {
-                        std::vector<unsigned char> vOpCode = ParseHex(txout.scriptPubKey.ToString().substr(9, std::string::npos));
-                        std::string opCode(vOpCode.begin(), vOpCode.end());
-
-                        CPeerlessBet plBet;
-                        CChainGamesBet cgBet;
-                        if (CPeerlessBet::FromOpCode(opCode, plBet)) {
-                            isBettingEntry = true;
-                        } else if (CChainGamesBet::FromOpCode(opCode, cgBet)) {
-                            isChainGameEntry = true;
-                        }
+                        CBetOpCode betOpCode;
+                        DecodeBetOpCode(txout.scriptPubKey, betOpCode);
+
+                        isBettingEntry = boost::get<CPeerlessBet>(&betOpCode) != NULL;
+                        isChainGameEntry = boost::get<CChainGamesBet>(&betOpCode) != NULL;
                     }
                     if (isBettingEntry) {
                         // Placed a bet
@@ -428,3 +428,39 @@ bool CZerocoinDB::EraseAccumulatorValue(const uint32_t& nChecksum)
     LogPrint("zero", "%s : checksum:%d\n", __func__, nChecksum);
     return Erase(std::make_pair('2', nChecksum));
 }
+
+bool CZerocoinDB::WriteBlockPubcoins(int nHeight, const uint256& hashBlock, const std::map<libzerocoin::CoinDenomination, CBlockPubcoins>& mapPubcoins)
+{
+    // The block hash is written even without mints, so a missing entry means the height was never indexed
+    CLevelDBBatch batch;
+    batch.Write(std::make_pair('p', std::make_pair(nHeight, (int)libzerocoin::ZQ_ERROR)), hashBlock);
+    for (auto denom : libzerocoin::zerocoinDenomList) {
+        auto it = mapPubcoins.find(denom);
+        if (it == mapPubcoins.end())
+            batch.Erase(std::make_pair('p', std::make_pair(nHeight, (int)denom)));
+        else
+            batch.Write(std::make_pair('p', std::make_pair(nHeight, (int)denom)), it->second);
+    }
+
+    return WriteBatch(batch);
+}
+
+bool CZerocoinDB::ReadBlockPubcoinsHash(int nHeight, uint256& hashBlock)
+{
+    return Read(std::make_pair('p', std::make_pair(nHeight, (int)libzerocoin::ZQ_ERROR)), hashBlock);
+}
+
+bool CZerocoinDB::ReadBlockPubcoins(int nHeight, libzerocoin::CoinDenomination denom, CBlockPubcoins& blockPubcoins)
+{
+    return Read(std::make_pair('p', std::make_pair(nHeight, (int)denom)), blockPubcoins);
+}
+
+bool CZerocoinDB::EraseBlockPubcoins(int nHeight)
+{
+    CLevelDBBatch batch;
+    batch.Erase(std::make_pair('p', std::make_pair(nHeight, (int)libzerocoin::ZQ_ERROR)));
+    for (auto denom : libzerocoin::zerocoinDenomList)
+        batch.Erase(std::make_pair('p', std::make_pair(nHeight, (int)denom)));
+
+    return WriteBatch(batch);
+}
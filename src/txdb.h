@@ -69,6 +69,35 @@ public:
     bool LoadBlockIndexGuts();
 };
 
+/** The zerocoin mints of one denomination in a block, in block order */
+class CBlockPubcoins
+{
+public:
+    uint256 hashBlock;
+    //! pubcoin value, and whether it survives the invalid outpoint filter of BlockToPubcoinList
+    std::vector<std::pair<CBigNum, bool> > vPubcoins;
+
+    CBlockPubcoins()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        hashBlock = 0;
+        vPubcoins.clear();
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(hashBlock);
+        READWRITE(vPubcoins);
+    }
+};
+
 /** Zerocoin database (zerocoin/) */
 class CZerocoinDB : public CLevelDBWrapper
 {
@@ -94,6 +123,11 @@ public:
     bool WriteAccumulatorValue(const uint32_t& nChecksum, const CBigNum& bnValue);
     bool ReadAccumulatorValue(const uint32_t& nChecksum, CBigNum& bnValue);
     bool EraseAccumulatorValue(const uint32_t& nChecksum);
+    /** Write the per denomination pubcoin index of the block at nHeight in a batch */
+    bool WriteBlockPubcoins(int nHeight, const uint256& hashBlock, const std::map<libzerocoin::CoinDenomination, CBlockPubcoins>& mapPubcoins);
+    bool ReadBlockPubcoinsHash(int nHeight, uint256& hashBlock);
+    bool ReadBlockPubcoins(int nHeight, libzerocoin::CoinDenomination denom, CBlockPubcoins& blockPubcoins);
+    bool EraseBlockPubcoins(int nHeight);
 };
 
 #endif // BITCOIN_TXDB_H
@@ -26,9 +26,15 @@ void RegisterValidationInterface(CValidationInterface* pwalletIn) {
     g_signals.BlockChecked.connect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
 // XX42    g_signals.ScriptForMining.connect(boost::bind(&CValidationInterface::GetScriptForMining, pwalletIn, _1));
     g_signals.BlockFound.connect(boost::bind(&CValidationInterface::ResetRequestCount, pwalletIn, _1));
+    g_signals.NotifyBetEvent.connect(boost::bind(&CValidationInterface::NotifyBetEvent, pwalletIn, _1));
+    g_signals.NotifyBetResult.connect(boost::bind(&CValidationInterface::NotifyBetResult, pwalletIn, _1));
+    g_signals.NotifyBetOdds.connect(boost::bind(&CValidationInterface::NotifyBetOdds, pwalletIn, _1));
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
+    g_signals.NotifyBetOdds.disconnect(boost::bind(&CValidationInterface::NotifyBetOdds, pwalletIn, _1));
+    g_signals.NotifyBetResult.disconnect(boost::bind(&CValidationInterface::NotifyBetResult, pwalletIn, _1));
+    g_signals.NotifyBetEvent.disconnect(boost::bind(&CValidationInterface::NotifyBetEvent, pwalletIn, _1));
     g_signals.BlockFound.disconnect(boost::bind(&CValidationInterface::ResetRequestCount, pwalletIn, _1));
 // XX42    g_signals.ScriptForMining.disconnect(boost::bind(&CValidationInterface::GetScriptForMining, pwalletIn, _1));
     g_signals.BlockChecked.disconnect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
@@ -43,6 +49,9 @@ void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
 }
 
 void UnregisterAllValidationInterfaces() {
+    g_signals.NotifyBetOdds.disconnect_all_slots();
+    g_signals.NotifyBetResult.disconnect_all_slots();
+    g_signals.NotifyBetEvent.disconnect_all_slots();
     g_signals.BlockFound.disconnect_all_slots();
 // XX42    g_signals.ScriptForMining.disconnect_all_slots();
     g_signals.BlockChecked.disconnect_all_slots();
@@ -14,6 +14,8 @@
 class CBlock;
 struct CBlockLocator;
 class CBlockIndex;
+class CPeerlessEvent;
+class CPeerlessResult;
 class CReserveScript;
 class CTransaction;
 class CValidationInterface;
@@ -45,6 +47,9 @@ protected:
     virtual void BlockChecked(const CBlock&, const CValidationState&) {}
 // XX42    virtual void GetScriptForMining(boost::shared_ptr<CReserveScript>&) {};
     virtual void ResetRequestCount(const uint256 &hash) {};
+    virtual void NotifyBetEvent(const CPeerlessEvent &event) {}
+    virtual void NotifyBetResult(const CPeerlessResult &result) {}
+    virtual void NotifyBetOdds(const CPeerlessEvent &event) {}
     friend void ::RegisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
@@ -73,6 +78,12 @@ struct CMainSignals {
 // XX42    boost::signals2::signal<void (boost::shared_ptr<CReserveScript>&)> ScriptForMining;
     /** Notifies listeners that a block has been successfully mined */
     boost::signals2::signal<void (const uint256 &)> BlockFound;
+    /** Notifies listeners of an event added or replaced by a connected block. */
+    boost::signals2::signal<void (const CPeerlessEvent &)> NotifyBetEvent;
+    /** Notifies listeners of a result added by a connected block. */
+    boost::signals2::signal<void (const CPeerlessResult &)> NotifyBetResult;
+    /** Notifies listeners of an event whose odds were updated by a connected block. */
+    boost::signals2::signal<void (const CPeerlessEvent &)> NotifyBetOdds;
 };
 
 CMainSignals& GetMainSignals();
@@ -22,6 +22,7 @@
 
 #include "transactionrecord.h"
 #include "betting/bet.h"
+#include "betting/bettingdb.h"
 
 #include <cstdlib>
 #include <stdint.h>
@@ -67,9 +68,8 @@ UniValue listevents(const UniValue& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("listevents", "") + HelpExampleRpc("listevents", ""));
 
-    CEventDB edb;
-    eventIndex_t eventsIndex;
-    edb.GetEvents(eventsIndex);
+    eventIndexSnapshot_t pEventsIndex = CEventDB::GetEventsSnapshot();
+    const eventIndex_t &eventsIndex = *pEventsIndex;
 
     mappingIndex_t sportsIndex;
     CMappingDB msdb("sports.dat");
@@ -100,7 +100,7 @@ UniValue listevents(const UniValue& params, bool fHelp)
 
     UniValue ret(UniValue::VARR);
 
-    std::map<uint32_t, CPeerlessEvent>::iterator it;
+    std::map<uint32_t, CPeerlessEvent>::const_iterator it;
     for (it = eventsIndex.begin(); it != eventsIndex.end(); it++) {
 
         try {
@@ -221,14 +221,10 @@ UniValue listchaingamesevents(const UniValue& params, bool fHelp)
             // Check each TX out for values
             for (unsigned int i = 0; i < tx.vout.size(); i++) {
                 const CTxOut &txout = tx.vout[i];
-                std::string scriptPubKey = txout.scriptPubKey.ToString();
+                std::string OpCode;
 
                 // Find OP_RETURN transactions
-                if(scriptPubKey.length() > 0 && strncmp(scriptPubKey.c_str(), "OP_RETURN", 9) == 0) {
-
-                    std::vector<unsigned char> vOpCode = ParseHex(scriptPubKey.substr(9, std::string::npos));
-                    std::string OpCode(vOpCode.begin(), vOpCode.end());
-
+                if (GetBetOpCode(txout.scriptPubKey, OpCode)) {
                     // Find any CChainGameEvents matching the specified id
                     CChainGamesEvent cgEvent;
                     if (validTx && CChainGamesEvent::FromOpCode(OpCode, cgEvent)) {
@@ -300,10 +296,6 @@ UniValue listbets(const UniValue& params, bool fHelp)
 
     const CWallet::TxItems & txOrdered = pwalletMain->wtxOrdered;
 
-    CEventDB edb;
-    eventIndex_t eventIndex;
-    edb.GetEvents(eventIndex);
-
     mappingIndex_t teamsIndex;
     CMappingDB mtdb("teams.dat");
     mtdb.GetTeams(teamsIndex);
@@ -321,13 +313,10 @@ UniValue listbets(const UniValue& params, bool fHelp)
 
             for (unsigned int i = 0; i < (*pwtx).vout.size(); i++) {
                 const CTxOut& txout = (*pwtx).vout[i];
-                std::string scriptPubKey = txout.scriptPubKey.ToString();
+                std::string opCode;
 
                 // TODO Remove hard-coded values from this block.
-                if (scriptPubKey.length() > 0 && strncmp(scriptPubKey.c_str(), "OP_RETURN", 9) == 0) {
-                    std::vector<unsigned char> vOpCode = ParseHex(scriptPubKey.substr(9, std::string::npos));
-                    std::string opCode(vOpCode.begin(), vOpCode.end());
-
+                if (GetBetOpCode(txout.scriptPubKey, opCode)) {
                     CPeerlessBet plBet;
                     if (CPeerlessBet::FromOpCode(opCode, plBet)) {
                         UniValue entry(UniValue::VOBJ);
@@ -335,8 +324,8 @@ UniValue listbets(const UniValue& params, bool fHelp)
                         entry.push_back(Pair("event-id", (uint64_t) plBet.nEventId));
 
                         // Retrieve the event details
-                        if (eventIndex.count(plBet.nEventId)){
-                            CPeerlessEvent plEvent = eventIndex.find(plBet.nEventId)->second;
+                        CPeerlessEvent plEvent;
+                        if (CEventDB::GetEvent(plBet.nEventId, plEvent)) {
 
                             entry.push_back(Pair("starting", plEvent.nStartTime));
                             if (teamsIndex.count(plEvent.nHomeTeam)) {
@@ -489,10 +478,6 @@ UniValue getbet(const UniValue& params, bool fHelp)
 
     UniValue ret(UniValue::VOBJ);
 
-    CEventDB edb;
-    eventIndex_t eventIndex;
-    edb.GetEvents(eventIndex);
-
     mappingIndex_t teamsIndex;
     CMappingDB mtdb("teams.dat");
     mtdb.GetTeams(teamsIndex);
@@ -503,21 +488,18 @@ UniValue getbet(const UniValue& params, bool fHelp)
 
     for (unsigned int i = 0; i < tx.vout.size(); i++) {
         const CTxOut& txout = tx.vout[i];
-        std::string scriptPubKey = txout.scriptPubKey.ToString();
+        std::string opCode;
 
         // TODO Remove hard-coded values from this block.
-        if (scriptPubKey.length() > 0 && strncmp(scriptPubKey.c_str(), "OP_RETURN", 9) == 0) {
-            std::vector<unsigned char> vOpCode = ParseHex(scriptPubKey.substr(9, std::string::npos));
-            std::string opCode(vOpCode.begin(), vOpCode.end());
-
+        if (GetBetOpCode(txout.scriptPubKey, opCode)) {
             CPeerlessBet plBet;
             if (CPeerlessBet::FromOpCode(opCode, plBet)) {
                 ret.push_back(Pair("tx-id", txHash.ToString().c_str()));
                 ret.push_back(Pair("event-id", (uint64_t)plBet.nEventId));
 
                 // Retrieve the event details
-                if (eventIndex.count(plBet.nEventId)) {
-                    CPeerlessEvent plEvent = eventIndex.find(plBet.nEventId)->second;
+                CPeerlessEvent plEvent;
+                if (CEventDB::GetEvent(plBet.nEventId, plEvent)) {
 
                     ret.push_back(Pair("starting", plEvent.nStartTime));
                     if (teamsIndex.count(plEvent.nHomeTeam)) {
@@ -650,13 +632,10 @@ UniValue listchaingamesbets(const UniValue& params, bool fHelp)
 
             for (unsigned int i = 0; i < (*pwtx).vout.size(); i++) {
                 const CTxOut& txout = (*pwtx).vout[i];
-                std::string scriptPubKey = txout.scriptPubKey.ToString();
+                std::string opCode;
 
                 // TODO Remove hard-coded values from this block.
-                if (scriptPubKey.length() > 0 && strncmp(scriptPubKey.c_str(), "OP_RETURN", 9) == 0) {
-                    std::vector<unsigned char> vOpCode = ParseHex(scriptPubKey.substr(9, std::string::npos));
-                    std::string opCode(vOpCode.begin(), vOpCode.end());
-
+                if (GetBetOpCode(txout.scriptPubKey, opCode)) {
                     CChainGamesBet cgBet;
                     if (CChainGamesBet::FromOpCode(opCode, cgBet)) {
                         UniValue entry(UniValue::VOBJ);
@@ -1101,6 +1080,96 @@ UniValue placebet(const UniValue& params, bool fHelp)
     return wtx.GetHash().GetHex();
 }
 
+/** The most bets placebets puts in a transaction, which keeps it well within the standard transaction size. */
+static const unsigned int MAX_PLACEBETS_COUNT = 1000;
+
+UniValue placebets(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 3)
+        throw std::runtime_error(
+            "placebets [{\"event-id\":n,\"outcome\":n,\"amount\":x.xxx},...] ( \"comment\" \"comment-to\" )\n"
+            "\nWARNING - Betting closes 20 minutes before event start time.\n"
+            "Any bets placed after this time will be invalid and will not be paid out! \n"
+            "\nPlace several bets in one transaction, selecting the coins to pay for them once.\n"
+            "The amounts are rounded to the nearest 0.00000001\n" +
+            HelpRequiringPassphrase() +
+            "\nArguments:\n"
+            "1. \"bets\"        (array, required) The bets to place, at most 1000.\n"
+            "    [\n"
+            "      {\n"
+            "        \"event-id\": n,     (numeric, required) The event to bet on.\n"
+            "        \"outcome\": n,      (numeric, required) The outcome to bet on, as in placebet.\n"
+            "        \"amount\": x.xxx    (numeric, required) The amount in wgr to bet. eg 25\n"
+            "      }\n"
+            "      ,...\n"
+            "    ]\n"
+            "2. \"comment\"     (string, optional) A comment used to store what the transaction is for. \n"
+            "                             This is not part of the transaction, just kept in your wallet.\n"
+            "3. \"comment-to\"  (string, optional) A comment to store the name of the person or organization \n"
+            "                             to which you're sending the transaction. This is not part of the \n"
+            "                             transaction, just kept in your wallet.\n"
+            "\nResult:\n"
+            "\"transactionid\"  (string) The transaction id.\n"
+            "\nExamples:\n" +
+            HelpExampleCli("placebets", "\"[{\\\"event-id\\\":1021,\\\"outcome\\\":1,\\\"amount\\\":25},{\\\"event-id\\\":1022,\\\"outcome\\\":2,\\\"amount\\\":30}]\"") +
+            HelpExampleRpc("placebets", "[{\"event-id\":1021,\"outcome\":1,\"amount\":25},{\"event-id\":1022,\"outcome\":2,\"amount\":30}]"));
+
+    UniValue bets = params[0].get_array();
+    if (bets.empty() || bets.size() > MAX_PLACEBETS_COUNT)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Error: Please place between 1 and %u bets.", MAX_PLACEBETS_COUNT));
+
+    // Each bet is an OP_RETURN output holding its op code, as placebet makes.
+    std::vector<std::pair<CScript, CAmount> > vecSend;
+    CAmount nTotalAmount = 0;
+    for (unsigned int i = 0; i < bets.size(); i++) {
+        const UniValue& bet = bets[i].get_obj();
+        RPCTypeCheckObj(bet, boost::assign::map_list_of("event-id", UniValue::VNUM)("outcome", UniValue::VNUM)("amount", UniValue::VNUM));
+
+        CAmount nAmount = AmountFromValue(find_value(bet, "amount"));
+
+        // Validate bet amount so its between 25 - 10000 WGR inclusive.
+        if (nAmount < (Params().MinBetPayoutRange()  * COIN ) || nAmount > (Params().MaxBetPayoutRange() * COIN)) {
+            throw JSONRPCError(RPC_BET_DETAILS_ERROR, strprintf("Error: Incorrect amount for bet %u. Please ensure your bet is between 25 - 10000 WGR inclusive.", i));
+        }
+
+        CPeerlessBet plBet(find_value(bet, "event-id").get_int(), (OutcomeType) find_value(bet, "outcome").get_int());
+        std::string opCode;
+        CPeerlessBet::ToOpCode(plBet, opCode);
+
+        std::vector<unsigned char> vectorValue;
+        boost::algorithm::unhex(opCode, back_inserter(vectorValue));
+
+        vecSend.push_back(std::make_pair(CScript() << OP_RETURN << vectorValue, nAmount));
+        nTotalAmount += nAmount;
+    }
+
+    // Wallet comments
+    CWalletTx wtx;
+    if (params.size() > 1 && !params[1].isNull() && !params[1].get_str().empty())
+        wtx.mapValue["comment"] = params[1].get_str();
+    if (params.size() > 2 && !params[2].isNull() && !params[2].get_str().empty())
+        wtx.mapValue["to"] = params[2].get_str();
+
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+
+    EnsureWalletIsUnlocked();
+    EnsureEnoughWagerr(nTotalAmount);
+
+    // Create and send one transaction for all the bets.
+    CReserveKey keyChange(pwalletMain);
+    CAmount nFeeRequired = 0;
+    std::string strFailReason;
+    if (!pwalletMain->CreateTransaction(vecSend, wtx, keyChange, nFeeRequired, strFailReason)) {
+        if (nTotalAmount + nFeeRequired > pwalletMain->GetBalance())
+            strFailReason = strprintf("Error: This transaction requires a transaction fee of at least %s because of its amount, complexity, or use of recently received funds!", FormatMoney(nFeeRequired));
+        throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, strFailReason);
+    }
+    if (!pwalletMain->CommitTransaction(wtx, keyChange))
+        throw JSONRPCError(RPC_WALLET_ERROR, "Error: The transaction was rejected! This might happen if some of the coins in your wallet were already spent, such as if you used a copy of wallet.dat and coins were spent in the copy but not marked as spent here.");
+
+    return wtx.GetHash().GetHex();
+}
+
 UniValue placechaingamesbet(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() < 1 || params.size() > 5) {
@@ -1193,58 +1262,41 @@ UniValue getchaingamesinfo(const UniValue& params, bool fHelp)
         fShowWinner = params[1].get_bool();
     }
 
-    //CBlockIndex* pindex = chainActive.Height() > Params().BetStartHeight() ? chainActive[Params().BetStartHeight()] : NULL;
+    LOCK(cs_main);
+
     CBlockIndex *BlocksIndex = NULL;
     int height = (Params().NetworkID() == CBaseChainParams::MAIN) ? chainActive.Height() - 10500 : chainActive.Height() - 14400;
     BlocksIndex = chainActive[height];
 
-    while (BlocksIndex) {
-        CBlock block;
-        ReadBlockFromDisk(block, BlocksIndex);
-
-        for (CTransaction& tx : block.vtx) {
-
-            const CTxIn &txin = tx.vin[0];
-            bool validTx = IsValidOracleTx(txin);
-
-            // Check each TX out for values
-            for (unsigned int i = 0; i < tx.vout.size(); i++) {
-                const CTxOut &txout = tx.vout[i];
-                std::string scriptPubKey = txout.scriptPubKey.ToString();
-
-                // Find OP_RETURN transactions
-                if(scriptPubKey.length() > 0 && strncmp(scriptPubKey.c_str(), "OP_RETURN", 9) == 0) {
+    // The postings and entries of the event are kept in its running pot, results carry a 16 bit event id.
+    CChainGamesPot pot;
+    CChainGamesPot resultPot;
+    if (BlocksIndex) {
+        bettingDB->ReadChainGamesPot(eventID, pot);
+        bettingDB->ReadChainGamesPot((uint16_t)eventID, resultPot);
+    }
 
-                    std::vector<unsigned char> vOpCode = ParseHex(scriptPubKey.substr(9, std::string::npos));
-                    std::string OpCode(vOpCode.begin(), vOpCode.end());
+    for (const CChainGamesPotEntry& entry : pot.vEntries) {
+        if (entry.nHeight < (uint32_t)height)
+            continue;
 
-                    // Find any CChainGameEvents matching the specified id
-                    CChainGamesEvent cgEvent;
-                    if (validTx && CChainGamesEvent::FromOpCode(OpCode, cgEvent)) {
-                        if (((unsigned int)cgEvent.nEventId) == eventID){
-                            entryFee = cgEvent.nEntryFee;
-                            gameStartTime = block.GetBlockTime();
-                            gameStartBlock = BlocksIndex -> nHeight;
-                        }
-                    }
-                    // Find a matching result transaction
-                    CChainGamesResult cgResult;
-                    if (validTx && resultHeight == -1 && cgResult.FromScript(txout.scriptPubKey)) {
-                        if (cgResult.nEventId == (uint16_t)eventID) {
-                            resultHeight = BlocksIndex->nHeight;
-                        }
-                    }
-                    CChainGamesBet cgBet;
-                    if (CChainGamesBet::FromOpCode(OpCode, cgBet)) {
-                        if (((unsigned int)cgBet.nEventId) == eventID){
-                            totalFoundCGBets = totalFoundCGBets + 1;
-                        }
-                    }
-                }
-            }
+        // Find the latest CChainGameEvent posting and count the bets on it.
+        if (entry.nTxType == cgEventTxType) {
+            entryFee = entry.nValue / COIN;
+            gameStartTime = entry.nBlockTime;
+            gameStartBlock = entry.nHeight;
         }
+        else if (entry.nTxType == cgBetTxType) {
+            totalFoundCGBets = totalFoundCGBets + 1;
+        }
+    }
 
-        BlocksIndex = chainActive.Next(BlocksIndex);
+    // Find the first matching result transaction.
+    for (const CChainGamesPotEntry& entry : resultPot.vEntries) {
+        if (entry.nHeight >= (uint32_t)height && entry.nTxType == cgResultTxType) {
+            resultHeight = entry.nHeight;
+            break;
+        }
     }
 
     if (resultHeight > Params().BetStartHeight() && fShowWinner) {
@@ -1313,9 +1365,8 @@ UniValue geteventsliability(const UniValue& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("geteventtotals", "") + HelpExampleRpc("geteventtotals", ""));
 
-    CEventDB edb;
-    eventIndex_t eventsIndex;
-    edb.GetEvents(eventsIndex);
+    eventIndexSnapshot_t pEventsIndex = CEventDB::GetEventsSnapshot();
+    const eventIndex_t &eventsIndex = *pEventsIndex;
 
     // Check the events index actually has events,
     if (eventsIndex.size() < 1) {
@@ -1327,7 +1378,7 @@ UniValue geteventsliability(const UniValue& params, bool fHelp)
 
     UniValue ret(UniValue::VARR);
 
-    std::map<uint32_t, CPeerlessEvent>::iterator it;
+    std::map<uint32_t, CPeerlessEvent>::const_iterator it;
     for (it = eventsIndex.begin(); it != eventsIndex.end(); it++) {
 
         CPeerlessEvent plEvent = it->second;
@@ -4,6 +4,10 @@
 
 #include "wallet/wallet.h"
 
+#include "init.h"
+#include "main.h"
+#include "txmempool.h"
+
 #include <set>
 #include <stdint.h>
 #include <utility>
@@ -304,4 +308,349 @@ BOOST_AUTO_TEST_CASE(coin_selection_tests)
     empty_wallet();
 }
 
+BOOST_AUTO_TEST_CASE(available_coins_unspent_set)
+{
+    CWallet unspentWallet("wallet_unspent.dat");
+    LOCK2(cs_main, unspentWallet.cs_wallet);
+
+    CKey key;
+    key.MakeNewKey(true);
+    BOOST_CHECK(unspentWallet.AddKeyPubKey(key, key.GetPubKey()));
+    CScript scriptMine = GetScriptForDestination(key.GetPubKey().GetID());
+
+    // Only coins that are in the mempool or a block are available.
+    CMutableTransaction txFund;
+    txFund.vin.resize(1);
+    txFund.vout.push_back(CTxOut(5 * COIN, scriptMine));
+    txFund.vout.push_back(CTxOut(3 * COIN, CScript() << OP_TRUE));
+    mempool.addUnchecked(CTransaction(txFund).GetHash(), CTxMemPoolEntry(txFund, 0, 0, 0, 1));
+    BOOST_CHECK(unspentWallet.AddToWallet(CWalletTx(&unspentWallet, txFund)));
+
+    std::vector<COutput> vAvailable;
+    unspentWallet.AvailableCoins(vAvailable, false);
+    BOOST_CHECK_EQUAL(vAvailable.size(), 1U);
+    BOOST_CHECK_EQUAL(vAvailable[0].i, 0);
+
+    // Spending the coin drops it, and its change output is picked up without a rebuild.
+    CMutableTransaction txSpend;
+    txSpend.vin.push_back(CTxIn(CTransaction(txFund).GetHash(), 0));
+    txSpend.vout.push_back(CTxOut(4 * COIN, CScript() << OP_TRUE));
+    txSpend.vout.push_back(CTxOut(1 * COIN, scriptMine));
+    mempool.addUnchecked(CTransaction(txSpend).GetHash(), CTxMemPoolEntry(txSpend, 0, 0, 0, 1));
+    BOOST_CHECK(unspentWallet.AddToWallet(CWalletTx(&unspentWallet, txSpend)));
+
+    unspentWallet.AvailableCoins(vAvailable, false);
+    BOOST_CHECK_EQUAL(vAvailable.size(), 1U);
+    BOOST_CHECK(vAvailable[0].tx->GetHash() == CTransaction(txSpend).GetHash());
+    BOOST_CHECK_EQUAL(vAvailable[0].i, 1);
+
+    // A key added later makes the outputs of wallet transactions paying to it available.
+    CKey keyLater;
+    keyLater.MakeNewKey(true);
+    CMutableTransaction txLater;
+    txLater.vin.resize(1);
+    txLater.vout.push_back(CTxOut(2 * COIN, GetScriptForDestination(keyLater.GetPubKey().GetID())));
+    mempool.addUnchecked(CTransaction(txLater).GetHash(), CTxMemPoolEntry(txLater, 0, 0, 0, 1));
+    BOOST_CHECK(unspentWallet.AddToWallet(CWalletTx(&unspentWallet, txLater)));
+    unspentWallet.AvailableCoins(vAvailable, false);
+    BOOST_CHECK_EQUAL(vAvailable.size(), 1U);
+    BOOST_CHECK(unspentWallet.AddKeyPubKey(keyLater, keyLater.GetPubKey()));
+    unspentWallet.AvailableCoins(vAvailable, false);
+    BOOST_CHECK_EQUAL(vAvailable.size(), 2U);
+
+    // A coin spent only in the mempool is available again once the spend leaves it.
+    std::list<CTransaction> removed;
+    mempool.remove(txSpend, removed);
+    unspentWallet.AvailableCoins(vAvailable, false);
+    BOOST_CHECK_EQUAL(vAvailable.size(), 2U);
+    bool fFundAvailable = false;
+    for (const COutput& output : vAvailable)
+        fFundAvailable |= output.tx->GetHash() == CTransaction(txFund).GetHash() && output.i == 0;
+    BOOST_CHECK(fFundAvailable);
+
+    mempool.clear();
+}
+
+BOOST_AUTO_TEST_CASE(cached_balances)
+{
+    CWallet balanceWallet("wallet_balances.dat");
+    LOCK2(cs_main, balanceWallet.cs_wallet);
+
+    CKey key;
+    key.MakeNewKey(true);
+    BOOST_CHECK(balanceWallet.AddKeyPubKey(key, key.GetPubKey()));
+    CScript scriptMine = GetScriptForDestination(key.GetPubKey().GetID());
+
+    // A payment from someone else is unconfirmed until it is in a block.
+    CMutableTransaction txFund;
+    txFund.vin.resize(1);
+    txFund.vout.push_back(CTxOut(5 * COIN, scriptMine));
+    mempool.addUnchecked(CTransaction(txFund).GetHash(), CTxMemPoolEntry(txFund, 0, 0, 0, 1));
+    BOOST_CHECK(balanceWallet.AddToWallet(CWalletTx(&balanceWallet, txFund)));
+    BOOST_CHECK_EQUAL(balanceWallet.GetBalance(), 0);
+    BOOST_CHECK_EQUAL(balanceWallet.GetUnconfirmedBalance(), 5 * COIN);
+
+    // Our own change is trusted, and the spent payment leaves the balances.
+    CMutableTransaction txSpend;
+    txSpend.vin.push_back(CTxIn(CTransaction(txFund).GetHash(), 0));
+    txSpend.vout.push_back(CTxOut(4 * COIN, CScript() << OP_TRUE));
+    txSpend.vout.push_back(CTxOut(1 * COIN, scriptMine));
+    mempool.addUnchecked(CTransaction(txSpend).GetHash(), CTxMemPoolEntry(txSpend, 0, 0, 0, 1));
+    BOOST_CHECK(balanceWallet.AddToWallet(CWalletTx(&balanceWallet, txSpend)));
+    BOOST_CHECK_EQUAL(balanceWallet.GetBalance(), 1 * COIN);
+    BOOST_CHECK_EQUAL(balanceWallet.GetUnconfirmedBalance(), 0);
+
+    // When the spend leaves the mempool the payment is unspent again.
+    std::list<CTransaction> removed;
+    mempool.remove(txSpend, removed);
+    BOOST_CHECK_EQUAL(balanceWallet.GetBalance(), 0);
+    BOOST_CHECK_EQUAL(balanceWallet.GetUnconfirmedBalance(), 5 * COIN);
+
+    mempool.clear();
+}
+
+/**
+ * Writes a proof of stake block paying to scriptPubKey after pindexPrev and indexes it, so a rescan
+ * can read it back. The block is not made the tip.
+ */
+static CBlockIndex* AppendRescanBlock(CBlockIndex* pindexPrev, const CScript& scriptPubKey, CDiskBlockPos& posNext)
+{
+    int nHeight = pindexPrev->nHeight + 1;
+
+    CMutableTransaction txCoinBase;
+    txCoinBase.vin.resize(1);
+    txCoinBase.vin[0].prevout.SetNull();
+    txCoinBase.vin[0].scriptSig = CScript() << nHeight << OP_0;
+    txCoinBase.vout.resize(1);
+    txCoinBase.vout[0].SetEmpty();
+
+    CMutableTransaction txCoinStake;
+    txCoinStake.vin.resize(1);
+    txCoinStake.vin[0].prevout = COutPoint(pindexPrev->GetBlockHash(), 0);
+    txCoinStake.vout.resize(2);
+    txCoinStake.vout[0].SetEmpty();
+    txCoinStake.vout[1] = CTxOut(1 * COIN, CScript() << OP_TRUE);
+
+    CMutableTransaction txPayment;
+    txPayment.vin.resize(1);
+    txPayment.vin[0].prevout = COutPoint(pindexPrev->GetBlockHash(), 1);
+    txPayment.vout.push_back(CTxOut(1 * COIN, scriptPubKey));
+
+    CBlock block;
+    block.nVersion = 4;
+    block.hashPrevBlock = pindexPrev->GetBlockHash();
+    block.nTime = GetTime();
+    block.vtx.push_back(txCoinBase);
+    block.vtx.push_back(txCoinStake);
+    block.vtx.push_back(txPayment);
+    block.hashMerkleRoot = block.BuildMerkleTree();
+
+    CDiskBlockPos pos = posNext;
+    BOOST_REQUIRE(WriteBlockToDisk(block, pos));
+    posNext.nPos = pos.nPos + ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+
+    CBlockIndex* pindex = new CBlockIndex(block);
+    BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(block.GetHash(), pindex)).first;
+    pindex->phashBlock = &mi->first;
+    pindex->pprev = pindexPrev;
+    pindex->nHeight = nHeight;
+    pindex->nFile = pos.nFile;
+    pindex->nDataPos = pos.nPos;
+    pindex->nStatus |= BLOCK_HAVE_DATA;
+    return pindex;
+}
+
+BOOST_AUTO_TEST_CASE(rescan_batches)
+{
+    CWallet rescanWallet("wallet_rescan.dat");
+    CWallet forkWallet("wallet_rescan_fork.dat");
+    LOCK(cs_main);
+
+    CKey key;
+    key.MakeNewKey(true);
+    CScript scriptMine = GetScriptForDestination(key.GetPubKey().GetID());
+    {
+        LOCK2(rescanWallet.cs_wallet, forkWallet.cs_wallet);
+        BOOST_CHECK(rescanWallet.AddKeyPubKey(key, key.GetPubKey()));
+        BOOST_CHECK(forkWallet.AddKeyPubKey(key, key.GetPubKey()));
+    }
+
+    // A chain several rescan batches long, every seventh block paying to the wallet.
+    CDiskBlockPos posNext(1, 0);
+    std::set<uint256> setPayments;
+    int nPaymentsAfterFork = 0;
+    for (int i = 1; i <= 500; i++) {
+        CBlockIndex* pindex = AppendRescanBlock(chainActive.Tip(), i % 7 ? CScript() << OP_TRUE : scriptMine, posNext);
+        chainActive.SetTip(pindex);
+        if (i % 7 == 0) {
+            setPayments.insert(pindex->GetBlockHash());
+            nPaymentsAfterFork += i > 100;
+        }
+    }
+
+    BOOST_CHECK_EQUAL(rescanWallet.ScanForWalletTransactions(chainActive.Genesis(), true), (int)setPayments.size());
+    {
+        LOCK(rescanWallet.cs_wallet);
+        BOOST_CHECK_EQUAL(rescanWallet.mapWallet.size(), setPayments.size());
+        for (const std::pair<const uint256, CWalletTx>& item : rescanWallet.mapWallet)
+            BOOST_CHECK(setPayments.count(item.second.hashBlock));
+    }
+
+    // A rescan starting on a block that left the active chain resumes after the fork rather than stopping.
+    CBlockIndex* pindexStale = AppendRescanBlock(chainActive[100], scriptMine, posNext);
+    BOOST_CHECK_EQUAL(forkWallet.ScanForWalletTransactions(pindexStale, true), nPaymentsAfterFork);
+    {
+        LOCK(forkWallet.cs_wallet);
+        for (const std::pair<const uint256, CWalletTx>& item : forkWallet.mapWallet) {
+            BOOST_CHECK(item.second.hashBlock != pindexStale->GetBlockHash());
+            BOOST_CHECK(mapBlockIndex[item.second.hashBlock]->nHeight > 100);
+        }
+    }
+}
+
+static CoinWitnessCacheData PrecomputeData(int nHeightAccEnd)
+{
+    CoinWitnessCacheData data;
+    data.nHeightAccEnd = nHeightAccEnd;
+    return data;
+}
+
+BOOST_AUTO_TEST_CASE(precompute_cache)
+{
+    const std::string strFile = "precomputes_test.dat";
+    CoinWitnessCacheData data;
+    {
+        CPrecomputeCache cache(strFile);
+
+        // The least recently advanced witnesses are dropped over the size limit
+        for (int i = 1; i <= PRECOMPUTE_LRU_CACHE_SIZE + 5; i++)
+            cache.Put(uint256(i), PrecomputeData(i));
+        BOOST_CHECK_EQUAL(cache.Size(), (size_t)PRECOMPUTE_LRU_CACHE_SIZE);
+        BOOST_CHECK(!cache.Contains(uint256(5)));
+        BOOST_CHECK(cache.Contains(uint256(6)));
+        BOOST_CHECK(cache.GetHashes().front() == uint256(PRECOMPUTE_LRU_CACHE_SIZE + 5));
+        BOOST_CHECK(cache.GetHashes().back() == uint256(6));
+
+        // Advancing a witness again makes it the most recent one
+        cache.Put(uint256(6), PrecomputeData(1006));
+        BOOST_CHECK(cache.GetHashes().front() == uint256(6));
+        cache.Put(uint256(PRECOMPUTE_LRU_CACHE_SIZE + 6), PrecomputeData(0));
+        BOOST_CHECK(cache.Contains(uint256(6)));
+        BOOST_CHECK(!cache.Contains(uint256(7)));
+        BOOST_CHECK(cache.Get(uint256(6), data));
+        BOOST_CHECK_EQUAL(data.nHeightAccEnd, 1006);
+
+        // Too many unwritten witnesses ask for a flush, which writes them all
+        BOOST_CHECK(cache.DirtySize() > (size_t)PRECOMPUTE_MAX_DIRTY_CACHE_SIZE);
+        BOOST_CHECK(cache.NeedsFlush());
+        cache.Flush();
+        BOOST_CHECK_EQUAL(cache.DirtySize(), 0U);
+        BOOST_CHECK(!cache.NeedsFlush());
+
+        // So does an unwritten witness older than the flush time
+        cache.Put(uint256(8), PrecomputeData(2008));
+        BOOST_CHECK(!cache.NeedsFlush());
+        SetMockTime(GetTime() + PRECOMPUTE_FLUSH_TIME + 1);
+        BOOST_CHECK(cache.NeedsFlush());
+        cache.Flush();
+        SetMockTime(0);
+
+        // Removed witnesses leave the database, cleared ones stay in it
+        cache.Remove(uint256(9));
+        std::set<uint256> setActive = {uint256(6), uint256(8), uint256(10)};
+        cache.RemoveInactive(setActive);
+        BOOST_CHECK_EQUAL(cache.Size(), setActive.size());
+        cache.Clear();
+        BOOST_CHECK_EQUAL(cache.Size(), 0U);
+    }
+    {
+        CPrecomputeCache cache(strFile);
+        cache.Load();
+        BOOST_CHECK_EQUAL(cache.Size(), 3U);
+        BOOST_CHECK(cache.Get(uint256(6), data));
+        BOOST_CHECK_EQUAL(data.nHeightAccEnd, 1006);
+        BOOST_CHECK(cache.Get(uint256(8), data));
+        BOOST_CHECK_EQUAL(data.nHeightAccEnd, 2008);
+        BOOST_CHECK(!cache.Contains(uint256(9)));
+
+        // Witnesses advanced when the thread is interrupted are written as the cache unwinds
+        try {
+            CPrecomputeCache cacheInterrupted(strFile);
+            cacheInterrupted.Put(uint256(11), PrecomputeData(3011));
+            throw boost::thread_interrupted();
+        } catch (const boost::thread_interrupted&) {
+        }
+    }
+    CPrecomputeCache cache(strFile);
+    cache.Load();
+    BOOST_CHECK(cache.Get(uint256(11), data));
+    BOOST_CHECK_EQUAL(data.nHeightAccEnd, 3011);
+}
+
+BOOST_AUTO_TEST_CASE(precompute_thread)
+{
+    // A connected block wakes the precompute thread
+    uint64_t nSeen = pwalletMain->blockTipNotifier.GetCount();
+    BOOST_CHECK(!pwalletMain->blockTipNotifier.Wait(nSeen, 10));
+    GetMainSignals().UpdatedBlockTip(chainActive.Tip());
+    BOOST_CHECK(pwalletMain->blockTipNotifier.Wait(nSeen, 1000));
+    BOOST_CHECK_EQUAL(nSeen, pwalletMain->blockTipNotifier.GetCount());
+
+    // Once caught up the thread sleeps until the next block, and leaves when interrupted
+    CWallet precomputeWallet("wallet_precompute.dat");
+    precomputeWallet.setZWallet(new CzWGRWallet(precomputeWallet.strWalletFile));
+    boost::thread thread(boost::bind(&CWallet::PrecomputeSpends, &precomputeWallet));
+    MilliSleep(500);
+    precomputeWallet.blockTipNotifier.Notify();
+    MilliSleep(100);
+    thread.interrupt();
+    BOOST_CHECK(thread.timed_join(boost::posix_time::seconds(10)));
+    delete precomputeWallet.getZWallet();
+}
+
+static void WaitForStakeNotification(CWallet* pwallet, uint64_t nSeen, bool* pfNotified)
+{
+    *pfNotified = pwallet->stakeNotifier.Wait(nSeen, 10 * 1000);
+}
+
+BOOST_AUTO_TEST_CASE(stake_notifier)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    {
+        LOCK(pwalletMain->cs_wallet);
+        BOOST_CHECK(pwalletMain->AddKeyPubKey(key, key.GetPubKey()));
+    }
+
+    // A new tip wakes a sleeping staker
+    uint64_t nSeen = pwalletMain->stakeNotifier.GetCount();
+    bool fNotified = false;
+    boost::thread thread(boost::bind(&WaitForStakeNotification, pwalletMain, nSeen, &fNotified));
+    MilliSleep(100);
+    GetMainSignals().UpdatedBlockTip(chainActive.Tip());
+    BOOST_CHECK(thread.timed_join(boost::posix_time::seconds(5)));
+    BOOST_CHECK(fNotified);
+    BOOST_CHECK(pwalletMain->stakeNotifier.Wait(nSeen, 10));
+
+    // A transaction that does not involve the wallet does not
+    CMutableTransaction txOther;
+    txOther.vin.push_back(CTxIn(uint256(1), 0));
+    txOther.vout.push_back(CTxOut(1 * COIN, CScript() << OP_TRUE));
+    SyncWithWallets(txOther, NULL);
+    BOOST_CHECK(!pwalletMain->stakeNotifier.Wait(nSeen, 10));
+
+    // A payment to the wallet does
+    CMutableTransaction txMine;
+    txMine.vin.push_back(CTxIn(uint256(2), 0));
+    txMine.vout.push_back(CTxOut(1 * COIN, GetScriptForDestination(key.GetPubKey().GetID())));
+    fNotified = false;
+    boost::thread threadTx(boost::bind(&WaitForStakeNotification, pwalletMain, nSeen, &fNotified));
+    MilliSleep(100);
+    SyncWithWallets(txMine, NULL);
+    BOOST_CHECK(threadTx.timed_join(boost::posix_time::seconds(5)));
+    BOOST_CHECK(fNotified);
+    BOOST_CHECK(pwalletMain->stakeNotifier.Wait(nSeen, 10));
+    BOOST_CHECK_EQUAL(nSeen, pwalletMain->stakeNotifier.GetCount());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -11,7 +11,9 @@
 #include "zwgr/accumulators.h"
 #include "base58.h"
 #include "checkpoints.h"
+#include "checkqueue.h"
 #include "coincontrol.h"
+#include "crypto/common.h"
 #include "kernel.h"
 #include "masternode-budget.h"
 #include "net.h"
@@ -36,6 +38,7 @@
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
+#include <boost/unordered_set.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <zwgr/witness.h>
@@ -132,6 +135,7 @@ bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey& pubkey)
     AssertLockHeld(cs_wallet); // mapKeyMetadata
     if (!CCryptoKeyStore::AddKeyPubKey(secret, pubkey))
         return false;
+    MarkUnspentTxsDirty();
 
     // check if we need to remove from watch-only
     CScript script;
@@ -185,6 +189,7 @@ bool CWallet::AddCScript(const CScript& redeemScript)
 {
     if (!CCryptoKeyStore::AddCScript(redeemScript))
         return false;
+    MarkUnspentTxsDirty();
     if (!fFileBacked)
         return true;
     return CWalletDB(strWalletFile).WriteCScript(Hash160(redeemScript), redeemScript);
@@ -209,6 +214,7 @@ bool CWallet::AddWatchOnly(const CScript& dest)
 {
     if (!CCryptoKeyStore::AddWatchOnly(dest))
         return false;
+    MarkUnspentTxsDirty();
     nTimeFirstKey = 1; // No birthday information for watch-only keys.
     NotifyWatchonlyChanged(true);
     if (!fFileBacked)
@@ -239,6 +245,7 @@ bool CWallet::AddMultiSig(const CScript& dest)
 {
     if (!CCryptoKeyStore::AddMultiSig(dest))
         return false;
+    MarkUnspentTxsDirty();
     nTimeFirstKey = 1; // No birthday information
     NotifyMultiSigChanged(true);
     if (!fFileBacked)
@@ -459,6 +466,63 @@ bool CWallet::IsSpent(const uint256& hash, unsigned int n) const
     return false;
 }
 
+/**
+ * Outpoint is spent in the main chain if a wallet transaction in
+ * a block spends it. Unlike IsSpent(), a spend that is only in the
+ * mempool doesn't count: the output is unspent again when the spend
+ * leaves the mempool, which the wallet is not told about.
+ */
+bool CWallet::IsSpentInMainChain(const uint256& hash, unsigned int n) const
+{
+    const COutPoint outpoint(hash, n);
+    std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range;
+    range = mapTxSpends.equal_range(outpoint);
+    for (TxSpends::const_iterator it = range.first; it != range.second; ++it) {
+        std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(it->second);
+        if (mit != mapWallet.end() && mit->second.GetDepthInMainChain(false) > 0)
+            return true;
+    }
+    return false;
+}
+
+void CWallet::UpdateUnspentTx(const uint256& wtxid) const
+{
+    AssertLockHeld(cs_wallet);
+    std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(wtxid);
+    if (it != mapWallet.end()) {
+        const CWalletTx& wtx = it->second;
+        for (unsigned int i = 0; i < wtx.vout.size(); i++) {
+            if (IsMine(wtx.vout[i]) == ISMINE_NO)
+                continue;
+
+            if (!IsSpentInMainChain(wtxid, i)) {
+                setUnspentTxs.insert(wtxid);
+                return;
+            }
+        }
+    }
+    setUnspentTxs.erase(wtxid);
+}
+
+void CWallet::SyncUnspentTxs() const
+{
+    AssertLockHeld(cs_wallet);
+    if (!fUnspentTxsDirty)
+        return;
+
+    setUnspentTxs.clear();
+    for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        UpdateUnspentTx(it->first);
+    fUnspentTxsDirty = false;
+    MarkBalancesDirty();
+}
+
+void CWallet::MarkUnspentTxsDirty()
+{
+    LOCK(cs_wallet);
+    fUnspentTxsDirty = true;
+}
+
 void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends.insert(std::make_pair(outpoint, wtxid));
@@ -663,6 +727,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet)
         wtx.BindWallet(this);
         wtxOrdered.insert(std::make_pair(wtx.nOrderPos, TxPair(&wtx, (CAccountingEntry*)0)));
         AddToSpends(hash);
+        fUnspentTxsDirty = true;
     } else {
         LOCK(cs_wallet);
         // Inserts only if not already there, returns tx inserted or tx found
@@ -708,6 +773,15 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet)
         // Break debit/credit balance caches:
         wtx.MarkDirty();
 
+        // The transaction may have outputs of ours, and may spend some.
+        if (!fUnspentTxsDirty) {
+            UpdateUnspentTx(hash);
+            if (!wtx.IsCoinBase()) {
+                for (const CTxIn& txin : wtx.vin)
+                    UpdateUnspentTx(txin.prevout.hash);
+            }
+        }
+
         // Notify UI of new or updated transaction
         NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
 
@@ -747,9 +821,19 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pbl
 void CWallet::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
 {
     LOCK2(cs_main, cs_wallet);
+
+    // A transaction of ours that was in a block and comes without one has had its block
+    // disconnected, and the outputs it spends may no longer be spent.
+    std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(tx.GetHash());
+    if (!pblock && mi != mapWallet.end() && mi->second.hashBlock != 0)
+        fUnspentTxsDirty = true;
+
     if (!AddToWalletIfInvolvingMe(tx, pblock, true))
         return; // Not one of ours
 
+    // Coins may have been added or spent that change what can be staked
+    stakeNotifier.Notify();
+
     // If a transaction changes 'conflicted' state, that changes the balance
     // available of the outputs it spends. So force those to be
     // recomputed, also:
@@ -759,14 +843,22 @@ void CWallet::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
     }
 }
 
+void CWallet::UpdatedBlockTip(const CBlockIndex* pindex)
+{
+    blockTipNotifier.Notify();
+    stakeNotifier.Notify();
+}
+
 void CWallet::EraseFromWallet(const uint256& hash)
 {
     if (!fFileBacked)
         return;
     {
         LOCK(cs_wallet);
-        if (mapWallet.erase(hash))
+        if (mapWallet.erase(hash)) {
             CWalletDB(strWalletFile).EraseTx(hash);
+            fUnspentTxsDirty = true;
+        }
     }
     return;
 }
@@ -1221,10 +1313,184 @@ bool CWalletTx::WriteToDisk()
     return CWalletDB(pwallet->strWalletFile).WriteTx(GetHash(), *this);
 }
 
+/** The number of blocks each rescan thread reads and filters at a time. */
+static const int RESCAN_BLOCKS_PER_THREAD = 16;
+
+struct CWalletScanIdHasher
+{
+    size_t operator()(const uint160& id) const
+    {
+        return ReadLE64(id.begin());
+    }
+};
+
+/**
+ * The key IDs, script IDs and scripts of a wallet, copied once at the start of a rescan so that
+ * blocks can be filtered on several threads without the keystore lock. Every output IsMine()
+ * accepts pays to one of them, so a transaction with no matching output is only the wallet's if
+ * it spends one of the wallet's transactions, which is checked when the block is committed.
+ */
+class CWalletScanFilter
+{
+public:
+    boost::unordered_set<uint160, CWalletScanIdHasher> setIds;
+    std::set<CScript> setScripts;
+
+    bool IsRelevant(const CTxOut& txout) const
+    {
+        if (setScripts.count(txout.scriptPubKey))
+            return true;
+
+        std::vector<std::vector<unsigned char> > vSolutions;
+        txnouttype whichType;
+        if (!Solver(txout.scriptPubKey, whichType, vSolutions))
+            return false;
+
+        for (const std::vector<unsigned char>& vSolution : vSolutions) {
+            if (vSolution.size() == 20 && setIds.count(uint160(vSolution)))
+                return true;
+            if (vSolution.size() > 20 && setIds.count(Hash160(vSolution)))
+                return true;
+        }
+        return false;
+    }
+};
+
+/** A block of a rescan, read and filtered by a reader thread and then committed in chain order. */
+struct CWalletScanBlock
+{
+    CBlockIndex* pindex;
+    CDiskBlockPos pos;
+    uint256 hashBlock;
+    bool fRead;
+    CBlock block;
+    std::vector<bool> vRelevant;    // Whether each transaction has an output the filter matches.
+
+    CWalletScanBlock(CBlockIndex* pindexIn) : pindex(pindexIn), pos(pindexIn->GetBlockPos()), hashBlock(pindexIn->GetBlockHash()), fRead(false) {}
+};
+
+/**
+ * Read and filter a block of a rescan. Takes no locks.
+ *
+ * @param scanBlock The block.
+ * @param filter    The wallet's scan filter.
+ */
+static void ReadWalletScanBlock(CWalletScanBlock& scanBlock, const CWalletScanFilter& filter)
+{
+    if (!ReadBlockFromDisk(scanBlock.block, scanBlock.pos) || scanBlock.block.GetHash() != scanBlock.hashBlock)
+        return;
+
+    scanBlock.vRelevant.resize(scanBlock.block.vtx.size());
+    for (size_t j = 0; j < scanBlock.block.vtx.size(); j++) {
+        for (const CTxOut& txout : scanBlock.block.vtx[j].vout) {
+            if (filter.IsRelevant(txout)) {
+                scanBlock.vRelevant[j] = true;
+                break;
+            }
+        }
+    }
+    scanBlock.fRead = true;
+}
+
+/** Reads a block of a rescan on a worker thread. A block that can't be read is left with fRead unset. */
+class CWalletScanCheck
+{
+private:
+    CWalletScanBlock* pScanBlock;
+    const CWalletScanFilter* pFilter;
+
+public:
+    CWalletScanCheck() : pScanBlock(NULL), pFilter(NULL) {}
+    CWalletScanCheck(CWalletScanBlock& scanBlockIn, const CWalletScanFilter& filterIn) : pScanBlock(&scanBlockIn), pFilter(&filterIn) {}
+
+    bool operator()()
+    {
+        ReadWalletScanBlock(*pScanBlock, *pFilter);
+        return true;
+    }
+
+    void swap(CWalletScanCheck& check)
+    {
+        std::swap(pScanBlock, check.pScanBlock);
+        std::swap(pFilter, check.pFilter);
+    }
+};
+
+static CCheckQueue<CWalletScanCheck> walletscanqueue(RESCAN_BLOCKS_PER_THREAD);
+
+/** Held by the rescan using walletscanqueue, as a queue has one master at a time. */
+static CCriticalSection cs_walletscanqueue;
+
+void ThreadWalletScan()
+{
+    RenameThread("wagerr-walletscan");
+    walletscanqueue.Thread();
+}
+
+/**
+ * Queue the blocks of a rescan batch on the worker threads, to be waited for with the control.
+ *
+ * @param control The control of walletscanqueue.
+ * @param vBlocks The batch, not to be changed until the control has waited.
+ * @param filter  The wallet's scan filter.
+ */
+static void QueueWalletScanBatch(CCheckQueueControl<CWalletScanCheck>& control, std::vector<CWalletScanBlock>& vBlocks, const CWalletScanFilter& filter)
+{
+    std::vector<CWalletScanCheck> vChecks;
+    vChecks.reserve(vBlocks.size());
+    for (CWalletScanBlock& scanBlock : vBlocks)
+        vChecks.push_back(CWalletScanCheck(scanBlock, filter));
+    control.Add(vChecks);
+}
+
+/**
+ * Read and filter a rescan batch, on the worker threads of the queue if one is given.
+ *
+ * @param pqueue  The queue to read the blocks on, NULL to read them on this thread.
+ * @param vBlocks The batch.
+ * @param filter  The wallet's scan filter.
+ */
+static void ReadWalletScanBatch(CCheckQueue<CWalletScanCheck>* pqueue, std::vector<CWalletScanBlock>& vBlocks, const CWalletScanFilter& filter)
+{
+    CCheckQueueControl<CWalletScanCheck> control(pqueue);
+    if (pqueue) {
+        QueueWalletScanBatch(control, vBlocks, filter);
+    } else {
+        for (CWalletScanBlock& scanBlock : vBlocks)
+            ReadWalletScanBlock(scanBlock, filter);
+    }
+    control.Wait();
+}
+
+/**
+ * Take the next blocks of a rescan from the active chain. When the first block has left the
+ * active chain the batch starts after the fork instead.
+ *
+ * @param pindex  The first block, NULL when the rescan is done.
+ * @param nBlocks The most blocks to take.
+ * @param vBlocks The batch.
+ * @return        The block after the batch.
+ */
+static CBlockIndex* GetWalletScanBatch(CBlockIndex* pindex, int nBlocks, std::vector<CWalletScanBlock>& vBlocks)
+{
+    LOCK(cs_main);
+    vBlocks.clear();
+    if (pindex && !chainActive.Contains(pindex))
+        pindex = chainActive.Next(chainActive.FindFork(pindex));
+    for (; pindex && (int)vBlocks.size() < nBlocks; pindex = chainActive.Next(pindex))
+        vBlocks.push_back(CWalletScanBlock(pindex));
+    return pindex;
+}
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
- * exist in the wallet will be updated.
+ * exist in the wallet will be updated. Blocks are read and matched
+ * against the wallet's keys and scripts on the worker threads a batch
+ * ahead, and added to the wallet in chain order with cs_main and
+ * cs_wallet held for one block at a time. A block that has left the
+ * active chain by then is not added, and the rescan resumes after the
+ * fork.
  */
 int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
 {
@@ -1235,6 +1501,8 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
         zwgrTracker->Init();
 
     CBlockIndex* pindex = pindexStart;
+    CWalletScanFilter filter;
+    double dProgressStart, dProgressTip;
     {
         LOCK2(cs_main, cs_wallet);
 
@@ -1243,30 +1511,75 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
         while (pindex && nTimeFirstKey && (pindex->GetBlockTime() < (nTimeFirstKey - 7200)) && pindex->nHeight <= Params().Zerocoin_StartHeight())
             pindex = chainActive.Next(pindex);
 
+        std::set<CKeyID> setKeys;
+        GetKeys(setKeys);
+        for (const CKeyID& keyID : setKeys)
+            filter.setIds.insert(keyID);
+        for (const auto& script : mapScripts)
+            filter.setIds.insert(script.first);
+        filter.setScripts.insert(setWatchOnly.begin(), setWatchOnly.end());
+        filter.setScripts.insert(setMultiSig.begin(), setMultiSig.end());
+
         ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
-        double dProgressStart = Checkpoints::GuessVerificationProgress(pindex, false);
-        double dProgressTip = Checkpoints::GuessVerificationProgress(chainActive.Tip(), false);
-        std::set<uint256> setAddedToWallet;
-        while (pindex) {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
-
-            CBlock block;
-            ReadBlockFromDisk(block, pindex);
-            for (CTransaction& tx : block.vtx) {
-                if (AddToWalletIfInvolvingMe(tx, &block, fUpdate))
+        dProgressStart = Checkpoints::GuessVerificationProgress(pindex, false);
+        dProgressTip = Checkpoints::GuessVerificationProgress(chainActive.Tip(), false);
+    }
+
+    // Only one rescan at a time reads on the worker threads, any other reads on its own thread.
+    TRY_LOCK(cs_walletscanqueue, lockQueue);
+    CCheckQueue<CWalletScanCheck>* pqueue = (nScriptCheckThreads && lockQueue) ? &walletscanqueue : NULL;
+    int nBatchBlocks = std::max(1, nScriptCheckThreads) * RESCAN_BLOCKS_PER_THREAD;
+
+    std::vector<CWalletScanBlock> vBlocks, vNextBlocks;
+    pindex = GetWalletScanBatch(pindex, nBatchBlocks, vBlocks);
+    ReadWalletScanBatch(pqueue, vBlocks, filter);
+
+    std::set<uint256> setAddedToWallet;
+    while (!vBlocks.empty()) {
+        // Read the next batch while this one is added to the wallet.
+        pindex = GetWalletScanBatch(pindex, nBatchBlocks, vNextBlocks);
+        CCheckQueueControl<CWalletScanCheck> control(pqueue);
+        if (pqueue)
+            QueueWalletScanBatch(control, vNextBlocks, filter);
+
+        CBlockIndex* pindexStale = NULL;
+        for (CWalletScanBlock& scanBlock : vBlocks) {
+            CBlockIndex* pindexBlock = scanBlock.pindex;
+            if (pindexBlock->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
+                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(pindexBlock, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+
+            LOCK2(cs_main, cs_wallet);
+            if (!chainActive.Contains(pindexBlock)) {
+                pindexStale = pindexBlock;
+                break;
+            }
+
+            if (!scanBlock.fRead) {
+                LogPrintf("%s: failed to read block %s\n", __func__, scanBlock.hashBlock.GetHex());
+                continue;
+            }
+            const CBlock& block = scanBlock.block;
+
+            for (size_t i = 0; i < block.vtx.size(); i++) {
+                const CTransaction& tx = block.vtx[i];
+
+                // Only transactions paying to the wallet, spending from it or already in it can be the wallet's.
+                bool fRelevant = scanBlock.vRelevant[i] || mapWallet.count(tx.GetHash());
+                for (unsigned int j = 0; !fRelevant && j < tx.vin.size(); j++)
+                    fRelevant = mapWallet.count(tx.vin[j].prevout.hash);
+                if (fRelevant && AddToWalletIfInvolvingMe(tx, &block, fUpdate))
                     ret++;
             }
 
             //If this is a zapwallettx, need to readd zwgr
-            if (fCheckZWGR && pindex->nHeight >= Params().Zerocoin_StartHeight()) {
+            if (fCheckZWGR && pindexBlock->nHeight >= Params().Zerocoin_StartHeight()) {
                 std::list<CZerocoinMint> listMints;
                 BlockToZerocoinMintList(block, listMints, true);
 
                 for (auto& m : listMints) {
                     if (IsMyMint(m.GetValue())) {
                         LogPrint("zero", "%s: found mint\n", __func__);
-                        pwalletMain->UpdateMint(m.GetValue(), pindex->nHeight, m.GetTxHash(), m.GetDenomination());
+                        pwalletMain->UpdateMint(m.GetValue(), pindexBlock->nHeight, m.GetTxHash(), m.GetDenomination());
 
                         // Add the transaction to the wallet
                         for (auto& tx : block.vtx) {
@@ -1304,14 +1617,24 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
                 }
             }
 
-            pindex = chainActive.Next(pindex);
             if (GetTime() >= nNow + 60) {
                 nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, Checkpoints::GuessVerificationProgress(pindex));
+                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindexBlock->nHeight, Checkpoints::GuessVerificationProgress(pindexBlock));
             }
         }
-        ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
+
+        control.Wait();
+        if (pindexStale) {
+            // The next batch follows the block that left the active chain, so it is taken again after the fork.
+            LogPrintf("%s: block %s left the active chain, resuming after the fork\n", __func__, pindexStale->GetBlockHash().GetHex());
+            pindex = GetWalletScanBatch(pindexStale, nBatchBlocks, vNextBlocks);
+            ReadWalletScanBatch(pqueue, vNextBlocks, filter);
+        } else if (!pqueue) {
+            ReadWalletScanBatch(NULL, vNextBlocks, filter);
+        }
+        vBlocks.swap(vNextBlocks);
     }
+    ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
     return ret;
 }
 
@@ -1416,20 +1739,61 @@ void CWallet::ResendWalletTransactions()
  * @{
  */
 
-CAmount CWallet::GetBalance() const
+const CWallet::CWalletBalances& CWallet::GetBalances() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    // Every balance is made of outputs of ours that are not spent, so only the
+    // transactions in setUnspentTxs need to be looked at.
+    SyncUnspentTxs();
+
+    const uint256 hashTip = chainActive.Tip() ? chainActive.Tip()->GetBlockHash() : uint256(0);
+    const unsigned int nMempoolUpdated = mempool.GetTransactionsUpdated();
+    if (fBalancesCached && hashBalancesTip == hashTip && nBalancesMempoolUpdated == nMempoolUpdated &&
+        nBalancesTXLocks == nCompleteTXLocks && nBalancesCachedGeneration == nBalancesGeneration)
+        return cachedBalances;
+
+    // Sum them all again: the cache is not updated per transaction
+    CWalletBalances balances = {};
+    for (const uint256& wtxid : setUnspentTxs) {
+        std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(wtxid);
+        if (it == mapWallet.end())
+            continue;
+        const CWalletTx* pcoin = &(*it).second;
 
-            if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAvailableCredit();
+        const bool fTrusted = pcoin->IsTrusted();
+        const int nDepth = pcoin->GetDepthInMainChain();
+        if (fTrusted) {
+            balances.nBalance += pcoin->GetAvailableCredit();
+            balances.nWatchOnly += pcoin->GetAvailableWatchOnlyCredit();
         }
+        if (fTrusted && nDepth > 0) {
+            balances.nLocked += pcoin->GetLockedCredit();
+            balances.nUnlocked += pcoin->GetUnlockedCredit();
+            balances.nLockedWatchOnly += pcoin->GetLockedWatchOnlyCredit();
+        }
+        if (!IsFinalTx(*pcoin) || (!fTrusted && nDepth == 0)) {
+            balances.nUnconfirmed += pcoin->GetAvailableCredit();
+            balances.nUnconfirmedWatchOnly += pcoin->GetAvailableWatchOnlyCredit();
+        }
+        balances.nImmature += pcoin->GetImmatureCredit();
+        balances.nImmatureWatchOnly += pcoin->GetImmatureWatchOnlyCredit();
     }
 
-    return nTotal;
+    cachedBalances = balances;
+    fBalancesCached = true;
+    hashBalancesTip = hashTip;
+    nBalancesMempoolUpdated = nMempoolUpdated;
+    nBalancesTXLocks = nCompleteTXLocks;
+    nBalancesCachedGeneration = nBalancesGeneration;
+    return cachedBalances;
+}
+
+CAmount CWallet::GetBalance() const
+{
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().nBalance;
 }
 
 //std::map<libzerocoin::CoinDenomination, int> mapMintMaturity;
@@ -1473,36 +1837,16 @@ CAmount CWallet::GetUnlockedCoins() const
 {
     if (fLiteMode) return 0;
 
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-
-            if (pcoin->IsTrusted() && pcoin->GetDepthInMainChain() > 0)
-                nTotal += pcoin->GetUnlockedCredit();
-        }
-    }
-
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().nUnlocked;
 }
 
 CAmount CWallet::GetLockedCoins() const
 {
     if (fLiteMode) return 0;
 
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-
-            if (pcoin->IsTrusted() && pcoin->GetDepthInMainChain() > 0)
-                nTotal += pcoin->GetLockedCredit();
-        }
-    }
-
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().nLocked;
 }
 
 // Get a Map pairing the Denominations with the amount of Zerocoin for each Denomination
@@ -1522,85 +1866,38 @@ std::map<libzerocoin::CoinDenomination, CAmount> CWallet::GetMyZerocoinDistribut
 
 CAmount CWallet::GetUnconfirmedBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!IsFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
-                nTotal += pcoin->GetAvailableCredit();
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().nUnconfirmed;
 }
 
 CAmount CWallet::GetImmatureBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            nTotal += pcoin->GetImmatureCredit();
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().nImmature;
 }
 
 CAmount CWallet::GetWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted())
-                nTotal += pcoin->GetAvailableWatchOnlyCredit();
-        }
-    }
-
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().nWatchOnly;
 }
 
 CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!IsFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
-                nTotal += pcoin->GetAvailableWatchOnlyCredit();
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().nUnconfirmedWatchOnly;
 }
 
 CAmount CWallet::GetImmatureWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            nTotal += pcoin->GetImmatureWatchOnlyCredit();
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().nImmatureWatchOnly;
 }
 
 CAmount CWallet::GetLockedWatchOnlyBalance() const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted() && pcoin->GetDepthInMainChain() > 0)
-                nTotal += pcoin->GetLockedWatchOnlyCredit();
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().nLockedWatchOnly;
 }
 
 /**
@@ -1619,7 +1916,11 @@ void CWallet::AvailableCoins(
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
+        SyncUnspentTxs();
+        for (std::set<uint256>::const_iterator itUnspent = setUnspentTxs.begin(); itUnspent != setUnspentTxs.end(); ++itUnspent) {
+            std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(*itUnspent);
+            if (it == mapWallet.end())
+                continue;
             const uint256& wtxid = it->first;
             const CWalletTx* pcoin = &(*it).second;
 
@@ -2355,7 +2656,6 @@ bool CWallet::CreateCoinStake(
 
     if (listInputs.empty()) {
         LogPrint("staking", "CreateCoinStake(): listInputs empty\n");
-        MilliSleep(50000);
         return false;
     }
 
@@ -2990,18 +3290,21 @@ void CWallet::LockCoin(COutPoint& output)
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.insert(output);
+    MarkBalancesDirty();
 }
 
 void CWallet::UnlockCoin(COutPoint& output)
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.erase(output);
+    MarkBalancesDirty();
 }
 
 void CWallet::UnlockAllCoins()
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.clear();
+    MarkBalancesDirty();
 }
 
 bool CWallet::IsLockedCoin(uint256 hash, unsigned int n) const
@@ -3889,6 +4192,7 @@ bool CWallet::MintsToInputVector(std::map<CBigNum, CZerocoinMint>& mapMintsSelec
     libzerocoin::ZerocoinParams* paramsAccumulator = Params().Zerocoin_Params(false);
     AccumulatorMap mapAccumulators(paramsAccumulator);
     int64_t nTimeStart = GetTimeMicros();
+    CWalletDB walletdbPrecompute("precomputes.dat", "cr+");
 
     int nLockAttempts = 0;
     while (nLockAttempts < 100) {
@@ -3906,12 +4210,26 @@ bool CWallet::MintsToInputVector(std::map<CBigNum, CZerocoinMint>& mapMintsSelec
             CoinWitnessData *coinWitness = zwgrTracker->GetSpendCache(meta.hashStake);
 
             if (!coinWitness->nHeightAccEnd) {
-                *coinWitness = CoinWitnessData(mint);
-                coinWitness->SetHeightMintAdded(mint.GetHeight());
+                // Resume from the witness saved by the precompute thread, if any
+                CoinWitnessCacheData cacheData;
+                if (meta.hashStake != 0 && walletdbPrecompute.ReadPrecompute(meta.hashStake, cacheData)) {
+                    *coinWitness = CoinWitnessData(cacheData);
+                } else {
+                    *coinWitness = CoinWitnessData(mint);
+                    coinWitness->SetHeightMintAdded(mint.GetHeight());
+                }
             }
 
             // Generate the witness for each mint being spent
-            if (!GenerateAccumulatorWitness(coinWitness, mapAccumulators, pindexCheckpoint)) {
+            bool fCachedWitness = coinWitness->nHeightAccEnd != 0;
+            bool fWitness = GenerateAccumulatorWitness(coinWitness, mapAccumulators, pindexCheckpoint);
+            if (!fWitness && fCachedWitness) {
+                // The cached range may have been reorganized away, start over from the mint
+                *coinWitness = CoinWitnessData(mint);
+                coinWitness->SetHeightMintAdded(mint.GetHeight());
+                fWitness = GenerateAccumulatorWitness(coinWitness, mapAccumulators, pindexCheckpoint);
+            }
+            if (!fWitness) {
                 receipt.SetStatus(_("Couldn't generate the accumulator witness"),
                                   ZWGR_FAILED_ACCUMULATOR_INITIALIZATION);
                 return error("%s : %s", __func__, receipt.GetStatusMessage());
@@ -4751,27 +5069,131 @@ void ThreadPrecomputeSpends()
     LogPrintf("ThreadPrecomputeSpends exiting,\n");
 }
 
+void CWalletNotifier::Notify()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        ++nNotifications;
+    }
+    cond.notify_all();
+}
+
+uint64_t CWalletNotifier::GetCount()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return nNotifications;
+}
+
+bool CWalletNotifier::Wait(uint64_t& nSeen, int64_t nMillis)
+{
+    const boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds(nMillis);
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (nNotifications == nSeen && cond.timed_wait(lock, deadline)) {}
+    const bool fNotified = nNotifications != nSeen;
+    nSeen = nNotifications;
+    return fNotified;
+}
+
+CPrecomputeCache::CPrecomputeCache(const std::string& strFile) : walletdb(strFile, "cr+"), nLastFlush(GetTime())
+{
+}
+
+CPrecomputeCache::~CPrecomputeCache()
+{
+    Flush();
+}
+
+void CPrecomputeCache::Load()
+{
+    walletdb.LoadPrecomputes(listItems, mapItems);
+    LogPrint("precompute", "%s: Loaded precomputes from database. Size of lru cache: %d\n", __func__, mapItems.size());
+}
+
+bool CPrecomputeCache::Get(const uint256& hash, CoinWitnessCacheData& data) const
+{
+    auto it = mapItems.find(hash);
+    if (it == mapItems.end())
+        return false;
+    data = it->second->second;
+    return true;
+}
+
+void CPrecomputeCache::Put(const uint256& hash, const CoinWitnessCacheData& data)
+{
+    auto it = mapItems.find(hash);
+    if (it != mapItems.end()) {
+        listItems.splice(listItems.begin(), listItems, it->second);
+        listItems.begin()->second = data;
+    } else {
+        listItems.push_front(std::make_pair(hash, data));
+        mapItems.insert(std::make_pair(hash, listItems.begin()));
+    }
+    setDirty.insert(hash);
+
+    while (mapItems.size() > PRECOMPUTE_LRU_CACHE_SIZE)
+        Remove(listItems.back().first);
+}
+
+void CPrecomputeCache::Remove(const uint256& hash)
+{
+    auto it = mapItems.find(hash);
+    if (it != mapItems.end()) {
+        listItems.erase(it->second);
+        mapItems.erase(it);
+    }
+    setDirty.erase(hash);
+    walletdb.ErasePrecompute(hash);
+}
+
+void CPrecomputeCache::RemoveInactive(const std::set<uint256>& setActive)
+{
+    for (auto it = listItems.begin(); it != listItems.end();) {
+        uint256 hash = (it++)->first;
+        if (!setActive.count(hash))
+            Remove(hash);
+    }
+}
+
+void CPrecomputeCache::Clear()
+{
+    listItems.clear();
+    mapItems.clear();
+    setDirty.clear();
+}
+
+bool CPrecomputeCache::NeedsFlush() const
+{
+    return setDirty.size() > PRECOMPUTE_MAX_DIRTY_CACHE_SIZE || nLastFlush < GetTime() - PRECOMPUTE_FLUSH_TIME;
+}
+
+void CPrecomputeCache::Flush()
+{
+    for (const uint256& hash : setDirty) {
+        auto it = mapItems.find(hash);
+        if (it != mapItems.end())
+            walletdb.WritePrecompute(hash, it->second->second);
+    }
+    LogPrint("precompute", "%s: Wrote %d precomputes to database. Precomputes size: %d\n", __func__, setDirty.size(), mapItems.size());
+    setDirty.clear();
+    nLastFlush = GetTime();
+}
+
+std::vector<uint256> CPrecomputeCache::GetHashes() const
+{
+    std::vector<uint256> vHashes;
+    for (const auto& item : listItems)
+        vHashes.push_back(item.first);
+    return vHashes;
+}
+
 void CWallet::PrecomputeSpends()
 {
-    // We don't even need to worry about this code.. no zWGR.
-    /*
     LogPrintf("Precomputer started\n");
     RenameThread("wagerr-precomputer");
 
-    CWalletDB walletdb("precomputes.dat", "cr+");
-
-    // Create LRU Cache
-    std::list<std::pair<uint256, CoinWitnessCacheData> > item_list;
-    std::map<uint256, std::list<std::pair<uint256, CoinWitnessCacheData> >::iterator> item_map;
+    // Flushed when the thread exits, including on interruption
+    CPrecomputeCache cache;
 
-    // Dirty cache that needs to be written to disk
-    std::map<uint256, CoinWitnessCacheData> mapDirtyWitnessData;
-
-    // Initialize Variables
-    bool fLoadedPrecomputesFromDB = false;
-    bool fOnFirstLoad = true;
-    int64_t nLastCacheCleanUpTime = GetTime();
-    int64_t nLastCacheWriteDB = nLastCacheCleanUpTime;
     int nRequiredStakeDepthBuffer = Params().Zerocoin_RequiredStakeDepth() + 10;
     int nAdjustableCacheLength = GetArg("-precomputecachelength", DEFAULT_PRECOMPUTE_LENGTH);
 
@@ -4785,142 +5207,120 @@ void CWallet::PrecomputeSpends()
     if (nAdjustableCacheLength > MAX_PRECOMPUTE_LENGTH)
         nAdjustableCacheLength = MAX_PRECOMPUTE_LENGTH;
 
+    cache.Load();
+
+    // Witnesses only move in checkpoint steps of 10 blocks, so once every
+    // mint is caught up there is nothing to do until the tip moves by 10.
+    bool fCaughtUp = false;
+    bool fFullRound = true;
+    int nLastTipHeight = 0;
+    uint64_t nTipNotifications = blockTipNotifier.GetCount();
+
     while (true) {
+        if (cache.NeedsFlush() || ShutdownRequested())
+            cache.Flush();
+
+        if (ShutdownRequested())
+            break;
+
+        if (fCaughtUp || IsLocked()) {
+            // Sleep until a block is connected. An unlocked wallet or a cleared cache is noticed within a minute.
+            blockTipNotifier.Wait(nTipNotifications, 60 * 1000);
+        } else if (!fFullRound) {
+            // Let the spend that cut the round short take the spend cache
+            MilliSleep(1000);
+        }
+
         // Check to see if we need to clear the cache
         if (fClearSpendCache) {
             fClearSpendCache = false;
-            item_map.clear();
-            item_list.clear();
-            mapDirtyWitnessData.clear();
-            nLastCacheCleanUpTime = GetTime();
-            nLastCacheWriteDB = nLastCacheCleanUpTime;
+            cache.Clear();
+            fCaughtUp = false;
         }
 
-        // Get the list of zWGR inputs
-        std::list <std::unique_ptr<CStakeInput>> listInputs;
-        if (!SelectStakeCoins(listInputs, 0, true)) {
-            MilliSleep(5000);
-            continue;
+        CBlockIndex* pindexTip;
+        {
+            LOCK(cs_main);
+            pindexTip = chainActive.Tip();
         }
-
-        if (listInputs.empty()) {
-            MilliSleep(5000);
+        if (!pindexTip)
+            continue;
+        int nTipHeight = pindexTip->nHeight;
+        if (IsLocked() || (fCaughtUp && nTipHeight < nLastTipHeight + 10))
             continue;
-        }
-
-        if (ShutdownRequested())
-            break;
-
-        while (IsLocked())
-            MilliSleep(5000);
 
-        // If we haven't loaded from database yet, load the precomputes from the database
-        if (!fLoadedPrecomputesFromDB) {
-            // Load the precomputes into the LRU cache
-            walletdb.LoadPrecomputes(item_list, item_map);
-            fLoadedPrecomputesFromDB = true;
-            LogPrint("precompute", "%s: Loaded precomputes from database. Size of lru cache: %d\n", __func__,
-                     item_map.size());
+        std::set<CMintMeta> setMints;
+        {
+            LOCK2(cs_main, cs_wallet);
+            setMints = zwgrTracker->ListMints(true, true, false);
         }
+        std::set<uint256> setActive;
+        fFullRound = true;
+        fCaughtUp = true;
 
-        // Do some precomputing of zerocoin spend knowledge proofs
-        std::set <uint256> setInputHashes;
-        for (std::unique_ptr <CStakeInput>& stakeInput : listInputs) {
-            if (ShutdownRequested() || IsLocked())
+        for (CMintMeta meta : setMints) {
+            if (ShutdownRequested() || IsLocked() || fClearSpendCache) {
+                fFullRound = false;
                 break;
+            }
 
-            CoinWitnessCacheData tempDataHolder;
+            // The tracker and the wallet are read under their locks, which are not taken under cs_spendcache
+            CZerocoinMint mint;
+            bool fHaveMint = false;
+            {
+                LOCK2(cs_main, cs_wallet);
+                if (meta.hashStake == 0) {
+                    if (!GetMint(meta.hashSerial, mint))
+                        continue;
+                    fHaveMint = true;
+                    uint256 hashStake = mint.GetSerialNumber().getuint256();
+                    meta.hashStake = Hash(hashStake.begin(), hashStake.end());
+                    zwgrTracker->UpdateState(meta);
+                }
+
+                // A witness that is not in the LRU cache may have to start from the mint
+                if (!fHaveMint && !cache.Contains(meta.hashStake))
+                    fHaveMint = GetMintFromStakeHash(meta.hashStake, mint);
+            }
+            const uint256& hashStake = meta.hashStake;
+            setActive.insert(hashStake);
 
             {
                 TRY_LOCK(zwgrTracker->cs_spendcache, fLocked);
-                if (!fLocked)
-                    continue;
 
-                if (fGlobalUnlockSpendCache) {
+                // A spend holds or is waiting for the lock
+                if (!fLocked || fGlobalUnlockSpendCache) {
+                    fFullRound = false;
+                    fCaughtUp = false;
                     break;
                 }
 
-                // When we see a clear spend cache bool set to true, break out of the loop
-                // All cache data will be cleared at the beginning of the while loop above
-                if (fClearSpendCache) {
-                    break;
-                }
-
-                uint256 serialHash = stakeInput->GetSerialHash();
-                setInputHashes.insert(serialHash);
-                CoinWitnessData* witnessData = zwgrTracker->GetSpendCache(serialHash);
-
-                // Initialize nHeightStop so it can be set below
-                int nHeightStop = 0;
-
-                if (witnessData->nHeightAccStart) { // Witness is already valid
-                    nHeightStop = std::min(chainActive.Height() - nRequiredStakeDepthBuffer,
-                                           (witnessData->nHeightAccEnd ? witnessData->nHeightAccEnd
-                                                                       : witnessData->nHeightAccStart) +
-                                           nAdjustableCacheLength);
-                } else if (item_map.count(serialHash)) { // Check Database cache
-                    // Get the witness data from the cache
-                    auto it = item_map.find(serialHash);
-                    item_list.splice(item_list.begin(), item_list, it->second);
-
-                    *witnessData = CoinWitnessData(it->second->second);
-
-                    // Set the stop height from the variables received from the database cache
-                    nHeightStop = std::min(chainActive.Height() - nRequiredStakeDepthBuffer,
-                                           (witnessData->nHeightAccEnd ? witnessData->nHeightAccEnd
-                                                                       : witnessData->nHeightAccStart) +
-                                           nAdjustableCacheLength);
-
-                    LogPrint("precompute", "%s: Got Witness Data from lru cache: %s\n", __func__,
-                             witnessData->ToString());
-                } else if (mapDirtyWitnessData.count(serialHash) || walletdb.ReadPrecompute(serialHash, tempDataHolder)) {
-                    if (mapDirtyWitnessData.count(serialHash)) {
-                        // Get the witness data from the dirty cache if it exists
-                        *witnessData = CoinWitnessData(mapDirtyWitnessData.at(serialHash));
-                        LogPrint("precompute", "%s: Got Witness Data from mapDirtyWitnessData: %s\n", __func__,
-                                 witnessData->ToString());
+                // Resume from the in-memory witness, then the database, then the mint itself
+                CoinWitnessData* witnessData = zwgrTracker->GetSpendCache(hashStake);
+                if (!witnessData->nHeightAccEnd) {
+                    CoinWitnessCacheData cacheData;
+                    if (cache.Get(hashStake, cacheData)) {
+                        *witnessData = CoinWitnessData(cacheData);
+                        LogPrint("precompute", "%s: Got Witness Data from lru cache: %s\n", __func__, witnessData->ToString());
                     } else {
-                        // Get the witness data from the database
-                        *witnessData = CoinWitnessData(tempDataHolder);
-                        LogPrint("precompute", "%s: Got Witness Data from precompute database: %s\n", __func__,
-                                 witnessData->ToString());
-                    }
-
-                    // Set the stop height from the variables received from the database cache
-                    nHeightStop = std::min(chainActive.Height() - nRequiredStakeDepthBuffer,
-                                           (witnessData->nHeightAccEnd ? witnessData->nHeightAccEnd
-                                                                       : witnessData->nHeightAccStart) +
-                                           nAdjustableCacheLength);
-
-                    // Add the serialHash found into the cache
-                    item_list.push_front(std::make_pair(serialHash, tempDataHolder));
-                    item_map.insert(std::make_pair(serialHash, item_list.begin()));
-
-                    // We just added a new hash into our LRU cache, so remove it if we also have it in the dirty map
-                    mapDirtyWitnessData.erase(serialHash);
-
-                    if (item_map.size() > PRECOMPUTE_LRU_CACHE_SIZE) {
-                        auto last_it = item_list.end(); last_it --;
-                        item_map.erase(last_it->first);
-                        CoinWitnessCacheData removedData = item_list.back().second;
-                        mapDirtyWitnessData[serialHash] = removedData;
-                        item_list.pop_back();
+                        if (!fHaveMint)
+                            continue;
+                        *witnessData = CoinWitnessData(mint);
+                        witnessData->SetHeightMintAdded(mint.GetHeight());
                     }
-                } else { // This has no cache, so initialize it
-                    CZerocoinMint mint;
-                    if (!GetMintFromStakeHash(serialHash, mint))
-                        continue;
-                    *witnessData = CoinWitnessData(mint);
-                    nHeightStop = std::min(chainActive.Height() - nRequiredStakeDepthBuffer,
-                                           mint.GetHeight() + nAdjustableCacheLength);
                 }
 
-                if (nHeightStop - (witnessData->nHeightAccEnd ? witnessData->nHeightAccEnd : witnessData->nHeightAccStart) < 20)
+                int nHeightAccumulated = witnessData->nHeightAccEnd ? witnessData->nHeightAccEnd : witnessData->nHeightAccStart;
+                int nHeightStop = std::min(nTipHeight - nRequiredStakeDepthBuffer, nHeightAccumulated + nAdjustableCacheLength);
+                if (nHeightStop - nHeightAccumulated < 20)
                     continue;
+                if (nHeightStop < nTipHeight - nRequiredStakeDepthBuffer)
+                    fCaughtUp = false;
 
-                CBlockIndex* pindexStop = chainActive[nHeightStop];
+                // The ancestor of the tip taken at the start of the round, as cs_main is not held here
+                CBlockIndex* pindexStop = pindexTip->GetAncestor(nHeightStop);
                 AccumulatorMap mapAccumulators(Params().Zerocoin_Params(false));
-                LogPrint("precompute","%s: caching mint %s of denom %d start=%d stop=%d end=%s\n", __func__,
+                LogPrint("precompute", "%s: caching mint %s of denom %d start=%d stop=%d end=%d\n", __func__,
                           witnessData->coin->getValue().GetHex().substr(0, 6),
                           ZerocoinDenominationToInt(witnessData->denom),
                           witnessData->nHeightAccStart, nHeightStop, witnessData->nHeightAccEnd);
@@ -4928,41 +5328,13 @@ void CWallet::PrecomputeSpends()
                 if (!GenerateAccumulatorWitness(witnessData, mapAccumulators, pindexStop)) {
                     LogPrintf("%s: Generate witness failed!\n", __func__);
 
-                    // If we fail this check, we need to make sure we remove this from the LRU cache
-                    auto it = item_map.find(serialHash);
-                    if (it != item_map.end())
-                    {
-                        item_list.erase(it->second);
-                        item_map.erase(it);
-                    }
-                    mapDirtyWitnessData.erase(serialHash);
-                    walletdb.ErasePrecompute(serialHash);
+                    // Start over from the mint next round, the cached range may be on a reorganized chain
+                    *witnessData = CoinWitnessData();
+                    cache.Remove(hashStake);
                     continue;
                 }
 
-
-                CoinWitnessCacheData serialData(witnessData);
-
-                // If the LRU cache already has a entry for it, update the entry and move it to the front of the list
-                auto it = item_map.find(serialHash);
-                if (it != item_map.end()) {
-                    item_list.splice(item_list.begin(), item_list, it->second);
-                    item_list.begin()->second = serialData;
-                } else {
-                    item_list.push_front(std::make_pair(serialHash, serialData));
-                    item_map.insert(std::make_pair(serialHash, item_list.begin()));
-                }
-
-                // We just added a new hash into our LRU cache, so remove it if we also have it in the dirty map
-                mapDirtyWitnessData.erase(serialHash);
-
-                // Clean up the LRU cache to the max size
-                while (item_map.size() > PRECOMPUTE_LRU_CACHE_SIZE) {
-                    auto last_it = item_list.end(); last_it --;
-                    item_map.erase(last_it->first);
-                    mapDirtyWitnessData[serialHash] = item_list.back().second;
-                    item_list.pop_back();
-                }
+                cache.Put(hashStake, CoinWitnessCacheData(witnessData));
             }
             // Sleep for 150ms to allow any potential spend attempt
             MilliSleep(150);
@@ -4972,63 +5344,16 @@ void CWallet::PrecomputeSpends()
             fGlobalUnlockSpendCache = false;
         }
 
-        // On first load, and every 5 minutes clean up our cache with only valid unspent inputs
-        if (fOnFirstLoad || nLastCacheCleanUpTime < GetTime() - PRECOMPUTE_FLUSH_TIME) {
-            LogPrint("precompute", "%s: Cleaning up precompute cache\n", __func__);
-
-            // We only want to clear the cache if we have calculated new witness data
-            if (setInputHashes.size()) {
-                // Get a list of hashes currently in the database
-                std::set <uint256> databaseHashes;
-                walletdb.LoadPrecomputes(databaseHashes);
-
-                // Remove old cache data
-                for (auto inputHash : setInputHashes) {
-                    databaseHashes.erase(inputHash);
-                }
-
-                // Erase all old hashes from the database
-                for (auto hash : databaseHashes) {
-                    auto it = item_map.find(hash);
-                    if (it != item_map.end())
-                    {
-                        item_list.erase(it->second);
-                        item_map.erase(it);
-                    }
-                    mapDirtyWitnessData.erase(hash);
-                    walletdb.ErasePrecompute(hash);
-                }
-
-                nLastCacheCleanUpTime = GetTime();
-            }
-        }
-
-        // On first load, and every 5 minutes write the cache to database
-        if (mapDirtyWitnessData.size() > PRECOMPUTE_MAX_DIRTY_CACHE_SIZE || nLastCacheWriteDB < GetTime() - PRECOMPUTE_FLUSH_TIME || ShutdownRequested()) {
-            // Save all cache data that was dirty back into the database
-            for (auto item : mapDirtyWitnessData) {
-                walletdb.WritePrecompute(item.first, item.second);
-            }
-            mapDirtyWitnessData.clear();
-
-            // Save the LRU cache data into the database
-            for (auto item : item_list) {
-                walletdb.WritePrecompute(item.first, item.second);
-            }
-
-            LogPrint("precompute", "%s: Writing precomputes to database. Precomputes size: %d\n", __func__, item_map.size());
-            nLastCacheWriteDB = GetTime();
+        if (!fFullRound) {
+            fCaughtUp = false;
+            continue;
         }
 
-        fOnFirstLoad = false;
-
-        if (ShutdownRequested())
-            break;
+        cache.RemoveInactive(setActive);
 
+        nLastTipHeight = nTipHeight;
         LogPrint("precompute", "%s: Finished precompute round...\n\n", __func__);
-        MilliSleep(5000);
-
-    }*/
+    }
 }
 
 bool CWallet::FillCoinStake(const CKeyStore& keystore, CMutableTransaction& txNew, CAmount &nFee, std::vector<CTxOut> voutPayouts, std::unique_ptr<CStakeInput>& stakeInput)
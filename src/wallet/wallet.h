@@ -37,6 +37,9 @@
 #include <utility>
 #include <vector>
 
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
 /**
  * Settings
  */
@@ -163,6 +166,68 @@ public:
     StringMap destdata;
 };
 
+/**
+ * Wakes the threads that sleep until something happens to the wallet, such as
+ * a block being connected. Each waiter keeps the count of notifications it has
+ * seen, so one notification wakes all of them.
+ */
+class CWalletNotifier
+{
+private:
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    uint64_t nNotifications;
+
+public:
+    CWalletNotifier() : nNotifications(0) {}
+
+    void Notify();
+    uint64_t GetCount();
+    /** Sleep until a notification after nSeen or for nMillis, and return whether one came in. This is an interruption point. */
+    bool Wait(uint64_t& nSeen, int64_t nMillis);
+};
+
+typedef std::list<std::pair<uint256, CoinWitnessCacheData> > PrecomputeList;
+typedef std::map<uint256, PrecomputeList::iterator> PrecomputeMap;
+
+/**
+ * LRU cache of the zWGR witnesses advanced by the precompute thread, most
+ * recently advanced first. It bounds both the memory used and the number of
+ * entries in its database. The entries advanced since the last flush are
+ * written when it is flushed or destroyed, so an interrupted thread keeps them.
+ */
+class CPrecomputeCache
+{
+private:
+    CWalletDB walletdb;
+    PrecomputeList listItems;
+    PrecomputeMap mapItems;
+    //! Witnesses advanced since the database was last written
+    std::set<uint256> setDirty;
+    int64_t nLastFlush;
+
+public:
+    CPrecomputeCache(const std::string& strFile = "precomputes.dat");
+    ~CPrecomputeCache();
+
+    void Load();
+    bool Contains(const uint256& hash) const { return mapItems.count(hash) > 0; }
+    bool Get(const uint256& hash, CoinWitnessCacheData& data) const;
+    /** Store an advanced witness as the most recent one, dropping the least recent ones over PRECOMPUTE_LRU_CACHE_SIZE */
+    void Put(const uint256& hash, const CoinWitnessCacheData& data);
+    void Remove(const uint256& hash);
+    /** Drop the witnesses of mints that were spent or archived */
+    void RemoveInactive(const std::set<uint256>& setActive);
+    /** Forget the witnesses in memory, the database keeps them */
+    void Clear();
+    bool NeedsFlush() const;
+    void Flush();
+    size_t Size() const { return mapItems.size(); }
+    size_t DirtySize() const { return setDirty.size(); }
+    /** The hashes of the witnesses, most recently advanced first */
+    std::vector<uint256> GetHashes() const;
+};
+
 /**
  * A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
  * and provides the ability to create new transactions.
@@ -196,6 +261,60 @@ private:
 
     void SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator>);
 
+    /**
+     * The wallet transactions that have an output of ours that is not spent in a
+     * block, which AvailableCoins() and GetBalances() look through instead of the
+     * whole of mapWallet. Both still check IsSpent() per output. Transactions
+     * are added and dropped as they and their spends are added to the wallet. The set
+     * is rebuilt when an output may have stopped being spent or started being ours,
+     * which is when a block is disconnected or keys or scripts are added.
+     */
+    mutable std::set<uint256> setUnspentTxs;
+    mutable bool fUnspentTxsDirty;
+    /** Whether an output is spent by a wallet transaction in a block, which is what drops it from setUnspentTxs. */
+    bool IsSpentInMainChain(const uint256& hash, unsigned int n) const;
+    /** Add a transaction to setUnspentTxs or drop it from it. Requires cs_wallet. */
+    void UpdateUnspentTx(const uint256& wtxid) const;
+    /** Rebuild setUnspentTxs if it is marked dirty. Requires cs_wallet. */
+    void SyncUnspentTxs() const;
+    void MarkUnspentTxsDirty();
+
+    /** The transparent balances of the wallet, summed up together in one pass. */
+    struct CWalletBalances {
+        CAmount nBalance;
+        CAmount nUnconfirmed;
+        CAmount nImmature;
+        CAmount nLocked;
+        CAmount nUnlocked;
+        CAmount nWatchOnly;
+        CAmount nUnconfirmedWatchOnly;
+        CAmount nImmatureWatchOnly;
+        CAmount nLockedWatchOnly;
+    };
+
+    /**
+     * The balances are kept until the chain tip, the mempool, the completed
+     * SwiftX locks or the wallet itself change. nBalancesGeneration is bumped
+     * on every wallet change that can move a balance: a transaction marked
+     * dirty, setUnspentTxs rebuilt or a coin locked or unlocked.
+     *
+     * This is a memoized rescan, not an incremental total: any of those
+     * changes sums every transaction in setUnspentTxs again. The depth of
+     * every transaction moves with the tip, and with it whether its credit is
+     * unconfirmed, immature or available, so a new block would have to
+     * reclassify them all anyway. What the cache saves is the repeated sums
+     * between changes, and the walk over spent transactions in mapWallet.
+     */
+    mutable CWalletBalances cachedBalances;
+    mutable bool fBalancesCached;
+    mutable uint256 hashBalancesTip;
+    mutable unsigned int nBalancesMempoolUpdated;
+    mutable int nBalancesTXLocks;
+    mutable unsigned int nBalancesCachedGeneration;
+    mutable unsigned int nBalancesGeneration;
+    /** Return the balances, summing them over setUnspentTxs when the cache is stale. Requires cs_main and cs_wallet. */
+    const CWalletBalances& GetBalances() const;
+
 public:
     bool MintableCoins();
     bool SelectStakeCoins(std::list<std::unique_ptr<CStakeInput> >& listInputs, CAmount nTargetAmount, int blockHeight, bool fPrecompute = false);
@@ -309,6 +428,9 @@ public:
         nNextResend = 0;
         nLastResend = 0;
         nTimeFirstKey = 0;
+        fUnspentTxsDirty = true;
+        fBalancesCached = false;
+        nBalancesGeneration = 0;
         fWalletUnlockAnonymizeOnly = false;
         fBackupMints = false;
 
@@ -387,6 +509,10 @@ public:
     const CWalletTx* GetWalletTx(const uint256& hash) const;
 
     void PrecomputeSpends();
+    //! Notified when a block is connected, to wake the precompute thread
+    CWalletNotifier blockTipNotifier;
+    //! Notified on a new tip or a transaction of ours, to wake the stake minter
+    CWalletNotifier stakeNotifier;
 
     //! check whether we are allowed to upgrade (or already support) to the named feature
     bool CanSupportFeature(enum WalletFeature wf)
@@ -472,8 +598,11 @@ public:
     int64_t IncOrderPosNext(CWalletDB* pwalletdb = NULL);
 
     void MarkDirty();
+    /** Drop the cached balances, because a wallet transaction or coin lock changed. */
+    void MarkBalancesDirty() const { ++nBalancesGeneration; }
     bool AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet = false);
     void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
+    void UpdatedBlockTip(const CBlockIndex* pindex);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate);
     void EraseFromWallet(const uint256& hash);
     int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
@@ -962,6 +1091,8 @@ public:
         fImmatureWatchCreditCached = false;
         fDebitCached = false;
         fChangeCached = false;
+        if (pwallet)
+            pwallet->MarkBalancesDirty();
     }
 
     void BindWallet(CWallet* pwalletIn)
@@ -1219,4 +1350,7 @@ private:
 
 void ThreadPrecomputeSpends();
 
+/** Worker thread reading blocks for ScanForWalletTransactions. */
+void ThreadWalletScan();
+
 #endif // BITCOIN_WALLET_H
@@ -1417,7 +1417,7 @@ void CWalletDB::LoadPrecomputes(std::list<std::pair<uint256, CoinWitnessCacheDat
     pcursor->close();
 }
 
-void CWalletDB::LoadPrecomputes(std::set<uint256> setHashes)
+void CWalletDB::LoadPrecomputes(std::set<uint256>& setHashes)
 {
     Dbc* pcursor = GetCursor();
     if (!pcursor)
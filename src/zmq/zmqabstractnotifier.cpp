@@ -25,3 +25,18 @@ bool CZMQAbstractNotifier::NotifyTransactionLock(const CTransaction &/*transacti
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyBetEvent(const CPeerlessEvent &/*event*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyBetResult(const CPeerlessResult &/*result*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyBetOdds(const CPeerlessEvent &/*event*/)
+{
+    return true;
+}
@@ -8,6 +8,8 @@
 #include "zmqconfig.h"
 
 class CBlockIndex;
+class CPeerlessEvent;
+class CPeerlessResult;
 class CZMQAbstractNotifier;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
@@ -35,6 +37,9 @@ public:
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
     virtual bool NotifyTransactionLock(const CTransaction &transaction);
+    virtual bool NotifyBetEvent(const CPeerlessEvent &event);
+    virtual bool NotifyBetResult(const CPeerlessResult &result);
+    virtual bool NotifyBetOdds(const CPeerlessEvent &event);
 
 protected:
     void *psocket;
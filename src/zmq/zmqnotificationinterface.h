@@ -27,6 +27,9 @@ protected:
     void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
     void UpdatedBlockTip(const CBlockIndex *pindex);
     void NotifyTransactionLock(const CTransaction &tx);
+    void NotifyBetEvent(const CPeerlessEvent &event);
+    void NotifyBetResult(const CPeerlessResult &result);
+    void NotifyBetOdds(const CPeerlessEvent &event);
 
 private:
     CZMQNotificationInterface();
@@ -4,6 +4,7 @@
 
 #include "chainparams.h"
 #include "zmqpublishnotifier.h"
+#include "betting/bet.h"
 #include "main.h"
 #include "util.h"
 #include "crypto/common.h"
@@ -16,6 +17,9 @@ static const char *MSG_HASHTXLOCK = "hashtxlock";
 static const char *MSG_RAWBLOCK   = "rawblock";
 static const char *MSG_RAWTX      = "rawtx";
 static const char *MSG_RAWTXLOCK = "rawtxlock";
+static const char *MSG_BETEVENT   = "betevent";
+static const char *MSG_BETRESULT  = "betresult";
+static const char *MSG_BETODDS    = "betodds";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -212,3 +216,27 @@ bool CZMQPublishRawTransactionLockNotifier::NotifyTransactionLock(const CTransac
     ss << transaction;
     return SendMessage(MSG_RAWTXLOCK, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishBetEventNotifier::NotifyBetEvent(const CPeerlessEvent &event)
+{
+    LogPrint("zmq", "zmq: Publish betevent %u\n", event.nEventId);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << event;
+    return SendMessage(MSG_BETEVENT, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishBetResultNotifier::NotifyBetResult(const CPeerlessResult &result)
+{
+    LogPrint("zmq", "zmq: Publish betresult %u\n", result.nEventId);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << result;
+    return SendMessage(MSG_BETRESULT, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishBetOddsNotifier::NotifyBetOdds(const CPeerlessEvent &event)
+{
+    LogPrint("zmq", "zmq: Publish betodds %u\n", event.nEventId);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << event;
+    return SendMessage(MSG_BETODDS, &(*ss.begin()), ss.size());
+}
@@ -64,4 +64,22 @@ public:
     bool NotifyTransactionLock(const CTransaction &transaction);
 };
 
+class CZMQPublishBetEventNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBetEvent(const CPeerlessEvent &event);
+};
+
+class CZMQPublishBetResultNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBetResult(const CPeerlessResult &result);
+};
+
+class CZMQPublishBetOddsNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBetOdds(const CPeerlessEvent &event);
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
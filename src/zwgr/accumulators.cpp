@@ -278,23 +278,26 @@ bool CalculateAccumulatorCheckpoint(int nHeight, uint256& nCheckpoint, Accumulat
             continue;
         }
 
-        //grab mints from this block
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex))
-            return error("%s: failed to read block from disk", __func__);
-
-        std::list<libzerocoin::PublicCoin> listPubcoins;
-        if (!BlockToPubcoinList(block, listPubcoins, fFilterInvalid))
-            return error("%s: failed to get zerocoin mintlist from block %d", __func__, pindex->nHeight);
-
-        nTotalMintsFound += listPubcoins.size();
-        LogPrint("zero", "%s found %d mints\n", __func__, listPubcoins.size());
+        //grab mints from the pubcoin index of this block
+        int nMintsFound = 0;
+        for (auto denom : libzerocoin::zerocoinDenomList) {
+            std::vector<CBigNum> vValues;
+            try {
+                vValues = GetPubcoinValuesFromBlock(pindex, denom, fFilterInvalid);
+            } catch (GetPubcoinException& e) {
+                return error("%s: %s", __func__, e.message);
+            }
 
-        //add the pubcoins to accumulator
-        for (const libzerocoin::PublicCoin& pubcoin : listPubcoins) {
-            if(!mapAccumulators.Accumulate(pubcoin, true))
-                return error("%s: failed to add pubcoin to accumulator at height %d", __func__, pindex->nHeight);
+            //add the pubcoins to accumulator
+            for (const CBigNum& bnValue : vValues) {
+                if(!mapAccumulators.Accumulate(libzerocoin::PublicCoin(Params().Zerocoin_Params(false), bnValue, denom), true))
+                    return error("%s: failed to add pubcoin to accumulator at height %d", __func__, pindex->nHeight);
+            }
+            nMintsFound += vValues.size();
         }
+
+        nTotalMintsFound += nMintsFound;
+        LogPrint("zero", "%s found %d mints\n", __func__, nMintsFound);
         pindex = chainActive.Next(pindex);
     }
 
@@ -369,27 +372,69 @@ std::list<libzerocoin::PublicCoin> GetPubcoinFromBlock(const CBlockIndex* pindex
     return listPubcoins;
 }
 
+std::vector<CBigNum> GetPubcoinValuesFromBlock(const CBlockIndex* pindex, const libzerocoin::CoinDenomination denom, bool fFilterInvalid)
+{
+    CBlockPubcoins blockPubcoins;
+    uint256 hashBlock;
+    if (zerocoinDB->ReadBlockPubcoinsHash(pindex->nHeight, hashBlock) && hashBlock == pindex->GetBlockHash()) {
+        //a missing entry or one left behind by a disconnected block means no mints of this denomination
+        if (!zerocoinDB->ReadBlockPubcoins(pindex->nHeight, denom, blockPubcoins) || blockPubcoins.hashBlock != hashBlock)
+            blockPubcoins.SetNull();
+    } else {
+        //blocks connected before the index existed are indexed on first use
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex))
+            throw GetPubcoinException("GetPubcoinValuesFromBlock: failed to read block from disk while indexing pubcoins");
+        std::map<libzerocoin::CoinDenomination, CBlockPubcoins> mapPubcoins;
+        if (!BlockToPubcoinIndex(block, mapPubcoins))
+            throw GetPubcoinException("GetPubcoinValuesFromBlock: failed to index zerocoin mints of block "+std::to_string(pindex->nHeight)+"\n");
+        if (chainActive.Contains(pindex) && !zerocoinDB->WriteBlockPubcoins(pindex->nHeight, pindex->GetBlockHash(), mapPubcoins))
+            LogPrintf("%s: failed to write pubcoin index for block %d\n", __func__, pindex->nHeight);
+        if (mapPubcoins.count(denom))
+            blockPubcoins = mapPubcoins.at(denom);
+    }
+
+    std::vector<CBigNum> vValues;
+    for (const auto& pubcoin : blockPubcoins.vPubcoins) {
+        if (fFilterInvalid && !pubcoin.second)
+            continue;
+        vValues.emplace_back(pubcoin.first);
+    }
+    return vValues;
+}
+
 
 
-int AddBlockMintsToAccumulator(const libzerocoin::CoinDenomination den, const CBloomFilter filter, const CBlockIndex* pindex,
-                               libzerocoin::Accumulator* accumulator, bool isWitness, std::list<CBigNum>& notAddedCoins)
+int AddBlockMintsToAccumulator(const libzerocoin::CoinDenomination den, const std::vector<CBloomFilter>& vFilters, const CBlockIndex* pindex,
+                               libzerocoin::Accumulator* accumulator, std::vector<std::list<CBigNum> >& vNotAddedCoins,
+                               std::vector<std::list<CBigNum> >& vOtherCoins)
 {
     // if this block contains mints of the denomination that is being spent, then add them to the witness
     int nMintsAdded = 0;
     if (pindex->MintedDenomination(den)) {
+        std::vector<bool> vMatches(vFilters.size());
         //add the mints to the witness
-        for (const libzerocoin::PublicCoin& pubcoin : GetPubcoinFromBlock(pindex)) {
-            if (pubcoin.getDenomination() != den) {
-                continue;
+        for (const CBigNum& bnValue : GetPubcoinValuesFromBlock(pindex, den, true)) {
+            bool fMatched = false;
+            for (unsigned int i = 0; i < vFilters.size(); i++) {
+                vMatches[i] = vFilters[i].contains(bnValue.getvch());
+                fMatched |= vMatches[i];
             }
 
-            if (isWitness && filter.contains(pubcoin.getValue().getvch())) {
-                notAddedCoins.emplace_back(pubcoin.getValue());
+            // A mint in none of the filters goes in every witness
+            if (!fMatched) {
+                accumulator->increment(bnValue);
+                ++nMintsAdded;
                 continue;
             }
 
-            accumulator->increment(pubcoin.getValue());
-            ++nMintsAdded;
+            // Otherwise it is returned to the filters it matches and added to the other witnesses later
+            for (unsigned int i = 0; i < vFilters.size(); i++) {
+                if (vMatches[i])
+                    vNotAddedCoins[i].emplace_back(bnValue);
+                else
+                    vOtherCoins[i].emplace_back(bnValue);
+            }
         }
     }
 
@@ -403,14 +448,11 @@ int AddBlockMintsToAccumulator(const libzerocoin::PublicCoin& coin, const int nH
     int nMintsAdded = 0;
     if (pindex->MintedDenomination(coin.getDenomination())) {
         //add the mints to the witness
-        for (const libzerocoin::PublicCoin& pubcoin : GetPubcoinFromBlock(pindex)) {
-            if (pubcoin.getDenomination() != coin.getDenomination())
-                continue;
-
-            if (isWitness && pindex->nHeight == nHeightMintAdded && pubcoin.getValue() == coin.getValue())
+        for (const CBigNum& bnValue : GetPubcoinValuesFromBlock(pindex, coin.getDenomination(), true)) {
+            if (isWitness && pindex->nHeight == nHeightMintAdded && bnValue == coin.getValue())
                 continue;
 
-            accumulator->increment(pubcoin.getValue());
+            accumulator->increment(bnValue);
             ++nMintsAdded;
         }
     }
@@ -607,13 +649,15 @@ bool calculateAccumulatedBlocksFor(
         CBigNum &bnAccValue,
         libzerocoin::Accumulator &accumulator,
         libzerocoin::CoinDenomination den,
-        CBloomFilter filter,
+        const std::vector<CBloomFilter>& vFilters,
         libzerocoin::Accumulator &witnessAccumulator,
-        std::list<CBigNum>& ret,
+        int& nMintsAdded,
+        std::vector<std::list<CBigNum> >& vRet,
+        std::vector<std::list<CBigNum> >& vOtherCoins,
         std::string& strError
 ){
     bool fDoubleCounted = false;
-    int nMintsAdded = 0;
+    nMintsAdded = 0;
     while (pindex) {
 
         if (pindex->nHeight >= nHeightStop) {
@@ -631,7 +675,7 @@ bool calculateAccumulatedBlocksFor(
             break;
         }
 
-        nMintsAdded += AddBlockMintsToAccumulator(den, filter, pindex, &witnessAccumulator, true, ret);
+        nMintsAdded += AddBlockMintsToAccumulator(den, vFilters, pindex, &witnessAccumulator, vRet, vOtherCoins);
 
         // 10 blocks were accumulated twice when zWGR v2 was activated
         if (pindex->nHeight == 1050010 && !fDoubleCounted) {
@@ -643,13 +687,6 @@ bool calculateAccumulatedBlocksFor(
         pindex = chainActive.Next(pindex);
     }
 
-    // A certain amount of accumulated coins are required
-    if (nMintsAdded < Params().Zerocoin_RequiredAccumulation()) {
-        strError = _(strprintf("Less than %d mints added, unable to create spend",
-                               Params().Zerocoin_RequiredAccumulation()).c_str());
-        throw NotEnoughMintsException(strError);
-    }
-
     LogPrintf("calculateAccumulatedBlocksFor() : nMintsAdded %d",nMintsAdded);
 
     return true;
@@ -715,28 +752,23 @@ bool calculateAccumulatedBlocksFor(
 }
 
 
-bool CalculateAccumulatorWitnessFor(
+bool CalculateAccumulatorWitnessesFor(
         const libzerocoin::ZerocoinParams* params,
         int startHeight,
         int maxCalulationRange,
         libzerocoin::CoinDenomination den,
-        const CBloomFilter& filter,
+        const std::vector<CBloomFilter>& vFilters,
         libzerocoin::Accumulator& accumulator,
-        libzerocoin::AccumulatorWitness& witness,
-        int& nMintsAdded,
+        std::vector<CBigNum>& vWitnessValues,
+        std::vector<int>& vMintsAdded,
         std::string& strError,
-        std::list<CBigNum>& ret,
+        std::vector<std::list<CBigNum> >& vRet,
         int &heightStop
 ){
     // Lock
     if (!LockMethod()) return false;
 
     try {
-        // Dummy coin init
-        libzerocoin::PublicCoin temp(params, 0, den);
-        // Dummy Acc init
-        libzerocoin::Accumulator testingAcc(params, den);
-
         //get the checkpoint added at the next multiple of 10
         int nHeightCheckpoint = startHeight + (10 - (startHeight % 10));
 
@@ -745,7 +777,6 @@ bool CalculateAccumulatorWitnessFor(
         CBigNum bnAccValue = 0;
         if (GetAccumulatorValue(nHeightCheckpoint, den, bnAccValue)) {
             accumulator.setValue(bnAccValue);
-            witness.resetValue(accumulator, temp);
         }
 
         // Add the pubcoins from the blockchain up to the next checksum starting from the block
@@ -761,11 +792,13 @@ bool CalculateAccumulatorWitnessFor(
         }
         heightStop = nHeightStop;
 
-        nMintsAdded = 0;
-
         // Starts on top of the witness that the node sent
-        libzerocoin::Accumulator witnessAccumulator(params, den, witness.getValue());
+        libzerocoin::Accumulator witnessAccumulator(params, den, accumulator.getValue());
 
+        // The mints that match none of the filters are accumulated once for all of them
+        int nSharedMintsAdded = 0;
+        vRet.assign(vFilters.size(), std::list<CBigNum>());
+        std::vector<std::list<CBigNum> > vOtherCoins(vFilters.size());
         if(!calculateAccumulatedBlocksFor(
                 startHeight,
                 nHeightStop,
@@ -773,19 +806,26 @@ bool CalculateAccumulatorWitnessFor(
                 bnAccValue,
                 accumulator,
                 den,
-                filter,
+                vFilters,
                 witnessAccumulator,
-                ret,
+                nSharedMintsAdded,
+                vRet,
+                vOtherCoins,
                 strError
         ))
-            return error("CalculateAccumulatorWitnessFor(): Calculate accumulated coins failed");
-
-        // reset the value
-        witness.resetValue(witnessAccumulator, temp);
-
-        // calculate how many mints of this denomination existed in the accumulator we initialized
-        nMintsAdded += ComputeAccumulatedCoins(startHeight, den);
-        LogPrint("zero", "%s : %d mints added to witness\n", __func__, nMintsAdded);
+            return error("CalculateAccumulatorWitnessesFor(): Calculate accumulated coins failed");
+
+        // Each witness adds the mints that only other filters matched
+        vWitnessValues.resize(vFilters.size());
+        vMintsAdded.resize(vFilters.size());
+        for (unsigned int i = 0; i < vFilters.size(); i++) {
+            libzerocoin::Accumulator filterAccumulator(params, den, witnessAccumulator.getValue());
+            for (const CBigNum& bnValue : vOtherCoins[i])
+                filterAccumulator.increment(bnValue);
+            vWitnessValues[i] = filterAccumulator.getValue();
+            vMintsAdded[i] = nSharedMintsAdded + vOtherCoins[i].size();
+        }
+        LogPrint("zero", "%s : %d mints added to %d witnesses\n", __func__, nSharedMintsAdded, vFilters.size());
 
         return true;
 
@@ -20,21 +20,25 @@ class CBlockIndex;
 std::map<libzerocoin::CoinDenomination, int> GetMintMaturityHeight();
 
 /**
- * Calculate the acc witness for a single coin.
- * @return true if the witness was calculated well
+ * Calculate the acc witnesses for light node requests that share a denomination, a
+ * starting height and a starting accumulator. The blocks are read and the mints that
+ * match none of the filters are accumulated once; each witness then only adds the
+ * mints that other filters of the batch matched. The mints a filter matches are
+ * returned to it instead of being added.
+ * @return true if the witnesses were calculated well
  */
 
-bool CalculateAccumulatorWitnessFor(
+bool CalculateAccumulatorWitnessesFor(
         const libzerocoin::ZerocoinParams* params,
         int startingHeight,
         int maxCalculationRange,
         libzerocoin::CoinDenomination den,
-        const CBloomFilter& filter,
+        const std::vector<CBloomFilter>& vFilters,
         libzerocoin::Accumulator& accumulator,
-        libzerocoin::AccumulatorWitness& witness,
-        int& nMintsAdded,
+        std::vector<CBigNum>& vWitnessValues,
+        std::vector<int>& vMintsAdded,
         std::string& strError,
-        std::list<CBigNum>& ret,
+        std::vector<std::list<CBigNum> >& vRet,
         int &heightStop
 );
 
@@ -49,6 +53,7 @@ bool GenerateAccumulatorWitness(
 
 bool GenerateAccumulatorWitness(CoinWitnessData* coinWitness, AccumulatorMap& mapAccumulators, CBlockIndex* pindexCheckpoint);
 std::list<libzerocoin::PublicCoin> GetPubcoinFromBlock(const CBlockIndex* pindex);
+std::vector<CBigNum> GetPubcoinValuesFromBlock(const CBlockIndex* pindex, const libzerocoin::CoinDenomination denom, bool fFilterInvalid);
 bool GetAccumulatorValueFromDB(uint256 nCheckpoint, libzerocoin::CoinDenomination denom, CBigNum& bnAccValue);
 bool GetAccumulatorValue(int& nHeight, const libzerocoin::CoinDenomination denom, CBigNum& bnAccValue);
 bool GetAccumulatorValueFromChecksum(uint32_t nChecksum, bool fMemoryOnly, CBigNum& bnAccValue);
@@ -81,6 +81,46 @@ bool BlockToPubcoinList(const CBlock& block, std::list<libzerocoin::PublicCoin>&
     return true;
 }
 
+//index the mints of a block by denomination, flagging the ones BlockToPubcoinList drops when filtering invalid outpoints
+bool BlockToPubcoinIndex(const CBlock& block, std::map<libzerocoin::CoinDenomination, CBlockPubcoins>& mapPubcoins)
+{
+    uint256 hashBlock = block.GetHash();
+    for (const CTransaction& tx : block.vtx) {
+        if(!tx.HasZerocoinMintOutputs())
+            continue;
+
+        bool fValid = true;
+        for (const CTxIn& in : tx.vin) {
+            if (!ValidOutPoint(in.prevout, INT_MAX)) {
+                fValid = false;
+                break;
+            }
+        }
+
+        uint256 txHash = tx.GetHash();
+        for (unsigned int i = 0; i < tx.vout.size(); i++) {
+            //once an output uses an invalid outpoint the filter skips the rest of the transaction
+            if (fValid && !ValidOutPoint(COutPoint(txHash, i), INT_MAX))
+                fValid = false;
+
+            const CTxOut txOut = tx.vout[i];
+            if(!txOut.IsZerocoinMint())
+                continue;
+
+            CValidationState state;
+            libzerocoin::PublicCoin pubCoin(Params().Zerocoin_Params(false));
+            if(!TxOutToPublicCoin(txOut, pubCoin, state))
+                return false;
+
+            CBlockPubcoins& blockPubcoins = mapPubcoins[pubCoin.getDenomination()];
+            blockPubcoins.hashBlock = hashBlock;
+            blockPubcoins.vPubcoins.emplace_back(pubCoin.getValue(), fValid);
+        }
+    }
+
+    return true;
+}
+
 //return a list of zerocoin mints contained in a specific block
 bool BlockToZerocoinMintList(const CBlock& block, std::list<CZerocoinMint>& vMints, bool fFilterInvalid)
 {
@@ -10,10 +10,12 @@
 #include "libzerocoin/Denominations.h"
 #include "libzerocoin/CoinSpend.h"
 #include <list>
+#include <map>
 #include <string>
 
 class CBlock;
 class CBigNum;
+class CBlockPubcoins;
 struct CMintMeta;
 class CTransaction;
 class CTxIn;
@@ -24,6 +26,7 @@ class uint256;
 
 bool BlockToMintValueVector(const CBlock& block, const libzerocoin::CoinDenomination denom, std::vector<CBigNum>& vValues);
 bool BlockToPubcoinList(const CBlock& block, std::list<libzerocoin::PublicCoin>& listPubcoins, bool fFilterInvalid);
+bool BlockToPubcoinIndex(const CBlock& block, std::map<libzerocoin::CoinDenomination, CBlockPubcoins>& mapPubcoins);
 bool BlockToZerocoinMintList(const CBlock& block, std::list<CZerocoinMint>& vMints, bool fFilterInvalid);
 void FindMints(std::vector<CMintMeta> vMintsToFind, std::vector<CMintMeta>& vMintsToUpdate, std::vector<CMintMeta>& vMissingMints);
 int GetZerocoinStartHeight();
@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The WAGERR Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the ZMQ betting notifications.
+
+Start a node that publishes blocks and the betting topics on separate
+addresses. Blocks that don't change the betting state must be published
+without any betevent, betresult or betodds message."""
+import configparser
+import os
+import struct
+import time
+
+from test_framework.test_framework import BitcoinTestFramework, SkipTest
+from test_framework.util import (assert_equal,
+                                 bytes_to_hex_str,
+                                )
+
+class ZMQSubscriber:
+    def __init__(self, socket, topic):
+        self.sequence = 0
+        self.socket = socket
+        self.topic = topic
+
+        import zmq
+        self.socket.setsockopt(zmq.SUBSCRIBE, self.topic)
+
+    def receive(self):
+        topic, body, seq = self.socket.recv_multipart()
+        # Topic should match the subscriber topic.
+        assert_equal(topic, self.topic)
+        # Sequence should be incremental.
+        assert_equal(struct.unpack('<I', seq)[-1], self.sequence)
+        self.sequence += 1
+        return body
+
+
+class ZMQBettingTest (BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+
+    def setup_nodes(self):
+        # Try to import python3-zmq. Skip this test if the import fails.
+        try:
+            import zmq
+        except ImportError:
+            raise SkipTest("python3-zmq module not available.")
+
+        # Check that wagerrd has been built with ZMQ enabled.
+        config = configparser.ConfigParser()
+        if not self.options.configfile:
+            self.options.configfile = os.path.abspath(os.path.join(os.path.dirname(__file__), "../config.ini"))
+        config.read_file(open(self.options.configfile))
+
+        if not config["components"].getboolean("ENABLE_ZMQ"):
+            raise SkipTest("wagerrd has not been built with zmq enabled.")
+
+        # The blocks and the betting topics are read from separate sockets,
+        # so the test doesn't depend on the order they are published in.
+        block_address = "tcp://127.0.0.1:28332"
+        bet_address = "tcp://127.0.0.1:28333"
+        self.zmq_context = zmq.Context()
+        self.block_socket = self.zmq_context.socket(zmq.SUB)
+        self.block_socket.set(zmq.RCVTIMEO, 60000)
+        self.block_socket.connect(block_address)
+        self.bet_socket = self.zmq_context.socket(zmq.SUB)
+        self.bet_socket.connect(bet_address)
+
+        self.hashblock = ZMQSubscriber(self.block_socket, b"hashblock")
+        self.betevent = ZMQSubscriber(self.bet_socket, b"betevent")
+        self.betresult = ZMQSubscriber(self.bet_socket, b"betresult")
+        self.betodds = ZMQSubscriber(self.bet_socket, b"betodds")
+
+        self.extra_args = [["-zmqpubhashblock=%s" % block_address] +
+                           ["-zmqpub%s=%s" % (sub.topic.decode(), bet_address) for sub in [self.betevent, self.betresult, self.betodds]]]
+        self.add_nodes(self.num_nodes, self.extra_args)
+        self.start_nodes()
+        time.sleep(10)
+
+    def run_test(self):
+        try:
+            self._zmq_test()
+        finally:
+            # Destroy the ZMQ context.
+            self.log.debug("Destroying ZMQ context")
+            self.zmq_context.destroy(linger=None)
+
+    def _zmq_test(self):
+        num_blocks = 5
+        self.log.info("Generate %d blocks without betting transactions" % num_blocks)
+        genhashes = self.nodes[0].generate(num_blocks)
+
+        # Every block is published on the block topic.
+        for x in range(num_blocks):
+            assert_equal(genhashes[x], bytes_to_hex_str(self.hashblock.receive()))
+
+        # The betting notifications are sent while a block is connected,
+        # before its hash is, so by now any of them would have arrived.
+        self.log.info("Check that nothing was published on the betting topics")
+        assert_equal(self.bet_socket.poll(1000), 0)
+
+if __name__ == '__main__':
+    ZMQBettingTest().main()
@@ -91,6 +91,7 @@ BASE_SCRIPTS= [
     # vv Tests less than 30s vv
     'rpc_spork.py',
     #'interface_zmq.py',  # Not Working -- TODO Fix it
+    'interface_zmq_betting.py',
     'interface_bitcoin_cli.py',
     #'mempool_resurrect.py', # Not Working -- TODO Fix it
     #'rpc_getchaintips.py', # Not Working -- TODO Fix it